@@ -0,0 +1,60 @@
+#include "arena.hpp"
+#include "input_replay.hpp"
+#include "presets.hpp"
+
+#include <QImage>
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+namespace battleship {
+namespace {
+
+// Paint an arena with a third of its cells attacked into an offscreen image.
+void BM_ArenaPaint(benchmark::State &state) {
+  GetOffscreenApplication();
+  MapSize size = GetPresetMapSize(static_cast<std::size_t>(state.range(0)));
+  Arena arena(size.x, size.y);
+  arena.SetDisplaying();
+  std::mt19937 random(1);
+  for (std::size_t i = 0; i != size.x * size.y / 3; ++i) {
+    if (random() % 4)
+      arena.AddMiss(random() % size.x, random() % size.y);
+    else
+      arena.AddHit(random() % size.x, random() % size.y);
+  }
+  arena.resize(arena.sizeHint());
+  QImage image(arena.size(), QImage::Format_ARGB32_Premultiplied);
+  for (auto _ : state) {
+    arena.render(&image);
+    benchmark::DoNotOptimize(image.constBits());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Drag ships along every row of a placing arena, from the mouse event to
+// the end of the paint it asks for.
+void BM_ArenaDrag(benchmark::State &state) {
+  GetOffscreenApplication();
+  MapSize size = GetPresetMapSize(static_cast<std::size_t>(state.range(0)));
+  Arena arena(size.x, size.y);
+  arena.SetPlacing();
+  arena.show();
+  QCoreApplication::processEvents();
+  std::vector<FrameTrace::Input> inputs;
+  MakeDragSweep(size, arena.cell_size(), inputs);
+  for (auto _ : state)
+    for (std::size_t i = 0, e = inputs.size(); i != e; ++i)
+      ReplayInput(arena, inputs[i]);
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(inputs.size()));
+}
+
+BENCHMARK(BM_ArenaPaint)->ArgName("size")->DenseRange(0, kNumPresets - 1);
+BENCHMARK(BM_ArenaDrag)->ArgName("size")->DenseRange(0, kNumPresets - 1);
+
+}  // namespace
+}  // namespace battleship
+
+BENCHMARK_MAIN();
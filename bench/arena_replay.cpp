@@ -0,0 +1,160 @@
+#include "arena.hpp"
+#include "frame_trace.hpp"
+#include "input_replay.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace battleship {
+namespace {
+
+struct Options {
+  MapSize size;
+  int cell_size;
+  bool attack;
+  // The track whose events are replayed, or all of them if negative.
+  long track;
+  std::size_t repeat;
+  // Where to write the Chrome trace, empty to write none.
+  std::string trace;
+  // The events to replay, a drag along every row if empty.
+  std::string inputs;
+};
+
+// Parse "WxH".
+bool ParseSize(char const *text, MapSize &size) {
+  char *end;
+  size.x = std::strtoul(text, &end, 10);
+  if (*end != 'x') return false;
+  size.y = std::strtoul(end + 1, &end, 10);
+  return *end == '\0' && size.x != 0 && size.y != 0;
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: battleship_arena_replay [options] [INPUTS]\n"
+               "  --size WxH       arena size (default 26x26)\n"
+               "  --cell-size N    cell size in pixels (default 30)\n"
+               "  --attack         replay into an attacking arena, not a\n"
+               "                   placing one\n"
+               "  --track N        replay only the events of one arena\n"
+               "  --repeat N       replay the events N times (default 10)\n"
+               "  --trace FILE     write the frames as a Chrome trace\n"
+               "INPUTS are mouse events saved by the game along with a "
+               "trace,\n"
+               "replayed back to back into an offscreen arena. Without "
+               "them a\n"
+               "ship is dragged along every row.\n");
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+  options.size = GetPresetMapSize(3);
+  options.cell_size = 30;
+  options.attack = false;
+  options.track = -1;
+  options.repeat = 10;
+
+  for (int i = 1; i < argc; ++i) {
+    char const *arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(arg, "--size") == 0 && has_value) {
+      if (!ParseSize(argv[++i], options.size)) return false;
+    } else if (std::strcmp(arg, "--cell-size") == 0 && has_value) {
+      options.cell_size = std::atoi(argv[++i]);
+    } else if (std::strcmp(arg, "--attack") == 0) {
+      options.attack = true;
+    } else if (std::strcmp(arg, "--track") == 0 && has_value) {
+      options.track = std::atol(argv[++i]);
+    } else if (std::strcmp(arg, "--repeat") == 0 && has_value) {
+      options.repeat = std::strtoul(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--trace") == 0 && has_value) {
+      options.trace = argv[++i];
+    } else if (arg[0] != '-' && options.inputs.empty()) {
+      options.inputs = arg;
+    } else {
+      return false;
+    }
+  }
+  return options.cell_size > 0;
+}
+
+// Print the quantiles of a histogram of nanoseconds in milliseconds.
+void PrintQuantiles(char const *name, LatencyHistogram const &histogram) {
+  std::printf("%s: median %.3f ms, 90%% %.3f ms, 99%% %.3f ms, max %.3f ms\n",
+              name, histogram.ValueAt(0.5) / 1e6,
+              histogram.ValueAt(0.9) / 1e6, histogram.ValueAt(0.99) / 1e6,
+              histogram.max() / 1e6);
+}
+
+}  // namespace
+}  // namespace battleship
+
+int main(int argc, char *argv[]) {
+  using namespace battleship;
+
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+
+  std::vector<FrameTrace::Input> inputs;
+  if (options.inputs.empty()) {
+    MakeDragSweep(options.size, options.cell_size, inputs);
+  } else {
+    std::vector<FrameTrace::Input> all;
+    if (!ReadInputs(options.inputs.c_str(), all)) {
+      std::fprintf(stderr, "cannot read %s\n", options.inputs.c_str());
+      return 1;
+    }
+    for (std::size_t i = 0, e = all.size(); i != e; ++i)
+      if (options.track < 0 ||
+          all[i].track == static_cast<std::size_t>(options.track))
+        inputs.push_back(all[i]);
+  }
+
+  GetOffscreenApplication();
+  Arena arena(options.size.x, options.size.y);
+  arena.SetCellSize(options.cell_size);
+  if (options.attack)
+    arena.SetAttacking();
+  else
+    arena.SetPlacing();
+  arena.show();
+  QCoreApplication::processEvents();
+
+  // Trace only the replay, not the first paint.
+  FrameTrace trace;
+  arena.SetTrace(&trace, 0);
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (std::size_t r = 0; r != options.repeat; ++r)
+    for (std::size_t i = 0, e = inputs.size(); i != e; ++i)
+      ReplayInput(arena, inputs[i]);
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  arena.SetTrace(0, 0);
+
+  if (!options.trace.empty() &&
+      !trace.WriteChromeTrace(options.trace.c_str())) {
+    std::fprintf(stderr, "cannot write %s\n", options.trace.c_str());
+    return 1;
+  }
+
+  LatencyHistogram latencies;
+  LatencyHistogram paints;
+  trace.GetLatencies(latencies, paints);
+  std::printf("events: %zu, frames: %llu\n",
+              inputs.size() * options.repeat,
+              static_cast<unsigned long long>(latencies.count()));
+  PrintQuantiles("input to paint", latencies);
+  PrintQuantiles("paint", paints);
+  std::fprintf(stderr, "%.2f s, %.0f events/s\n", seconds,
+               static_cast<double>(inputs.size() * options.repeat) / seconds);
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include "batch_board.hpp"
+#include "board.hpp"
+#include "fleet_generator.hpp"
+#include "presets.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace battleship {
+namespace {
+
+// Fleets and attack orders generated ahead of the timed loops.
+std::size_t const kFleets = 256;
+std::size_t const kOrders = 61;
+std::size_t const kBatchOrders = 8;
+
+// Random fleets and orders to attack every cell in, for the preset of a
+// benchmark, so that the games measure only the boards.
+struct Games {
+  MapSize size;
+  std::size_t fleet_size;
+  std::vector<Ship> ships;
+  std::vector<std::uint32_t> orders;
+  // The orders of kBatchOrders batches, lane minor: cell k of lane i of
+  // batch b at (b * width * height + k) * kLanes + i.
+  std::vector<std::uint32_t> batch_orders;
+
+  explicit Games(benchmark::State const &state) {
+    std::size_t preset = static_cast<std::size_t>(state.range(0));
+    size = GetPresetMapSize(preset);
+    FleetGenerator generator(1);
+    generator.Init(size, GetPresetShipSet(preset));
+    fleet_size = generator.fleet_size();
+    ships.resize(kFleets * fleet_size);
+    generator.Generate(&ships[0], kFleets);
+
+    std::size_t cells = size.x * size.y;
+    std::vector<std::uint32_t> shuffled(cells);
+    for (std::size_t i = 0; i != cells; ++i)
+      shuffled[i] = static_cast<std::uint32_t>(i);
+    std::mt19937 random(1);
+    for (std::size_t i = 0; i != kOrders; ++i) {
+      std::shuffle(shuffled.begin(), shuffled.end(), random);
+      orders.insert(orders.end(), shuffled.begin(), shuffled.end());
+    }
+
+    std::size_t const lanes = BatchBoard::kLanes;
+    batch_orders.resize(kBatchOrders * cells * lanes);
+    for (std::size_t b = 0; b != kBatchOrders; ++b)
+      for (std::size_t i = 0; i != lanes; ++i)
+        for (std::size_t k = 0; k != cells; ++k)
+          batch_orders[(b * cells + k) * lanes + i] = order(b * lanes + i)[k];
+  }
+
+  Ship const *fleet(std::size_t i) const {
+    return &ships[i % kFleets * fleet_size];
+  }
+
+  std::uint32_t const *order(std::size_t i) const {
+    return &orders[i % kOrders * size.x * size.y];
+  }
+
+  std::uint32_t const *batch_order(std::size_t b) const {
+    std::size_t cells = size.x * size.y * BatchBoard::kLanes;
+    return &batch_orders[b % kBatchOrders * cells];
+  }
+};
+
+// Play games one at a time on a Board, attacking in a random order until
+// the fleet is sunk.
+void BM_SingleGames(benchmark::State &state) {
+  Games games(state);
+  Board board;
+  std::size_t round = 0;
+  std::size_t attacks = 0;
+  for (auto _ : state) {
+    board.Init(games.size.x, games.size.y);
+    Ship const *fleet = games.fleet(round);
+    for (std::size_t i = 0; i != games.fleet_size; ++i) board.Place(fleet[i]);
+    std::uint32_t const *order = games.order(round);
+    ++round;
+    for (std::size_t sunk = 0; sunk != games.fleet_size; ++attacks) {
+      std::uint32_t cell = *order++;
+      Board::AttackResult result =
+          board.Attack(cell % games.size.x, cell / games.size.x);
+      if (result.type == Board::kSunk) ++sunk;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["attacks"] = benchmark::Counter(
+      static_cast<double>(attacks), benchmark::Counter::kAvgIterations);
+}
+
+// Play games kLanes at a time on a BatchBoard with a kernel, until every
+// lane has sunk its fleet. The attacks come lane minor, as a batch of
+// attackers would write them.
+void BM_BatchGames(benchmark::State &state) {
+  Games games(state);
+  BatchBoard board;
+  if (!board.UseKernel(static_cast<BatchBoard::Kernel>(state.range(1)))) {
+    state.SkipWithError("kernel not supported");
+    return;
+  }
+  board.Init(games.size, games.fleet_size);
+  std::size_t const lanes = BatchBoard::kLanes;
+  std::size_t round = 0;
+  std::size_t batch = 0;
+  for (auto _ : state) {
+    board.Clear();
+    for (std::size_t lane = 0; lane != lanes; ++lane, ++round) {
+      Ship const *fleet = games.fleet(round);
+      for (std::size_t i = 0; i != games.fleet_size; ++i)
+        board.Place(lane, fleet[i]);
+    }
+    std::uint32_t const *cells = games.batch_order(batch++);
+    for (BatchBoard::LaneMask active = BatchBoard::kAllLanes; active != 0;
+         cells += lanes)
+      active &= ~board.Attack(cells, active).finished;
+  }
+  state.SetItemsProcessed(state.iterations() * lanes);
+}
+
+BENCHMARK(BM_SingleGames)->ArgName("size")->DenseRange(0, kNumPresets - 1);
+BENCHMARK(BM_BatchGames)
+    ->ArgNames({"size", "kernel"})
+    ->ArgsProduct({{0, 1, 2, 3},
+                   {BatchBoard::kScalarKernel, BatchBoard::kAvx2Kernel,
+                    BatchBoard::kAvx512Kernel}});
+
+}  // namespace
+}  // namespace battleship
@@ -0,0 +1,158 @@
+#include "board.hpp"
+#include "board_snapshot.hpp"
+#include "fleet_generator.hpp"
+#include "legacy_board.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace battleship {
+namespace {
+
+// The 2,3,3,4,5 fleet on a 10x10 board, laid out so that every ship can be
+// placed.
+Ship const kFleet[] = {{Ship::kHorizontal, 0, 0, 2},
+                       {Ship::kVertical, 9, 1, 3},
+                       {Ship::kHorizontal, 3, 4, 3},
+                       {Ship::kVertical, 1, 5, 4},
+                       {Ship::kHorizontal, 4, 9, 5}};
+std::size_t const kFleetSize = sizeof(kFleet) / sizeof(kFleet[0]);
+std::size_t const kSize = 10;
+
+// Place the fleet, then attack every cell of the board.
+template <typename BoardType>
+void BM_PlaceAndAttack(benchmark::State &state) {
+  BoardType board(kSize, kSize);
+  for (auto _ : state) {
+    board.Init(kSize, kSize);
+    for (std::size_t i = 0; i != kFleetSize; ++i)
+      benchmark::DoNotOptimize(board.Place(kFleet[i]));
+    for (std::size_t y = 0; y != kSize; ++y)
+      for (std::size_t x = 0; x != kSize; ++x)
+        benchmark::DoNotOptimize(board.Attack(x, y));
+  }
+  state.SetItemsProcessed(state.iterations() * kSize * kSize);
+}
+
+// Place the fleet, then attack every cell in salvos of one shot per ship,
+// the same attacks as BM_PlaceAndAttack.
+void BM_PlaceAndSalvo(benchmark::State &state) {
+  std::vector<Cell> cells;
+  for (std::size_t y = 0; y != kSize; ++y) {
+    for (std::size_t x = 0; x != kSize; ++x) {
+      Cell cell = {x, y};
+      cells.push_back(cell);
+    }
+  }
+  std::vector<Board::AttackResult> results(cells.size());
+  Board board(kSize, kSize);
+  for (auto _ : state) {
+    board.Init(kSize, kSize);
+    for (std::size_t i = 0; i != kFleetSize; ++i)
+      benchmark::DoNotOptimize(board.Place(kFleet[i]));
+    for (std::size_t i = 0, e = cells.size(); i != e; i += kFleetSize)
+      board.AttackMany(&cells[i], std::min(kFleetSize, e - i), &results[i]);
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kSize * kSize);
+}
+
+// Try to place a ship that only overlaps the fleet on its last cell.
+template <typename BoardType>
+void BM_PlaceOverlap(benchmark::State &state) {
+  BoardType board(kSize, kSize);
+  for (std::size_t i = 0; i != kFleetSize; ++i) board.Place(kFleet[i]);
+  Ship ship = {Ship::kVertical, 1, 2, 4};
+  for (auto _ : state) benchmark::DoNotOptimize(board.Place(ship));
+}
+
+// Place a fleet on a huge, mostly empty board and fire a few thousand shots.
+// The board stays sparse, so Init costs nothing per cell.
+void BM_HugeBoard(benchmark::State &state) {
+  std::size_t const kHugeSize = 10000;
+  std::size_t const kShots = 4096;
+  std::vector<std::size_t> lengths(static_cast<std::size_t>(state.range(0)));
+  for (std::size_t i = 0, e = lengths.size(); i != e; ++i)
+    lengths[i] = 2 + i % 4;
+  MapSize size = {kHugeSize, kHugeSize};
+  ShipSet set = {&lengths[0], &lengths[0] + lengths.size()};
+  FleetGenerator generator(1);
+  generator.Init(size, set);
+  std::vector<Ship> fleet(generator.fleet_size());
+  generator.Generate(&fleet[0]);
+  std::mt19937 random(1);
+  std::vector<Cell> shots(kShots);
+  for (std::size_t i = 0; i != kShots; ++i) {
+    shots[i].x = random() % kHugeSize;
+    shots[i].y = random() % kHugeSize;
+  }
+
+  Board board;
+  for (auto _ : state) {
+    board.Init(kHugeSize, kHugeSize);
+    for (std::size_t i = 0, e = fleet.size(); i != e; ++i)
+      benchmark::DoNotOptimize(board.Place(fleet[i]));
+    for (std::size_t i = 0; i != kShots; ++i)
+      benchmark::DoNotOptimize(board.Attack(shots[i].x, shots[i].y));
+  }
+  if (!board.sparse()) state.SkipWithError("the board went dense");
+  state.SetItemsProcessed(state.iterations() * (fleet.size() + kShots));
+}
+
+// Return the fleet placed and every other cell attacked, a game half played.
+Board MidGame() {
+  Board board(kSize, kSize);
+  for (std::size_t i = 0; i != kFleetSize; ++i) board.Place(kFleet[i]);
+  for (std::size_t y = 0; y != kSize; ++y)
+    for (std::size_t x = y % 2; x < kSize; x += 2) board.Attack(x, y);
+  return board;
+}
+
+// Branch on every cell of a game in progress the way a search would, by
+// copying the board and attacking the copy.
+void BM_BranchBoardCopy(benchmark::State &state) {
+  Board board = MidGame();
+  for (auto _ : state) {
+    for (std::size_t y = 0; y != kSize; ++y) {
+      for (std::size_t x = 0; x != kSize; ++x) {
+        Board child(board);
+        benchmark::DoNotOptimize(child.Attack(x, y));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSize * kSize);
+}
+
+// Branch on every cell of the same game by attacking its snapshot, which
+// shares all but the attacked leaf with its children.
+void BM_BranchSnapshot(benchmark::State &state) {
+  BoardSnapshot snapshot = MidGame().Snapshot();
+  Board::AttackResult result;
+  for (auto _ : state) {
+    for (std::size_t y = 0; y != kSize; ++y) {
+      for (std::size_t x = 0; x != kSize; ++x) {
+        BoardSnapshot child = snapshot.Attack(x, y, result);
+        benchmark::DoNotOptimize(child);
+        benchmark::DoNotOptimize(result);
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSize * kSize);
+}
+
+BENCHMARK_TEMPLATE(BM_PlaceAndAttack, LegacyBoard);
+BENCHMARK_TEMPLATE(BM_PlaceAndAttack, Board);
+BENCHMARK(BM_PlaceAndSalvo);
+BENCHMARK_TEMPLATE(BM_PlaceOverlap, LegacyBoard);
+BENCHMARK_TEMPLATE(BM_PlaceOverlap, Board);
+BENCHMARK(BM_HugeBoard)->Arg(100)->Arg(1000);
+BENCHMARK(BM_BranchBoardCopy);
+BENCHMARK(BM_BranchSnapshot);
+
+}  // namespace
+}  // namespace battleship
+
+BENCHMARK_MAIN();
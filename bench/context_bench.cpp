@@ -0,0 +1,52 @@
+#include "game_context.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace battleship {
+namespace {
+
+// Reset a context and place both fleets. test/game_context_test checks that
+// this does not allocate.
+void BM_ResetGameContext(benchmark::State &state) {
+  MapSize size = GetPresetMapSize(static_cast<std::size_t>(state.range(0)));
+  ShipSet set = GetPresetShipSet(static_cast<std::size_t>(state.range(1)));
+  GameContext context(1);
+  // The first game of a size builds its placement tables.
+  context.Reset(size, set);
+  context.PlaceRandomFleets();
+
+  for (auto _ : state) {
+    context.Reset(size, set);
+    context.PlaceRandomFleets();
+    benchmark::DoNotOptimize(&context);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Set up every game with a new game and generator, for comparison.
+void BM_NewGame(benchmark::State &state) {
+  MapSize size = GetPresetMapSize(static_cast<std::size_t>(state.range(0)));
+  ShipSet set = GetPresetShipSet(static_cast<std::size_t>(state.range(1)));
+  std::vector<Ship> fleet(static_cast<std::size_t>(set.last - set.first));
+  for (auto _ : state) {
+    GameState game;
+    FleetGenerator generator(1);
+    game.Init(size, set);
+    generator.Init(size, set);
+    for (std::size_t i = 0; i != 2; ++i) {
+      generator.Generate(&fleet[0]);
+      for (std::size_t j = 0, e = fleet.size(); j != e; ++j)
+        game.Place(fleet[j]);
+    }
+    benchmark::DoNotOptimize(&game);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ResetGameContext)->Args({1, 1})->Args({3, 3});
+BENCHMARK(BM_NewGame)->Args({1, 1})->Args({3, 3});
+
+}  // namespace
+}  // namespace battleship
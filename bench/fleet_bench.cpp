@@ -0,0 +1,100 @@
+#include "board.hpp"
+#include "fleet_generator.hpp"
+#include "placement_table.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace battleship {
+namespace {
+
+// Generate fleets one at a time for a preset map size and ship set.
+void BM_GenerateFleet(benchmark::State &state) {
+  MapSize size = GetPresetMapSize(static_cast<std::size_t>(state.range(0)));
+  ShipSet set = GetPresetShipSet(static_cast<std::size_t>(state.range(1)));
+  FleetGenerator generator(1);
+  generator.Init(size, set);
+  std::vector<Ship> fleet(generator.fleet_size());
+  for (auto _ : state) {
+    generator.Generate(&fleet[0]);
+    benchmark::DoNotOptimize(&fleet[0]);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Generate a batch of fleets into a caller-provided buffer.
+void BM_GenerateFleetBatch(benchmark::State &state) {
+  std::size_t const kBatch = 1024;
+  FleetGenerator generator(1);
+  generator.Init(GetPresetMapSize(0), GetPresetShipSet(3));
+  std::vector<Ship> fleets(kBatch * generator.fleet_size());
+  for (auto _ : state) {
+    generator.Generate(&fleets[0], kBatch);
+    benchmark::DoNotOptimize(&fleets[0]);
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+}
+
+// Filter the placements of a length against a board with scattered misses.
+void BM_FilterPlacements(benchmark::State &state) {
+  MapSize size = GetPresetMapSize(3);
+  PlacementTable const &table = PlacementTable::Get(
+      size.x, size.y, static_cast<std::size_t>(state.range(0)));
+  std::mt19937 random(1);
+  Bitboard misses;
+  for (std::size_t i = 0; i != size.x * size.y / 8; ++i)
+    misses.Set(random() % size.x, random() % size.y);
+  Bitboard columns = misses.Transposed();
+  std::vector<std::uint32_t> legal(table.size());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table.Filter(misses, columns, &legal[0]));
+    benchmark::DoNotOptimize(&legal[0]);
+  }
+  state.SetItemsProcessed(state.iterations() * table.size());
+}
+
+// Naive placement that retries every overlapping ship, for comparison.
+void BM_RetryFleet(benchmark::State &state) {
+  MapSize size = GetPresetMapSize(static_cast<std::size_t>(state.range(0)));
+  ShipSet set = GetPresetShipSet(static_cast<std::size_t>(state.range(1)));
+  std::mt19937 random(1);
+  Board board;
+  for (auto _ : state) {
+    board.Init(size.x, size.y);
+    for (std::size_t *it = set.last; it != set.first;) {
+      --it;
+      for (;;) {
+        Ship ship;
+        ship.orientation = random() % 2 ? Ship::kHorizontal : Ship::kVertical;
+        ship.length = *it;
+        bool horizontal = ship.orientation == Ship::kHorizontal;
+        ship.x = random() % (size.x - (horizontal ? ship.length - 1 : 0));
+        ship.y = random() % (size.y - (horizontal ? 0 : ship.length - 1));
+        if (board.Place(ship).type == Board::kPlaced) break;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Every preset size with its densest set, and the classic game.
+BENCHMARK(BM_GenerateFleet)
+    ->Args({0, 3})
+    ->Args({1, 1})
+    ->Args({1, 3})
+    ->Args({2, 3})
+    ->Args({3, 3});
+BENCHMARK(BM_GenerateFleetBatch);
+BENCHMARK(BM_FilterPlacements)->Arg(2)->Arg(5);
+BENCHMARK(BM_RetryFleet)
+    ->Args({0, 3})
+    ->Args({1, 1})
+    ->Args({1, 3})
+    ->Args({2, 3})
+    ->Args({3, 3});
+
+}  // namespace
+}  // namespace battleship
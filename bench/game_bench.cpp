@@ -0,0 +1,159 @@
+#include "board.hpp"
+#include "fixed_board.hpp"
+#include "fleet_generator.hpp"
+#include "game_context.hpp"
+#include "presets.hpp"
+#include "random_attacker.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace battleship {
+namespace {
+
+// Fleets generated ahead of the timed loops.
+std::size_t const kFleets = 256;
+
+// Every map size with every ship set of the game selection dialog.
+void AllPresets(benchmark::internal::Benchmark *benchmark) {
+  benchmark->ArgNames({"size", "set"});
+  for (std::size_t size = 0; size != kNumPresets; ++size)
+    for (std::size_t set = 0; set != kNumPresets; ++set)
+      benchmark->Args({static_cast<std::int64_t>(size),
+                       static_cast<std::int64_t>(set)});
+}
+
+// Random fleets for the preset of a benchmark, one after the other.
+struct Fleets {
+  MapSize size;
+  std::size_t fleet_size;
+  std::vector<Ship> ships;
+
+  explicit Fleets(benchmark::State const &state) {
+    size = GetPresetMapSize(static_cast<std::size_t>(state.range(0)));
+    ShipSet set = GetPresetShipSet(static_cast<std::size_t>(state.range(1)));
+    FleetGenerator generator(1);
+    generator.Init(size, set);
+    fleet_size = generator.fleet_size();
+    ships.resize(kFleets * fleet_size);
+    generator.Generate(&ships[0], kFleets);
+  }
+
+  Ship const *fleet(std::size_t i) const {
+    return &ships[i % kFleets * fleet_size];
+  }
+};
+
+// Clear a board and place a fleet on it.
+struct PlaceFleets {
+  benchmark::State &state;
+
+  template <typename BoardType>
+  void operator()(BoardType &board) {
+    Fleets fleets(state);
+    std::size_t round = 0;
+    for (auto _ : state) {
+      board.Init(fleets.size.x, fleets.size.y);
+      Ship const *fleet = fleets.fleet(round++);
+      for (std::size_t i = 0; i != fleets.fleet_size; ++i)
+        benchmark::DoNotOptimize(board.Place(fleet[i]));
+    }
+    state.SetItemsProcessed(state.iterations() * fleets.fleet_size);
+  }
+};
+
+// Attack every cell of a board in a random order. The fleet is placed again
+// before every round, which is small next to the attacks.
+struct AttackCells {
+  benchmark::State &state;
+
+  template <typename BoardType>
+  void operator()(BoardType &board) {
+    Fleets fleets(state);
+    std::vector<Cell> cells;
+    for (std::size_t y = 0; y != fleets.size.y; ++y) {
+      for (std::size_t x = 0; x != fleets.size.x; ++x) {
+        Cell cell = {x, y};
+        cells.push_back(cell);
+      }
+    }
+    std::mt19937 random(1);
+    std::shuffle(cells.begin(), cells.end(), random);
+
+    std::size_t round = 0;
+    for (auto _ : state) {
+      board.Init(fleets.size.x, fleets.size.y);
+      Ship const *fleet = fleets.fleet(round++);
+      for (std::size_t i = 0; i != fleets.fleet_size; ++i)
+        board.Place(fleet[i]);
+      for (std::size_t i = 0, e = cells.size(); i != e; ++i)
+        benchmark::DoNotOptimize(board.Attack(cells[i].x, cells[i].y));
+    }
+    state.SetItemsProcessed(state.iterations() * cells.size());
+  }
+};
+
+// Place fleets on the dynamic Board.
+void BM_BoardPlace(benchmark::State &state) {
+  Board board;
+  PlaceFleets place = {state};
+  place(board);
+}
+
+// Place fleets on the FixedBoard of the map size.
+void BM_FixedBoardPlace(benchmark::State &state) {
+  PlaceFleets place = {state};
+  DispatchBoard(GetPresetMapSize(static_cast<std::size_t>(state.range(0))),
+                place);
+}
+
+// Attack the cells of the dynamic Board.
+void BM_BoardAttack(benchmark::State &state) {
+  Board board;
+  AttackCells attack = {state};
+  attack(board);
+}
+
+// Attack the cells of the FixedBoard of the map size.
+void BM_FixedBoardAttack(benchmark::State &state) {
+  AttackCells attack = {state};
+  DispatchBoard(GetPresetMapSize(static_cast<std::size_t>(state.range(0))),
+                attack);
+}
+
+// Play whole games between two random attackers, fleets included.
+void BM_RandomGame(benchmark::State &state) {
+  MapSize size = GetPresetMapSize(static_cast<std::size_t>(state.range(0)));
+  ShipSet set = GetPresetShipSet(static_cast<std::size_t>(state.range(1)));
+  GameContext context(1);
+  RandomAttacker attackers[2] = {RandomAttacker(2), RandomAttacker(3)};
+  std::size_t attacks = 0;
+  for (auto _ : state) {
+    context.Reset(size, set);
+    context.PlaceRandomFleets();
+    attackers[0].Init(size, set);
+    attackers[1].Init(size, set);
+    GameState &game = context.state();
+    while (game.phase() != GameState::kFinished) {
+      RandomAttacker &attacker = attackers[game.turn()];
+      Cell cell = attacker.NextAttack();
+      attacker.Observe(cell.x, cell.y, game.Attack(cell.x, cell.y));
+      ++attacks;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["attacks"] = benchmark::Counter(
+      static_cast<double>(attacks), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_BoardPlace)->Apply(AllPresets);
+BENCHMARK(BM_FixedBoardPlace)->Apply(AllPresets);
+BENCHMARK(BM_BoardAttack)->Apply(AllPresets);
+BENCHMARK(BM_FixedBoardAttack)->Apply(AllPresets);
+BENCHMARK(BM_RandomGame)->Apply(AllPresets);
+
+}  // namespace
+}  // namespace battleship
@@ -0,0 +1,72 @@
+#include "input_replay.hpp"
+
+#include <QMouseEvent>
+
+namespace battleship {
+
+// Return the application the widgets need, rendering offscreen unless a
+// platform was chosen.
+QApplication &GetOffscreenApplication() {
+  static int argc = 1;
+  static char name[] = "battleship";
+  static char *argv[] = {name, 0};
+  if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  static QApplication application(argc, argv);
+  return application;
+}
+
+// Append the mouse events of dragging a ship along every row of a board
+// from its first cell to its last and back, the placement input that costs
+// the most: every move changes the ship dragged.
+void MakeDragSweep(MapSize size, int cell_size,
+                   std::vector<FrameTrace::Input> &inputs) {
+  int width = static_cast<int>(size.x);
+  int height = static_cast<int>(size.y);
+  std::uint64_t time = 0;
+  for (int row = 0; row != height; ++row) {
+    // The grid is offset by a cell because of the labels.
+    int y = (row + 1) * cell_size + cell_size / 2;
+    int left = cell_size + cell_size / 2;
+    FrameTrace::Input input = {time, 0, FrameTrace::kPress, left, y};
+    inputs.push_back(input);
+    input.type = FrameTrace::kMove;
+    for (int column = 1; column < 2 * width - 1; ++column) {
+      int cell = column < width ? column : 2 * width - 2 - column;
+      input.time = ++time;
+      input.x = (cell + 1) * cell_size + cell_size / 2;
+      inputs.push_back(input);
+    }
+    input.time = ++time;
+    input.type = FrameTrace::kRelease;
+    inputs.push_back(input);
+    ++time;
+  }
+}
+
+// Send a mouse event to a widget and let it paint whatever it asked to.
+// The left button is the only one the arenas use.
+void ReplayInput(QWidget &widget, FrameTrace::Input const &input) {
+  QEvent::Type type = QEvent::MouseMove;
+  Qt::MouseButton button = Qt::NoButton;
+  Qt::MouseButtons buttons = Qt::LeftButton;
+  switch (input.type) {
+    case FrameTrace::kPress:
+      type = QEvent::MouseButtonPress;
+      button = Qt::LeftButton;
+      break;
+    case FrameTrace::kMove:
+      break;
+    case FrameTrace::kRelease:
+      type = QEvent::MouseButtonRelease;
+      button = Qt::LeftButton;
+      buttons = Qt::NoButton;
+      break;
+  }
+  QMouseEvent event(type, QPointF(input.x, input.y), button, buttons,
+                    Qt::NoModifier);
+  QCoreApplication::sendEvent(&widget, &event);
+  QCoreApplication::processEvents();
+}
+
+}  // namespace battleship
@@ -0,0 +1,20 @@
+#ifndef BATTLESHIP_INPUT_REPLAY_H
+#define BATTLESHIP_INPUT_REPLAY_H
+
+#include "frame_trace.hpp"
+#include "presets.hpp"
+
+#include <QApplication>
+#include <QWidget>
+
+#include <vector>
+
+namespace battleship {
+
+QApplication &GetOffscreenApplication();
+void MakeDragSweep(MapSize size, int cell_size,
+                   std::vector<FrameTrace::Input> &inputs);
+void ReplayInput(QWidget &widget, FrameTrace::Input const &input);
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_INPUT_REPLAY_H
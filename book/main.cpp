@@ -0,0 +1,352 @@
+#include "density_attacker.hpp"
+#include "opening_book.hpp"
+#include "posterior_attacker.hpp"
+#include "random_attacker.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace battleship {
+namespace {
+
+struct Options {
+  MapSize size;
+  std::vector<std::size_t> lengths;
+  std::string strategy;
+  std::size_t depth;
+  std::size_t threads;
+  unsigned seed;
+  // The time the posterior strategy gets to choose each attack.
+  std::chrono::milliseconds budget;
+  std::string path;
+};
+
+// States whose attacks are chosen by a worker at a time.
+std::size_t const kChunkSize = 16;
+
+// What was seen of a cell.
+enum CellState { kUnknown, kMissed, kOpenHit, kSunkShip };
+
+// An attack on the way to a state and its result.
+struct Observation {
+  Cell cell;
+  Board::AttackType type;
+  Ship ship;
+};
+
+// A set of observations the strategy can meet, the key of the set, one
+// order in which they can be made and the attack the strategy makes next.
+struct State {
+  std::uint64_t key;
+  std::vector<Observation> path;
+  Cell attack;
+};
+
+// What the observations of a state show: every cell and the ships afloat,
+// shortest first.
+struct View {
+  std::vector<CellState> cells;
+  std::vector<std::size_t> afloat;
+};
+
+// Return a new attacker from its name or null if there is no such strategy.
+Attacker *MakeAttacker(std::string const &name,
+                       std::chrono::milliseconds budget) {
+  if (name == "random") return new RandomAttacker;
+  if (name == "density") return new DensityAttacker;
+  if (name == "posterior") return new PosteriorAttacker(0, budget);
+  return 0;
+}
+
+// Return the result an observation was made of.
+Board::AttackResult ResultOf(Observation const &observation) {
+  Board::AttackResult result = {observation.type, &observation.ship};
+  return result;
+}
+
+// Choose the attack of a state. Every state is played from the same seed,
+// as the book will play it.
+void ChooseAttack(Attacker &attacker, Options const &options, ShipSet set,
+                  State &state) {
+  attacker.Seed(options.seed);
+  attacker.Init(options.size, set);
+  for (std::size_t i = 0, e = state.path.size(); i != e; ++i)
+    attacker.Observe(state.path[i].cell.x, state.path[i].cell.y,
+                     ResultOf(state.path[i]));
+  state.attack = attacker.NextAttack();
+}
+
+// Make out what the observations of a state show.
+void MakeView(Options const &options, State const &state, View &view) {
+  view.cells.assign(options.size.x * options.size.y, kUnknown);
+  view.afloat = options.lengths;
+  std::sort(view.afloat.begin(), view.afloat.end());
+  for (std::size_t i = 0, e = state.path.size(); i != e; ++i) {
+    Observation const &observation = state.path[i];
+    Cell cell = observation.cell;
+    if (observation.type == Board::kMiss)
+      view.cells[cell.y * options.size.x + cell.x] = kMissed;
+    if (observation.type == Board::kHit)
+      view.cells[cell.y * options.size.x + cell.x] = kOpenHit;
+    if (observation.type != Board::kSunk) continue;
+    Ship const &ship = observation.ship;
+    std::size_t dx = ship.orientation == Ship::kHorizontal ? 1 : 0;
+    std::size_t dy = 1 - dx;
+    for (std::size_t j = 0; j != ship.length; ++j)
+      view.cells[(ship.y + j * dy) * options.size.x + ship.x + j * dx] =
+          kSunkShip;
+    view.afloat.erase(
+        std::find(view.afloat.begin(), view.afloat.end(), ship.length));
+  }
+}
+
+// Return the first and last start of a ship of a length along a line of
+// limit cells covering pos, false if it does not fit.
+bool GetStarts(std::size_t pos, std::size_t limit, std::size_t length,
+               std::size_t &first, std::size_t &last) {
+  if (length > limit) return false;
+  first = pos + 1 >= length ? pos + 1 - length : 0;
+  last = std::min(pos, limit - length);
+  return true;
+}
+
+// Collect the results the attack of a state can have: a miss, a hit if a
+// ship afloat fits through the cell without being sunk by it, and a sinking
+// for every ship afloat covering it whose other cells are all open hits.
+// Results that only several ships together rule out are rare this early and
+// are kept, which costs room in the book but never a wrong attack.
+void GetResults(Options const &options, View const &view, Cell cell,
+                std::vector<Observation> &results) {
+  MapSize size = options.size;
+  Observation observation = {cell, Board::kMiss, Ship()};
+  results.assign(1, observation);
+
+  bool hits = false;
+  observation.type = Board::kSunk;
+  for (std::size_t i = 0, e = view.afloat.size(); i != e; ++i) {
+    std::size_t length = view.afloat[i];
+    if (i != 0 && length == view.afloat[i - 1]) continue;
+    for (std::size_t o = 0; o != 2; ++o) {
+      if (o == 1 && length == 1) break;
+      Ship &ship = observation.ship;
+      ship.orientation = o == 0 ? Ship::kHorizontal : Ship::kVertical;
+      ship.length = length;
+      std::size_t dx = 1 - o;
+      std::size_t dy = o;
+      std::size_t first;
+      std::size_t last;
+      if (!GetStarts(o == 0 ? cell.x : cell.y, o == 0 ? size.x : size.y,
+                     length, first, last))
+        continue;
+      for (std::size_t start = first; start <= last; ++start) {
+        ship.x = o == 0 ? start : cell.x;
+        ship.y = o == 0 ? cell.y : start;
+        std::size_t open_hits = 0;
+        bool fits = true;
+        for (std::size_t j = 0; j != length && fits; ++j) {
+          CellState state =
+              view.cells[(ship.y + j * dy) * size.x + ship.x + j * dx];
+          fits = state != kMissed && state != kSunkShip;
+          if (state == kOpenHit) ++open_hits;
+        }
+        if (!fits) continue;
+        if (open_hits + 1 == length)
+          results.push_back(observation);
+        else
+          hits = true;
+      }
+    }
+  }
+
+  if (!hits) return;
+  observation.type = Board::kHit;
+  results.push_back(observation);
+}
+
+// Parse "WxH".
+bool ParseSize(char const *text, MapSize &size) {
+  char *end;
+  size.x = std::strtoul(text, &end, 10);
+  if (*end != 'x') return false;
+  size.y = std::strtoul(end + 1, &end, 10);
+  return *end == '\0' && size.x != 0 && size.y != 0;
+}
+
+// Parse "a,b,c".
+bool ParseLengths(char const *text, std::vector<std::size_t> &lengths) {
+  lengths.clear();
+  for (;;) {
+    char *end;
+    std::size_t length = std::strtoul(text, &end, 10);
+    if (end == text || length == 0) return false;
+    lengths.push_back(length);
+    if (*end == '\0') return true;
+    if (*end != ',') return false;
+    text = end + 1;
+  }
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: battleship_book [options] FILE\n"
+               "  --size WxH       map size (default 10x10)\n"
+               "  --set A,B,...    ship lengths (default 2,3,3,4,5)\n"
+               "  --strategy NAME  random, density or posterior "
+               "(default: posterior)\n"
+               "  --depth N        attacks in the book (default 10)\n"
+               "  --threads N      worker threads (default: all cores)\n"
+               "  --seed N         seed the strategy plays every state with "
+               "(default 1)\n"
+               "  --budget MS      time posterior gets for every attack "
+               "(default 100)\n"
+               "Writes the attack of the strategy for every set of "
+               "observations it can\n"
+               "meet in its first N attacks to FILE, for battleship_sim and "
+               "battleship_engine\n"
+               "--book.\n");
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+  options.size = GetPresetMapSize(1);
+  ShipSet set = GetPresetShipSet(1);
+  options.lengths.assign(set.first, set.last);
+  options.strategy = "posterior";
+  options.depth = 10;
+  options.threads = 0;
+  options.seed = 1;
+  options.budget = std::chrono::milliseconds(100);
+
+  for (int i = 1; i < argc; ++i) {
+    char const *arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(arg, "--size") == 0 && has_value) {
+      if (!ParseSize(argv[++i], options.size)) return false;
+    } else if (std::strcmp(arg, "--set") == 0 && has_value) {
+      if (!ParseLengths(argv[++i], options.lengths)) return false;
+    } else if (std::strcmp(arg, "--strategy") == 0 && has_value) {
+      options.strategy = argv[++i];
+    } else if (std::strcmp(arg, "--depth") == 0 && has_value) {
+      options.depth = std::strtoul(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--threads") == 0 && has_value) {
+      options.threads = std::strtoul(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--seed") == 0 && has_value) {
+      options.seed = static_cast<unsigned>(std::strtoul(argv[++i], 0, 10));
+    } else if (std::strcmp(arg, "--budget") == 0 && has_value) {
+      options.budget =
+          std::chrono::milliseconds(std::strtoul(argv[++i], 0, 10));
+    } else if (arg[0] != '-' && options.path.empty()) {
+      options.path = arg;
+    } else {
+      return false;
+    }
+  }
+  if (options.path.empty() || options.depth == 0) return false;
+
+  // The posterior solver only works on boards that fit a Bitboard, and
+  // every fleet must fit on the board.
+  if (options.strategy == "posterior" &&
+      (options.size.x > Bitboard::kMaxWidth ||
+       options.size.y > Bitboard::kMaxHeight))
+    return false;
+  std::size_t cells = 0;
+  for (std::size_t i = 0, e = options.lengths.size(); i != e; ++i) {
+    if (options.lengths[i] > std::max(options.size.x, options.size.y))
+      return false;
+    cells += options.lengths[i];
+  }
+  return cells <= options.size.x * options.size.y;
+}
+
+}  // namespace
+}  // namespace battleship
+
+int main(int argc, char *argv[]) {
+  using namespace battleship;
+
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+
+  ShipSet set = {&options.lengths[0],
+                 &options.lengths[0] + options.lengths.size()};
+  WorkStealingPool pool(options.threads);
+  std::vector<std::unique_ptr<Attacker> > attackers(pool.threads());
+  for (std::size_t i = 0, e = attackers.size(); i != e; ++i) {
+    attackers[i].reset(MakeAttacker(options.strategy, options.budget));
+    if (!attackers[i]) {
+      std::fprintf(stderr, "unknown strategy: %s\n", options.strategy.c_str());
+      return 1;
+    }
+  }
+
+  // The states are walked a number of attacks at a time, choosing the
+  // attacks of all the states at once, and a set of observations reached in
+  // several orders is only walked once.
+  std::vector<State> states(1);
+  states[0].key = 0;
+  std::vector<State> next;
+  std::unordered_set<std::uint64_t> visited;
+  visited.insert(0);
+  std::vector<BookEntry> entries;
+  View view;
+  std::vector<Observation> results;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (std::size_t depth = 0; depth != options.depth && !states.empty();
+       ++depth) {
+    pool.ParallelFor(
+        states.size(), kChunkSize,
+        [&](std::size_t worker, std::size_t begin, std::size_t end) {
+          for (std::size_t i = begin; i != end; ++i)
+            ChooseAttack(*attackers[worker], options, set, states[i]);
+        });
+    next.clear();
+    for (std::size_t i = 0, e = states.size(); i != e; ++i) {
+      State const &state = states[i];
+      BookEntry entry = {
+          state.key, static_cast<std::uint32_t>(
+                         state.attack.y * options.size.x + state.attack.x)};
+      entries.push_back(entry);
+      if (depth + 1 == options.depth) continue;
+      MakeView(options, state, view);
+      GetResults(options, view, state.attack, results);
+      for (std::size_t j = 0, e2 = results.size(); j != e2; ++j) {
+        Observation const &result = results[j];
+        std::uint64_t key = BookKey(state.key, options.size, result.cell.x,
+                                    result.cell.y, ResultOf(result));
+        if (!visited.insert(key).second) continue;
+        next.push_back(State());
+        next.back().key = key;
+        next.back().path = state.path;
+        next.back().path.push_back(result);
+      }
+    }
+    std::fprintf(stderr, "attack %zu: %zu states\n", depth + 1,
+                 states.size());
+    states.swap(next);
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  if (!WriteOpeningBook(options.path.c_str(), options.size, set,
+                        options.depth, options.strategy, entries)) {
+    std::fprintf(stderr, "cannot write %s\n", options.path.c_str());
+    return 1;
+  }
+  std::printf("states: %zu\n", entries.size());
+  std::fprintf(stderr, "%.2f s, %.0f states/s on %zu threads\n", seconds,
+               static_cast<double>(entries.size()) / seconds, pool.threads());
+  return 0;
+}
@@ -0,0 +1,157 @@
+#include "book_attacker.hpp"
+#include "density_attacker.hpp"
+#include "engine_protocol.hpp"
+#include "fleet_generator.hpp"
+#include "opening_book.hpp"
+#include "posterior_attacker.hpp"
+#include "random_attacker.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace battleship {
+namespace {
+
+struct Options {
+  std::string strategy;
+  unsigned seed;
+  // The opening book of the strategy, empty to play without.
+  std::string book;
+};
+
+// Return a new attacker from its name or null if there is no such strategy.
+Attacker *MakeAttacker(std::string const &name) {
+  if (name == "random") return new RandomAttacker;
+  if (name == "density") return new DensityAttacker;
+  if (name == "posterior") return new PosteriorAttacker;
+  return 0;
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: battleship_engine [options]\n"
+               "  --strategy NAME  random, density or posterior "
+               "(default: density)\n"
+               "  --seed N         seed of the fleets and attacks "
+               "(default: 1)\n"
+               "  --book FILE      play the openings of a battleship_book "
+               "book in the\n"
+               "                   games it was built for\n"
+               "Plays battleship_match games over standard input and "
+               "output\n");
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+  options.strategy = "density";
+  options.seed = 1;
+  for (int i = 1; i < argc; ++i) {
+    char const *arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(arg, "--strategy") == 0 && has_value) {
+      options.strategy = argv[++i];
+    } else if (std::strcmp(arg, "--seed") == 0 && has_value) {
+      options.seed = static_cast<unsigned>(std::strtoul(argv[++i], 0, 10));
+    } else if (std::strcmp(arg, "--book") == 0 && has_value) {
+      options.book = argv[++i];
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace battleship
+
+int main(int argc, char *argv[]) {
+  using namespace battleship;
+
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+  std::unique_ptr<Attacker> attacker(MakeAttacker(options.strategy));
+  if (!attacker) {
+    std::fprintf(stderr, "unknown strategy: %s\n", options.strategy.c_str());
+    return 1;
+  }
+  // Games of other sizes and ship sets are played without the book.
+  OpeningBook book;
+  if (!options.book.empty()) {
+    if (!book.Open(options.book.c_str())) {
+      std::fprintf(stderr, "cannot read %s\n", options.book.c_str());
+      return 1;
+    }
+    if (book.strategy() != options.strategy) {
+      std::fprintf(stderr, "%s is a book of %s\n", options.book.c_str(),
+                   book.strategy().c_str());
+      return 1;
+    }
+    attacker.reset(new BookAttacker(attacker.release(), &book));
+  }
+
+  // Commands are read with iostreams and answers written with stdio, which
+  // need not be kept in step. The runner waits for every answer, so each is
+  // flushed at once.
+  std::ios::sync_with_stdio(false);
+  FleetGenerator generator(options.seed);
+  GameRules rules;
+  std::vector<Ship> fleet;
+  Cell shot = {0, 0};
+  bool playing = false;
+  unsigned game = 0;
+  std::string line;
+  std::vector<std::string> words;
+  while (std::getline(std::cin, line)) {
+    SplitWords(line, words);
+    if (words.empty()) continue;
+    std::string const &command = words[0];
+    if (command == "bsp") {
+      std::printf("id name %s\nbspok\n", options.strategy.c_str());
+      std::fflush(stdout);
+    } else if (command == "newgame" && words.size() == 3) {
+      playing = ParseRules(words[1], words[2], rules);
+      if (!playing) continue;
+      ShipSet set = {&rules.ship_set[0],
+                     &rules.ship_set[0] + rules.ship_set.size()};
+      // Rules whose ships cannot fit the board are not played.
+      playing = generator.Init(rules.size, set);
+      if (!playing) continue;
+      attacker->Seed(options.seed + ++game);
+      attacker->Init(rules.size, set);
+      fleet.resize(generator.fleet_size());
+    } else if (command == "place" && playing) {
+      // A fleet that could not be drawn is sent empty, which forfeits.
+      bool placed = generator.Generate(&fleet[0]);
+      std::string reply = "fleet";
+      for (std::size_t i = 0, e = placed ? fleet.size() : 0; i != e; ++i) {
+        reply += ' ';
+        reply += FormatShip(fleet[i]);
+      }
+      std::printf("%s\n", reply.c_str());
+      std::fflush(stdout);
+    } else if (command == "shoot" && playing) {
+      shot = attacker->NextAttack();
+      std::printf("shot %zu,%zu\n", shot.x, shot.y);
+      std::fflush(stdout);
+    } else if (command == "result" && playing && words.size() >= 2) {
+      Ship ship;
+      Board::AttackResult result = {Board::kMiss, 0};
+      if (!ParseAttack(words[1], result.type)) continue;
+      if (result.type == Board::kSunk) {
+        if (words.size() != 3 || !ParseShip(words[2], ship)) continue;
+        result.ship = &ship;
+      }
+      attacker->Observe(shot.x, shot.y, result);
+    } else if (command == "quit") {
+      return 0;
+    }
+  }
+  return 0;
+}
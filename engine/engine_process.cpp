@@ -0,0 +1,132 @@
+#include "engine_process.hpp"
+
+#include <cerrno>
+#include <csignal>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace battleship {
+
+// The longest line read, so an engine cannot make us buffer without bound.
+static std::size_t const kMaxLine = 1 << 16;
+
+// Construct a stopped engine.
+EngineProcess::EngineProcess() : pid_(-1), input_(-1), output_(-1) {}
+
+// Kill the engine if it is running.
+EngineProcess::~EngineProcess() { Stop(); }
+
+// Run a shell command as the engine, stopping any engine running before.
+// Return false if it could not be started.
+bool EngineProcess::Start(std::string const &command) {
+  Stop();
+  // Close on exec, so engines started by other threads do not hold our
+  // pipes open.
+  int input[2];
+  int output[2];
+  if (pipe2(input, O_CLOEXEC) != 0) return false;
+  if (pipe2(output, O_CLOEXEC) != 0) {
+    close(input[0]);
+    close(input[1]);
+    return false;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, input[0], 0);
+  posix_spawn_file_actions_adddup2(&actions, output[1], 1);
+  char const *argv[] = {"/bin/sh", "-c", command.c_str(), 0};
+  int error = posix_spawn(&pid_, "/bin/sh", &actions, 0,
+                          const_cast<char *const *>(argv), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(input[0]);
+  close(output[1]);
+  if (error != 0) {
+    pid_ = -1;
+    close(input[1]);
+    close(output[0]);
+    return false;
+  }
+  input_ = input[1];
+  output_ = output[0];
+  return true;
+}
+
+// Kill the engine and wait for it.
+void EngineProcess::Stop() {
+  if (pid_ < 0) return;
+  close(input_);
+  close(output_);
+  kill(pid_, SIGKILL);
+  while (waitpid(pid_, 0, 0) < 0 && errno == EINTR) {
+  }
+  pid_ = -1;
+  input_ = -1;
+  output_ = -1;
+  read_.clear();
+  write_.clear();
+}
+
+// Queue a line for the engine. Lines are written by Flush, so commands that
+// need no answer go out with the next one that does.
+void EngineProcess::Send(std::string const &line) {
+  write_ += line;
+  write_ += '\n';
+}
+
+// Write the queued lines. Return false if the engine is gone.
+bool EngineProcess::Flush() {
+  std::size_t written = 0;
+  while (written != write_.size()) {
+    ssize_t size = write(input_, write_.data() + written,
+                         write_.size() - written);
+    if (size < 0 && errno == EINTR) continue;
+    if (size < 0) return false;
+    written += static_cast<std::size_t>(size);
+  }
+  write_.clear();
+  return true;
+}
+
+// Read the next line from the engine without its newline, waiting no later
+// than deadline.
+EngineProcess::ReadStatus EngineProcess::ReadLine(Clock::time_point deadline,
+                                                  std::string &line) {
+  for (;;) {
+    std::size_t end = read_.find('\n');
+    if (end != std::string::npos) {
+      line.assign(read_, 0, end);
+      read_.erase(0, end + 1);
+      return kLine;
+    }
+    if (read_.size() > kMaxLine) return kClosed;
+
+    Clock::duration left = deadline - Clock::now();
+    if (left <= Clock::duration::zero()) return kTimeout;
+    pollfd poll_fd = {output_, POLLIN, 0};
+    // Round up so we never wake just before the deadline.
+    int timeout = static_cast<int>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(left).count() +
+        1);
+    int ready = poll(&poll_fd, 1, timeout);
+    if (ready < 0 && errno != EINTR) return kClosed;
+    if (ready <= 0) continue;
+
+    char buffer[4096];
+    ssize_t size = read(output_, buffer, sizeof(buffer));
+    if (size < 0 && errno == EINTR) continue;
+    if (size <= 0) return kClosed;
+    read_.append(buffer, static_cast<std::size_t>(size));
+  }
+}
+
+// Return whether the engine was started and not stopped.
+bool EngineProcess::running() const { return pid_ >= 0; }
+
+}  // namespace battleship
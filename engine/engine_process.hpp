@@ -0,0 +1,43 @@
+#ifndef BATTLESHIP_ENGINE_PROCESS_H
+#define BATTLESHIP_ENGINE_PROCESS_H
+
+#include <chrono>
+#include <string>
+
+#include <sys/types.h>
+
+namespace battleship {
+
+// An engine running as a child process, spoken to over pipes to its standard
+// input and output. Its standard error is ours.
+class EngineProcess {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  enum ReadStatus { kLine, kTimeout, kClosed };
+
+ private:
+  pid_t pid_;
+  // Our ends of the engine's standard input and output.
+  int input_;
+  int output_;
+  // Read and not yet returned, and queued and not yet written.
+  std::string read_;
+  std::string write_;
+
+  EngineProcess(EngineProcess const &);
+  EngineProcess &operator=(EngineProcess const &);
+
+ public:
+  EngineProcess();
+  ~EngineProcess();
+  bool Start(std::string const &command);
+  void Stop();
+  void Send(std::string const &line);
+  bool Flush();
+  ReadStatus ReadLine(Clock::time_point deadline, std::string &line);
+  bool running() const;
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_ENGINE_PROCESS_H
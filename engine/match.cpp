@@ -0,0 +1,500 @@
+#include "engine_process.hpp"
+#include "engine_protocol.hpp"
+#include "game_state.hpp"
+#include "metrics.hpp"
+#include "record_writer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace battleship {
+namespace {
+
+typedef EngineProcess::Clock Clock;
+
+// How long an engine may take to start and answer bsp.
+std::chrono::seconds const kStartTime(10);
+
+struct Options {
+  std::uint64_t games;
+  std::size_t concurrency;
+  // The time limit of every answer.
+  std::chrono::milliseconds move_time;
+  MapSize size;
+  std::vector<std::size_t> lengths;
+  std::string commands[2];
+  // Where to append every game played to the end, empty to record nothing.
+  std::string record;
+  // Where to write metrics, empty to time nothing.
+  std::string metrics;
+};
+
+// Why an engine lost a game other than by having its fleet sunk.
+enum Forfeit { kNoForfeit, kTimeout, kIllegal, kCrash };
+
+// Sums over played games, by engine. Everything is an integer so merging the
+// pairs in any order gives the same result.
+struct Tally {
+  std::uint64_t games;
+  std::uint64_t wins[2];
+  // Shots fired in games won without a forfeit.
+  std::uint64_t shots[2];
+  std::uint64_t sunk_wins[2];
+  std::uint64_t forfeits[2][4];
+  // Answers and the nanoseconds waited for them.
+  std::uint64_t answers[2];
+  std::uint64_t wait[2];
+  std::uint64_t max_wait[2];
+};
+
+// The record file shared by the pairs.
+struct Recorder {
+  RecordWriter writer;
+  std::mutex mutex;
+  // The player ids of the two engines.
+  std::uint32_t players[2];
+  bool failed;
+};
+
+// Two engine processes playing games one after the other on a thread.
+struct Pair {
+  EngineProcess engines[2];
+  std::string names[2];
+  GameState state;
+  GameRecord record;
+  Tally tally;
+  // Why the pair stopped early, empty if it did not.
+  std::string error;
+};
+
+// Start an engine and wait for it to answer bsp, reading its name if it
+// gives one. Return false if it does not start in time.
+bool StartEngine(EngineProcess &engine, std::string const &command,
+                 std::string &name) {
+  name = command;
+  if (!engine.Start(command)) return false;
+  engine.Send("bsp");
+  if (!engine.Flush()) return false;
+  Clock::time_point deadline = Clock::now() + kStartTime;
+  std::string line;
+  std::vector<std::string> words;
+  while (engine.ReadLine(deadline, line) == EngineProcess::kLine) {
+    SplitWords(line, words);
+    if (words.size() == 1 && words[0] == "bspok") return true;
+    if (words.size() > 2 && words[0] == "id" && words[1] == "name")
+      name = line.substr(line.find("name") + 5);
+  }
+  return false;
+}
+
+// Wait for the answer of an engine to a request sent at start, skipping info
+// lines. The answer must begin with word. Waits for shots are the engines'
+// move times.
+Forfeit Await(Pair &pair, std::size_t engine, char const *word,
+              Clock::time_point start, Options const &options,
+              std::vector<std::string> &words) {
+  Tally &tally = pair.tally;
+  Clock::time_point deadline = start + options.move_time;
+  std::string line;
+  Forfeit forfeit = kNoForfeit;
+  for (;;) {
+    EngineProcess::ReadStatus status =
+        pair.engines[engine].ReadLine(deadline, line);
+    if (status != EngineProcess::kLine) {
+      forfeit = status == EngineProcess::kTimeout ? kTimeout : kCrash;
+      break;
+    }
+    SplitWords(line, words);
+    if (words.empty() || words[0] == "info") continue;
+    if (words[0] != word) forfeit = kIllegal;
+    break;
+  }
+
+  std::uint64_t wait = static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                           start)
+          .count());
+  ++tally.answers[engine];
+  tally.wait[engine] += wait;
+  tally.max_wait[engine] = std::max(tally.max_wait[engine], wait);
+  if (MetricsTiming() && std::strcmp(word, "shot") == 0)
+    RecordTime(kMoveTimer, wait);
+  return forfeit;
+}
+
+// Place a fleet from the words of a fleet answer on the board being placed
+// on, and pack it into fleet unless that is null. Return false if it is not
+// one legal ship of every length.
+bool PlaceFleet(GameState &state, std::vector<std::string> const &words,
+                std::vector<PackedShip> *fleet) {
+  std::size_t board = state.turn();
+  if (words.size() != state.ship_set(board).size() + 1) return false;
+  if (fleet != 0) fleet->clear();
+  for (std::size_t i = 1, e = words.size(); i != e; ++i) {
+    Ship ship;
+    if (!ParseShip(words[i], ship) ||
+        state.Place(ship).type != GameState::kPlaced)
+      return false;
+    if (fleet != 0) fleet->push_back(Pack(ship));
+  }
+  return state.turn() != board || state.phase() != GameState::kPlacing;
+}
+
+// Append a finished game to the record file.
+void RecordGame(Pair &pair, std::uint64_t game, Recorder &recorder) {
+  GameRecord &record = pair.record;
+  for (std::size_t i = 0; i != 2; ++i)
+    record.players[i] = recorder.players[(i + game) % 2];
+  std::lock_guard<std::mutex> lock(recorder.mutex);
+  if (!recorder.writer.Write(record)) recorder.failed = true;
+}
+
+// Play one game between the engines of a pair. Seat i attacks board i and
+// places the ships of the other board. Seat 0 shoots first and is played by
+// engine game % 2, so the first shot alternates with the game number.
+// Return false if an engine that had to be restarted did not start.
+bool PlayGame(Pair &pair, Options const &options, std::uint64_t game,
+              Recorder *recorder) {
+  GameRules rules = {options.size, options.lengths};
+  ShipSet set = {&rules.ship_set[0],
+                 &rules.ship_set[0] + rules.ship_set.size()};
+  std::string newgame = "newgame " + FormatRules(rules);
+  std::size_t engines[2] = {game % 2, (game + 1) % 2};
+
+  // Both engines place at once. Board 1 is placed first, by seat 0.
+  Forfeit forfeits[2] = {kNoForfeit, kNoForfeit};
+  std::vector<std::string> words[2];
+  Clock::time_point start = Clock::now();
+  for (std::size_t seat = 0; seat != 2; ++seat) {
+    EngineProcess &engine = pair.engines[engines[seat]];
+    engine.Send(newgame);
+    engine.Send("place");
+    if (!engine.Flush()) forfeits[seat] = kCrash;
+  }
+  for (std::size_t seat = 0; seat != 2; ++seat)
+    if (forfeits[seat] == kNoForfeit)
+      forfeits[seat] =
+          Await(pair, engines[seat], "fleet", start, options, words[seat]);
+
+  GameState &state = pair.state;
+  GameRecord &record = pair.record;
+  state.Init(options.size, set);
+  record.Clear();
+  record.size = options.size;
+  record.ship_set = options.lengths;
+  for (std::size_t seat = 0; seat != 2 && forfeits[0] == kNoForfeit; ++seat)
+    if (forfeits[seat] == kNoForfeit &&
+        !PlaceFleet(state, words[seat],
+                    recorder != 0 ? &record.fleets[1 - seat] : 0))
+      forfeits[seat] = kIllegal;
+
+  // The first engine to forfeit loses.
+  std::size_t shots[2] = {0, 0};
+  std::size_t loser = forfeits[0] != kNoForfeit ? 0 : 1;
+  while (forfeits[0] == kNoForfeit && forfeits[1] == kNoForfeit &&
+         state.phase() == GameState::kAttacking) {
+    ScopedTimer turn_timer(kTurnTimer);
+    std::size_t seat = state.turn();
+    EngineProcess &engine = pair.engines[engines[seat]];
+    engine.Send("shoot");
+    start = Clock::now();
+    Forfeit &forfeit = forfeits[seat];
+    if (!engine.Flush()) {
+      forfeit = kCrash;
+      break;
+    }
+    forfeit = Await(pair, engines[seat], "shot", start, options, words[seat]);
+    Cell cell;
+    if (forfeit == kNoForfeit &&
+        (words[seat].size() != 2 || !ParseCell(words[seat][1], cell) ||
+         cell.x >= options.size.x || cell.y >= options.size.y))
+      forfeit = kIllegal;
+    if (forfeit != kNoForfeit) break;
+
+    // Shooting a cell twice would never end the game.
+    Board::AttackResult res = state.Attack(cell.x, cell.y);
+    if (res.type == Board::kRetry) {
+      forfeit = kIllegal;
+      break;
+    }
+    ++shots[seat];
+    RecordedAttack attack = {cell.x, cell.y, res.type};
+    record.attacks.push_back(attack);
+    std::string result = "result ";
+    result += FormatAttack(res.type);
+    if (res.type == Board::kSunk) result += " " + FormatShip(*res.ship);
+    engine.Send(result);
+  }
+  if (forfeits[0] == kNoForfeit && forfeits[1] == kNoForfeit) {
+    loser = 1 - state.turn();
+    if (recorder != 0) RecordGame(pair, game, *recorder);
+  } else if (forfeits[0] == kNoForfeit) {
+    loser = 1;
+  }
+
+  // The gameover lines go out with the next request.
+  Tally &tally = pair.tally;
+  ++tally.games;
+  ++tally.wins[engines[1 - loser]];
+  if (forfeits[loser] == kNoForfeit) {
+    tally.shots[engines[1 - loser]] += shots[1 - loser];
+    ++tally.sunk_wins[engines[1 - loser]];
+  }
+  for (std::size_t seat = 0; seat != 2; ++seat) {
+    ++tally.forfeits[engines[seat]][forfeits[seat]];
+    EngineProcess &engine = pair.engines[engines[seat]];
+    engine.Send(seat == loser ? "gameover loss" : "gameover win");
+    // An engine that timed out may still answer, so it starts afresh.
+    if (forfeits[seat] != kTimeout && forfeits[seat] != kCrash) continue;
+    std::string name;
+    if (!StartEngine(engine, options.commands[engines[seat]], name)) {
+      pair.error = "cannot restart " + options.commands[engines[seat]];
+      return false;
+    }
+  }
+  return true;
+}
+
+// Parse "WxH".
+bool ParseSize(char const *text, MapSize &size) {
+  char *end;
+  size.x = std::strtoul(text, &end, 10);
+  if (*end != 'x') return false;
+  size.y = std::strtoul(end + 1, &end, 10);
+  return *end == '\0' && size.x != 0 && size.y != 0;
+}
+
+// Parse "a,b,c".
+bool ParseLengths(char const *text, std::vector<std::size_t> &lengths) {
+  lengths.clear();
+  for (;;) {
+    char *end;
+    std::size_t length = std::strtoul(text, &end, 10);
+    if (end == text || length == 0) return false;
+    lengths.push_back(length);
+    if (*end == '\0') return true;
+    if (*end != ',') return false;
+    text = end + 1;
+  }
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: battleship_match [options] ENGINE1 ENGINE2\n"
+               "  --games N        number of games (default 1000)\n"
+               "  --concurrency N  pairs of engines playing at once "
+               "(default 1)\n"
+               "  --time MS        time limit of every answer "
+               "(default 1000)\n"
+               "  --size WxH       map size (default 10x10)\n"
+               "  --set A,B,...    ship lengths (default 2,3,3,4,5)\n"
+               "  --record FILE    append every game to a record file,\n"
+               "                   on boards up to 1024 cells a side\n"
+               "  --metrics FILE   time every operation and write counts and\n"
+               "                   latencies, as Prometheus text if FILE ends\n"
+               "                   in .prom and as JSON otherwise\n"
+               "ENGINEs are shell commands speaking the engine protocol, "
+               "such as\n"
+               "\"battleship_engine --strategy density\"\n");
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+  options.games = 1000;
+  options.concurrency = 1;
+  options.move_time = std::chrono::milliseconds(1000);
+  options.size = GetPresetMapSize(1);
+  ShipSet set = GetPresetShipSet(1);
+  options.lengths.assign(set.first, set.last);
+
+  std::size_t engines = 0;
+  for (int i = 1; i < argc; ++i) {
+    char const *arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(arg, "--games") == 0 && has_value) {
+      options.games = std::strtoull(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--concurrency") == 0 && has_value) {
+      options.concurrency = std::strtoul(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--time") == 0 && has_value) {
+      options.move_time =
+          std::chrono::milliseconds(std::strtoul(argv[++i], 0, 10));
+    } else if (std::strcmp(arg, "--size") == 0 && has_value) {
+      if (!ParseSize(argv[++i], options.size)) return false;
+    } else if (std::strcmp(arg, "--set") == 0 && has_value) {
+      if (!ParseLengths(argv[++i], options.lengths)) return false;
+    } else if (std::strcmp(arg, "--record") == 0 && has_value) {
+      options.record = argv[++i];
+    } else if (std::strcmp(arg, "--metrics") == 0 && has_value) {
+      options.metrics = argv[++i];
+    } else if (arg[0] != '-' && engines != 2) {
+      options.commands[engines++] = arg;
+    } else {
+      return false;
+    }
+  }
+  if (engines != 2 || options.concurrency == 0) return false;
+  // Records keep the ships packed.
+  if (!options.record.empty() && !CanPack(options.size.x, options.size.y))
+    return false;
+
+  // Every fleet must fit on the board.
+  std::size_t cells = 0;
+  for (std::size_t i = 0, e = options.lengths.size(); i != e; ++i) {
+    if (options.lengths[i] > std::max(options.size.x, options.size.y))
+      return false;
+    cells += options.lengths[i];
+  }
+  return cells <= options.size.x * options.size.y;
+}
+
+// Return the Elo difference that makes a score expected, clamped to +-1000
+// for scores of 0 and 1.
+double Elo(double score) {
+  if (score <= 0) return -1000;
+  if (score >= 1) return 1000;
+  return std::max(-1000.0, std::min(1000.0, -400 * std::log10(1 / score - 1)));
+}
+
+}  // namespace
+}  // namespace battleship
+
+int main(int argc, char *argv[]) {
+  using namespace battleship;
+
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+  // Writing to an engine that exited must not kill us.
+  std::signal(SIGPIPE, SIG_IGN);
+  SetMetricsTiming(!options.metrics.empty());
+
+  std::vector<std::unique_ptr<Pair> > pairs;
+  for (std::size_t i = 0; i != options.concurrency; ++i) {
+    pairs.push_back(std::unique_ptr<Pair>(new Pair));
+    Pair &pair = *pairs.back();
+    Tally tally = {0, {0, 0}, {0, 0}, {0, 0}, {{0}}, {0, 0}, {0, 0}, {0, 0}};
+    pair.tally = tally;
+    pair.state.Reserve(options.lengths.size());
+    for (std::size_t j = 0; j != 2; ++j) {
+      if (!StartEngine(pair.engines[j], options.commands[j], pair.names[j])) {
+        std::fprintf(stderr, "cannot start %s\n",
+                     options.commands[j].c_str());
+        return 1;
+      }
+    }
+  }
+
+  // Games land in the file in the order they finish, not by game number.
+  std::unique_ptr<Recorder> recorder;
+  if (!options.record.empty()) {
+    recorder.reset(new Recorder);
+    recorder->failed = false;
+    if (!recorder->writer.Open(options.record.c_str())) {
+      std::fprintf(stderr, "cannot append to %s\n", options.record.c_str());
+      return 1;
+    }
+    for (std::size_t i = 0; i != 2; ++i)
+      recorder->players[i] = recorder->writer.AddPlayer(pairs[0]->names[i]);
+  }
+
+  // Every pair plays the next game until all are played, paying for starting
+  // its engines once.
+  std::atomic<std::uint64_t> next_game(0);
+  std::vector<std::thread> threads;
+  Clock::time_point start = Clock::now();
+  for (std::size_t i = 0; i != options.concurrency; ++i) {
+    Pair *pair = pairs[i].get();
+    Recorder *shared = recorder.get();
+    threads.push_back(std::thread([pair, shared, &options, &next_game]() {
+      for (;;) {
+        std::uint64_t game = next_game++;
+        if (game >= options.games ||
+            !PlayGame(*pair, options, game, shared))
+          break;
+      }
+      for (std::size_t j = 0; j != 2; ++j) {
+        pair->engines[j].Send("quit");
+        pair->engines[j].Flush();
+      }
+    }));
+  }
+  for (std::size_t i = 0, e = threads.size(); i != e; ++i) threads[i].join();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  Tally total = {0, {0, 0}, {0, 0}, {0, 0}, {{0}}, {0, 0}, {0, 0}, {0, 0}};
+  for (std::size_t i = 0, e = pairs.size(); i != e; ++i) {
+    Tally const &tally = pairs[i]->tally;
+    if (!pairs[i]->error.empty())
+      std::fprintf(stderr, "%s\n", pairs[i]->error.c_str());
+    total.games += tally.games;
+    for (std::size_t j = 0; j != 2; ++j) {
+      total.wins[j] += tally.wins[j];
+      total.shots[j] += tally.shots[j];
+      total.sunk_wins[j] += tally.sunk_wins[j];
+      for (std::size_t k = 0; k != 4; ++k)
+        total.forfeits[j][k] += tally.forfeits[j][k];
+      total.answers[j] += tally.answers[j];
+      total.wait[j] += tally.wait[j];
+      total.max_wait[j] = std::max(total.max_wait[j], tally.max_wait[j]);
+    }
+  }
+
+  if (recorder && (!recorder->writer.Close() || recorder->failed)) {
+    std::fprintf(stderr, "cannot write %s\n", options.record.c_str());
+    return 1;
+  }
+  if (!options.metrics.empty()) {
+    Metrics metrics;
+    CollectMetrics(metrics);
+    if (!WriteMetrics(options.metrics, metrics)) {
+      std::fprintf(stderr, "cannot write %s\n", options.metrics.c_str());
+      return 1;
+    }
+  }
+
+  double n = static_cast<double>(total.games);
+  std::printf("games: %llu\n", static_cast<unsigned long long>(total.games));
+  for (std::size_t i = 0; i != 2; ++i) {
+    double wins = static_cast<double>(total.wins[i]);
+    double answers = static_cast<double>(std::max<std::uint64_t>(
+        total.answers[i], 1));
+    std::printf("%s wins: %llu (%.2f%%)\n", pairs[0]->names[i].c_str(),
+                static_cast<unsigned long long>(total.wins[i]),
+                100 * wins / n);
+    std::printf("  shots to win: %.3f\n",
+                static_cast<double>(total.shots[i]) /
+                    static_cast<double>(
+                        std::max<std::uint64_t>(total.sunk_wins[i], 1)));
+    std::printf("  forfeits: %llu timeouts, %llu illegal, %llu crashes\n",
+                static_cast<unsigned long long>(total.forfeits[i][kTimeout]),
+                static_cast<unsigned long long>(total.forfeits[i][kIllegal]),
+                static_cast<unsigned long long>(total.forfeits[i][kCrash]));
+    std::printf("  answer time: mean %.3f ms, max %.3f ms\n",
+                static_cast<double>(total.wait[i]) / answers / 1e6,
+                static_cast<double>(total.max_wait[i]) / 1e6);
+  }
+
+  // The Elo difference of engine 1 over engine 2 with a 95% interval.
+  if (total.games != 0) {
+    double score = static_cast<double>(total.wins[0]) / n;
+    double margin = 1.96 * std::sqrt(score * (1 - score) / n);
+    std::printf("Elo difference: %+.1f [%+.1f, %+.1f]\n", Elo(score),
+                Elo(score - margin), Elo(score + margin));
+  }
+  std::fprintf(stderr, "%.2f s, %.0f games/s with %zu pairs\n", seconds,
+               n / seconds, options.concurrency);
+  return 0;
+}
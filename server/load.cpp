@@ -0,0 +1,376 @@
+#include "fleet_generator.hpp"
+#include "protocol.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace battleship {
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+  std::size_t matches;
+  std::size_t concurrency;
+  std::string host;
+  std::uint16_t port;
+  std::string unix_path;
+  unsigned seed;
+};
+
+// A client playing one match: it places a random fleet and attacks the cells
+// of the board in a random order.
+struct Client {
+  int fd;
+  std::vector<std::uint8_t> input;
+  std::vector<std::uint8_t> output;
+  std::size_t written;
+  bool want_write;
+  std::size_t seat;
+  std::vector<Ship> fleet;
+  // Cells of the board to attack, row-major.
+  std::size_t width;
+  std::vector<std::uint32_t> cells;
+  std::size_t next_cell;
+  // Ships of our fleet the opponent sank.
+  std::size_t sunk;
+  Clock::time_point sent;
+};
+
+// What the clients saw.
+struct Totals {
+  std::size_t finished;
+  std::size_t left;
+  std::size_t errors;
+  std::size_t failed;
+  std::uint64_t attacks;
+  // Microseconds from sending each attack to its result.
+  std::vector<std::uint32_t> latencies;
+};
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: battleship_load [options]\n"
+               "  --matches N      matches to play (default: 10000)\n"
+               "  --concurrency N  matches at a time (default: 1000)\n"
+               "  --host ADDR      server address (default: 127.0.0.1)\n"
+               "  --port P         connect to TCP port P\n"
+               "  --unix PATH      connect to the Unix socket PATH\n"
+               "  --seed N         seed of the fleets and attacks\n"
+               "Plays 10x10 games with ships 2,3,3,4,5 against "
+               "battleship_server\n");
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+  options.matches = 10000;
+  options.concurrency = 1000;
+  options.host = "127.0.0.1";
+  options.port = 0;
+  options.seed = 1;
+  for (int i = 1; i < argc; ++i) {
+    char const *arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(arg, "--matches") == 0 && has_value) {
+      options.matches = std::strtoul(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--concurrency") == 0 && has_value) {
+      options.concurrency = std::strtoul(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--host") == 0 && has_value) {
+      options.host = argv[++i];
+    } else if (std::strcmp(arg, "--port") == 0 && has_value) {
+      unsigned long port = std::strtoul(argv[++i], 0, 10);
+      if (port == 0 || port > 65535) return false;
+      options.port = static_cast<std::uint16_t>(port);
+    } else if (std::strcmp(arg, "--unix") == 0 && has_value) {
+      options.unix_path = argv[++i];
+    } else if (std::strcmp(arg, "--seed") == 0 && has_value) {
+      options.seed = static_cast<unsigned>(std::strtoul(argv[++i], 0, 10));
+    } else {
+      return false;
+    }
+  }
+  return options.concurrency != 0 &&
+         (options.port != 0 || !options.unix_path.empty());
+}
+
+// Connect to the server, return the socket or -1. Connecting blocks, which
+// is quick on the local machine.
+int Connect(Options const &options) {
+  int fd;
+  if (!options.unix_path.empty()) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (options.unix_path.size() >= sizeof(address.sun_path)) return -1;
+    std::strcpy(address.sun_path, options.unix_path.c_str());
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) != 0) {
+      close(fd);
+      return -1;
+    }
+  } else {
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1)
+      return -1;
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) != 0) {
+      close(fd);
+      return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+// Watch a socket for input, and for room to write if want_write.
+void Watch(int epoll, int op, int fd, bool want_write) {
+  epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  if (want_write) event.events |= EPOLLOUT;
+  event.data.fd = fd;
+  epoll_ctl(epoll, op, fd, &event);
+}
+
+// Write as much pending output as the socket takes. Return false on error.
+bool Write(int epoll, Client &client) {
+  while (client.written != client.output.size()) {
+    ssize_t size = send(client.fd, &client.output[client.written],
+                        client.output.size() - client.written, MSG_NOSIGNAL);
+    if (size >= 0) {
+      client.written += static_cast<std::size_t>(size);
+      continue;
+    }
+    if (errno == EINTR) continue;
+    if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+    if (!client.want_write) {
+      client.want_write = true;
+      Watch(epoll, EPOLL_CTL_MOD, client.fd, true);
+    }
+    return true;
+  }
+  client.output.clear();
+  client.written = 0;
+  if (client.want_write) {
+    client.want_write = false;
+    Watch(epoll, EPOLL_CTL_MOD, client.fd, false);
+  }
+  return true;
+}
+
+// Queue the next attack of a client.
+void Attack(Client &client) {
+  std::uint32_t cell = client.cells[client.next_cell++];
+  Message message;
+  message.type = kAttackMessage;
+  message.x = cell % client.width;
+  message.y = cell / client.width;
+  EncodeMessage(message, client.output);
+  client.sent = Clock::now();
+}
+
+// Act on a message from the server. Return false once the match is over.
+bool Handle(Client &client, Message const &message, Totals &totals) {
+  switch (message.type) {
+    case kJoinedMessage:
+      client.seat = message.seat;
+      return true;
+
+    case kTurnMessage:
+      // Send the whole fleet at once, the server places it in order.
+      if (message.phase == GameState::kPlacing &&
+          message.board == 1 - client.seat) {
+        Message place;
+        place.type = kPlaceMessage;
+        for (std::size_t i = 0, e = client.fleet.size(); i != e; ++i) {
+          place.ship = client.fleet[i];
+          EncodeMessage(place, client.output);
+        }
+      } else if (message.phase == GameState::kAttacking &&
+                 message.board == client.seat) {
+        Attack(client);
+      }
+      return true;
+
+    case kPlacedMessage:
+      if (message.place != GameState::kPlaced) ++totals.errors;
+      return true;
+
+    case kAttackedMessage:
+      if (message.board == client.seat) {
+        ++totals.attacks;
+        totals.latencies.push_back(static_cast<std::uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                Clock::now() - client.sent)
+                .count()));
+        return true;
+      }
+      // Attack back unless that was our last ship.
+      if (message.attack == Board::kSunk) ++client.sunk;
+      if (client.sunk != client.fleet.size()) Attack(client);
+      return true;
+
+    case kFinishedMessage:
+      if (client.seat == 0) ++totals.finished;
+      return false;
+
+    case kLeftMessage:
+      ++totals.left;
+      return false;
+
+    default:
+      ++totals.errors;
+      return false;
+  }
+}
+
+}  // namespace
+}  // namespace battleship
+
+int main(int argc, char *argv[]) {
+  using namespace battleship;
+
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+
+  MapSize size = GetPresetMapSize(1);
+  ShipSet set = GetPresetShipSet(1);
+  Message join;
+  join.type = kJoinMessage;
+  join.rules.size = size;
+  join.rules.ship_set.assign(set.first, set.last);
+  FleetGenerator generator(options.seed);
+  generator.Init(size, set);
+  std::mt19937 random(options.seed);
+  std::vector<std::uint32_t> cells(size.x * size.y);
+  for (std::size_t i = 0, e = cells.size(); i != e; ++i)
+    cells[i] = static_cast<std::uint32_t>(i);
+
+  int epoll = epoll_create1(EPOLL_CLOEXEC);
+  std::unordered_map<int, std::unique_ptr<Client> > clients;
+  Totals totals = {0, 0, 0, 0, 0, {}};
+  std::size_t clients_left = 2 * options.matches;
+  std::vector<epoll_event> events(256);
+  Clock::time_point start = Clock::now();
+  for (;;) {
+    // Keep concurrency matches going, two clients each.
+    while (clients_left != 0 && clients.size() < 2 * options.concurrency) {
+      --clients_left;
+      int fd = Connect(options);
+      if (fd < 0) {
+        ++totals.failed;
+        continue;
+      }
+      std::unique_ptr<Client> client(new Client);
+      client->fd = fd;
+      client->written = 0;
+      client->want_write = false;
+      client->seat = 0;
+      client->fleet.resize(generator.fleet_size());
+      generator.Generate(&client->fleet[0]);
+      client->width = size.x;
+      client->cells = cells;
+      std::shuffle(client->cells.begin(), client->cells.end(), random);
+      client->next_cell = 0;
+      client->sunk = 0;
+      EncodeMessage(join, client->output);
+      Watch(epoll, EPOLL_CTL_ADD, fd, false);
+      if (!Write(epoll, *client)) {
+        ++totals.failed;
+        close(fd);
+        continue;
+      }
+      clients[fd] = std::move(client);
+    }
+    if (clients.empty()) break;
+
+    int count = epoll_wait(epoll, &events[0], static_cast<int>(events.size()),
+                           -1);
+    for (int i = 0; i < count; ++i) {
+      Client &client = *clients[events[i].data.fd];
+      bool open = true;
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        std::uint8_t buffer[4096];
+        ssize_t size;
+        while ((size = recv(client.fd, buffer, sizeof(buffer), 0)) > 0) {
+          client.input.insert(client.input.end(), buffer, buffer + size);
+          if (static_cast<std::size_t>(size) < sizeof(buffer)) break;
+        }
+        bool eof = size == 0 ||
+                   (size < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+
+        // The server closes the connection after the last message, so the
+        // end of input only means failure before that.
+        std::uint8_t const *first = client.input.data();
+        std::uint8_t const *last = first + client.input.size();
+        Message message;
+        bool over = false;
+        while (first != last && !over) {
+          DecodeStatus status = DecodeMessage(first, last, message);
+          if (status == kIncomplete) break;
+          if (status == kMalformed) ++totals.errors;
+          over = status == kMalformed || !Handle(client, message, totals);
+        }
+        client.input.erase(client.input.begin(),
+                           client.input.begin() +
+                               (first - client.input.data()));
+        if (eof && !over) ++totals.failed;
+        open = !eof && !over;
+      }
+      if (open && !Write(epoll, client)) {
+        ++totals.failed;
+        open = false;
+      }
+      if (!open) {
+        close(client.fd);
+        clients.erase(client.fd);
+      }
+    }
+  }
+
+  double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  std::printf("%zu matches finished, %zu left, %zu errors, %zu failed\n",
+              totals.finished, totals.left, totals.errors, totals.failed);
+  std::printf("%.2f s, %.0f matches/s, %.0f attacks/s\n", seconds,
+              static_cast<double>(totals.finished) / seconds,
+              static_cast<double>(totals.attacks) / seconds);
+  std::vector<std::uint32_t> &latencies = totals.latencies;
+  if (!latencies.empty()) {
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("attack latency: p50 %u us, p99 %u us, max %u us\n",
+                latencies[latencies.size() / 2],
+                latencies[latencies.size() * 99 / 100], latencies.back());
+  }
+  close(epoll);
+  return totals.errors == 0 && totals.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+#include "server.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <pthread.h>
+
+namespace battleship {
+namespace {
+
+struct Options {
+  std::size_t loops;
+  // The TCP port to listen on, 0 for none.
+  std::uint16_t port;
+  // The Unix socket to listen on, empty for none.
+  std::string unix_path;
+};
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: battleship_server [options]\n"
+               "  --loops N    event loop threads (default: all cores)\n"
+               "  --port P     listen for TCP connections on port P\n"
+               "  --unix PATH  listen on the Unix socket PATH\n"
+               "At least one of --port and --unix is needed\n");
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+  options.loops = 0;
+  options.port = 0;
+  for (int i = 1; i < argc; ++i) {
+    char const *arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(arg, "--loops") == 0 && has_value) {
+      options.loops = std::strtoul(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--port") == 0 && has_value) {
+      unsigned long port = std::strtoul(argv[++i], 0, 10);
+      if (port == 0 || port > 65535) return false;
+      options.port = static_cast<std::uint16_t>(port);
+    } else if (std::strcmp(arg, "--unix") == 0 && has_value) {
+      options.unix_path = argv[++i];
+    } else {
+      return false;
+    }
+  }
+  return options.port != 0 || !options.unix_path.empty();
+}
+
+}  // namespace
+}  // namespace battleship
+
+int main(int argc, char *argv[]) {
+  using namespace battleship;
+
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+
+  // Block the signals that stop us before the loops start so only sigwait
+  // below sees them.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, 0);
+
+  Server server(options.loops);
+  if (options.port != 0 && !server.ListenTcp(options.port)) {
+    std::fprintf(stderr, "cannot listen on port %u\n",
+                 static_cast<unsigned>(options.port));
+    return 1;
+  }
+  if (!options.unix_path.empty() &&
+      !server.ListenUnix(options.unix_path.c_str())) {
+    std::fprintf(stderr, "cannot listen on %s\n", options.unix_path.c_str());
+    return 1;
+  }
+  server.Start();
+
+  int signal;
+  sigwait(&signals, &signal);
+  server.Stop();
+  return 0;
+}
@@ -0,0 +1,545 @@
+#include "server.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace battleship {
+
+// Events handled per epoll_wait.
+static int const kMaxEvents = 256;
+
+// The largest map side and fleet a client may ask for.
+static std::size_t const kMaxSide = 1000;
+static std::size_t const kMaxFleet = 256;
+
+// Return whether a client may play by some rules: the board is not too large
+// and every ship fits on it.
+static bool ValidRules(GameRules const &rules) {
+  std::size_t x = rules.size.x;
+  std::size_t y = rules.size.y;
+  std::size_t ships = rules.ship_set.size();
+  if (x == 0 || y == 0 || x > kMaxSide || y > kMaxSide || ships == 0 ||
+      ships > kMaxFleet)
+    return false;
+  std::size_t cells = 0;
+  for (std::size_t i = 0; i != ships; ++i) {
+    std::size_t length = rules.ship_set[i];
+    if (length == 0 || length > std::max(x, y)) return false;
+    cells += length;
+  }
+  return cells <= x * y;
+}
+
+// Return the seat of the player to act in a match.
+static std::size_t Actor(GameState const &state) {
+  // Board 1 is placed by seat 0, and board i attacked by seat i.
+  return state.phase() == GameState::kPlacing ? 1 - state.turn()
+                                              : state.turn();
+}
+
+// Watch a socket for input, and for room to write if want_write.
+static void Watch(int epoll, int op, int fd, bool want_write) {
+  epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  if (want_write) event.events |= EPOLLOUT;
+  event.data.fd = fd;
+  epoll_ctl(epoll, op, fd, &event);
+}
+
+// Add a listening socket to loop 0. Return false if it could not listen.
+bool Server::AddListener(int fd) {
+  if (listen(fd, SOMAXCONN) != 0) {
+    close(fd);
+    return false;
+  }
+  listeners_.push_back(fd);
+  Watch(loops_[0]->epoll, EPOLL_CTL_ADD, fd, false);
+  return true;
+}
+
+// Handle events on a loop until the server stops.
+void Server::Run(std::size_t index) {
+  Loop &loop = *loops_[index];
+  epoll_event events[kMaxEvents];
+  while (!stopping_) {
+    int count = epoll_wait(loop.epoll, events, kMaxEvents, -1);
+    if (count < 0 && errno != EINTR) break;
+    for (int i = 0; i < count; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == loop.wake) {
+        std::uint64_t value;
+        if (read(loop.wake, &value, sizeof(value)) < 0) continue;
+        Adopt(loop);
+        continue;
+      }
+      if (std::find(listeners_.begin(), listeners_.end(), fd) !=
+          listeners_.end()) {
+        Accept(loop, fd);
+        continue;
+      }
+
+      // The connection may have been closed by an earlier event.
+      std::unordered_map<int, std::unique_ptr<Connection> >::iterator it =
+          loop.connections.find(fd);
+      if (it == loop.connections.end()) continue;
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        Read(loop, *it->second);
+      } else if (events[i].events & EPOLLOUT) {
+        loop.dirty.push_back(fd);
+      }
+    }
+    Flush(loop);
+    HandOff(loop);
+  }
+}
+
+// Accept every pending connection on a listener.
+void Server::Accept(Loop &loop, int listener) {
+  for (;;) {
+    int fd = accept4(listener, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+    // Turns are single small messages, send them right away.
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    std::unique_ptr<Connection> connection(new Connection);
+    connection->fd = fd;
+    connection->written = 0;
+    connection->match = 0;
+    connection->seat = 0;
+    connection->joined = false;
+    connection->closing = false;
+    connection->want_write = false;
+    loop.connections[fd] = std::move(connection);
+    Watch(loop.epoll, EPOLL_CTL_ADD, fd, false);
+  }
+}
+
+// Take over the matches handed to a loop.
+void Server::Adopt(Loop &loop) {
+  std::vector<Handoff> inbox;
+  {
+    std::lock_guard<std::mutex> lock(loop.mutex);
+    inbox.swap(loop.inbox);
+  }
+  for (std::size_t i = 0, e = inbox.size(); i != e; ++i) {
+    Handoff &handoff = inbox[i];
+    for (std::size_t seat = 0; seat != 2; ++seat) {
+      int fd = handoff.seats[seat]->fd;
+      Watch(loop.epoll, EPOLL_CTL_ADD, fd, handoff.seats[seat]->want_write);
+      loop.connections[fd] = std::move(handoff.seats[seat]);
+      loop.dirty.push_back(fd);
+    }
+    Match *match = handoff.match.get();
+    loop.matches[match] = std::move(handoff.match);
+  }
+}
+
+// Read what arrived on a connection and handle every whole message.
+void Server::Read(Loop &loop, Connection &connection) {
+  std::uint8_t buffer[16384];
+  for (;;) {
+    ssize_t size = recv(connection.fd, buffer, sizeof(buffer), 0);
+    if (size > 0) {
+      connection.input.insert(connection.input.end(), buffer, buffer + size);
+      // Epoll reports the rest, saving a read that would fail.
+      if (static_cast<std::size_t>(size) < sizeof(buffer)) break;
+      continue;
+    }
+    if (size < 0 && errno == EINTR) continue;
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    Close(loop, connection);
+    return;
+  }
+
+  // Leave a partial message for the next read.
+  std::vector<std::uint8_t> &input = connection.input;
+  std::uint8_t const *first = input.data();
+  std::uint8_t const *last = first + input.size();
+  Message message;
+  while (first != last && !connection.closing) {
+    DecodeStatus status = DecodeMessage(first, last, message);
+    if (status == kIncomplete) break;
+    if (status == kMalformed) {
+      SendError(loop, connection, kBadMessage);
+      connection.closing = true;
+      break;
+    }
+    Handle(loop, connection, message);
+  }
+  input.erase(input.begin(), input.begin() + (first - input.data()));
+}
+
+// Write as much pending output as the socket takes, closing the connection
+// once all is written if it is closing.
+void Server::Write(Loop &loop, Connection &connection) {
+  while (connection.written != connection.output.size()) {
+    ssize_t size = send(connection.fd, &connection.output[connection.written],
+                        connection.output.size() - connection.written,
+                        MSG_NOSIGNAL);
+    if (size >= 0) {
+      connection.written += static_cast<std::size_t>(size);
+      continue;
+    }
+    if (errno == EINTR) continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      if (!connection.want_write) {
+        connection.want_write = true;
+        Watch(loop.epoll, EPOLL_CTL_MOD, connection.fd, true);
+      }
+      return;
+    }
+    Close(loop, connection);
+    return;
+  }
+
+  connection.output.clear();
+  connection.written = 0;
+  if (connection.closing) {
+    Close(loop, connection);
+    return;
+  }
+  if (connection.want_write) {
+    connection.want_write = false;
+    Watch(loop.epoll, EPOLL_CTL_MOD, connection.fd, false);
+  }
+}
+
+// Act on a message from a client.
+void Server::Handle(Loop &loop, Connection &connection,
+                    Message const &message) {
+  switch (message.type) {
+    case kJoinMessage:
+      if (connection.joined) break;
+      if (!ValidRules(message.rules)) {
+        SendError(loop, connection, kBadRules);
+        connection.closing = true;
+        return;
+      }
+      Join(loop, connection, message.rules);
+      return;
+
+    case kPlaceMessage:
+      Place(loop, connection, message.ship);
+      return;
+
+    case kAttackMessage:
+      Attack(loop, connection, message.x, message.y);
+      return;
+
+    default:
+      break;
+  }
+  SendError(loop, connection, kBadMessage);
+  connection.closing = true;
+}
+
+// Pair a client with the one waiting for the same rules, or make it wait.
+// Only loop 0 has clients that have not joined yet.
+void Server::Join(Loop &loop, Connection &connection, GameRules const &rules) {
+  assert(&loop == loops_[0].get());
+  connection.joined = true;
+  std::vector<std::size_t> key(rules.ship_set);
+  key.push_back(rules.size.x);
+  key.push_back(rules.size.y);
+  std::map<std::vector<std::size_t>, Connection *>::iterator it =
+      lobby_.find(key);
+  if (it == lobby_.end()) {
+    lobby_[key] = &connection;
+    return;
+  }
+
+  std::unique_ptr<Match> match(new Match);
+  ShipSet set = {const_cast<std::size_t *>(&rules.ship_set[0]),
+                 const_cast<std::size_t *>(&rules.ship_set[0]) +
+                     rules.ship_set.size()};
+  match->state.Init(rules.size, set);
+  match->seats[0] = it->second;
+  match->seats[1] = &connection;
+  lobby_.erase(it);
+  Match *started = match.get();
+  loop.matches[started] = std::move(match);
+  Start(loop, *started);
+
+  // Spread the matches over the loops.
+  std::size_t target = next_loop_++ % loops_.size();
+  if (target != 0) pending_.push_back(std::make_pair(started, target));
+}
+
+// Tell the players of a new match their seats and who acts first.
+void Server::Start(Loop &loop, Match &match) {
+  Message message;
+  message.type = kJoinedMessage;
+  for (std::size_t seat = 0; seat != 2; ++seat) {
+    match.seats[seat]->match = &match;
+    match.seats[seat]->seat = seat;
+    message.seat = seat;
+    Send(loop, *match.seats[seat], message);
+  }
+  SendTurn(loop, match);
+}
+
+// Place a ship for a client if it is their turn to.
+void Server::Place(Loop &loop, Connection &connection, Ship const &ship) {
+  Match *match = connection.match;
+  if (match == 0 || match->state.phase() != GameState::kPlacing ||
+      Actor(match->state) != connection.seat) {
+    SendError(loop, connection, kNotYourTurn);
+    return;
+  }
+
+  // GameState trusts coordinates to be on the board.
+  GameState &state = match->state;
+  Message message;
+  message.type = kPlacedMessage;
+  message.ship = ship;
+  std::size_t side = std::max(state.size().x, state.size().y);
+  if (ship.x >= state.size().x || ship.y >= state.size().y ||
+      ship.length > side) {
+    message.place = GameState::kOutOfBounds;
+    Send(loop, connection, message);
+    return;
+  }
+
+  std::size_t turn = state.turn();
+  message.place = state.Place(ship).type;
+  Send(loop, connection, message);
+  if (state.turn() != turn || state.phase() != GameState::kPlacing)
+    SendTurn(loop, *match);
+}
+
+// Attack for a client if it is their turn to, and end the match if they won.
+void Server::Attack(Loop &loop, Connection &connection, std::size_t x,
+                    std::size_t y) {
+  Match *match = connection.match;
+  if (match == 0 || match->state.phase() != GameState::kAttacking ||
+      Actor(match->state) != connection.seat) {
+    SendError(loop, connection, kNotYourTurn);
+    return;
+  }
+  GameState &state = match->state;
+  if (x >= state.size().x || y >= state.size().y) {
+    SendError(loop, connection, kBadMessage);
+    return;
+  }
+
+  Message message;
+  message.type = kAttackedMessage;
+  message.board = state.turn();
+  message.x = x;
+  message.y = y;
+  Board::AttackResult result = state.Attack(x, y);
+  message.attack = result.type;
+  if (result.type == Board::kSunk) message.ship = *result.ship;
+  if (result.type == Board::kRetry) {
+    Send(loop, connection, message);
+    return;
+  }
+  Send(loop, *match->seats[0], message);
+  Send(loop, *match->seats[1], message);
+
+  if (state.phase() == GameState::kFinished) {
+    message.type = kFinishedMessage;
+    message.seat = state.turn();
+    Send(loop, *match->seats[0], message);
+    Send(loop, *match->seats[1], message);
+    EndMatch(loop, *match);
+  }
+}
+
+// Tell both players the phase and board of a match.
+void Server::SendTurn(Loop &loop, Match &match) {
+  Message message;
+  message.type = kTurnMessage;
+  message.phase = match.state.phase();
+  message.board = match.state.turn();
+  Send(loop, *match.seats[0], message);
+  Send(loop, *match.seats[1], message);
+}
+
+// Queue a message, it is written once the current events are handled.
+void Server::Send(Loop &loop, Connection &connection, Message const &message) {
+  if (connection.output.empty()) loop.dirty.push_back(connection.fd);
+  EncodeMessage(message, connection.output);
+}
+
+// Queue an error.
+void Server::SendError(Loop &loop, Connection &connection, ErrorCode error) {
+  Message message;
+  message.type = kErrorMessage;
+  message.error = error;
+  Send(loop, connection, message);
+}
+
+// Forget a match and close its connections once they have written all.
+void Server::EndMatch(Loop &loop, Match &match) {
+  for (std::size_t seat = 0; seat != 2; ++seat) {
+    Connection &connection = *match.seats[seat];
+    connection.match = 0;
+    connection.closing = true;
+    loop.dirty.push_back(connection.fd);
+  }
+  loop.matches.erase(&match);
+}
+
+// Close a connection now, telling the opponent if it was playing.
+void Server::Close(Loop &loop, Connection &connection) {
+  if (Match *match = connection.match) {
+    Message message;
+    message.type = kLeftMessage;
+    Send(loop, *match->seats[1 - connection.seat], message);
+    EndMatch(loop, *match);
+  } else if (connection.joined && &loop == loops_[0].get()) {
+    for (std::map<std::vector<std::size_t>, Connection *>::iterator it =
+             lobby_.begin();
+         it != lobby_.end(); ++it) {
+      if (it->second != &connection) continue;
+      lobby_.erase(it);
+      break;
+    }
+  }
+  close(connection.fd);
+  loop.connections.erase(connection.fd);
+}
+
+// Write the output queued while handling the current events.
+void Server::Flush(Loop &loop) {
+  // Writing may close connections and queue more, so go by index.
+  for (std::size_t i = 0; i != loop.dirty.size(); ++i) {
+    std::unordered_map<int, std::unique_ptr<Connection> >::iterator it =
+        loop.connections.find(loop.dirty[i]);
+    if (it != loop.connections.end()) Write(loop, *it->second);
+  }
+  loop.dirty.clear();
+}
+
+// Move the matches loop 0 paired to the loops that play them.
+void Server::HandOff(Loop &loop) {
+  for (std::size_t i = 0, e = pending_.size(); i != e; ++i) {
+    // The match may already be over if a player left.
+    std::unordered_map<Match *, std::unique_ptr<Match> >::iterator it =
+        loop.matches.find(pending_[i].first);
+    if (it == loop.matches.end()) continue;
+
+    Handoff handoff;
+    handoff.match = std::move(it->second);
+    loop.matches.erase(it);
+    for (std::size_t seat = 0; seat != 2; ++seat) {
+      int fd = handoff.match->seats[seat]->fd;
+      epoll_ctl(loop.epoll, EPOLL_CTL_DEL, fd, 0);
+      handoff.seats[seat] = std::move(loop.connections[fd]);
+      loop.connections.erase(fd);
+    }
+    Loop &target = *loops_[pending_[i].second];
+    {
+      std::lock_guard<std::mutex> lock(target.mutex);
+      target.inbox.push_back(std::move(handoff));
+    }
+    std::uint64_t one = 1;
+    if (write(target.wake, &one, sizeof(one)) < 0) continue;
+  }
+  pending_.clear();
+}
+
+// Construct a server with a number of event loops, 0 for one per hardware
+// thread. Call Listen* and Start to serve.
+Server::Server(std::size_t loops) : next_loop_(0), stopping_(false) {
+  if (loops == 0) loops = std::thread::hardware_concurrency();
+  if (loops == 0) loops = 1;
+  for (std::size_t i = 0; i != loops; ++i) {
+    std::unique_ptr<Loop> loop(new Loop);
+    loop->epoll = epoll_create1(EPOLL_CLOEXEC);
+    loop->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    Watch(loop->epoll, EPOLL_CTL_ADD, loop->wake, false);
+    loops_.push_back(std::move(loop));
+  }
+}
+
+// Stop serving and close every socket.
+Server::~Server() {
+  Stop();
+  for (std::size_t i = 0, e = loops_.size(); i != e; ++i) {
+    Loop &loop = *loops_[i];
+    for (std::unordered_map<int, std::unique_ptr<Connection> >::iterator it =
+             loop.connections.begin();
+         it != loop.connections.end(); ++it)
+      close(it->first);
+    for (std::size_t j = 0, e2 = loop.inbox.size(); j != e2; ++j)
+      for (std::size_t seat = 0; seat != 2; ++seat)
+        close(loop.inbox[j].seats[seat]->fd);
+    close(loop.epoll);
+    close(loop.wake);
+  }
+  for (std::size_t i = 0, e = listeners_.size(); i != e; ++i)
+    close(listeners_[i]);
+  for (std::size_t i = 0, e = unix_paths_.size(); i != e; ++i)
+    unlink(unix_paths_[i].c_str());
+}
+
+// Listen for TCP connections on a port of every interface.
+bool Server::ListenTcp(std::uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) return false;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+    close(fd);
+    return false;
+  }
+  return AddListener(fd);
+}
+
+// Listen for connections on a Unix socket, replacing any file at path.
+bool Server::ListenUnix(char const *path) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (std::strlen(path) >= sizeof(address.sun_path)) return false;
+  std::strcpy(address.sun_path, path);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) return false;
+  unlink(path);
+  if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+    close(fd);
+    return false;
+  }
+  unix_paths_.push_back(path);
+  return AddListener(fd);
+}
+
+// Run every loop on its own thread.
+void Server::Start() {
+  for (std::size_t i = 0, e = loops_.size(); i != e; ++i)
+    threads_.push_back(std::thread(&Server::Run, this, i));
+}
+
+// Stop the loops and wait for them.
+void Server::Stop() {
+  stopping_ = true;
+  for (std::size_t i = 0, e = loops_.size(); i != e; ++i) {
+    std::uint64_t one = 1;
+    if (write(loops_[i]->wake, &one, sizeof(one)) < 0) continue;
+  }
+  for (std::size_t i = 0, e = threads_.size(); i != e; ++i) threads_[i].join();
+  threads_.clear();
+}
+
+}  // namespace battleship
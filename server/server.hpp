@@ -0,0 +1,111 @@
+#ifndef BATTLESHIP_SERVER_H
+#define BATTLESHIP_SERVER_H
+
+#include "game_state.hpp"
+#include "protocol.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace battleship {
+
+// Hosts matches between clients speaking the protocol of protocol.hpp over
+// TCP and Unix sockets. Every event loop runs on its own thread around an
+// epoll instance. Loop 0 also accepts connections and pairs the clients that
+// join, then hands every new match with its two connections to a loop in
+// turn, which plays it to the end.
+class Server {
+ private:
+  struct Match;
+
+  struct Connection {
+    int fd;
+    std::vector<std::uint8_t> input;
+    std::vector<std::uint8_t> output;
+    // How much of output was written.
+    std::size_t written;
+    Match *match;
+    std::size_t seat;
+    bool joined;
+    // Close once the output is written.
+    bool closing;
+    // Whether epoll is waiting for the socket to take more output.
+    bool want_write;
+  };
+
+  // A match and its players, seat i attacks board i.
+  struct Match {
+    GameState state;
+    Connection *seats[2];
+  };
+
+  // A match handed from loop 0 to another loop.
+  struct Handoff {
+    std::unique_ptr<Match> match;
+    std::unique_ptr<Connection> seats[2];
+  };
+
+  struct Loop {
+    int epoll;
+    // Written to when handoffs arrive or the server stops.
+    int wake;
+    std::unordered_map<int, std::unique_ptr<Connection> > connections;
+    std::unordered_map<Match *, std::unique_ptr<Match> > matches;
+    // Connections with output to write at the end of the current events.
+    std::vector<int> dirty;
+    std::mutex mutex;
+    std::vector<Handoff> inbox;
+  };
+
+  std::vector<std::unique_ptr<Loop> > loops_;
+  std::vector<int> listeners_;
+  std::vector<std::string> unix_paths_;
+  std::vector<std::thread> threads_;
+  // Clients of loop 0 waiting for an opponent, by the rules they want.
+  std::map<std::vector<std::size_t>, Connection *> lobby_;
+  // Matches loop 0 paired in the current events and the loops they go to.
+  std::vector<std::pair<Match *, std::size_t> > pending_;
+  std::size_t next_loop_;
+  std::atomic<bool> stopping_;
+
+  bool AddListener(int fd);
+  void Run(std::size_t loop);
+  void Accept(Loop &loop, int listener);
+  void Adopt(Loop &loop);
+  void Read(Loop &loop, Connection &connection);
+  void Write(Loop &loop, Connection &connection);
+  void Handle(Loop &loop, Connection &connection, Message const &message);
+  void Join(Loop &loop, Connection &connection, GameRules const &rules);
+  void Start(Loop &loop, Match &match);
+  void Place(Loop &loop, Connection &connection, Ship const &ship);
+  void Attack(Loop &loop, Connection &connection, std::size_t x,
+              std::size_t y);
+  void SendTurn(Loop &loop, Match &match);
+  void Send(Loop &loop, Connection &connection, Message const &message);
+  void SendError(Loop &loop, Connection &connection, ErrorCode error);
+  void EndMatch(Loop &loop, Match &match);
+  void Close(Loop &loop, Connection &connection);
+  void Flush(Loop &loop);
+  void HandOff(Loop &loop);
+
+  Server(Server const &);
+  Server &operator=(Server const &);
+
+ public:
+  explicit Server(std::size_t loops);
+  ~Server();
+  bool ListenTcp(std::uint16_t port);
+  bool ListenUnix(char const *path);
+  void Start();
+  void Stop();
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_SERVER_H
@@ -0,0 +1,416 @@
+#include "book_attacker.hpp"
+#include "density_attacker.hpp"
+#include "fleet_generator.hpp"
+#include "game_context.hpp"
+#include "metrics.hpp"
+#include "opening_book.hpp"
+#include "posterior_attacker.hpp"
+#include "random_attacker.hpp"
+#include "record_writer.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace battleship {
+namespace {
+
+// Games handed to a worker at a time.
+std::size_t const kChunkSize = 256;
+
+struct Options {
+  std::uint64_t games;
+  std::size_t threads;
+  std::uint64_t seed;
+  MapSize size;
+  std::vector<std::size_t> lengths;
+  std::string strategies[2];
+  GameState::Variant variant;
+  // Where to append every game, empty to record nothing.
+  std::string record;
+  // Where to write metrics, empty to time nothing.
+  std::string metrics;
+  // The opening book of one of the strategies, empty to play without.
+  std::string book;
+};
+
+// Sums over played games. Everything is an integer so merging the workers in
+// any order gives the same result.
+struct Tally {
+  std::uint64_t games;
+  std::uint64_t wins[2];
+  std::uint64_t shots;
+  std::uint64_t shots_squared;
+  // Games not played as their fleets could not be placed.
+  std::uint64_t unplaced;
+};
+
+// The record file shared by the workers.
+struct Recorder {
+  RecordWriter writer;
+  std::mutex mutex;
+  // The player ids of the two strategies.
+  std::uint32_t players[2];
+  bool failed;
+};
+
+// The state a worker reuses from game to game.
+struct Worker {
+  GameContext context;
+  std::unique_ptr<Attacker> attackers[2];
+  Tally tally;
+  GameRecord record;
+  // Scratch space for salvos.
+  std::vector<Cell> salvo;
+  std::vector<Board::AttackResult> results;
+};
+
+// Mix a seed and a game number into an independent seed.
+std::uint64_t MixSeed(std::uint64_t seed, std::uint64_t game) {
+  std::uint64_t z = seed + (game + 1) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// Return a new attacker from its name or null if there is no such strategy.
+Attacker *MakeAttacker(std::string const &name) {
+  if (name == "random") return new RandomAttacker;
+  if (name == "density") return new DensityAttacker;
+  if (name == "posterior") return new PosteriorAttacker;
+  return 0;
+}
+
+// Append a finished game to the record file.
+void RecordGame(Worker &worker, Options const &options, std::uint64_t game,
+                Recorder &recorder) {
+  GameRecord &record = worker.record;
+  record.size = options.size;
+  record.ship_set = options.lengths;
+  for (std::size_t i = 0; i != 2; ++i) {
+    record.players[i] = recorder.players[(i + game) % 2];
+    Ship const *fleet = worker.context.fleet(i);
+    record.fleets[i].resize(options.lengths.size());
+    for (std::size_t j = 0, e = options.lengths.size(); j != e; ++j)
+      record.fleets[i][j] = Pack(fleet[j]);
+  }
+  std::lock_guard<std::mutex> lock(recorder.mutex);
+  if (!recorder.writer.Write(record)) recorder.failed = true;
+}
+
+// Play one game between the two attackers. Board 0 is attacked first, by
+// attacker game % 2, so the first move alternates with the game number. A
+// game whose fleets cannot be placed is counted as unplaced and not played.
+void PlayGame(Worker &worker, Options const &options, std::uint64_t game,
+              Recorder *recorder) {
+  ShipSet set = {const_cast<std::size_t *>(&options.lengths[0]),
+                 const_cast<std::size_t *>(&options.lengths[0]) +
+                     options.lengths.size()};
+  std::uint64_t seed = MixSeed(options.seed, game);
+  GameContext &context = worker.context;
+  context.Seed(static_cast<unsigned>(seed));
+  if (!context.Reset(options.size, set, options.variant) ||
+      !context.PlaceRandomFleets()) {
+    ++worker.tally.unplaced;
+    return;
+  }
+  for (std::size_t i = 0; i != 2; ++i) {
+    worker.attackers[i]->Seed(static_cast<unsigned>(seed >> 32) + i);
+    worker.attackers[i]->Init(options.size, set);
+  }
+
+  GameState &state = context.state();
+  std::uint64_t shots[2] = {0, 0};
+  worker.record.attacks.clear();
+  while (state.phase() != GameState::kFinished) {
+    ScopedTimer turn_timer(kTurnTimer);
+    std::size_t turn = (state.turn() + game) % 2;
+    if (options.variant == GameState::kSalvo) {
+      // Salvo games are never recorded.
+      std::size_t count = state.shots();
+      worker.salvo.resize(count);
+      worker.results.resize(count);
+      {
+        ScopedTimer move_timer(kMoveTimer);
+        worker.attackers[turn]->NextSalvo(&worker.salvo[0], count);
+      }
+      state.AttackMany(&worker.salvo[0], count, &worker.results[0]);
+      for (std::size_t i = 0; i != count; ++i) {
+        Cell cell = worker.salvo[i];
+        worker.attackers[turn]->Observe(cell.x, cell.y, worker.results[i]);
+      }
+      shots[turn] += count;
+      continue;
+    }
+    Cell cell;
+    {
+      ScopedTimer move_timer(kMoveTimer);
+      cell = worker.attackers[turn]->NextAttack();
+    }
+    Board::AttackResult res = state.Attack(cell.x, cell.y);
+    worker.attackers[turn]->Observe(cell.x, cell.y, res);
+    ++shots[turn];
+    if (recorder != 0 && res.type != Board::kRetry) {
+      RecordedAttack attack = {cell.x, cell.y, res.type};
+      worker.record.attacks.push_back(attack);
+    }
+  }
+  if (recorder != 0) RecordGame(worker, options, game, *recorder);
+
+  std::size_t winner = (state.turn() + game) % 2;
+  Tally &tally = worker.tally;
+  ++tally.games;
+  ++tally.wins[winner];
+  tally.shots += shots[winner];
+  tally.shots_squared += shots[winner] * shots[winner];
+}
+
+// Parse "WxH".
+bool ParseSize(char const *text, MapSize &size) {
+  char *end;
+  size.x = std::strtoul(text, &end, 10);
+  if (*end != 'x') return false;
+  size.y = std::strtoul(end + 1, &end, 10);
+  return *end == '\0' && size.x != 0 && size.y != 0;
+}
+
+// Parse "a,b,c".
+bool ParseLengths(char const *text, std::vector<std::size_t> &lengths) {
+  lengths.clear();
+  for (;;) {
+    char *end;
+    std::size_t length = std::strtoul(text, &end, 10);
+    if (end == text || length == 0) return false;
+    lengths.push_back(length);
+    if (*end == '\0') return true;
+    if (*end != ',') return false;
+    text = end + 1;
+  }
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: battleship_sim [options] STRATEGY1 STRATEGY2\n"
+               "  --games N      number of games (default 100000)\n"
+               "  --threads N    worker threads (default: all cores)\n"
+               "  --seed N       base seed (default 1)\n"
+               "  --size WxH     map size (default 10x10)\n"
+               "  --set A,B,...  ship lengths (default 2,3,3,4,5)\n"
+               "  --salvo        fire one shot per ship afloat every turn\n"
+               "  --record FILE  append every game to a record file,\n"
+               "                 not with --salvo nor on boards over 1024\n"
+               "                 cells a side\n"
+               "  --metrics FILE time every operation and write counts and\n"
+               "                 latencies, as Prometheus text if FILE ends\n"
+               "                 in .prom and as JSON otherwise\n"
+               "  --book FILE    play the openings of a battleship_book book\n"
+               "                 for the strategy it was built for\n"
+               "strategies: random, density, posterior\n"
+               "posterior works to a time budget and is not reproducible,\n"
+               "and only on maps up to 26x26\n");
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+  options.games = 100000;
+  options.threads = 0;
+  options.seed = 1;
+  options.variant = GameState::kStandard;
+  options.size = GetPresetMapSize(1);
+  ShipSet set = GetPresetShipSet(1);
+  options.lengths.assign(set.first, set.last);
+
+  std::size_t strategies = 0;
+  for (int i = 1; i < argc; ++i) {
+    char const *arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(arg, "--games") == 0 && has_value) {
+      options.games = std::strtoull(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--threads") == 0 && has_value) {
+      options.threads = std::strtoul(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--seed") == 0 && has_value) {
+      options.seed = std::strtoull(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--size") == 0 && has_value) {
+      if (!ParseSize(argv[++i], options.size)) return false;
+    } else if (std::strcmp(arg, "--set") == 0 && has_value) {
+      if (!ParseLengths(argv[++i], options.lengths)) return false;
+    } else if (std::strcmp(arg, "--salvo") == 0) {
+      options.variant = GameState::kSalvo;
+    } else if (std::strcmp(arg, "--record") == 0 && has_value) {
+      options.record = argv[++i];
+    } else if (std::strcmp(arg, "--metrics") == 0 && has_value) {
+      options.metrics = argv[++i];
+    } else if (std::strcmp(arg, "--book") == 0 && has_value) {
+      options.book = argv[++i];
+    } else if (arg[0] != '-' && strategies != 2) {
+      options.strategies[strategies++] = arg;
+    } else {
+      return false;
+    }
+  }
+  if (strategies != 2 || options.games == 0) return false;
+  // Records are a sequence of single attacks in turn, with the ships packed.
+  if (!options.record.empty() &&
+      (options.variant == GameState::kSalvo ||
+       !CanPack(options.size.x, options.size.y)))
+    return false;
+
+  // Every fleet must fit on the board, and the posterior solver only works on
+  // boards that fit a Bitboard.
+  bool posterior = options.strategies[0] == "posterior" ||
+                   options.strategies[1] == "posterior";
+  if (posterior && (options.size.x > Bitboard::kMaxWidth ||
+                    options.size.y > Bitboard::kMaxHeight))
+    return false;
+  std::size_t cells = 0;
+  for (std::size_t i = 0, e = options.lengths.size(); i != e; ++i) {
+    if (options.lengths[i] > std::max(options.size.x, options.size.y))
+      return false;
+    cells += options.lengths[i];
+  }
+  return cells <= options.size.x * options.size.y;
+}
+
+// Return the half width of a 95% confidence interval of a mean.
+double ConfidenceInterval(double sum, double sum_squared, double n) {
+  if (n < 2) return 0;
+  double mean = sum / n;
+  double variance = (sum_squared - n * mean * mean) / (n - 1);
+  return 1.96 * std::sqrt(std::max(variance, 0.0) / n);
+}
+
+}  // namespace
+}  // namespace battleship
+
+int main(int argc, char *argv[]) {
+  using namespace battleship;
+
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+
+  // The book is mapped once and shared by the workers.
+  OpeningBook book;
+  if (!options.book.empty() && !book.Open(options.book.c_str())) {
+    std::fprintf(stderr, "cannot read %s\n", options.book.c_str());
+    return 1;
+  }
+  ShipSet set = {&options.lengths[0],
+                 &options.lengths[0] + options.lengths.size()};
+  if (!options.book.empty() &&
+      (!book.Matches(options.size, set) ||
+       (options.strategies[0] != book.strategy() &&
+        options.strategies[1] != book.strategy()))) {
+    std::fprintf(stderr, "%s is a book of %s for another game\n",
+                 options.book.c_str(), book.strategy().c_str());
+    return 1;
+  }
+
+  // ParseOptions checked the lengths and cells of the set, but a set can still
+  // have no room to lie side by side.
+  FleetGenerator generator(static_cast<unsigned>(options.seed));
+  std::vector<Ship> fleet(options.lengths.size());
+  if (!generator.Init(options.size, set) || !generator.Generate(&fleet[0])) {
+    std::fprintf(stderr, "the ships do not fit on the board\n");
+    return 1;
+  }
+
+  SetMetricsTiming(!options.metrics.empty());
+  WorkStealingPool pool(options.threads);
+  std::vector<Worker> workers(pool.threads());
+  for (std::size_t i = 0, e = workers.size(); i != e; ++i) {
+    Tally tally = {0, {0, 0}, 0, 0, 0};
+    workers[i].tally = tally;
+    for (std::size_t j = 0; j != 2; ++j) {
+      workers[i].attackers[j].reset(MakeAttacker(options.strategies[j]));
+      if (!workers[i].attackers[j]) {
+        std::fprintf(stderr, "unknown strategy: %s\n",
+                     options.strategies[j].c_str());
+        return 1;
+      }
+      if (!options.book.empty() && options.strategies[j] == book.strategy())
+        workers[i].attackers[j].reset(
+            new BookAttacker(workers[i].attackers[j].release(), &book));
+    }
+  }
+
+  // Games land in the file in the order they finish, not by game number.
+  std::unique_ptr<Recorder> recorder;
+  if (!options.record.empty()) {
+    recorder.reset(new Recorder);
+    recorder->failed = false;
+    if (!recorder->writer.Open(options.record.c_str())) {
+      std::fprintf(stderr, "cannot append to %s\n", options.record.c_str());
+      return 1;
+    }
+    for (std::size_t i = 0; i != 2; ++i)
+      recorder->players[i] = recorder->writer.AddPlayer(options.strategies[i]);
+  }
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  pool.ParallelFor(options.games, kChunkSize,
+                   [&](std::size_t worker, std::size_t begin, std::size_t end) {
+                     for (std::size_t game = begin; game != end; ++game)
+                       PlayGame(workers[worker], options, game,
+                                recorder.get());
+                   });
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  Tally total = {0, {0, 0}, 0, 0, 0};
+  for (std::size_t i = 0, e = workers.size(); i != e; ++i) {
+    total.games += workers[i].tally.games;
+    total.wins[0] += workers[i].tally.wins[0];
+    total.wins[1] += workers[i].tally.wins[1];
+    total.shots += workers[i].tally.shots;
+    total.shots_squared += workers[i].tally.shots_squared;
+    total.unplaced += workers[i].tally.unplaced;
+  }
+  if (total.unplaced != 0) {
+    std::fprintf(stderr, "the fleets of %llu games could not be placed\n",
+                 static_cast<unsigned long long>(total.unplaced));
+    return 1;
+  }
+
+  if (recorder && (!recorder->writer.Close() || recorder->failed)) {
+    std::fprintf(stderr, "cannot write %s\n", options.record.c_str());
+    return 1;
+  }
+  if (!options.metrics.empty()) {
+    Metrics metrics;
+    CollectMetrics(metrics);
+    if (!WriteMetrics(options.metrics, metrics)) {
+      std::fprintf(stderr, "cannot write %s\n", options.metrics.c_str());
+      return 1;
+    }
+  }
+
+  double n = static_cast<double>(total.games);
+  std::printf("games: %llu\n", static_cast<unsigned long long>(total.games));
+  for (std::size_t i = 0; i != 2; ++i) {
+    double wins = static_cast<double>(total.wins[i]);
+    std::printf("%s wins: %llu (%.2f%% +- %.2f%%)\n",
+                options.strategies[i].c_str(),
+                static_cast<unsigned long long>(total.wins[i]),
+                100 * wins / n, 100 * ConfidenceInterval(wins, wins, n));
+  }
+  std::printf("shots to win: %.3f +- %.3f\n",
+              static_cast<double>(total.shots) / n,
+              ConfidenceInterval(static_cast<double>(total.shots),
+                                 static_cast<double>(total.shots_squared), n));
+  std::fprintf(stderr, "%.2f s, %.0f games/s on %zu threads\n", seconds,
+               n / seconds, pool.threads());
+  return 0;
+}
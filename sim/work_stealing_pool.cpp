@@ -0,0 +1,74 @@
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+namespace battleship {
+
+// Take the most recently queued chunk of a worker's own queue.
+bool WorkStealingPool::Pop(std::size_t worker, std::size_t &chunk) {
+  Queue &queue = queues_[worker];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.chunks.empty()) return false;
+  chunk = queue.chunks.back();
+  queue.chunks.pop_back();
+  return true;
+}
+
+// Take the oldest chunk of the first other worker that has one left.
+bool WorkStealingPool::Steal(std::size_t worker, std::size_t &chunk) {
+  for (std::size_t i = 1; i != threads_; ++i) {
+    Queue &queue = queues_[(worker + i) % threads_];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.chunks.empty()) continue;
+    chunk = queue.chunks.front();
+    queue.chunks.pop_front();
+    return true;
+  }
+  return false;
+}
+
+// Run chunks until no worker has any left. No chunks are added while running
+// so an empty pool means we are done.
+void WorkStealingPool::Work(std::size_t worker, std::size_t count,
+                            std::size_t chunk_size, Task const &task) {
+  std::size_t chunk;
+  while (Pop(worker, chunk) || Steal(worker, chunk)) {
+    std::size_t begin = chunk * chunk_size;
+    task(worker, begin, std::min(begin + chunk_size, count));
+  }
+}
+
+// Construct a pool, 0 threads means one per hardware thread.
+WorkStealingPool::WorkStealingPool(std::size_t threads) : threads_(threads) {
+  if (threads_ == 0) threads_ = std::thread::hardware_concurrency();
+  if (threads_ == 0) threads_ = 1;
+  queues_.reset(new Queue[threads_]);
+}
+
+// Return the number of workers.
+std::size_t WorkStealingPool::threads() const { return threads_; }
+
+// Call task on chunks of chunk_size indexes covering [0, count) and return once
+// all of them are done. The calling thread is worker 0.
+void WorkStealingPool::ParallelFor(std::size_t count, std::size_t chunk_size,
+                                   Task const &task) {
+  assert(chunk_size != 0);
+  std::size_t chunks = (count + chunk_size - 1) / chunk_size;
+  for (std::size_t i = 0; i != threads_; ++i) {
+    std::size_t first = chunks * i / threads_;
+    std::size_t last = chunks * (i + 1) / threads_;
+    for (std::size_t c = first; c != last; ++c) queues_[i].chunks.push_back(c);
+  }
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i != threads_; ++i)
+    threads.push_back(std::thread(&WorkStealingPool::Work, this, i, count,
+                                  chunk_size, std::cref(task)));
+  Work(0, count, chunk_size, task);
+  for (std::size_t i = 0, e = threads.size(); i != e; ++i) threads[i].join();
+}
+
+}  // namespace battleship
@@ -0,0 +1,40 @@
+#ifndef BATTLESHIP_WORK_STEALING_POOL_H
+#define BATTLESHIP_WORK_STEALING_POOL_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace battleship {
+
+// Runs chunks of an index range on a fixed number of threads. Every worker
+// starts with its own contiguous share of the chunks and steals from the other
+// workers once it runs dry.
+class WorkStealingPool {
+ public:
+  // Called with the index of the worker and a half open range of indexes.
+  typedef std::function<void(std::size_t, std::size_t, std::size_t)> Task;
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::size_t> chunks;
+  };
+
+  std::size_t threads_;
+  std::unique_ptr<Queue[]> queues_;
+
+  bool Pop(std::size_t worker, std::size_t &chunk);
+  bool Steal(std::size_t worker, std::size_t &chunk);
+  void Work(std::size_t worker, std::size_t count, std::size_t chunk_size,
+            Task const &task);
+
+ public:
+  explicit WorkStealingPool(std::size_t threads);
+  std::size_t threads() const;
+  void ParallelFor(std::size_t count, std::size_t chunk_size, Task const &task);
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_WORK_STEALING_POOL_H
@@ -1,28 +1,23 @@
 #include "arena.hpp"
+#include "frame_trace.hpp"
 
+#include <QFontMetrics>
 #include <QMouseEvent>
 #include <QPainter>
+#include <QWheelEvent>
 
-#include <iostream>
+#include <algorithm>
+#include <cassert>
 
 namespace battleship {
 
-// Size constants.
+// Size constants, in pixels.
 static int const kCellSize = 30;
-static int const kAttackSize = 12;
-static int const kAttackMargin = (kCellSize - kAttackSize) / 2;
-static int const kMaxWidth = 26;
-static int const kMaxHeight = 26;
+static int const kMinCellSize = 6;
+static int const kMaxCellSize = 60;
 
-// Grid labels.
-static char const *const x_labels_[kMaxWidth] = {
-    "1",  "2",  "3",  "4",  "5",  "6",  "7",  "8",  "9",
-    "10", "11", "12", "13", "14", "15", "16", "17", "18",
-    "19", "20", "21", "22", "23", "24", "25", "26"};
-
-static char const *const y_labels_[kMaxHeight] = {
-    "A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M",
-    "N", "O", "P", "Q", "R", "S", "T", "U", "V", "W", "X", "Y", "Z"};
+// Room reserved up front: the cells of the largest preset board.
+static std::size_t const kReservedCells = 26 * 26;
 
 // Color constants.
 static int const kShipColor[] = {160, 160, 160};
@@ -31,6 +26,48 @@ static int const kHitColor[] = {255, 0, 0};
 static int const kSeaColor[] = {224, 224, 255};
 static int const kFocusColor[] = {0, 0, 255};
 static int const kDragColor[] = {192, 192, 224};
+static int const kOverlayColor[] = {255, 96, 0};
+static int const kMaxOverlayAlpha = 192;
+
+// Return the label of a row: A to Z, then AA, AB and so on.
+static QString MakeRowLabel(std::size_t y) {
+  QString label;
+  for (++y; y != 0; y = (y - 1) / 26)
+    label.prepend(QChar('A' + static_cast<int>((y - 1) % 26)));
+  return label;
+}
+
+// Return the width of a text in pixels. QFontMetrics::width is deprecated
+// since Qt 5.11.
+static int TextWidth(QFontMetrics const &fm, QString const &text) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+  return fm.horizontalAdvance(text);
+#else
+  return fm.width(text);
+#endif
+}
+
+// Reports a mouse event to a trace, if there is one, for as long as it is
+// being handled.
+class TracedInput {
+ private:
+  FrameTrace *trace_;
+  std::size_t track_;
+
+  TracedInput(TracedInput const &);
+  TracedInput &operator=(TracedInput const &);
+
+ public:
+  TracedInput(FrameTrace *trace, std::size_t track, FrameTrace::InputType type,
+              QMouseEvent const *event)
+      : trace_(trace), track_(track) {
+    if (trace_) trace_->BeginInput(track_, type, event->x(), event->y());
+  }
+
+  ~TracedInput() {
+    if (trace_) trace_->EndInput(track_);
+  }
+};
 
 struct ShipOption {
   bool is_valid;
@@ -81,42 +118,52 @@ bool Arena::CheckBounds(int x, int y) {
 // Convert screen coordinates to grid numbers.
 int Arena::GetCellFromPosition(int pos) {
   // The grid is offset by 1 because of the labels
-  return pos / kCellSize - 1;
+  return pos / cell_size_ - 1;
 }
 
-// Draw the arena according to mode.
-void Arena::paintEvent(QPaintEvent *) {
-  DrawGrid();
+// Draw the dirty part of the arena according to mode.
+void Arena::paintEvent(QPaintEvent *event) {
+  if (trace_) trace_->BeginPaint(trace_track_);
+  // Outlines reach a pixel past the rects of the shapes.
+  QRect dirty = event->rect();
+  QRect reach = dirty.adjusted(-1, -1, 1, 1);
+  QPainter painter(this);
+  DrawGrid(painter, dirty);
+  DrawOverlay(painter, dirty);
+  DrawLabels(painter, dirty);
 
   switch (mode_) {
     case kPlace:
-      DrawDrag();
+      DrawDrag(painter);
+      // Fall through.
     case kReveal:
-      DrawReveal();
+      DrawShips(painter, reach, reveal_ships_);
       break;
 
     case kAttack:
     case kDisplay:
-      DrawSunk();
+      DrawShips(painter, reach, sunk_ships_);
       break;
   }
 
   switch (mode_) {
     case kPlace:
     case kAttack:
-      DrawFocus();
+      DrawFocus(painter);
       break;
     case kReveal:
     case kDisplay:
       break;
   }
 
-  DrawMisses();
-  DrawHits();
+  DrawMarks(painter, dirty);
+  painter.end();
+  if (trace_) trace_->EndPaint(trace_track_);
 }
 
 // Handle a button press.
 void Arena::mousePressEvent(QMouseEvent *event) {
+  TracedInput traced(trace_, trace_track_, FrameTrace::kPress, event);
   // Check if we are in the map and convert to grid numbers.
   int x = GetCellFromPosition(event->x());
   int y = GetCellFromPosition(event->y());
@@ -132,8 +179,10 @@ void Arena::mousePressEvent(QMouseEvent *event) {
 
     case kPlace:
       // Mark the current cell as selected.
+      UpdateRect(drag_rect_);
       drag_rect_ = MakeSingleRect(x2, y2);
-      this->update();
+      UpdateRect(drag_rect_);
+      // Fall through.
     case kAttack:
       pressed_x_ = x2;
       pressed_y_ = y2;
@@ -143,9 +192,10 @@ void Arena::mousePressEvent(QMouseEvent *event) {
 
 // Handle a button release.
 void Arena::mouseReleaseEvent(QMouseEvent *event) {
+  TracedInput traced(trace_, trace_track_, FrameTrace::kRelease, event);
   // We don't have a selection anymore.
+  UpdateRect(drag_rect_);
   drag_rect_ = QRect();
-  this->update();
 
   // Check if we are in the map and convert to grid numbers.
   int x = GetCellFromPosition(event->x());
@@ -161,7 +211,11 @@ void Arena::mouseReleaseEvent(QMouseEvent *event) {
       break;
 
     case kAttack:
-      if (x2 == pressed_x_ && y2 == pressed_y_) emit Attacked(x2, y2);
+      if (x2 != pressed_x_ || y2 != pressed_y_) break;
+      if (salvo_size_ == 0)
+        emit Attacked(x2, y2);
+      else
+        ToggleTarget(x2, y2);
       break;
 
     case kPlace:
@@ -173,13 +227,17 @@ void Arena::mouseReleaseEvent(QMouseEvent *event) {
 
 // Handle mouse movement while a button is clicked.
 void Arena::mouseMoveEvent(QMouseEvent *event) {
+  TracedInput traced(trace_, trace_track_, FrameTrace::kMove, event);
+  // Only placements are dragged.
+  if (mode_ != kPlace) return;
+
   // Check if we are in the map and convert to grid numbers.
   int x = GetCellFromPosition(event->x());
   int y = GetCellFromPosition(event->y());
   if (!CheckBounds(x, y)) {
     // We don't have a selection anymore.
+    UpdateRect(drag_rect_);
     drag_rect_ = QRect();
-    this->update();
     return;
   }
   std::size_t x2 = static_cast<std::size_t>(x);
@@ -187,73 +245,160 @@ void Arena::mouseMoveEvent(QMouseEvent *event) {
 
   // Update the selection if it changed.
   ShipOption option = MakeShip(pressed_x_, pressed_y_, x2, y2);
-  if (option.is_valid) {
-    QRect rect = MakeShipRect(option.ship);
-    if (rect == drag_rect_) return;
-    drag_rect_ = rect;
-  } else
-    drag_rect_ = QRect();
-  this->update();
+  QRect rect;
+  if (option.is_valid) rect = MakeShipRect(option.ship);
+  if (rect == drag_rect_) return;
+  UpdateRect(drag_rect_);
+  drag_rect_ = rect;
+  UpdateRect(drag_rect_);
 }
 
-void Arena::DrawGrid() {
-  QPainter painter(this);
-  // We need an extra cell for the header.
-  int num_cell_x = x_size_ + 1;
-  int num_cell_y = y_size_ + 1;
+// Schedule a repaint of a rect and the outline drawn around it.
+void Arena::UpdateRect(QRect const &rect) {
+  if (rect.isNull()) return;
+  if (trace_) trace_->Update(trace_track_);
+  this->update(rect.adjusted(-1, -1, 1, 1));
+}
 
-  // Draw the background.
-  QBrush brush;
-  brush.setColor(QColor(kSeaColor[0], kSeaColor[1], kSeaColor[2]));
-  brush.setStyle(Qt::SolidPattern);
-  painter.fillRect(0, 0, num_cell_x * kCellSize, num_cell_y * kCellSize, brush);
+// Mark a cell for the salvo or unmark it if it was. Cells attacked before
+// cannot be marked. The salvo is fired once every shot has a cell.
+void Arena::ToggleTarget(std::size_t x, std::size_t y) {
+  std::uint8_t &mark = marks_[y * static_cast<std::size_t>(x_size_) + x];
+  if (mark == kTargetMark) {
+    mark = kNoMark;
+    for (std::size_t i = 0, e = targets_.size(); i != e; ++i) {
+      if (targets_[i].x != x || targets_[i].y != y) continue;
+      targets_.erase(targets_.begin() + static_cast<std::ptrdiff_t>(i));
+      break;
+    }
+  } else if (mark == kNoMark) {
+    mark = kTargetMark;
+    Cell cell = {x, y};
+    targets_.push_back(cell);
+  }
+  UpdateRect(MakeAttackRect(x, y));
+  if (targets_.size() != salvo_size_) return;
+
+  std::vector<Cell> salvo;
+  salvo.swap(targets_);
+  ClearTargets();
+  emit SalvoFired(salvo);
+}
 
-  // We need 1 more lines than cells.
-  int num_lines_x = num_cell_x + 1;
-  int num_lines_y = num_cell_y + 1;
+// Unmark the cells marked for the salvo.
+void Arena::ClearTargets() {
+  for (std::size_t i = 0, e = targets_.size(); i != e; ++i) {
+    Cell cell = targets_[i];
+    marks_[cell.y * static_cast<std::size_t>(x_size_) + cell.x] = kNoMark;
+    UpdateRect(MakeAttackRect(cell.x, cell.y));
+  }
+  targets_.clear();
+}
 
-  // Draw the lines on the x-axis.
-  for (int x = 0; x != num_lines_x; ++x) {
-    int start_x = x * kCellSize;
-    int end_y = num_cell_y * kCellSize;
-    painter.drawLine(start_x, 0, start_x, end_y);
+// Zoom with Ctrl and the wheel, leave the wheel to the scroll area otherwise.
+void Arena::wheelEvent(QWheelEvent *event) {
+  if (!(event->modifiers() & Qt::ControlModifier)) {
+    event->ignore();
+    return;
   }
+  if (event->angleDelta().y() > 0)
+    ZoomIn();
+  else if (event->angleDelta().y() < 0)
+    ZoomOut();
+  event->accept();
+}
+
+// Render a single cell of sea with its top and left lines into the tile.
+void Arena::RenderTile() {
+  device_ratio_ = devicePixelRatioF();
+  tile_ = QPixmap(QSize(cell_size_, cell_size_) * device_ratio_);
+  tile_.setDevicePixelRatio(device_ratio_);
+  tile_.fill(QColor(kSeaColor[0], kSeaColor[1], kSeaColor[2]));
 
-  // Draw the lines on the y-axis.
-  for (int y = 0; y != num_lines_y; ++y) {
-    int start_y = y * kCellSize;
-    int end_x = num_cell_x * kCellSize;
-    painter.drawLine(0, start_y, end_x, start_y);
+  QPainter painter(&tile_);
+  painter.drawLine(0, 0, cell_size_, 0);
+  painter.drawLine(0, 0, 0, cell_size_);
+}
+
+// Tile the dirty part of the grid, rendering the tile first if it is out of
+// date.
+void Arena::DrawGrid(QPainter &painter, QRect const &dirty) {
+  if (tile_.isNull() || device_ratio_ != devicePixelRatioF()) RenderTile();
+
+  // We need an extra cell for the header.
+  int end_x = (x_size_ + 1) * cell_size_;
+  int end_y = (y_size_ + 1) * cell_size_;
+  QRect area = dirty & QRect(0, 0, end_x, end_y);
+  if (!area.isEmpty()) {
+    QPoint offset(area.x() % cell_size_, area.y() % cell_size_);
+    painter.drawTiledPixmap(area, tile_, offset);
   }
 
-  QFontMetrics fm(painter.font());
+  // The tiles hold the top and left lines of every cell, close the grid.
+  painter.drawLine(end_x, 0, end_x, end_y);
+  painter.drawLine(0, end_y, end_x, end_y);
+}
 
-  // Label the x-axis using the x table.
-  for (int x = 1; x != num_cell_x; ++x) {
-    // Draw the label centered in the cell.
-    char const *label = x_labels_[x - 1];
-    int char_width = fm.width(label);
-    int char_height = fm.height();
-    int x_pos = x * kCellSize + (kCellSize - char_width) / 2;
-    int y_pos = (kCellSize + char_height) / 2;
-    painter.drawText(x_pos, y_pos, label);
+// Shade the cells of the heatmap in the dirty rect.
+void Arena::DrawOverlay(QPainter &painter, QRect const &dirty) {
+  if (overlay_.empty()) return;
+  int first_x = std::max(GetCellFromPosition(dirty.left()), 0);
+  int last_x = std::min(GetCellFromPosition(dirty.right()), x_size_ - 1);
+  int first_y = std::max(GetCellFromPosition(dirty.top()), 0);
+  int last_y = std::min(GetCellFromPosition(dirty.bottom()), y_size_ - 1);
+  for (int y = first_y; y <= last_y; ++y) {
+    for (int x = first_x; x <= last_x; ++x) {
+      std::size_t x2 = static_cast<std::size_t>(x);
+      std::size_t y2 = static_cast<std::size_t>(y);
+      int alpha = overlay_[y2 * static_cast<std::size_t>(x_size_) + x2];
+      if (alpha == 0) continue;
+      // Leave the grid lines of the tile visible.
+      QRect rect = MakeSingleRect(x2, y2).adjusted(1, 1, 0, 0);
+      painter.fillRect(rect, QColor(kOverlayColor[0], kOverlayColor[1],
+                                    kOverlayColor[2], alpha));
+    }
+  }
+}
+
+// Label the columns and rows in the dirty part of the headers. Labels that do
+// not fit their cell are left out.
+void Arena::DrawLabels(QPainter &painter, QRect const &dirty) {
+  QFontMetrics fm(painter.font());
+  int char_height = fm.height();
+
+  // Label the x-axis.
+  if (dirty.top() < cell_size_) {
+    int first = std::max(dirty.left() / cell_size_, 1);
+    int last = std::min(dirty.right() / cell_size_, x_size_);
+    for (int x = first; x <= last; ++x) {
+      // Draw the label centered in the cell.
+      QString const &label = x_labels_[static_cast<std::size_t>(x - 1)];
+      int char_width = TextWidth(fm, label);
+      if (char_width > cell_size_) continue;
+      int x_pos = x * cell_size_ + (cell_size_ - char_width) / 2;
+      int y_pos = (cell_size_ + char_height) / 2;
+      painter.drawText(x_pos, y_pos, label);
+    }
   }
 
-  // Label the y-axis using the y table.
-  for (int y = 1; y != num_cell_y; ++y) {
-    // Draw the label centered in the cell.
-    char const *label = y_labels_[y - 1];
-    int char_width = fm.width(label);
-    int char_height = fm.height();
-    int x_pos = (kCellSize - char_width) / 2;
-    int y_pos = y * kCellSize + (kCellSize + char_height) / 2;
-    painter.drawText(x_pos, y_pos, label);
+  // Label the y-axis.
+  if (dirty.left() < cell_size_) {
+    int first = std::max(dirty.top() / cell_size_, 1);
+    int last = std::min(dirty.bottom() / cell_size_, y_size_);
+    for (int y = first; y <= last; ++y) {
+      // Draw the label centered in the cell.
+      QString const &label = y_labels_[static_cast<std::size_t>(y - 1)];
+      int char_width = TextWidth(fm, label);
+      if (char_width > cell_size_) continue;
+      int x_pos = (cell_size_ - char_width) / 2;
+      int y_pos = y * cell_size_ + (cell_size_ + char_height) / 2;
+      painter.drawText(x_pos, y_pos, label);
+    }
   }
 }
 
 // Draw the arena as accepting input.
-void Arena::DrawFocus() {
-  QPainter painter(this);
+void Arena::DrawFocus(QPainter &painter) {
   QBrush brush;
   brush.setStyle(Qt::NoBrush);
   painter.setBrush(brush);
@@ -264,38 +409,28 @@ void Arena::DrawFocus() {
   QRect rect;
   rect.setLeft(1);
   rect.setTop(1);
-  rect.setRight(kCellSize * x_size_ + kCellSize);
-  rect.setBottom(kCellSize * y_size_ + kCellSize);
+  rect.setRight(cell_size_ * x_size_ + cell_size_);
+  rect.setBottom(cell_size_ * y_size_ + cell_size_);
   painter.drawRect(rect);
+  painter.setPen(QPen());
 }
 
-// Draw all sunk ships.
-void Arena::DrawSunk() {
-  QPainter painter(this);
-  QBrush brush;
-  brush.setColor(QColor(kShipColor[0], kShipColor[1], kShipColor[2]));
-  brush.setStyle(Qt::SolidPattern);
-  painter.setBrush(brush);
-
-  for (std::size_t i = 0, e = sunk_rects_.size(); i != e; ++i)
-    painter.drawRect(sunk_rects_[i]);
-}
-
-// Draw all revealed ships.
-void Arena::DrawReveal() {
-  QPainter painter(this);
+// Draw the ships of a list that reach the dirty rect.
+void Arena::DrawShips(QPainter &painter, QRect const &dirty,
+                      std::vector<Ship> const &ships) {
   QBrush brush;
   brush.setColor(QColor(kShipColor[0], kShipColor[1], kShipColor[2]));
   brush.setStyle(Qt::SolidPattern);
   painter.setBrush(brush);
 
-  for (std::size_t i = 0, e = reveal_rects_.size(); i != e; ++i)
-    painter.drawRect(reveal_rects_[i]);
+  for (std::size_t i = 0, e = ships.size(); i != e; ++i) {
+    QRect rect = MakeShipRect(ships[i]);
+    if (rect.intersects(dirty)) painter.drawRect(rect);
+  }
 }
 
 // Draw the current ship placement that is being dragged.
-void Arena::DrawDrag() {
-  QPainter painter(this);
+void Arena::DrawDrag(QPainter &painter) {
   QBrush brush;
   brush.setColor(QColor(kDragColor[0], kDragColor[1], kDragColor[2]));
   brush.setStyle(Qt::SolidPattern);
@@ -303,28 +438,41 @@ void Arena::DrawDrag() {
   painter.drawRect(drag_rect_);
 }
 
-// Draw all hit attacks.
-void Arena::DrawHits() {
-  QPainter painter(this);
-  QBrush brush;
-  brush.setColor(QColor(kHitColor[0], kHitColor[1], kHitColor[2]));
-  brush.setStyle(Qt::SolidPattern);
-  painter.setBrush(brush);
-
-  for (std::size_t i = 0, e = hit_rects_.size(); i != e; ++i)
-    painter.drawEllipse(hit_rects_[i]);
-}
-
-// Draw all missed attacks.
-void Arena::DrawMisses() {
-  QPainter painter(this);
-  QBrush brush;
-  brush.setColor(QColor(kMissColor[0], kMissColor[1], kMissColor[2]));
-  brush.setStyle(Qt::SolidPattern);
-  painter.setBrush(brush);
-
-  for (std::size_t i = 0, e = miss_rects_.size(); i != e; ++i)
-    painter.drawEllipse(miss_rects_[i]);
+// Draw the hits and misses of the cells in the dirty rect.
+void Arena::DrawMarks(QPainter &painter, QRect const &dirty) {
+  QBrush hit_brush;
+  hit_brush.setColor(QColor(kHitColor[0], kHitColor[1], kHitColor[2]));
+  hit_brush.setStyle(Qt::SolidPattern);
+  QBrush miss_brush;
+  miss_brush.setColor(QColor(kMissColor[0], kMissColor[1], kMissColor[2]));
+  miss_brush.setStyle(Qt::SolidPattern);
+  // Cells marked for the salvo in progress are drawn hollow.
+  QBrush target_brush;
+
+  int first_x = std::max(GetCellFromPosition(dirty.left()), 0);
+  int last_x = std::min(GetCellFromPosition(dirty.right()), x_size_ - 1);
+  int first_y = std::max(GetCellFromPosition(dirty.top()), 0);
+  int last_y = std::min(GetCellFromPosition(dirty.bottom()), y_size_ - 1);
+  for (int y = first_y; y <= last_y; ++y) {
+    for (int x = first_x; x <= last_x; ++x) {
+      std::size_t x2 = static_cast<std::size_t>(x);
+      std::size_t y2 = static_cast<std::size_t>(y);
+      switch (marks_[y2 * static_cast<std::size_t>(x_size_) + x2]) {
+        case kNoMark:
+          continue;
+        case kHitMark:
+          painter.setBrush(hit_brush);
+          break;
+        case kMissMark:
+          painter.setBrush(miss_brush);
+          break;
+        case kTargetMark:
+          painter.setBrush(target_brush);
+          break;
+      }
+      painter.drawEllipse(MakeAttackRect(x2, y2));
+    }
+  }
 }
 
 // Returns A rect covering an entire ship.
@@ -335,18 +483,18 @@ QRect Arena::MakeShipRect(Ship const &ship) {
   int length2 = static_cast<int>(ship.length);
 
   QRect rect;
-  rect.setLeft(x * kCellSize);
-  rect.setTop(y * kCellSize);
+  rect.setLeft(x * cell_size_);
+  rect.setTop(y * cell_size_);
 
   switch (ship.orientation) {
     case Ship::kHorizontal:
-      rect.setWidth(kCellSize * length2);
-      rect.setHeight(kCellSize);
+      rect.setWidth(cell_size_ * length2);
+      rect.setHeight(cell_size_);
       break;
 
     case Ship::kVertical:
-      rect.setWidth(kCellSize);
-      rect.setHeight(kCellSize * length2);
+      rect.setWidth(cell_size_);
+      rect.setHeight(cell_size_ * length2);
       break;
   }
 
@@ -359,11 +507,15 @@ QRect Arena::MakeAttackRect(std::size_t x, std::size_t y) {
   int x2 = static_cast<int>(x + 1);
   int y2 = static_cast<int>(y + 1);
 
+  // Attacks cover 2/5 of a cell.
+  int attack_size = cell_size_ * 2 / 5;
+  int attack_margin = (cell_size_ - attack_size) / 2;
+
   QRect rect;
-  rect.setLeft(x2 * kCellSize + kAttackMargin);
-  rect.setTop(y2 * kCellSize + kAttackMargin);
-  rect.setWidth(kAttackSize);
-  rect.setHeight(kAttackSize);
+  rect.setLeft(x2 * cell_size_ + attack_margin);
+  rect.setTop(y2 * cell_size_ + attack_margin);
+  rect.setWidth(attack_size);
+  rect.setHeight(attack_size);
   return rect;
 }
 
@@ -374,10 +526,10 @@ QRect Arena::MakeSingleRect(std::size_t x, std::size_t y) {
   int y2 = static_cast<int>(y + 1);
 
   QRect rect;
-  rect.setLeft(x2 * kCellSize);
-  rect.setTop(y2 * kCellSize);
-  rect.setWidth(kCellSize);
-  rect.setHeight(kCellSize);
+  rect.setLeft(x2 * cell_size_);
+  rect.setTop(y2 * cell_size_);
+  rect.setWidth(cell_size_);
+  rect.setHeight(cell_size_);
   return rect;
 }
 
@@ -393,6 +545,13 @@ void Arena::SetAttacking() {
   this->update();
 }
 
+// Attack a salvo of shots cells at a time from now on, or a cell per click
+// if shots is 0. Cells marked for a salvo before are unmarked.
+void Arena::SetSalvo(std::size_t shots) {
+  ClearTargets();
+  salvo_size_ = shots;
+}
+
 // Make the arena display Attacks and sunk ships.
 void Arena::SetDisplaying() {
   mode_ = kDisplay;
@@ -405,50 +564,114 @@ void Arena::SetRevealing() {
   this->update();
 }
 
+// Zoom so that a cell is cell_size pixels wide, within limits. The drag in
+// progress, if any, is dropped.
+void Arena::SetCellSize(int cell_size) {
+  cell_size = std::max(kMinCellSize, std::min(cell_size, kMaxCellSize));
+  if (cell_size == cell_size_) return;
+  cell_size_ = cell_size;
+  drag_rect_ = QRect();
+  tile_ = QPixmap();
+  updateGeometry();
+  resize(sizeHint());
+  this->update();
+}
+
+// Shade every cell by its weight, from 0 to 1, to show a heatmap over the
+// board. Empty weights remove the heatmap.
+void Arena::SetOverlay(std::vector<double> const &weights) {
+  assert(weights.empty() ||
+         weights.size() == static_cast<std::size_t>(x_size_ * y_size_));
+  overlay_.resize(weights.size());
+  for (std::size_t i = 0, e = weights.size(); i != e; ++i) {
+    double weight = std::max(0.0, std::min(weights[i], 1.0));
+    overlay_[i] = static_cast<std::uint8_t>(weight * kMaxOverlayAlpha + 0.5);
+  }
+  this->update();
+}
+
+// Report input and paints to a trace on one of its tracks from now on, or
+// stop if trace is null. The trace must outlive the arena or be replaced.
+void Arena::SetTrace(FrameTrace *trace, std::size_t track) {
+  trace_ = trace;
+  trace_track_ = track;
+}
+
+// Zoom in by a quarter.
+void Arena::ZoomIn() { SetCellSize(cell_size_ + std::max(cell_size_ / 4, 1)); }
+
+// Zoom out by a fifth.
+void Arena::ZoomOut() {
+  SetCellSize(cell_size_ - std::max(cell_size_ / 5, 1));
+}
+
 // Add a revealed ship.
 void Arena::AddReveal(Ship const &ship) {
-  reveal_rects_.push_back(MakeShipRect(ship));
-  this->update();
+  reveal_ships_.push_back(ship);
+  UpdateRect(MakeShipRect(ship));
 }
 
 // Add a sunk ship.
 void Arena::AddSunk(const Ship &ship) {
-  sunk_rects_.push_back(MakeShipRect(ship));
-  this->update();
+  sunk_ships_.push_back(ship);
+  UpdateRect(MakeShipRect(ship));
 }
 
 // Add a hit attack.
 void Arena::AddHit(std::size_t x, std::size_t y) {
-  hit_rects_.push_back(MakeAttackRect(x, y));
-  this->update();
+  marks_[y * static_cast<std::size_t>(x_size_) + x] = kHitMark;
+  UpdateRect(MakeAttackRect(x, y));
 }
 
 // Add a missed attack.
 void Arena::AddMiss(std::size_t x, std::size_t y) {
-  miss_rects_.push_back(MakeAttackRect(x, y));
-  this->update();
+  marks_[y * static_cast<std::size_t>(x_size_) + x] = kMissMark;
+  UpdateRect(MakeAttackRect(x, y));
 }
 
-// Add construct an x_size by y_size board.
-Arena::Arena(std::size_t x_size, std::size_t y_size) { Init(x_size, y_size); }
+// Add construct an x_size by y_size board. Room for the largest preset board
+// is reserved once so that Init rarely allocates.
+Arena::Arena(std::size_t x_size, std::size_t y_size)
+    : cell_size_(kCellSize), device_ratio_(0), trace_(0), trace_track_(0) {
+  sunk_ships_.reserve(kReservedCells);
+  reveal_ships_.reserve(kReservedCells);
+  marks_.reserve(kReservedCells);
+  Init(x_size, y_size);
+}
 
 // Resize the board and clear all state.
 void Arena::Init(std::size_t x_size, std::size_t y_size) {
   mode_ = kDisplay;
   x_size_ = static_cast<int>(x_size);
   y_size_ = static_cast<int>(y_size);
-  sunk_rects_.clear();
-  reveal_rects_.clear();
-  hit_rects_.clear();
-  miss_rects_.clear();
+  sunk_ships_.clear();
+  reveal_ships_.clear();
+  marks_.assign(x_size * y_size, kNoMark);
+  salvo_size_ = 0;
+  targets_.clear();
+  drag_rect_ = QRect();
+  overlay_.clear();
+
+  // Number the columns and letter the rows.
+  x_labels_.resize(x_size);
+  for (std::size_t x = 0; x != x_size; ++x)
+    x_labels_[x] = QString::number(x + 1);
+  y_labels_.resize(y_size);
+  for (std::size_t y = 0; y != y_size; ++y) y_labels_[y] = MakeRowLabel(y);
+
   updateGeometry();
+  resize(sizeHint());
+  this->update();
 }
 
+// Return the size of a cell in pixels.
+int Arena::cell_size() const { return cell_size_; }
+
 // Return our optimal size.
 QSize Arena::sizeHint() const {
   QSize size;
-  size.setWidth(x_size_ * kCellSize + kCellSize + 2);
-  size.setHeight(y_size_ * kCellSize + kCellSize + 4);
+  size.setWidth(x_size_ * cell_size_ + cell_size_ + 2);
+  size.setHeight(y_size_ * cell_size_ + cell_size_ + 4);
   return size;
 }
 
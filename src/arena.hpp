@@ -3,12 +3,22 @@
 
 #include "ship.hpp"
 
+#include <QPainter>
+#include <QPixmap>
+#include <QString>
 #include <QWidget>
 
+#include <cstdint>
+#include <vector>
+
 namespace battleship {
 
+class FrameTrace;
+
 // Graphical representation of the game state and input mechanism for placing
-// ships and attacks.
+// ships and attacks. Boards of any size are supported: the arena is meant to
+// sit in a QScrollArea, zooms with Ctrl and the mouse wheel, and only paints
+// the cells that need it.
 class Arena : public QWidget {
   Q_OBJECT
  protected:
@@ -16,38 +26,66 @@ class Arena : public QWidget {
   void mousePressEvent(QMouseEvent *event);
   void mouseReleaseEvent(QMouseEvent *event);
   void mouseMoveEvent(QMouseEvent *event);
+  void wheelEvent(QWheelEvent *event);
 
  private:
   enum Mode { kPlace, kAttack, kDisplay, kReveal };
+  enum Mark { kNoMark, kHitMark, kMissMark, kTargetMark };
 
   Mode mode_;
   // Where the last click was.
   std::size_t pressed_x_;
   std::size_t pressed_y_;
 
-  // Our cell sizes.
+  // Our cell counts and the size of a cell in pixels.
   int x_size_;
   int y_size_;
+  int cell_size_;
 
-  // Rects for drawing.
-  std::vector<QRect> sunk_rects_;
-  std::vector<QRect> reveal_rects_;
-  std::vector<QRect> hit_rects_;
-  std::vector<QRect> miss_rects_;
+  // Ships to draw and the attack mark of every cell.
+  std::vector<Ship> sunk_ships_;
+  std::vector<Ship> reveal_ships_;
+  std::vector<std::uint8_t> marks_;
+  // In salvo games, the shots of a salvo and the cells marked for it so
+  // far. Zero shots attack a cell per click.
+  std::size_t salvo_size_;
+  std::vector<Cell> targets_;
   QRect drag_rect_;
+  // The opacity of the heatmap over every cell, empty when there is none.
+  std::vector<std::uint8_t> overlay_;
+
+  // The labels of the columns and rows.
+  std::vector<QString> x_labels_;
+  std::vector<QString> y_labels_;
+
+  // A single cell of sea with its lines, rendered at device_ratio_ and tiled
+  // over the grid. Only rebuilt when the cell size or device pixel ratio
+  // changes.
+  QPixmap tile_;
+  qreal device_ratio_;
+
+  // Where input and paints are traced, null when they are not, and the
+  // track of the trace they go to.
+  FrameTrace *trace_;
+  std::size_t trace_track_;
 
   int GetCellFromPosition(int pos);
   bool CheckBounds(int x, int y);
   QRect MakeShipRect(Ship const &ship);
   QRect MakeAttackRect(std::size_t x, std::size_t y);
   QRect MakeSingleRect(std::size_t x, std::size_t y);
-  void DrawGrid();
-  void DrawFocus();
-  void DrawSunk();
-  void DrawReveal();
-  void DrawDrag();
-  void DrawHits();
-  void DrawMisses();
+  void UpdateRect(QRect const &rect);
+  void ToggleTarget(std::size_t x, std::size_t y);
+  void ClearTargets();
+  void RenderTile();
+  void DrawGrid(QPainter &painter, QRect const &dirty);
+  void DrawOverlay(QPainter &painter, QRect const &dirty);
+  void DrawLabels(QPainter &painter, QRect const &dirty);
+  void DrawFocus(QPainter &painter);
+  void DrawShips(QPainter &painter, QRect const &dirty,
+                 std::vector<Ship> const &ships);
+  void DrawDrag(QPainter &painter);
+  void DrawMarks(QPainter &painter, QRect const &dirty);
 
  public:
   Arena(std::size_t x_size = 10, std::size_t y_size = 10);
@@ -57,16 +95,24 @@ class Arena : public QWidget {
   void SetAttacking();
   void SetDisplaying();
   void SetRevealing();
+  void SetSalvo(std::size_t shots);
+  void SetCellSize(int cell_size);
+  void SetOverlay(std::vector<double> const &weights);
+  void SetTrace(FrameTrace *trace, std::size_t track);
+  void ZoomIn();
+  void ZoomOut();
 
   void AddReveal(Ship const &ship);
   void AddSunk(Ship const &ship);
   void AddHit(std::size_t x, std::size_t y);
   void AddMiss(std::size_t x, std::size_t y);
 
+  int cell_size() const;
   QSize sizeHint() const;
 
  signals:
   void Attacked(std::size_t x, std::size_t y);
+  void SalvoFired(std::vector<Cell> const &cells);
   void ShipPlaced(Ship const &ship);
 };
 
@@ -0,0 +1,7 @@
+#include "attacker.hpp"
+
+namespace battleship {
+
+Attacker::~Attacker() {}
+
+}  // namespace battleship
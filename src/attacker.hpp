@@ -0,0 +1,26 @@
+#ifndef BATTLESHIP_ATTACKER_H
+#define BATTLESHIP_ATTACKER_H
+
+#include "board.hpp"
+#include "presets.hpp"
+#include "ship.hpp"
+
+namespace battleship {
+
+// A computer player choosing which cells of a board to attack. Every cell
+// returned by NextAttack must be followed by a call to Observe with the result
+// of attacking it. In salvo games NextSalvo chooses count distinct cells at
+// once and their results are observed after the whole salvo, in order.
+class Attacker {
+ public:
+  virtual ~Attacker();
+  virtual void Seed(unsigned seed) = 0;
+  virtual void Init(MapSize size, ShipSet set) = 0;
+  virtual Cell NextAttack() = 0;
+  virtual void NextSalvo(Cell *cells, std::size_t count) = 0;
+  virtual void Observe(std::size_t x, std::size_t y,
+                       Board::AttackResult const &result) = 0;
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_ATTACKER_H
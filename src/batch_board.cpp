@@ -0,0 +1,330 @@
+#include "batch_board.hpp"
+
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATTLESHIP_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace battleship {
+
+static_assert(BatchBoard::kLanes == 16, "lanes are counted in quarters");
+
+// Count the bits of each 16 bit quarter of a word into its low byte, so the
+// lanes of four masks are counted at once.
+static std::uint64_t CountLanes(std::uint64_t bits) {
+  bits -= bits >> 1 & 0x5555555555555555ULL;
+  bits = (bits & 0x3333333333333333ULL) + (bits >> 2 & 0x3333333333333333ULL);
+  bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return (bits + (bits >> 8)) & 0x00ff00ff00ff00ffULL;
+}
+
+// Attack one lane at a time.
+static void AttackScalar(BatchBoard::Planes const &planes,
+                         std::uint32_t const *cells,
+                         BatchBoard::LaneMask lanes,
+                         BatchBoard::Outcome &outcome) {
+  BatchBoard::Outcome result = {0, 0, 0, 0, 0};
+  for (std::size_t lane = 0; lane != BatchBoard::kLanes; ++lane) {
+    BatchBoard::LaneMask bit = BatchBoard::LaneMask(1) << lane;
+    if ((lanes & bit) == 0) continue;
+    std::uint32_t &cell =
+        planes.cells[cells[lane] * BatchBoard::kLanes + lane];
+    if ((cell & BatchBoard::kAttacked) != 0) {
+      result.retry |= bit;
+      continue;
+    }
+    std::uint32_t ship = cell;
+    cell |= BatchBoard::kAttacked;
+    if (ship == 0) {
+      result.miss |= bit;
+      continue;
+    }
+    planes.hit_ships[lane] = ship - 1;
+    if (--planes.hits_left[(ship - 1) * BatchBoard::kLanes + lane] != 0) {
+      result.hit |= bit;
+      continue;
+    }
+    result.sunk |= bit;
+    if (--planes.ships_left[lane] == 0) result.finished |= bit;
+  }
+  outcome = result;
+}
+
+#ifdef BATTLESHIP_X86_KERNELS
+
+// Attack eight lanes per register. AVX2 can gather but not scatter, so the
+// updates are stored one lane at a time.
+__attribute__((target("avx2"))) static void AttackAvx2(
+    BatchBoard::Planes const &planes, std::uint32_t const *cells,
+    BatchBoard::LaneMask lanes, BatchBoard::Outcome &outcome) {
+  int const lanes_count = static_cast<int>(BatchBoard::kLanes);
+  __m256i const bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  __m256i const attacked =
+      _mm256_set1_epi32(static_cast<int>(BatchBoard::kAttacked));
+  __m256i const one = _mm256_set1_epi32(1);
+  __m256i const zero = _mm256_setzero_si256();
+  int *cell_words = reinterpret_cast<int *>(planes.cells);
+  int *hits_left = reinterpret_cast<int *>(planes.hits_left);
+  BatchBoard::Outcome result = {0, 0, 0, 0, 0};
+  for (int half = 0; half != lanes_count / 8; ++half) {
+    unsigned shift = 8 * static_cast<unsigned>(half);
+    __m256i lane = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                    _mm256_set1_epi32(8 * half));
+    __m256i half_lanes = _mm256_set1_epi32(static_cast<int>(lanes >> shift));
+    __m256i active =
+        _mm256_cmpeq_epi32(_mm256_and_si256(half_lanes, bits), bits);
+    __m256i index = _mm256_add_epi32(
+        _mm256_slli_epi32(
+            _mm256_loadu_si256(reinterpret_cast<__m256i const *>(cells) + half),
+            4),
+        lane);
+    __m256i cell =
+        _mm256_mask_i32gather_epi32(zero, cell_words, index, active, 4);
+    __m256i retry = _mm256_and_si256(
+        active,
+        _mm256_cmpeq_epi32(_mm256_and_si256(cell, attacked), attacked));
+    __m256i fresh = _mm256_andnot_si256(retry, active);
+    __m256i miss = _mm256_and_si256(fresh, _mm256_cmpeq_epi32(cell, zero));
+    __m256i hit_any = _mm256_andnot_si256(miss, fresh);
+    __m256i ship = _mm256_sub_epi32(cell, one);
+    __m256i ship_index = _mm256_add_epi32(_mm256_slli_epi32(ship, 4), lane);
+    __m256i left = _mm256_sub_epi32(
+        _mm256_mask_i32gather_epi32(zero, hits_left, ship_index, hit_any, 4),
+        one);
+    __m256i sunk = _mm256_and_si256(hit_any, _mm256_cmpeq_epi32(left, zero));
+
+    unsigned fresh_bits = static_cast<unsigned>(
+        _mm256_movemask_ps(_mm256_castsi256_ps(fresh)));
+    unsigned hit_bits = static_cast<unsigned>(
+        _mm256_movemask_ps(_mm256_castsi256_ps(hit_any)));
+    unsigned sunk_bits = static_cast<unsigned>(
+        _mm256_movemask_ps(_mm256_castsi256_ps(sunk)));
+    result.retry |= static_cast<unsigned>(_mm256_movemask_ps(
+                        _mm256_castsi256_ps(retry))) << shift;
+    result.miss |= static_cast<unsigned>(_mm256_movemask_ps(
+                       _mm256_castsi256_ps(miss))) << shift;
+    result.hit |= (hit_bits & ~sunk_bits) << shift;
+    result.sunk |= sunk_bits << shift;
+
+    std::uint32_t indexes[8];
+    std::uint32_t ships[8];
+    std::uint32_t lefts[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(indexes), index);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(ships), ship);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lefts), left);
+    for (unsigned rest = fresh_bits; rest != 0; rest &= rest - 1) {
+      unsigned i = static_cast<unsigned>(__builtin_ctz(rest));
+      planes.cells[indexes[i]] |= BatchBoard::kAttacked;
+    }
+    for (unsigned rest = hit_bits; rest != 0; rest &= rest - 1) {
+      unsigned i = static_cast<unsigned>(__builtin_ctz(rest));
+      planes.hit_ships[8 * half + i] = ships[i];
+      planes.hits_left[ships[i] * BatchBoard::kLanes + 8 * half + i] =
+          lefts[i];
+    }
+    for (unsigned rest = sunk_bits; rest != 0; rest &= rest - 1) {
+      unsigned i = static_cast<unsigned>(__builtin_ctz(rest));
+      if (--planes.ships_left[8 * half + i] == 0)
+        result.finished |= BatchBoard::LaneMask(1) << (8 * half + i);
+    }
+  }
+  outcome = result;
+}
+
+// Attack all sixteen lanes in one register, gathering and scattering the
+// cells and hit counters under lane masks.
+__attribute__((target("avx512f"))) static void AttackAvx512(
+    BatchBoard::Planes const &planes, std::uint32_t const *cells,
+    BatchBoard::LaneMask lanes, BatchBoard::Outcome &outcome) {
+  __m512i const lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+                                         12, 13, 14, 15);
+  __m512i const attacked =
+      _mm512_set1_epi32(static_cast<int>(BatchBoard::kAttacked));
+  __m512i const one = _mm512_set1_epi32(1);
+  __m512i const zero = _mm512_setzero_si512();
+  __mmask16 active = static_cast<__mmask16>(lanes);
+  __m512i index = _mm512_add_epi32(
+      _mm512_maskz_slli_epi32(active, _mm512_loadu_si512(cells), 4), lane);
+  __m512i cell =
+      _mm512_mask_i32gather_epi32(zero, active, index, planes.cells, 4);
+  __mmask16 retry = _mm512_mask_test_epi32_mask(active, cell, attacked);
+  __mmask16 fresh = static_cast<__mmask16>(active & ~retry);
+  _mm512_mask_i32scatter_epi32(planes.cells, fresh, index,
+                               _mm512_or_si512(cell, attacked), 4);
+  __mmask16 hit_any = _mm512_mask_test_epi32_mask(fresh, cell, cell);
+  __m512i ship = _mm512_sub_epi32(cell, one);
+  __m512i ship_index =
+      _mm512_add_epi32(_mm512_maskz_slli_epi32(hit_any, ship, 4), lane);
+  __m512i left = _mm512_sub_epi32(
+      _mm512_mask_i32gather_epi32(zero, hit_any, ship_index, planes.hits_left,
+                                  4),
+      one);
+  _mm512_mask_i32scatter_epi32(planes.hits_left, hit_any, ship_index, left, 4);
+  _mm512_mask_storeu_epi32(planes.hit_ships, hit_any, ship);
+  __mmask16 sunk = _mm512_mask_cmpeq_epi32_mask(hit_any, left, zero);
+  __m512i ships_left = _mm512_loadu_si512(planes.ships_left);
+  ships_left = _mm512_mask_sub_epi32(ships_left, sunk, ships_left, one);
+  _mm512_storeu_si512(planes.ships_left, ships_left);
+
+  outcome.retry = retry;
+  outcome.miss = static_cast<__mmask16>(fresh & ~hit_any);
+  outcome.hit = static_cast<__mmask16>(hit_any & ~sunk);
+  outcome.sunk = sunk;
+  outcome.finished = _mm512_mask_cmpeq_epi32_mask(sunk, ships_left, zero);
+}
+
+#endif  // #ifdef BATTLESHIP_X86_KERNELS
+
+// Construct an empty batch that uses the best kernel.
+BatchBoard::BatchBoard() : max_ships_(0), attacked_(0) {
+  size_.x = 0;
+  size_.y = 0;
+  std::fill(ship_counts_, ship_counts_ + kLanes, 0);
+  std::fill(ships_left_, ships_left_ + kLanes, 0);
+  std::fill(hit_ships_, hit_ships_ + kLanes, 0);
+  Outcome none = {0, 0, 0, 0, 0};
+  outcome_ = none;
+  UseKernel(BestKernel());
+}
+
+// Return the fastest kernel this processor runs.
+BatchBoard::Kernel BatchBoard::BestKernel() {
+#ifdef BATTLESHIP_X86_KERNELS
+  if (__builtin_cpu_supports("avx512f")) return kAvx512Kernel;
+  if (__builtin_cpu_supports("avx2")) return kAvx2Kernel;
+#endif
+  return kScalarKernel;
+}
+
+// Attack with a kernel. Return false and keep the current one if this
+// processor cannot run it.
+bool BatchBoard::UseKernel(Kernel kernel) {
+  KernelFunction attack = 0;
+  switch (kernel) {
+    case kScalarKernel:
+      attack = AttackScalar;
+      break;
+#ifdef BATTLESHIP_X86_KERNELS
+    case kAvx2Kernel:
+      if (__builtin_cpu_supports("avx2")) attack = AttackAvx2;
+      break;
+    case kAvx512Kernel:
+      if (__builtin_cpu_supports("avx512f")) attack = AttackAvx512;
+      break;
+#else
+    default:
+      break;
+#endif
+  }
+  if (attack == 0) return false;
+  kernel_ = kernel;
+  attack_ = attack;
+  return true;
+}
+
+// Empty every lane for a map size and room for up to max_ships ships a lane.
+void BatchBoard::Init(MapSize size, std::size_t max_ships) {
+  assert(max_ships < kAttacked);
+  size_ = size;
+  max_ships_ = max_ships;
+  cells_.resize(size.x * size.y * kLanes);
+  hits_left_.assign(max_ships * kLanes, 0);
+  Ship none = {Ship::kHorizontal, 0, 0, 0};
+  ships_.assign(max_ships * kLanes, none);
+  Clear();
+}
+
+// Remove the ships and attacks of every lane, to start new games on all.
+void BatchBoard::Clear() {
+  std::fill(cells_.begin(), cells_.end(), 0);
+  std::fill(ship_counts_, ship_counts_ + kLanes, 0);
+  std::fill(ships_left_, ships_left_ + kLanes, 0);
+  attacked_ = 0;
+}
+
+// Remove the ships and attacks of one lane, to start another game on it.
+void BatchBoard::ClearLane(std::size_t lane) {
+  assert(lane < kLanes);
+  for (std::size_t i = lane, e = cells_.size(); i < e; i += kLanes)
+    cells_[i] = 0;
+  ship_counts_[lane] = 0;
+  ships_left_[lane] = 0;
+  attacked_ &= ~(LaneMask(1) << lane);
+}
+
+// Try to place a ship in a lane and return if we were successful or not.
+Board::PlaceResult BatchBoard::Place(std::size_t lane, Ship const &ship) {
+  assert(lane < kLanes && ship.length != 0);
+  assert(ship.orientation == Ship::kHorizontal
+             ? ship.x + ship.length <= size_.x && ship.y < size_.y
+             : ship.y + ship.length <= size_.y && ship.x < size_.x);
+  assert(ship_counts_[lane] < max_ships_);
+  std::size_t step = ship.orientation == Ship::kHorizontal ? kLanes
+                                                           : size_.x * kLanes;
+  std::size_t first = (ship.y * size_.x + ship.x) * kLanes + lane;
+  std::size_t end = first + ship.length * step;
+  Board::PlaceResult result;
+  for (std::size_t i = first; i != end; i += step) {
+    if (cells_[i] != 0) {
+      result.type = Board::kOverlap;
+      CountMetric(kOverlapCounter);
+      return result;
+    }
+  }
+
+  std::uint32_t index = ship_counts_[lane]++;
+  for (std::size_t i = first; i != end; i += step) cells_[i] = index + 1;
+  hits_left_[index * kLanes + lane] = static_cast<std::uint32_t>(ship.length);
+  ++ships_left_[lane];
+  Ship &placed = ships_[lane * max_ships_ + index];
+  placed = ship;
+  result.type = Board::kPlaced;
+  result.ship = &placed;
+  CountMetric(kPlacedCounter);
+  return result;
+}
+
+// Attack cells[i], a cell y * width + x, in every lane i of lanes. The other
+// lanes are left alone and cells of theirs are not read.
+BatchBoard::Outcome const &BatchBoard::Attack(std::uint32_t const *cells,
+                                              LaneMask lanes) {
+  for (std::size_t i = 0; i != kLanes; ++i)
+    assert((lanes >> i & 1) == 0 || cells[i] < size_.x * size_.y);
+  Planes planes = {cells_.data(), hits_left_.data(), ships_left_, hit_ships_};
+  attacked_ = lanes & kAllLanes;
+  attack_(planes, cells, attacked_, outcome_);
+  std::uint64_t counts = CountLanes(
+      std::uint64_t(outcome_.retry) | std::uint64_t(outcome_.miss) << 16 |
+      std::uint64_t(outcome_.hit) << 32 | std::uint64_t(outcome_.sunk) << 48);
+  CountMetric(kRetryCounter, counts & 0xff);
+  CountMetric(kMissCounter, counts >> 16 & 0xff);
+  CountMetric(kHitCounter, counts >> 32 & 0xff);
+  CountMetric(kSunkCounter, counts >> 48);
+  return outcome_;
+}
+
+// Return the result of the last attack in a lane as Board::Attack gives it.
+// Only the lanes of the last attack have one, and a cleared lane loses it.
+Board::AttackResult BatchBoard::result(std::size_t lane) const {
+  assert(lane < kLanes);
+  LaneMask bit = LaneMask(1) << lane;
+  assert((attacked_ & bit) != 0);
+  Board::AttackResult result;
+  result.ship = 0;
+  if ((outcome_.retry & bit) != 0) {
+    result.type = Board::kRetry;
+  } else if ((outcome_.miss & bit) != 0) {
+    result.type = Board::kMiss;
+  } else {
+    result.type = (outcome_.sunk & bit) != 0 ? Board::kSunk : Board::kHit;
+    result.ship = &ships_[lane * max_ships_ + hit_ships_[lane]];
+  }
+  return result;
+}
+
+}  // namespace battleship
@@ -0,0 +1,99 @@
+#ifndef BATTLESHIP_BATCH_BOARD_H
+#define BATTLESHIP_BATCH_BOARD_H
+
+#include "board.hpp"
+#include "presets.hpp"
+#include "ship.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace battleship {
+
+// Boards for kLanes independent games of one map size, played in lockstep
+// for self-play at scale. Every array is lane minor, so the state a cell or
+// ship has in each game lies in one run of kLanes words, and one call
+// resolves an attack in every game: with AVX-512 a gather, a test and a
+// scatter over one register each, with AVX2 gathers over two. The kernel is
+// chosen at run time from what the processor supports, with a scalar one
+// for the rest. Results are the ones a Board would give for the same ships
+// and attacks.
+class BatchBoard {
+ public:
+  static std::size_t const kLanes = 16;
+
+  // A set of lanes, lane i in bit i.
+  typedef std::uint32_t LaneMask;
+  static LaneMask const kAllLanes = (LaneMask(1) << kLanes) - 1;
+
+  // Set on the word of an attacked cell.
+  static std::uint32_t const kAttacked = 0x80000000;
+
+  enum Kernel { kScalarKernel, kAvx2Kernel, kAvx512Kernel };
+
+  // The lanes each result of the last attack went to.
+  struct Outcome {
+    LaneMask retry;
+    LaneMask miss;
+    LaneMask hit;
+    LaneMask sunk;
+    // Lanes whose last ship was just sunk.
+    LaneMask finished;
+  };
+
+  // The arrays a kernel updates, described below.
+  struct Planes {
+    std::uint32_t *cells;
+    std::uint32_t *hits_left;
+    std::uint32_t *ships_left;
+    std::uint32_t *hit_ships;
+  };
+
+  // Attack cells[i] in every lane i of lanes and tell where the results went.
+  typedef void (*KernelFunction)(Planes const &planes,
+                                 std::uint32_t const *cells, LaneMask lanes,
+                                 Outcome &outcome);
+
+ private:
+  MapSize size_;
+  std::size_t max_ships_;
+  // The ship on every cell of every game, as one more than its index, or 0,
+  // with kAttacked set once the cell was attacked. Cell y * width + x of
+  // lane i is word (y * width + x) * kLanes + i.
+  std::vector<std::uint32_t> cells_;
+  // Hits left on ship s of lane i, at s * kLanes + i.
+  std::vector<std::uint32_t> hits_left_;
+  // The ships of lane i from i * max_ships.
+  std::vector<Ship> ships_;
+  std::uint32_t ship_counts_[kLanes];
+  std::uint32_t ships_left_[kLanes];
+  // The last attack: the lanes it went to and still play the same game,
+  // where its results went and the ship it hit per lane.
+  LaneMask attacked_;
+  Outcome outcome_;
+  std::uint32_t hit_ships_[kLanes];
+  Kernel kernel_;
+  KernelFunction attack_;
+
+  BatchBoard(BatchBoard const &);
+  BatchBoard &operator=(BatchBoard const &);
+
+ public:
+  BatchBoard();
+  static Kernel BestKernel();
+  bool UseKernel(Kernel kernel);
+  void Init(MapSize size, std::size_t max_ships);
+  void Clear();
+  void ClearLane(std::size_t lane);
+  Board::PlaceResult Place(std::size_t lane, Ship const &ship);
+  Outcome const &Attack(std::uint32_t const *cells, LaneMask lanes);
+  Board::AttackResult result(std::size_t lane) const;
+
+  MapSize size() const { return size_; }
+  Kernel kernel() const { return kernel_; }
+  Outcome const &outcome() const { return outcome_; }
+  std::size_t ships_left(std::size_t lane) const { return ships_left_[lane]; }
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_BATCH_BOARD_H
@@ -0,0 +1,166 @@
+#ifndef BATTLESHIP_BIT_GRID_H
+#define BATTLESHIP_BIT_GRID_H
+
+#include "ship.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace battleship {
+
+// A set of cells on a board of any size, one bit per cell. Every row starts on
+// its own word so that a horizontal run of cells touches as few words as
+// possible. Unlike Bitboard the size is chosen at runtime; Init keeps the
+// memory of the largest board seen so that it never allocates again.
+class BitGrid {
+ public:
+  static std::size_t const kWordBits = 64;
+
+ private:
+  std::size_t x_size_;
+  std::size_t y_size_;
+  // The words of every row.
+  std::size_t stride_;
+  std::vector<std::uint64_t> words_;
+
+  // Return the bits of cells [x, x + n) inside the word holding x, where the
+  // run does not leave the word.
+  static std::uint64_t RunMask(std::size_t x, std::size_t n) {
+    std::uint64_t run = n == kWordBits ? ~std::uint64_t(0)
+                                       : (std::uint64_t(1) << n) - 1;
+    return run << (x % kWordBits);
+  }
+
+  // Return the number of cells from x to the end of a run or of its word.
+  static std::size_t RunLength(std::size_t x, std::size_t end) {
+    return std::min(end - x, kWordBits - x % kWordBits);
+  }
+
+ public:
+  BitGrid() : x_size_(0), y_size_(0), stride_(0) {}
+
+  // Resize the grid to x_size by y_size cells and remove all cells.
+  void Init(std::size_t x_size, std::size_t y_size) {
+    x_size_ = x_size;
+    y_size_ = y_size;
+    stride_ = (x_size + kWordBits - 1) / kWordBits;
+    words_.assign(stride_ * y_size, 0);
+  }
+
+  // Make room for boards of up to x_size by y_size cells.
+  void Reserve(std::size_t x_size, std::size_t y_size) {
+    words_.reserve((x_size + kWordBits - 1) / kWordBits * y_size);
+  }
+
+  // Remove all cells.
+  void Clear() { std::fill(words_.begin(), words_.end(), 0); }
+
+  // Return the index of the word holding a cell. Operations on many cells
+  // work on whole words through word(), a cell being BitOf(x) in WordOf(x, y).
+  std::size_t WordOf(std::size_t x, std::size_t y) const {
+    assert(x < x_size_ && y < y_size_);
+    return y * stride_ + x / kWordBits;
+  }
+
+  // Return the bit of a cell inside its word.
+  static std::uint64_t BitOf(std::size_t x) {
+    return std::uint64_t(1) << (x % kWordBits);
+  }
+
+  // Return a word of cells by its index.
+  std::uint64_t word(std::size_t i) const { return words_[i]; }
+  std::uint64_t &word(std::size_t i) { return words_[i]; }
+
+  // Return whether a cell is in the set.
+  bool Test(std::size_t x, std::size_t y) const {
+    return (words_[WordOf(x, y)] & BitOf(x)) != 0;
+  }
+
+  // Add a cell to the set.
+  void Set(std::size_t x, std::size_t y) { words_[WordOf(x, y)] |= BitOf(x); }
+
+  // Remove a cell from the set.
+  void Reset(std::size_t x, std::size_t y) {
+    words_[WordOf(x, y)] &= ~BitOf(x);
+  }
+
+  // Return whether any cell of a ship is in the set. Only the words the ship
+  // covers are touched.
+  bool IntersectsShip(Ship const &ship) const {
+    assert(ship.length != 0);
+    std::uint64_t any = 0;
+    switch (ship.orientation) {
+      case Ship::kHorizontal:
+        for (std::size_t x = ship.x, e = ship.x + ship.length; x != e;) {
+          std::size_t n = RunLength(x, e);
+          any |= words_[WordOf(x, ship.y)] & RunMask(x, n);
+          x += n;
+        }
+        break;
+
+      case Ship::kVertical: {
+        assert(ship.y + ship.length <= y_size_);
+        std::uint64_t bit = BitOf(ship.x);
+        std::size_t w = WordOf(ship.x, ship.y);
+        for (std::size_t i = 0; i != ship.length; ++i, w += stride_)
+          any |= words_[w] & bit;
+        break;
+      }
+    }
+    return any != 0;
+  }
+
+  // Add all cells of a ship to the set.
+  void SetShip(Ship const &ship) {
+    assert(ship.length != 0);
+    switch (ship.orientation) {
+      case Ship::kHorizontal:
+        for (std::size_t x = ship.x, e = ship.x + ship.length; x != e;) {
+          std::size_t n = RunLength(x, e);
+          words_[WordOf(x, ship.y)] |= RunMask(x, n);
+          x += n;
+        }
+        break;
+
+      case Ship::kVertical: {
+        assert(ship.y + ship.length <= y_size_);
+        std::uint64_t bit = BitOf(ship.x);
+        std::size_t w = WordOf(ship.x, ship.y);
+        for (std::size_t i = 0; i != ship.length; ++i, w += stride_)
+          words_[w] |= bit;
+        break;
+      }
+    }
+  }
+
+  // Remove all cells of a ship from the set.
+  void ResetShip(Ship const &ship) {
+    assert(ship.length != 0);
+    switch (ship.orientation) {
+      case Ship::kHorizontal:
+        for (std::size_t x = ship.x, e = ship.x + ship.length; x != e;) {
+          std::size_t n = RunLength(x, e);
+          words_[WordOf(x, ship.y)] &= ~RunMask(x, n);
+          x += n;
+        }
+        break;
+
+      case Ship::kVertical: {
+        assert(ship.y + ship.length <= y_size_);
+        std::uint64_t bit = BitOf(ship.x);
+        std::size_t w = WordOf(ship.x, ship.y);
+        for (std::size_t i = 0; i != ship.length; ++i, w += stride_)
+          words_[w] &= ~bit;
+        break;
+      }
+    }
+  }
+
+  std::size_t x_size() const { return x_size_; }
+  std::size_t y_size() const { return y_size_; }
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_BIT_GRID_H
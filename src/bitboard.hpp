@@ -0,0 +1,182 @@
+#ifndef BATTLESHIP_BITBOARD_H
+#define BATTLESHIP_BITBOARD_H
+
+#include "ship.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+namespace battleship {
+
+// A fixed-width set of cells on a board of at most kMaxWidth by kMaxHeight
+// cells. Every row lives in its own 32 bit lane so that a horizontal run of
+// cells never straddles a word.
+class Bitboard {
+ public:
+  static std::size_t const kMaxWidth = 26;
+  static std::size_t const kMaxHeight = 26;
+  static std::size_t const kLaneBits = 32;
+  static std::size_t const kWords = (kMaxHeight * kLaneBits + 63) / 64;
+
+ private:
+  std::uint64_t words_[kWords];
+
+  // Return the bits of a horizontal ship inside the word holding its row.
+  static std::uint64_t HorizontalMask(Ship const &ship) {
+    assert(ship.length != 0 && ship.x + ship.length <= kMaxWidth);
+    std::uint64_t run = (std::uint64_t(1) << ship.length) - 1;
+    return run << ((ship.y % 2) * kLaneBits + ship.x);
+  }
+
+  // Return the bits of a vertical ship inside word w.
+  static std::uint64_t VerticalMask(Ship const &ship, std::size_t w) {
+    assert(ship.length != 0 && ship.y + ship.length <= kMaxHeight);
+    std::uint64_t column = std::uint64_t(1) << ship.x;
+    std::uint64_t mask = 0;
+    if (2 * w >= ship.y) mask |= column;
+    if (2 * w + 1 < ship.y + ship.length) mask |= column << kLaneBits;
+    return mask;
+  }
+
+ public:
+  // Return the word holding a cell.
+  static std::size_t WordOf(std::size_t x, std::size_t y) {
+    assert(x < kMaxWidth && y < kMaxHeight);
+    return y / 2;
+  }
+
+  // Return the bit of a cell inside its word.
+  static std::uint64_t BitOf(std::size_t x, std::size_t y) {
+    assert(x < kMaxWidth && y < kMaxHeight);
+    return std::uint64_t(1) << ((y % 2) * kLaneBits + x);
+  }
+
+  // Return the number of cells in a word.
+  static std::size_t CountBits(std::uint64_t bits) {
+    std::size_t count = 0;
+    for (; bits != 0; bits &= bits - 1) ++count;
+    return count;
+  }
+
+  // Return a set covering all cells of a ship.
+  static Bitboard FromShip(Ship const &ship) {
+    Bitboard board;
+    board.SetShip(ship);
+    return board;
+  }
+
+  Bitboard() { Clear(); }
+
+  // Remove all cells.
+  void Clear() {
+    for (std::size_t i = 0; i != kWords; ++i) words_[i] = 0;
+  }
+
+  // Return whether a cell is in the set.
+  bool Test(std::size_t x, std::size_t y) const {
+    return (words_[WordOf(x, y)] & BitOf(x, y)) != 0;
+  }
+
+  // Add a cell to the set.
+  void Set(std::size_t x, std::size_t y) {
+    words_[WordOf(x, y)] |= BitOf(x, y);
+  }
+
+  // Remove a cell from the set.
+  void Reset(std::size_t x, std::size_t y) {
+    words_[WordOf(x, y)] &= ~BitOf(x, y);
+  }
+
+  // Return whether any cell of a ship is in the set. Only the words the ship
+  // covers are touched.
+  bool IntersectsShip(Ship const &ship) const {
+    std::uint64_t any = 0;
+    switch (ship.orientation) {
+      case Ship::kHorizontal:
+        any = words_[WordOf(ship.x, ship.y)] & HorizontalMask(ship);
+        break;
+
+      case Ship::kVertical:
+        for (std::size_t w = ship.y / 2, e = (ship.y + ship.length + 1) / 2;
+             w != e; ++w)
+          any |= words_[w] & VerticalMask(ship, w);
+        break;
+    }
+    return any != 0;
+  }
+
+  // Add all cells of a ship to the set.
+  void SetShip(Ship const &ship) {
+    switch (ship.orientation) {
+      case Ship::kHorizontal:
+        words_[WordOf(ship.x, ship.y)] |= HorizontalMask(ship);
+        break;
+
+      case Ship::kVertical:
+        for (std::size_t w = ship.y / 2, e = (ship.y + ship.length + 1) / 2;
+             w != e; ++w)
+          words_[w] |= VerticalMask(ship, w);
+        break;
+    }
+  }
+
+  // Remove all cells of a ship from the set.
+  void ResetShip(Ship const &ship) {
+    switch (ship.orientation) {
+      case Ship::kHorizontal:
+        words_[WordOf(ship.x, ship.y)] &= ~HorizontalMask(ship);
+        break;
+
+      case Ship::kVertical:
+        for (std::size_t w = ship.y / 2, e = (ship.y + ship.length + 1) / 2;
+             w != e; ++w)
+          words_[w] &= ~VerticalMask(ship, w);
+        break;
+    }
+  }
+
+  // Return whether the two sets share any cell.
+  bool Intersects(Bitboard const &other) const {
+    std::uint64_t any = 0;
+    for (std::size_t i = 0; i != kWords; ++i)
+      any |= words_[i] & other.words_[i];
+    return any != 0;
+  }
+
+  // Return whether the set is empty.
+  bool None() const {
+    std::uint64_t any = 0;
+    for (std::size_t i = 0; i != kWords; ++i) any |= words_[i];
+    return any == 0;
+  }
+
+  // Return the set mirrored along the diagonal, so that cell (x, y) becomes
+  // (y, x). Columns of this set are then runs along the rows of the result.
+  Bitboard Transposed() const {
+    Bitboard board;
+    for (std::size_t i = 0; i != kWords; ++i) {
+      for (std::uint64_t bits = words_[i]; bits != 0; bits &= bits - 1) {
+        std::size_t bit = 0;
+        while ((bits >> bit & 1) == 0) ++bit;
+        std::size_t y = 2 * i + bit / kLaneBits;
+        board.Set(y, bit % kLaneBits);
+      }
+    }
+    return board;
+  }
+
+  Bitboard &operator|=(Bitboard const &other) {
+    for (std::size_t i = 0; i != kWords; ++i) words_[i] |= other.words_[i];
+    return *this;
+  }
+
+  Bitboard &operator&=(Bitboard const &other) {
+    for (std::size_t i = 0; i != kWords; ++i) words_[i] &= other.words_[i];
+    return *this;
+  }
+
+  std::uint64_t word(std::size_t i) const { return words_[i]; }
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_BITBOARD_H
@@ -1,44 +1,33 @@
 #ifndef BATTLESHIP_BOARD_H
 #define BATTLESHIP_BOARD_H
 
+#include "bit_grid.hpp"
+#include "cell_map.hpp"
+#include "metrics.hpp"
 #include "ship.hpp"
 
 #include <cassert>
+#include <cstdint>
 #include <vector>
 
 namespace battleship {
 
+class BoardSnapshot;
+
 // Represents the state of an arena. Knows which cells contain a ship, what ship
 // they contain, how many hits they have left, and which cells have been
-// attacked.
+// attacked. All cell state is kept in bit planes of one bit per cell, with the
+// index of the ship on every ship cell beside them, so placing a ship is a
+// mask-and-test per word it covers and an attack is a couple of word
+// operations and a load. Boards of any size are supported and each ship only
+// costs its counter.
+//
+// Bit planes cost memory for every cell, so very large boards start sparse:
+// ship cells and attacks live in hash maps whose memory grows with the ships
+// and shots instead. Once the maps would take more room than the planes the
+// board moves to the planes for good, so dense and sparse play is chosen
+// automatically from what the board holds.
 class Board {
- private:
-  struct ShipCounter {
-    Ship ship;
-    std::size_t hits_left;
-  };
-
-  // Our cell size.
-  std::size_t x_size_;
-  std::size_t y_size_;
-
-  // Maps a cell to an index into ships_counters.
-  std::vector<std::size_t> indexes_;
-  // A collection of all ships and how many hits before they are sunk.
-  std::vector<ShipCounter> ship_counters_;
-  // Maps a cell to if it contains a ship.
-  std::vector<bool> ship_map_;
-  // Maps a cell to if it has already been attacked.
-  std::vector<bool> attacks_;
-
-  std::size_t IndexOf(std::size_t x, std::size_t y) const;
-  std::size_t &GetShipIndex(std::size_t x, std::size_t y);
-  ShipCounter &GetShipCounter(std::size_t x, std::size_t y);
-  bool DoesContainsShip(std::size_t x, std::size_t y) const;
-  void SetContainsShip(std::size_t x, std::size_t y);
-  bool IsAttacked(std::size_t x, std::size_t y) const;
-  void SetAttacked(std::size_t x, std::size_t y);
-
  public:
   enum PlaceType { kPlaced, kOverlap };
 
@@ -54,11 +43,80 @@ class Board {
     Ship const *ship;
   };
 
+ private:
+  // A ship and how many hits before it is sunk, in one 8 byte word.
+  struct ShipCounter {
+    PackedShip ship;
+    std::uint32_t hits_left;
+  };
+
+  // The same for a ship of a board too large to pack.
+  struct WideShipCounter {
+    Ship ship;
+    std::uint32_t hits_left;
+  };
+
+  // Our cell size.
+  std::size_t x_size_;
+  std::size_t y_size_;
+
+  // A collection of all ships and how many hits before they are sunk. Boards
+  // small enough to pack their ships keep them in ship_counters_ and unpack
+  // the ship of a result into result_ship_, or into salvo_ships_ for the
+  // results of AttackMany, so it is valid until the next Place or Attack.
+  // Larger boards keep them in wide_counters_ and results point there.
+  bool packed_;
+  std::vector<ShipCounter> ship_counters_;
+  std::vector<WideShipCounter> wide_counters_;
+  Ship result_ship_;
+  std::vector<Ship> salvo_ships_;
+  // Cells that contain a ship.
+  BitGrid ship_map_;
+  // Cells that have already been attacked.
+  BitGrid attacks_;
+  // Cells that have been attacked and contain a ship.
+  BitGrid hits_;
+  // The index of the ship on every ship cell, row-major, so that a hit finds
+  // its ship with one load. Other cells hold whatever they held before Init.
+  std::vector<std::uint32_t> ship_indices_;
+
+  // Whether the board is sparse, the index of the ship on every ship cell and
+  // whether every attacked cell was a hit. The maps are only used when
+  // sparse, the planes only when not.
+  bool sparse_;
+  CellMap ship_cells_;
+  CellMap attacked_cells_;
+
+  std::uint64_t CellOf(std::size_t x, std::size_t y) const;
+  std::size_t GetShipIndex(std::size_t x, std::size_t y);
+  std::size_t ship_count() const;
+  Ship GetShip(std::size_t index) const;
+  Ship const *GetResultShip(std::size_t index, Ship &scratch) const;
+  bool HitShip(std::size_t index);
+  void SetShipIndex(Ship const &ship, std::uint32_t index);
+  bool SparseIntersects(Ship const &ship) const;
+  void UpdateDensity();
+  void MakeDense();
+  PlaceResult PlaceShip(Ship const &ship);
+  PlaceResult TimePlace(Ship const &ship);
+  AttackResult AttackSparse(std::size_t x, std::size_t y);
+  AttackResult AttackDense(std::size_t x, std::size_t y);
+  AttackResult TimeAttack(std::size_t x, std::size_t y);
+
+ public:
   Board(std::size_t x_size = 0, std::size_t y_size = 0);
   void Init(std::size_t x_size, std::size_t y_size);
+  void Reserve(std::size_t x_size, std::size_t y_size, std::size_t ships);
   PlaceResult Place(Ship const &ship);
   AttackResult Attack(std::size_t x, std::size_t y);
+  void AttackMany(Cell const *cells, std::size_t count, AttackResult *results);
+  BoardSnapshot Snapshot() const;
+
+  // Return whether the board keeps its cells in hash maps.
+  bool sparse() const { return sparse_; }
 };
 
+MetricCounter AttackCounter(Board::AttackType type);
+
 }  // namespace battleship
 #endif  // #ifndef BATTLESHIP_BOARD_H
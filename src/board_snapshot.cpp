@@ -0,0 +1,206 @@
+#include "board_snapshot.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace battleship {
+
+// Return a node of no attacks owned by the caller.
+BoardSnapshot::Node *BoardSnapshot::NewNode() {
+  Node *node = new Node;
+  node->refs.store(1, std::memory_order_relaxed);
+  std::memset(node->words, 0, sizeof(node->words));
+  return node;
+}
+
+// Drop a reference to a node of a level, freeing it and dropping its
+// children's once it was the last. Nodes are shared between threads by the
+// snapshots copied to them, so the last owner must see every other's writes.
+void BoardSnapshot::Release(Node *node, std::size_t level) {
+  if (node == 0) return;
+  if (node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+  if (level != 0)
+    for (std::size_t i = 0; i != kFanout; ++i)
+      Release(node->children[i], level - 1);
+  delete node;
+}
+
+// Return a copy of a subtree, which may be null, with a bit of a word set.
+// Only the nodes on the path to the word are copied, the copies share every
+// other child of the nodes they copy.
+BoardSnapshot::Node *BoardSnapshot::Insert(Node const *node,
+                                           std::size_t level,
+                                           std::uint64_t word,
+                                           std::uint64_t bit) {
+  Node *copy = NewNode();
+  if (level == 0) {
+    if (node) std::memcpy(copy->words, node->words, sizeof(copy->words));
+    copy->words[word % kFanout] |= bit;
+    return copy;
+  }
+  std::size_t shift = level * kFanoutBits;
+  std::size_t index = static_cast<std::size_t>(word >> shift) & (kFanout - 1);
+  Node const *child = 0;
+  if (node) {
+    for (std::size_t i = 0; i != kFanout; ++i) {
+      Node *shared = node->children[i];
+      if (i == index || shared == 0) continue;
+      shared->refs.fetch_add(1, std::memory_order_relaxed);
+      copy->children[i] = shared;
+    }
+    child = node->children[index];
+  }
+  copy->children[index] = Insert(child, level - 1, word, bit);
+  return copy;
+}
+
+// Construct a snapshot taking a reference to its attacks.
+BoardSnapshot::BoardSnapshot(std::shared_ptr<Layout const> const &layout,
+                             Node *root, std::size_t ships_left,
+                             std::size_t attacks)
+    : layout_(layout),
+      root_(root),
+      ships_left_(ships_left),
+      attacks_(attacks) {}
+
+// Convert 2d coordinates into a bit of the attacks.
+std::uint64_t BoardSnapshot::CellOf(std::size_t x, std::size_t y) const {
+  return std::uint64_t(y) * layout_->x_size + x;
+}
+
+// Return a word of attacks or null if none of its cells were attacked.
+std::uint64_t const *BoardSnapshot::FindWord(std::uint64_t word) const {
+  Node const *node = root_;
+  for (std::size_t level = layout_->levels; node && level != 0; --level) {
+    std::size_t shift = level * kFanoutBits;
+    node = node->children[static_cast<std::size_t>(word >> shift) &
+                          (kFanout - 1)];
+  }
+  return node ? &node->words[word % kFanout] : 0;
+}
+
+// Construct the snapshot of an empty board with no ships.
+BoardSnapshot::BoardSnapshot()
+    : layout_(std::make_shared<Layout>()),
+      root_(0),
+      ships_left_(0),
+      attacks_(0) {}
+
+// Construct the snapshot of a board before its first attack. The ships must
+// lie on the board and must not overlap.
+BoardSnapshot::BoardSnapshot(std::size_t x_size, std::size_t y_size,
+                             Ship const *ships, std::size_t count)
+    : root_(0), ships_left_(count), attacks_(0) {
+  std::shared_ptr<Layout> layout = std::make_shared<Layout>();
+  layout->x_size = x_size;
+  layout->y_size = y_size;
+  layout->levels = 0;
+  std::uint64_t words = (std::uint64_t(x_size) * y_size + 63) / 64;
+  std::uint64_t span = kFanout;
+  while (span < words) {
+    span <<= kFanoutBits;
+    ++layout->levels;
+  }
+  layout->ships.assign(ships, ships + count);
+  for (std::size_t i = 0; i != count; ++i) {
+    Ship const &ship = ships[i];
+    std::size_t dx = ship.orientation == Ship::kHorizontal ? 1 : 0;
+    std::size_t dy = 1 - dx;
+    for (std::size_t j = 0; j != ship.length; ++j) {
+      std::uint64_t cell =
+          std::uint64_t(ship.y + j * dy) * x_size + ship.x + j * dx;
+      layout->ship_cells.Insert(cell, static_cast<std::uint32_t>(i));
+    }
+  }
+  layout_ = layout;
+}
+
+// Share the layout and attacks of another snapshot.
+BoardSnapshot::BoardSnapshot(BoardSnapshot const &other)
+    : layout_(other.layout_),
+      root_(other.root_),
+      ships_left_(other.ships_left_),
+      attacks_(other.attacks_) {
+  if (root_) root_->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Take the layout and attacks of another snapshot, leaving it with no
+// attacks.
+BoardSnapshot::BoardSnapshot(BoardSnapshot &&other)
+    : layout_(other.layout_),
+      root_(other.root_),
+      ships_left_(other.ships_left_),
+      attacks_(other.attacks_) {
+  other.root_ = 0;
+}
+
+// Share the layout and attacks of another snapshot.
+BoardSnapshot &BoardSnapshot::operator=(BoardSnapshot other) {
+  std::swap(layout_, other.layout_);
+  std::swap(root_, other.root_);
+  ships_left_ = other.ships_left_;
+  attacks_ = other.attacks_;
+  return *this;
+}
+
+// Drop our reference to the attacks.
+BoardSnapshot::~BoardSnapshot() {
+  if (root_) Release(root_, layout_->levels);
+}
+
+// Return the snapshot after attacking a cell, and how the attack went in
+// result. A retry returns the snapshot unchanged. Ships in the result are
+// valid as long as any snapshot of the board is.
+BoardSnapshot BoardSnapshot::Attack(std::size_t x, std::size_t y,
+                                    Board::AttackResult &result) const {
+  assert(x < layout_->x_size && y < layout_->y_size);
+  if (attacked(x, y)) {
+    result.type = Board::kRetry;
+    return *this;
+  }
+
+  std::uint64_t cell = CellOf(x, y);
+  Node *root = Insert(root_, layout_->levels, cell / 64,
+                      std::uint64_t(1) << (cell % 64));
+  BoardSnapshot next(layout_, root, ships_left_, attacks_ + 1);
+
+  std::uint32_t const *index = layout_->ship_cells.Get(cell);
+  if (index == 0) {
+    result.type = Board::kMiss;
+    return next;
+  }
+  result.ship = &layout_->ships[*index];
+  if (next.hits_left(*index) == 0) {
+    result.type = Board::kSunk;
+    --next.ships_left_;
+  } else {
+    result.type = Board::kHit;
+  }
+  return next;
+}
+
+// Return whether a cell was attacked.
+bool BoardSnapshot::attacked(std::size_t x, std::size_t y) const {
+  std::uint64_t cell = CellOf(x, y);
+  std::uint64_t const *word = FindWord(cell / 64);
+  return word && (*word >> (cell % 64) & 1) != 0;
+}
+
+// Return the ship covering a cell or null if there is none.
+Ship const *BoardSnapshot::ShipAt(std::size_t x, std::size_t y) const {
+  std::uint32_t const *index = layout_->ship_cells.Get(CellOf(x, y));
+  return index ? &layout_->ships[*index] : 0;
+}
+
+// Return how many hits a ship, by its index among the ships, has left.
+std::size_t BoardSnapshot::hits_left(std::size_t ship) const {
+  Ship const &s = layout_->ships[ship];
+  std::size_t dx = s.orientation == Ship::kHorizontal ? 1 : 0;
+  std::size_t dy = 1 - dx;
+  std::size_t left = 0;
+  for (std::size_t i = 0; i != s.length; ++i)
+    if (!attacked(s.x + i * dx, s.y + i * dy)) ++left;
+  return left;
+}
+
+}  // namespace battleship
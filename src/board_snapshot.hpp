@@ -0,0 +1,122 @@
+#ifndef BATTLESHIP_BOARD_SNAPSHOT_H
+#define BATTLESHIP_BOARD_SNAPSHOT_H
+
+#include "board.hpp"
+#include "cell_map.hpp"
+#include "ship.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace battleship {
+
+// An immutable state of a board. Attacking a snapshot gives a new one and
+// leaves it as it was, so keeping the old one is all undo takes and a search
+// can branch on every cell without copying a Board per node.
+//
+// The ships never change once placed and are shared by every snapshot of a
+// game. The attacked cells, as y * width + x, are the bits of a persistent
+// radix tree: leaves hold kFanout words, branches kFanout children, and an
+// attack copies the one node per level on the path to its word and shares
+// the rest. Preset boards fit in one or two leaves. Missing subtrees have no
+// attacks, so very large boards cost memory for their shots only. A ship's
+// hits are the attacked cells it covers and are counted when asked for
+// rather than stored.
+class BoardSnapshot {
+ private:
+  static std::size_t const kFanoutBits = 3;
+  static std::size_t const kFanout = std::size_t(1) << kFanoutBits;
+
+  struct Node {
+    std::atomic<std::size_t> refs;
+    // Words of cells in a leaf, children in a branch.
+    union {
+      std::uint64_t words[kFanout];
+      Node *children[kFanout];
+    };
+  };
+
+  // The ships of a board and the index of the ship on every ship cell.
+  struct Layout {
+    std::size_t x_size;
+    std::size_t y_size;
+    // Levels of branches above the leaves.
+    std::size_t levels;
+    std::vector<Ship> ships;
+    CellMap ship_cells;
+  };
+
+  std::shared_ptr<Layout const> layout_;
+  // Null while nothing was attacked.
+  Node *root_;
+  std::size_t ships_left_;
+  std::size_t attacks_;
+
+  static Node *NewNode();
+  static void Release(Node *node, std::size_t level);
+  static Node *Insert(Node const *node, std::size_t level,
+                      std::uint64_t word, std::uint64_t bit);
+  BoardSnapshot(std::shared_ptr<Layout const> const &layout, Node *root,
+                std::size_t ships_left, std::size_t attacks);
+  std::uint64_t CellOf(std::size_t x, std::size_t y) const;
+  std::uint64_t const *FindWord(std::uint64_t word) const;
+
+  // Call f(word, bits) for every non-zero word of a subtree.
+  template <typename Function>
+  static void ForEachWord(Node const *node, std::size_t level,
+                          std::uint64_t first, Function &f) {
+    if (node == 0) return;
+    if (level == 0) {
+      for (std::size_t i = 0; i != kFanout; ++i)
+        if (node->words[i] != 0) f(first + i, node->words[i]);
+      return;
+    }
+    std::uint64_t span = std::uint64_t(1) << (level * kFanoutBits);
+    for (std::size_t i = 0; i != kFanout; ++i)
+      ForEachWord(node->children[i], level - 1, first + i * span, f);
+  }
+
+ public:
+  BoardSnapshot();
+  BoardSnapshot(std::size_t x_size, std::size_t y_size, Ship const *ships,
+                std::size_t count);
+  BoardSnapshot(BoardSnapshot const &other);
+  BoardSnapshot(BoardSnapshot &&other);
+  BoardSnapshot &operator=(BoardSnapshot other);
+  ~BoardSnapshot();
+
+  BoardSnapshot Attack(std::size_t x, std::size_t y,
+                       Board::AttackResult &result) const;
+
+  bool attacked(std::size_t x, std::size_t y) const;
+  Ship const *ShipAt(std::size_t x, std::size_t y) const;
+  std::size_t hits_left(std::size_t ship) const;
+
+  // Call f(x, y, ship) for every attacked cell, in row order, where ship is
+  // the ship hit or null for a miss.
+  template <typename Function>
+  void ForEachAttack(Function f) const {
+    Layout const &layout = *layout_;
+    auto visit = [&](std::uint64_t word, std::uint64_t bits) {
+      for (; bits != 0; bits &= bits - 1) {
+        std::uint64_t cell = word * 64 + std::uint64_t(__builtin_ctzll(bits));
+        std::size_t x = static_cast<std::size_t>(cell % layout.x_size);
+        std::size_t y = static_cast<std::size_t>(cell / layout.x_size);
+        f(x, y, ShipAt(x, y));
+      }
+    };
+    ForEachWord(root_, layout.levels, 0, visit);
+  }
+
+  std::size_t x_size() const { return layout_->x_size; }
+  std::size_t y_size() const { return layout_->y_size; }
+  std::size_t ship_count() const { return layout_->ships.size(); }
+  Ship const &ship(std::size_t i) const { return layout_->ships[i]; }
+  std::size_t ships_left() const { return ships_left_; }
+  std::size_t attacks() const { return attacks_; }
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_BOARD_SNAPSHOT_H
@@ -0,0 +1,45 @@
+#include "book_attacker.hpp"
+
+namespace battleship {
+
+// Construct an attacker taking ownership of the one playing after the book.
+// The book must outlive it.
+BookAttacker::BookAttacker(Attacker *attacker, OpeningBook const *book)
+    : attacker_(attacker), book_(book), in_book_(false), key_(0) {
+  size_.x = 0;
+  size_.y = 0;
+}
+
+// Seed the attacker playing after the book.
+void BookAttacker::Seed(unsigned seed) { attacker_->Seed(seed); }
+
+// Start a new game, in the book if it was built for this one.
+void BookAttacker::Init(MapSize size, ShipSet set) {
+  attacker_->Init(size, set);
+  size_ = size;
+  in_book_ = book_->Matches(size, set);
+  key_ = 0;
+}
+
+// Play the book's attack, or the other attacker's once out of the book.
+Cell BookAttacker::NextAttack() {
+  Cell cell;
+  if (in_book_ && book_->Find(key_, cell)) return cell;
+  in_book_ = false;
+  return attacker_->NextAttack();
+}
+
+// Leave the book and let the other attacker choose the salvo.
+void BookAttacker::NextSalvo(Cell *cells, std::size_t count) {
+  in_book_ = false;
+  attacker_->NextSalvo(cells, count);
+}
+
+// Pass the result of an attack on and follow the book.
+void BookAttacker::Observe(std::size_t x, std::size_t y,
+                           Board::AttackResult const &result) {
+  attacker_->Observe(x, y, result);
+  if (in_book_) key_ = BookKey(key_, size_, x, y, result);
+}
+
+}  // namespace battleship
@@ -0,0 +1,35 @@
+#ifndef BATTLESHIP_BOOK_ATTACKER_H
+#define BATTLESHIP_BOOK_ATTACKER_H
+
+#include "attacker.hpp"
+#include "opening_book.hpp"
+
+#include <cstdint>
+#include <memory>
+
+namespace battleship {
+
+// A computer player that plays the attacks of an opening book while the game
+// is in it and those of another attacker afterwards. The other attacker
+// observes every attack, so it takes over where the book ends as if it had
+// played the opening itself. Salvos are not in books.
+class BookAttacker : public Attacker {
+ private:
+  std::unique_ptr<Attacker> attacker_;
+  OpeningBook const *book_;
+  MapSize size_;
+  // Whether the game is still in the book, and the key of what was seen.
+  bool in_book_;
+  std::uint64_t key_;
+
+ public:
+  BookAttacker(Attacker *attacker, OpeningBook const *book);
+  void Seed(unsigned seed);
+  void Init(MapSize size, ShipSet set);
+  Cell NextAttack();
+  void NextSalvo(Cell *cells, std::size_t count);
+  void Observe(std::size_t x, std::size_t y, Board::AttackResult const &result);
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_BOOK_ATTACKER_H
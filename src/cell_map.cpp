@@ -0,0 +1,61 @@
+#include "cell_map.hpp"
+
+#include <algorithm>
+
+namespace battleship {
+
+// Return the slot holding a cell or the free slot it would go to.
+std::size_t CellMap::Find(std::uint64_t cell) const {
+  std::uint64_t hash = cell * 0x9e3779b97f4a7c15ULL;
+  hash ^= hash >> 32;
+  std::size_t mask = entries_.size() - 1;
+  for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask)
+    if (entries_[slot].cell == kFree || entries_[slot].cell == cell)
+      return slot;
+}
+
+// Double the slots and insert the cells again.
+void CellMap::Grow() {
+  Entry free = {kFree, 0};
+  std::vector<Entry> entries(entries_.size() * 2, free);
+  entries_.swap(entries);
+  for (std::size_t i = 0, e = entries.size(); i != e; ++i)
+    if (entries[i].cell != kFree) entries_[Find(entries[i].cell)] = entries[i];
+}
+
+// Construct an empty map.
+CellMap::CellMap() : size_(0) {
+  Entry free = {kFree, 0};
+  entries_.assign(16, free);
+}
+
+// Remove all cells, keeping the slots.
+void CellMap::Clear() {
+  if (size_ == 0) return;
+  Entry free = {kFree, 0};
+  std::fill(entries_.begin(), entries_.end(), free);
+  size_ = 0;
+}
+
+// Return the value of a cell or null if it is not stored.
+std::uint32_t const *CellMap::Get(std::uint64_t cell) const {
+  Entry const &entry = entries_[Find(cell)];
+  return entry.cell == kFree ? 0 : &entry.value;
+}
+
+// Store a cell, return false and leave the map as is if it is already stored.
+// The slots double when half of them are used.
+bool CellMap::Insert(std::uint64_t cell, std::uint32_t value) {
+  std::size_t slot = Find(cell);
+  if (entries_[slot].cell != kFree) return false;
+  if (2 * (size_ + 1) > entries_.size()) {
+    Grow();
+    slot = Find(cell);
+  }
+  entries_[slot].cell = cell;
+  entries_[slot].value = value;
+  ++size_;
+  return true;
+}
+
+}  // namespace battleship
@@ -0,0 +1,46 @@
+#ifndef BATTLESHIP_CELL_MAP_H
+#define BATTLESHIP_CELL_MAP_H
+
+#include <cstdint>
+#include <vector>
+
+namespace battleship {
+
+// An open addressing map from cells, as y * width + x, to a 32 bit value. Its
+// memory grows with the cells stored and not with the size of the board.
+class CellMap {
+ private:
+  // Cell of a free slot, past any board.
+  static std::uint64_t const kFree = ~std::uint64_t(0);
+
+  struct Entry {
+    std::uint64_t cell;
+    std::uint32_t value;
+  };
+
+  std::vector<Entry> entries_;
+  std::size_t size_;
+
+  std::size_t Find(std::uint64_t cell) const;
+  void Grow();
+
+ public:
+  CellMap();
+  void Clear();
+  std::uint32_t const *Get(std::uint64_t cell) const;
+  bool Insert(std::uint64_t cell, std::uint32_t value);
+
+  // Return the number of cells stored.
+  std::size_t size() const { return size_; }
+
+  // Call f(cell, value) for every cell stored, in no particular order.
+  template <typename Function>
+  void ForEach(Function f) const {
+    for (std::size_t i = 0, e = entries_.size(); i != e; ++i)
+      if (entries_[i].cell != kFree)
+        f(entries_[i].cell, entries_[i].value);
+  }
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_CELL_MAP_H
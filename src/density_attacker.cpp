@@ -0,0 +1,275 @@
+#include "density_attacker.hpp"
+
+#include <algorithm>
+
+namespace battleship {
+
+// Find the first and last start of the runs of length cells along a line of
+// size cells that cover pos. Return false if no run fits on the line.
+static bool GetRunStarts(std::size_t pos, std::size_t size, std::size_t length,
+                         std::size_t &first, std::size_t &last) {
+  if (length > size) return false;
+  first = pos + 1 >= length ? pos + 1 - length : 0;
+  last = std::min(pos, size - length);
+  return true;
+}
+
+// Convert 2d coordinates into 1d coordinates.
+std::size_t DensityAttacker::IndexOf(std::size_t x, std::size_t y) const {
+  return y * x_size_ + x;
+}
+
+// Return the heatmap of one distinct length.
+std::size_t *DensityAttacker::Density(std::size_t slot) {
+  return &density_[slot * x_size_ * y_size_];
+}
+
+// Add weight to the score of every cell of a placement not attacked yet.
+void DensityAttacker::ScorePlacement(Ship const &ship, std::size_t weight) {
+  std::size_t dx = ship.orientation == Ship::kHorizontal ? 1 : 0;
+  std::size_t dy = 1 - dx;
+  for (std::size_t i = 0; i != ship.length; ++i) {
+    std::size_t x = ship.x + i * dx;
+    std::size_t y = ship.y + i * dy;
+    if (!attacks_.Test(x, y)) scores_[IndexOf(x, y)] += weight;
+  }
+}
+
+// Remove a placement that is no longer legal from the heatmap of its length.
+void DensityAttacker::RemovePlacement(std::size_t slot, Ship const &ship) {
+  std::size_t *density = Density(slot);
+  std::size_t dx = ship.orientation == Ship::kHorizontal ? 1 : 0;
+  std::size_t dy = 1 - dx;
+  for (std::size_t i = 0; i != ship.length; ++i)
+    --density[IndexOf(ship.x + i * dx, ship.y + i * dy)];
+}
+
+// Mark a cell as unable to hold a floating ship. Only the placements crossing
+// its row and column are affected.
+void DensityAttacker::Block(std::size_t x, std::size_t y) {
+  assert(!blocked_.Test(x, y));
+  for (std::size_t slot = 0, e = lengths_.size(); slot != e; ++slot) {
+    if (afloat_[slot] == 0) continue;
+    std::size_t length = lengths_[slot];
+    std::size_t first;
+    std::size_t last;
+
+    // Horizontal placements along the row.
+    if (GetRunStarts(x, x_size_, length, first, last)) {
+      Ship ship = {Ship::kHorizontal, 0, y, length};
+      for (ship.x = first; ship.x <= last; ++ship.x)
+        if (!blocked_.IntersectsShip(ship)) RemovePlacement(slot, ship);
+    }
+
+    // Vertical placements along the column, single cells were counted once.
+    if (length != 1 && GetRunStarts(y, y_size_, length, first, last)) {
+      Ship ship = {Ship::kVertical, x, 0, length};
+      for (ship.y = first; ship.y <= last; ++ship.y)
+        if (!blocked_.IntersectsShip(ship)) RemovePlacement(slot, ship);
+    }
+  }
+  blocked_.Set(x, y);
+}
+
+// Remove a sunk ship from the fleet and block its cells.
+void DensityAttacker::Sink(Ship const &ship) {
+  std::size_t slot =
+      std::find(lengths_.begin(), lengths_.end(), ship.length) -
+      lengths_.begin();
+  assert(slot != lengths_.size() && afloat_[slot] != 0);
+  --afloat_[slot];
+
+  std::size_t dx = ship.orientation == Ship::kHorizontal ? 1 : 0;
+  std::size_t dy = 1 - dx;
+  for (std::size_t i = 0; i != ship.length; ++i) {
+    std::size_t x = ship.x + i * dx;
+    std::size_t y = ship.y + i * dy;
+    open_hits_.Reset(x, y);
+    Block(x, y);
+  }
+
+  // Forget the hits that belonged to this ship.
+  std::size_t kept = 0;
+  for (std::size_t i = 0, e = open_hit_cells_.size(); i != e; ++i)
+    if (open_hits_.Test(open_hit_cells_[i].x, open_hit_cells_[i].y))
+      open_hit_cells_[kept++] = open_hit_cells_[i];
+  open_hit_cells_.resize(kept);
+}
+
+// Return the unattacked cell with the highest score, breaking ties at random.
+Cell DensityAttacker::PickBest() {
+  Cell best = {0, 0};
+  std::size_t best_score = 0;
+  std::size_t ties = 0;
+  for (std::size_t y = 0; y != y_size_; ++y) {
+    for (std::size_t x = 0; x != x_size_; ++x) {
+      if (attacks_.Test(x, y)) continue;
+      std::size_t score = scores_[IndexOf(x, y)];
+      if (score < best_score) continue;
+      if (score > best_score) {
+        best_score = score;
+        ties = 0;
+      }
+      // Keep each of the tied cells with equal probability.
+      ++ties;
+      if (random_() % ties == 0) {
+        best.x = x;
+        best.y = y;
+      }
+    }
+  }
+  assert(ties != 0);
+  return best;
+}
+
+// Construct an attacker, call Init before playing.
+DensityAttacker::DensityAttacker(unsigned seed)
+    : x_size_(0), y_size_(0), random_(seed) {}
+
+// Restart the random sequence used to break ties.
+void DensityAttacker::Seed(unsigned seed) { random_.seed(seed); }
+
+// Start a new game and build the heatmap of an empty board.
+void DensityAttacker::Init(MapSize size, ShipSet set) {
+  x_size_ = size.x;
+  y_size_ = size.y;
+  attacks_.Init(size.x, size.y);
+  blocked_.Init(size.x, size.y);
+  open_hits_.Init(size.x, size.y);
+  open_hit_cells_.clear();
+
+  lengths_.assign(set.first, set.last);
+  std::sort(lengths_.begin(), lengths_.end());
+  lengths_.erase(std::unique(lengths_.begin(), lengths_.end()),
+                 lengths_.end());
+  afloat_.assign(lengths_.size(), 0);
+  for (std::size_t *it = set.first; it != set.last; ++it)
+    ++afloat_[std::find(lengths_.begin(), lengths_.end(), *it) -
+              lengths_.begin()];
+
+  density_.assign(lengths_.size() * x_size_ * y_size_, 0);
+  for (std::size_t slot = 0, e = lengths_.size(); slot != e; ++slot) {
+    std::size_t *density = Density(slot);
+    std::size_t length = lengths_[slot];
+    for (std::size_t y = 0; y != y_size_; ++y) {
+      for (std::size_t x = 0; x != x_size_; ++x) {
+        std::size_t first;
+        std::size_t last;
+        if (GetRunStarts(x, x_size_, length, first, last))
+          density[IndexOf(x, y)] += last - first + 1;
+        if (length != 1 && GetRunStarts(y, y_size_, length, first, last))
+          density[IndexOf(x, y)] += last - first + 1;
+      }
+    }
+  }
+  scores_.assign(x_size_ * y_size_, 0);
+}
+
+// Score the cells to finish off damaged ships: only placements through an
+// open hit count, weighted by how many open hits they explain. Return false
+// if there are none, leaving every score 0.
+bool DensityAttacker::ScoreTargets() {
+  std::fill(scores_.begin(), scores_.end(), 0);
+  bool targeting = false;
+  for (std::size_t i = 0, e = open_hit_cells_.size(); i != e; ++i) {
+    Cell hit = open_hit_cells_[i];
+    for (std::size_t slot = 0, e2 = lengths_.size(); slot != e2; ++slot) {
+      if (afloat_[slot] == 0) continue;
+      std::size_t length = lengths_[slot];
+      std::size_t first;
+      std::size_t last;
+
+      if (GetRunStarts(hit.x, x_size_, length, first, last)) {
+        Ship ship = {Ship::kHorizontal, 0, hit.y, length};
+        for (ship.x = first; ship.x <= last; ++ship.x) {
+          if (blocked_.IntersectsShip(ship)) continue;
+          ScorePlacement(ship, afloat_[slot]);
+          targeting = true;
+        }
+      }
+
+      if (length != 1 && GetRunStarts(hit.y, y_size_, length, first, last)) {
+        Ship ship = {Ship::kVertical, hit.x, 0, length};
+        for (ship.y = first; ship.y <= last; ++ship.y) {
+          if (blocked_.IntersectsShip(ship)) continue;
+          ScorePlacement(ship, afloat_[slot]);
+          targeting = true;
+        }
+      }
+    }
+  }
+  return targeting;
+}
+
+// Score the cells by the heatmaps of all floating ships.
+void DensityAttacker::ScoreHunt() {
+  std::fill(scores_.begin(), scores_.end(), 0);
+  for (std::size_t slot = 0, e = lengths_.size(); slot != e; ++slot) {
+    if (afloat_[slot] == 0) continue;
+    std::size_t const *density = Density(slot);
+    for (std::size_t i = 0, e2 = scores_.size(); i != e2; ++i)
+      scores_[i] += afloat_[slot] * density[i];
+  }
+}
+
+// Choose the next cell to attack. Damaged ships are finished off first,
+// otherwise we hunt.
+Cell DensityAttacker::NextAttack() {
+  if (!ScoreTargets()) ScoreHunt();
+  return PickBest();
+}
+
+// Choose the cells of a salvo: the best targets around open hits, then the
+// best cells to hunt. Picked cells count as attacked until the salvo is
+// chosen so that no cell is picked twice.
+void DensityAttacker::NextSalvo(Cell *cells, std::size_t count) {
+  std::size_t picked = 0;
+  if (ScoreTargets()) {
+    for (; picked != count; ++picked) {
+      Cell cell = PickBest();
+      if (scores_[IndexOf(cell.x, cell.y)] == 0) break;
+      attacks_.Set(cell.x, cell.y);
+      cells[picked] = cell;
+    }
+  }
+  if (picked != count) {
+    ScoreHunt();
+    for (; picked != count; ++picked) {
+      Cell cell = PickBest();
+      attacks_.Set(cell.x, cell.y);
+      cells[picked] = cell;
+    }
+  }
+  for (std::size_t i = 0; i != count; ++i)
+    attacks_.Reset(cells[i].x, cells[i].y);
+}
+
+// Update the heatmap with the result of an attack.
+void DensityAttacker::Observe(std::size_t x, std::size_t y,
+                              Board::AttackResult const &result) {
+  switch (result.type) {
+    case Board::kRetry:
+      return;
+
+    case Board::kMiss:
+      attacks_.Set(x, y);
+      Block(x, y);
+      return;
+
+    case Board::kHit: {
+      attacks_.Set(x, y);
+      open_hits_.Set(x, y);
+      Cell cell = {x, y};
+      open_hit_cells_.push_back(cell);
+      return;
+    }
+
+    case Board::kSunk:
+      attacks_.Set(x, y);
+      open_hits_.Set(x, y);
+      Sink(*result.ship);
+      return;
+  }
+}
+
+}  // namespace battleship
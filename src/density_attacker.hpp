@@ -0,0 +1,58 @@
+#ifndef BATTLESHIP_DENSITY_ATTACKER_H
+#define BATTLESHIP_DENSITY_ATTACKER_H
+
+#include "attacker.hpp"
+#include "bit_grid.hpp"
+
+#include <random>
+#include <vector>
+
+namespace battleship {
+
+// A computer player that attacks the cell covered by the most legal placements
+// of the ships that are still afloat. The heatmap is built once per game and
+// afterwards only the rows and columns touched by an attack are updated.
+class DensityAttacker : public Attacker {
+ private:
+  std::size_t x_size_;
+  std::size_t y_size_;
+  std::mt19937 random_;
+
+  // The distinct ship lengths and how many of each are still afloat.
+  std::vector<std::size_t> lengths_;
+  std::vector<std::size_t> afloat_;
+  // For every distinct length, the number of placements covering each cell
+  // that avoid blocked cells.
+  std::vector<std::size_t> density_;
+
+  // Cells that were attacked.
+  BitGrid attacks_;
+  // Cells no floating ship can cover: misses and sunk ships.
+  BitGrid blocked_;
+  // Hits that do not belong to a sunk ship yet.
+  BitGrid open_hits_;
+  std::vector<Cell> open_hit_cells_;
+  // Scratch space for scoring the cells.
+  std::vector<std::size_t> scores_;
+
+  std::size_t IndexOf(std::size_t x, std::size_t y) const;
+  std::size_t *Density(std::size_t slot);
+  void ScorePlacement(Ship const &ship, std::size_t weight);
+  void RemovePlacement(std::size_t slot, Ship const &ship);
+  void Block(std::size_t x, std::size_t y);
+  void Sink(Ship const &ship);
+  bool ScoreTargets();
+  void ScoreHunt();
+  Cell PickBest();
+
+ public:
+  explicit DensityAttacker(unsigned seed = 0);
+  void Seed(unsigned seed);
+  void Init(MapSize size, ShipSet set);
+  Cell NextAttack();
+  void NextSalvo(Cell *cells, std::size_t count);
+  void Observe(std::size_t x, std::size_t y, Board::AttackResult const &result);
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_DENSITY_ATTACKER_H
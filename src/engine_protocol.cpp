@@ -0,0 +1,146 @@
+#include "engine_protocol.hpp"
+
+#include <cstdio>
+
+namespace battleship {
+
+// The largest number read, so sizes and coordinates never overflow.
+static std::size_t const kMaxNumber = 1 << 24;
+
+// Read a decimal number at it and advance past it.
+static bool ParseNumber(char const *&it, std::size_t &value) {
+  if (*it < '0' || *it > '9') return false;
+  value = 0;
+  for (; *it >= '0' && *it <= '9'; ++it) {
+    value = value * 10 + static_cast<std::size_t>(*it - '0');
+    if (value > kMaxNumber) return false;
+  }
+  return true;
+}
+
+// Skip a separator character at it.
+static bool Skip(char const *&it, char separator) {
+  if (*it != separator) return false;
+  ++it;
+  return true;
+}
+
+// Split a line into its words.
+void SplitWords(std::string const &line, std::vector<std::string> &words) {
+  words.clear();
+  std::size_t i = 0;
+  std::size_t e = line.size();
+  for (;;) {
+    while (i != e && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r'))
+      ++i;
+    if (i == e) return;
+    std::size_t start = i;
+    while (i != e && line[i] != ' ' && line[i] != '\t' && line[i] != '\r') ++i;
+    words.push_back(line.substr(start, i - start));
+  }
+}
+
+// Return "WxH A,B,..." for the rules of a game.
+std::string FormatRules(GameRules const &rules) {
+  char buffer[48];
+  std::snprintf(buffer, sizeof(buffer), "%zux%zu", rules.size.x,
+                rules.size.y);
+  std::string text = buffer;
+  for (std::size_t i = 0, e = rules.ship_set.size(); i != e; ++i) {
+    std::snprintf(buffer, sizeof(buffer), "%c%zu", i == 0 ? ' ' : ',',
+                  rules.ship_set[i]);
+    text += buffer;
+  }
+  return text;
+}
+
+// Return "x,y,h|v,length" for a ship.
+std::string FormatShip(Ship const &ship) {
+  char buffer[80];
+  std::snprintf(buffer, sizeof(buffer), "%zu,%zu,%c,%zu", ship.x, ship.y,
+                ship.orientation == Ship::kHorizontal ? 'h' : 'v',
+                ship.length);
+  return buffer;
+}
+
+// Return "x,y" for a cell.
+std::string FormatCell(std::size_t x, std::size_t y) {
+  char buffer[48];
+  std::snprintf(buffer, sizeof(buffer), "%zu,%zu", x, y);
+  return buffer;
+}
+
+// Return the word for the result of an attack.
+char const *FormatAttack(Board::AttackType type) {
+  switch (type) {
+    case Board::kSunk:
+      return "sunk";
+    case Board::kHit:
+      return "hit";
+    case Board::kMiss:
+      return "miss";
+    case Board::kRetry:
+      break;
+  }
+  return "retry";
+}
+
+// Parse the words "WxH" and "A,B,..." of a newgame command.
+bool ParseRules(std::string const &size, std::string const &lengths,
+                GameRules &rules) {
+  char const *it = size.c_str();
+  if (!ParseNumber(it, rules.size.x) || !Skip(it, 'x') ||
+      !ParseNumber(it, rules.size.y) || *it != '\0' || rules.size.x == 0 ||
+      rules.size.y == 0)
+    return false;
+
+  rules.ship_set.clear();
+  it = lengths.c_str();
+  for (;;) {
+    std::size_t length;
+    if (!ParseNumber(it, length) || length == 0) return false;
+    rules.ship_set.push_back(length);
+    if (*it == '\0') return true;
+    if (!Skip(it, ',')) return false;
+  }
+}
+
+// Parse "x,y,h|v,length".
+bool ParseShip(std::string const &text, Ship &ship) {
+  char const *it = text.c_str();
+  if (!ParseNumber(it, ship.x) || !Skip(it, ',') ||
+      !ParseNumber(it, ship.y) || !Skip(it, ','))
+    return false;
+  if (*it == 'h') {
+    ship.orientation = Ship::kHorizontal;
+  } else if (*it == 'v') {
+    ship.orientation = Ship::kVertical;
+  } else {
+    return false;
+  }
+  ++it;
+  return Skip(it, ',') && ParseNumber(it, ship.length) && *it == '\0';
+}
+
+// Parse "x,y".
+bool ParseCell(std::string const &text, Cell &cell) {
+  char const *it = text.c_str();
+  return ParseNumber(it, cell.x) && Skip(it, ',') &&
+         ParseNumber(it, cell.y) && *it == '\0';
+}
+
+// Parse "hit", "miss" or "sunk".
+bool ParseAttack(std::string const &text, Board::AttackType &type) {
+  if (text == "hit") {
+    type = Board::kHit;
+  } else if (text == "miss") {
+    type = Board::kMiss;
+  } else if (text == "sunk") {
+    type = Board::kSunk;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace battleship
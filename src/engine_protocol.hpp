@@ -0,0 +1,52 @@
+#ifndef BATTLESHIP_ENGINE_PROTOCOL_H
+#define BATTLESHIP_ENGINE_PROTOCOL_H
+
+#include "board.hpp"
+#include "game_record.hpp"
+#include "ship.hpp"
+
+#include <string>
+#include <vector>
+
+namespace battleship {
+
+// A line-based protocol between a tournament runner and engines playing over
+// their standard input and output, in the spirit of UCI for chess engines.
+// Words are separated by spaces. Coordinates count from 0, x along a row and y
+// down a column, and a cell is written "x,y". A ship is written "x,y,h,length"
+// or "x,y,v,length" from its top left cell.
+//
+// Runner to engine:
+//   bsp                          Sent once. The engine may answer with
+//                                "id name NAME", and must end with "bspok".
+//   newgame WxH A,B,...          A new game on a W by H board with ships of
+//                                lengths A, B, ... No answer.
+//   place                        Answer "fleet SHIP SHIP ..." with one ship
+//                                of every length of the game.
+//   shoot                        Answer "shot x,y".
+//   result hit|miss|sunk [SHIP]  What the last shot did, with the ship sunk.
+//   gameover win|loss            The game is over. No answer.
+//   quit                         Exit.
+//
+// Engines may send "info ..." lines at any time, which are ignored, and should
+// ignore commands they do not know. Several games are played one after the
+// other by the same engine. An engine that places an illegal fleet, shoots
+// outside the board or at a cell it shot before, or does not answer in time
+// loses the game.
+
+// Split a line into its words.
+void SplitWords(std::string const &line, std::vector<std::string> &words);
+
+std::string FormatRules(GameRules const &rules);
+std::string FormatShip(Ship const &ship);
+std::string FormatCell(std::size_t x, std::size_t y);
+char const *FormatAttack(Board::AttackType type);
+
+bool ParseRules(std::string const &size, std::string const &lengths,
+                GameRules &rules);
+bool ParseShip(std::string const &text, Ship &ship);
+bool ParseCell(std::string const &text, Cell &cell);
+bool ParseAttack(std::string const &text, Board::AttackType &type);
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_ENGINE_PROTOCOL_H
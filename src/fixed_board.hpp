@@ -0,0 +1,257 @@
+#ifndef BATTLESHIP_FIXED_BOARD_H
+#define BATTLESHIP_FIXED_BOARD_H
+
+#include "board.hpp"
+#include "metrics.hpp"
+#include "presets.hpp"
+#include "ship.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace battleship {
+
+// A Board whose size is fixed at compile time, for the preset map sizes. It
+// plays exactly as a Board does, but every index is a constant shift and mask
+// and the bit planes are arrays inside the object: each row sits in a lane of
+// 8, 16 or 32 bits, so an 8x8 plane is one word and a 26x26 one thirteen, and
+// the three planes of the largest preset fit in two cache lines. Only the
+// ships live on the heap, as they must keep their addresses.
+template <std::size_t W, std::size_t H>
+class FixedBoard {
+ public:
+  static std::size_t const kWidth = W;
+  static std::size_t const kHeight = H;
+  static std::size_t const kLaneBits = W <= 8 ? 8 : W <= 16 ? 16 : W <= 32 ? 32
+                                                                           : 64;
+  static std::size_t const kLanes = 64 / kLaneBits;
+  static std::size_t const kWords = (H + kLanes - 1) / kLanes;
+
+ private:
+  static_assert(W != 0 && H != 0 && W <= 64, "rows must fit a word");
+  static_assert(H <= kMaxPackedSide, "ships must pack");
+
+  typedef std::array<std::uint64_t, kWords> Plane;
+
+  // Bit 0 of every lane of a word.
+  static std::uint64_t const kColumn =
+      kLanes == 1 ? 1
+                  : ~std::uint64_t(0) / ((std::uint64_t(1) << kLaneBits) - 1);
+
+  struct ShipCounter {
+    PackedShip ship;
+    std::uint32_t hits_left;
+  };
+
+  Plane ship_map_;
+  Plane attacks_;
+  Plane hits_;
+  std::vector<ShipCounter> ship_counters_;
+  std::vector<Ship> ships_;
+
+  // Return the bits of a run of n cells from lane bit 0.
+  static std::uint64_t RunMask(std::size_t n) {
+    return n == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << n) - 1;
+  }
+
+  // Return the word holding a row.
+  static std::size_t WordOf(std::size_t y) { return y / kLanes; }
+
+  // Return the bit of a cell inside its word.
+  static std::uint64_t BitOf(std::size_t x, std::size_t y) {
+    assert(x < W && y < H);
+    return std::uint64_t(1) << ((y % kLanes) * kLaneBits + x);
+  }
+
+  // Return the bits of a ship inside word w, which it must touch.
+  static std::uint64_t ShipMask(Ship const &ship, std::size_t w) {
+    if (ship.orientation == Ship::kHorizontal)
+      return RunMask(ship.length) << ((ship.y % kLanes) * kLaneBits + ship.x);
+    // The lanes of the word the ship covers, as a run of rows.
+    std::size_t first = w * kLanes;
+    std::size_t begin = ship.y > first ? ship.y - first : 0;
+    std::size_t end = ship.y + ship.length - first;
+    if (end > kLanes) end = kLanes;
+    std::uint64_t lanes = RunMask((end - begin) * kLaneBits)
+                          << (begin * kLaneBits);
+    return (kColumn & lanes) << ship.x;
+  }
+
+  // Return the first word and one past the last word a ship touches.
+  static void GetWords(Ship const &ship, std::size_t &begin,
+                       std::size_t &end) {
+    begin = WordOf(ship.y);
+    end = ship.orientation == Ship::kHorizontal
+              ? begin + 1
+              : WordOf(ship.y + ship.length - 1) + 1;
+  }
+
+  // Return the index of the ship covering a cell.
+  std::size_t GetShipIndex(std::size_t x, std::size_t y) const {
+    std::size_t i = 0;
+    while (!Covers(ship_counters_[i].ship, x, y)) ++i;
+    return i;
+  }
+
+  // Place a ship unless it overlaps another.
+  Board::PlaceResult PlaceShip(Ship const &ship) {
+    assert(ship.length != 0);
+    assert(ship.orientation == Ship::kHorizontal
+               ? ship.x + ship.length <= W && ship.y < H
+               : ship.y + ship.length <= H && ship.x < W);
+    Board::PlaceResult result;
+    std::size_t begin;
+    std::size_t end;
+    GetWords(ship, begin, end);
+    std::uint64_t any = 0;
+    for (std::size_t w = begin; w != end; ++w)
+      any |= ship_map_[w] & ShipMask(ship, w);
+    if (any != 0) {
+      result.type = Board::kOverlap;
+      CountMetric(kOverlapCounter);
+      return result;
+    }
+
+    for (std::size_t w = begin; w != end; ++w)
+      ship_map_[w] |= ShipMask(ship, w);
+    ShipCounter counter = {Pack(ship),
+                           static_cast<std::uint32_t>(ship.length)};
+    ship_counters_.push_back(counter);
+    ships_.push_back(ship);
+    result.type = Board::kPlaced;
+    result.ship = &ships_.back();
+    CountMetric(kPlacedCounter);
+    return result;
+  }
+
+  // Place a ship as Place does, timing it.
+  Board::PlaceResult TimePlace(Ship const &ship) {
+    ScopedTimer timer(kPlaceTimer);
+    return PlaceShip(ship);
+  }
+
+  // Attack a cell without counting the outcome.
+  Board::AttackResult Strike(std::size_t x, std::size_t y) {
+    Board::AttackResult result;
+    std::size_t w = WordOf(y);
+    std::uint64_t bit = BitOf(x, y);
+    if ((attacks_[w] & bit) != 0) {
+      result.type = Board::kRetry;
+      return result;
+    }
+    attacks_[w] |= bit;
+    if ((ship_map_[w] & bit) == 0) {
+      result.type = Board::kMiss;
+      return result;
+    }
+
+    hits_[w] |= bit;
+    std::size_t index = GetShipIndex(x, y);
+    ShipCounter &counter = ship_counters_[index];
+    result.ship = &ships_[index];
+    --counter.hits_left;
+    result.type = counter.hits_left == 0 ? Board::kSunk : Board::kHit;
+    return result;
+  }
+
+  // Attack a cell.
+  Board::AttackResult AttackCell(std::size_t x, std::size_t y) {
+    Board::AttackResult result = Strike(x, y);
+    CountMetric(AttackCounter(result.type));
+    return result;
+  }
+
+  // Attack a cell as Attack does, timing it.
+  Board::AttackResult TimeAttack(std::size_t x, std::size_t y) {
+    ScopedTimer timer(kAttackTimer);
+    return AttackCell(x, y);
+  }
+
+ public:
+  FixedBoard() { Init(); }
+
+  // Remove every ship and attack. The size is only there so that code
+  // written for Board works unchanged and must be W by H.
+  void Init(std::size_t x_size = W, std::size_t y_size = H) {
+    assert(x_size == W && y_size == H);
+    (void)x_size;
+    (void)y_size;
+    ship_map_.fill(0);
+    attacks_.fill(0);
+    hits_.fill(0);
+    ship_counters_.clear();
+    ships_.clear();
+  }
+
+  // Make room for ships so that placing them never allocates.
+  void Reserve(std::size_t, std::size_t, std::size_t ships) {
+    ship_counters_.reserve(ships);
+    ships_.reserve(ships);
+  }
+
+  // Try to place a ship and return if we were successful or not.
+  Board::PlaceResult Place(Ship const &ship) {
+    if (MetricsTiming()) return TimePlace(ship);
+    return PlaceShip(ship);
+  }
+
+  // Try to attack a cell and return the status of the cell.
+  Board::AttackResult Attack(std::size_t x, std::size_t y) {
+    if (MetricsTiming()) return TimeAttack(x, y);
+    return AttackCell(x, y);
+  }
+
+  // Attack several cells at once as Board::AttackMany does, counting the
+  // outcomes once for the salvo.
+  void AttackMany(Cell const *cells, std::size_t count,
+                  Board::AttackResult *results) {
+    std::uint64_t outcomes[4] = {0, 0, 0, 0};
+    for (std::size_t i = 0; i != count; ++i) {
+      results[i] = Strike(cells[i].x, cells[i].y);
+      ++outcomes[results[i].type];
+    }
+    for (std::size_t i = 0; i != 4; ++i)
+      if (outcomes[i] != 0)
+        CountMetric(AttackCounter(static_cast<Board::AttackType>(i)),
+                    outcomes[i]);
+  }
+};
+
+// Call function with an empty FixedBoard if the map size is one of the
+// first N presets, and with a Board otherwise.
+template <std::size_t N>
+struct PresetBoardDispatch {
+  template <typename Function>
+  static void Run(MapSize size, Function &function) {
+    std::size_t const w = kPresetWidths[N - 1];
+    std::size_t const h = kPresetHeights[N - 1];
+    if (size.x == w && size.y == h) {
+      FixedBoard<w, h> board;
+      function(board);
+    } else {
+      PresetBoardDispatch<N - 1>::Run(size, function);
+    }
+  }
+};
+
+template <>
+struct PresetBoardDispatch<0> {
+  template <typename Function>
+  static void Run(MapSize size, Function &function) {
+    Board board(size.x, size.y);
+    function(board);
+  }
+};
+
+// Call function with an empty board for a map size: a FixedBoard for the
+// preset sizes and a Board for any other. The board lives for the call, so
+// a whole batch of games should be played inside it.
+template <typename Function>
+void DispatchBoard(MapSize size, Function &function) {
+  PresetBoardDispatch<kNumPresets>::Run(size, function);
+}
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_FIXED_BOARD_H
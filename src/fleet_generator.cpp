@@ -0,0 +1,258 @@
+#include "fleet_generator.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace battleship {
+
+// Whole fleets drawn before Generate gives up. Sets that overlap this often
+// are drawn from their LayoutGraph, so only a set whose graph is too large to
+// build and that barely fits its board ever runs out.
+static std::size_t const kMaxAttempts = 1 << 16;
+// Fleets drawn by the first Init of a map size and set to see how often they
+// overlap, and the least of them that must not for drawing to be kept.
+static std::size_t const kTrials = 1024;
+static std::size_t const kMinAccepted = kTrials / 64;
+
+// A random number times a range, as wide as it takes.
+__extension__ typedef unsigned __int128 Product;
+
+// How a map size and set are drawn: from a graph, or without one when
+// drawing is fast or the graph too large. A set the graph has no fleet for
+// does not fit its board. Boards of a word of cells or less also keep the
+// cells of every placement of every ship, as bit y * width + x.
+struct FleetGenerator::Plan {
+  MapSize size;
+  std::vector<std::size_t> lengths;
+  std::unique_ptr<LayoutGraph> graph;
+  std::vector<std::vector<std::uint64_t> > cells;
+};
+
+// Return whether the bits left after drawing numbers from one random number,
+// ranges of those numbers multiplied together as range, keep every draw
+// equally likely. Multiplying the random number by each range in turn takes
+// the numbers as the digits of one draw below range and leaves the bits as
+// the fraction dropped, which is even over the draws if it is not below
+// 2^64 mod range.
+static bool IsUnbiased(std::uint64_t bits, std::uint64_t range) {
+  return bits >= range || bits >= -range % range;
+}
+
+// Return whether two ships share a cell, without branches since the answer
+// is a coin toss while drawing.
+static bool Overlap(Ship const &a, Ship const &b) {
+  std::size_t a_x = a.orientation == Ship::kHorizontal ? a.length : 1;
+  std::size_t a_y = a.orientation == Ship::kHorizontal ? 1 : a.length;
+  std::size_t b_x = b.orientation == Ship::kHorizontal ? b.length : 1;
+  std::size_t b_y = b.orientation == Ship::kHorizontal ? 1 : b.length;
+  return (a.x < b.x + b_x) & (b.x < a.x + a_x) & (a.y < b.y + b_y) &
+         (b.y < a.y + a_y);
+}
+
+// Return the plan of a map size and a set sorted longest first that Prepare
+// accepts, measuring and keeping it the first time, so that this only
+// allocates then.
+FleetGenerator::Plan const &FleetGenerator::GetPlan(MapSize size,
+                                                    ShipSet set) {
+  typedef std::multimap<std::uint64_t, Plan> Cache;
+  static std::mutex mutex;
+  static Cache cache;
+
+  std::uint64_t key = size.x * 0x9e3779b97f4a7c15ULL ^ size.y;
+  for (std::size_t const *length = set.first; length != set.last; ++length)
+    key = (key ^ *length) * 0xff51afd7ed558ccdULL;
+  std::size_t ships = set.last - set.first;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::pair<Cache::iterator, Cache::iterator> range = cache.equal_range(key);
+  for (Cache::iterator it = range.first; it != range.second; ++it) {
+    Plan const &plan = it->second;
+    if (plan.size.x == size.x && plan.size.y == size.y &&
+        plan.lengths.size() == ships &&
+        std::equal(set.first, set.last, plan.lengths.begin()))
+      return plan;
+  }
+
+  // Trials use their own random numbers, so that the fleets a generator
+  // draws do not depend on whether it came first.
+  FleetGenerator trial;
+  trial.Prepare(size, set);
+  std::mt19937_64 random(1);
+  std::vector<Ship> fleet(ships);
+  std::size_t accepted = 0;
+  for (std::size_t i = 0; i != kTrials; ++i)
+    accepted += trial.TryGenerate(random, fleet.data());
+
+  Plan plan;
+  plan.size = size;
+  plan.lengths.assign(set.first, set.last);
+  if (accepted < kMinAccepted) plan.graph.reset(LayoutGraph::Create(size, set));
+  if (size.x * size.y <= 64 && trial.tables_.size() == ships) {
+    plan.cells.resize(ships);
+    for (std::size_t i = 0; i != ships; ++i) {
+      PlacementTable const &table = *trial.tables_[i];
+      for (std::size_t p = 0, e = table.size(); p != e; ++p) {
+        Ship ship = table.GetShip(p);
+        std::size_t step = ship.orientation == Ship::kHorizontal ? 1 : size.x;
+        std::uint64_t cells = 0;
+        for (std::size_t j = 0; j != ship.length; ++j)
+          cells |= std::uint64_t(1) << (ship.y * size.x + ship.x + j * step);
+        plan.cells[i].push_back(cells);
+      }
+    }
+  }
+  return cache.insert(std::make_pair(key, std::move(plan)))->second;
+}
+
+// Look up the placements of every ship length of a set, if the board is small
+// enough to have them. Return false if a ship fits the board in neither
+// direction or the ships have more cells than the board.
+bool FleetGenerator::Prepare(MapSize size, ShipSet set) {
+  lengths_.assign(set.first, set.last);
+  std::sort(lengths_.begin(), lengths_.end(), std::greater<std::size_t>());
+
+  size_ = size;
+  tables_.clear();
+  cells_.clear();
+  graph_ = 0;
+  std::size_t cells = 0;
+  for (std::size_t i = 0, e = lengths_.size(); i != e; ++i) {
+    if (lengths_[i] == 0 || lengths_[i] > std::max(size.x, size.y))
+      return false;
+    cells += lengths_[i];
+  }
+  if (cells > size.x * size.y) return false;
+
+  if (size.x <= Bitboard::kMaxWidth && size.y <= Bitboard::kMaxHeight)
+    for (std::size_t i = 0, e = lengths_.size(); i != e; ++i)
+      tables_.push_back(&PlacementTable::Get(size.x, size.y, lengths_[i]));
+  return true;
+}
+
+// Draw every ship from all its placements, return false if one overlaps a ship
+// drawn before it. As many ships as the product of their placements allows
+// are drawn from one random number by multiplying instead of dividing.
+bool FleetGenerator::TryGenerate(std::mt19937_64 &random, Ship *ships) const {
+  std::uint64_t bits = 0;
+  std::uint64_t range = 0;
+  std::uint64_t occupied = 0;
+  for (std::size_t i = 0, e = lengths_.size(); i != e; ++i) {
+    // Boards too large for placement tables count placements. Single cells
+    // are only counted once, as horizontal placements. Init made sure every
+    // length has a placement.
+    std::size_t length = lengths_[i];
+    std::size_t x_starts = 0;
+    std::uint64_t horizontal = 0;
+    std::uint64_t placements;
+    if (i < tables_.size()) {
+      placements = tables_[i]->size();
+    } else {
+      x_starts = size_.x >= length ? size_.x - length + 1 : 0;
+      std::size_t y_starts = size_.y >= length ? size_.y - length + 1 : 0;
+      horizontal = x_starts * size_.y;
+      placements = horizontal + (length == 1 ? 0 : size_.x * y_starts);
+    }
+
+    std::uint64_t next_range;
+    if (range == 0 ||
+        __builtin_mul_overflow(range, placements, &next_range)) {
+      if (range != 0 && !IsUnbiased(bits, range)) return false;
+      bits = random();
+      next_range = placements;
+    }
+    range = next_range;
+    Product product = static_cast<Product>(bits) * placements;
+    std::uint64_t p = static_cast<std::uint64_t>(product >> 64);
+    bits = static_cast<std::uint64_t>(product);
+
+    Ship &ship = ships[i];
+    if (!cells_.empty()) {
+      std::uint64_t cells = cells_[i][p];
+      if ((occupied & cells) != 0) return false;
+      occupied |= cells;
+      ship = tables_[i]->GetShip(p);
+      continue;
+    }
+    if (i < tables_.size()) {
+      ship = tables_[i]->GetShip(p);
+    } else {
+      ship.length = length;
+      if (p < horizontal) {
+        ship.orientation = Ship::kHorizontal;
+        ship.x = p % x_starts;
+        ship.y = p / x_starts;
+      } else {
+        p -= horizontal;
+        ship.orientation = Ship::kVertical;
+        ship.x = p % size_.x;
+        ship.y = p / size_.x;
+      }
+    }
+    bool overlaps = false;
+    for (std::size_t j = 0; j != i; ++j) overlaps |= Overlap(ship, ships[j]);
+    if (overlaps) return false;
+  }
+  return range == 0 || IsUnbiased(bits, range);
+}
+
+// Construct a generator, call Init before generating.
+FleetGenerator::FleetGenerator(unsigned seed) : random_(seed), graph_(0) {
+  size_.x = 0;
+  size_.y = 0;
+}
+
+// Restart the random sequence.
+void FleetGenerator::Seed(unsigned seed) { random_.seed(seed); }
+
+// Prepare a set and look up how to draw it. Return false if Prepare does or
+// the set has a graph without a fleet; the generator must not be used until
+// an Init succeeds.
+bool FleetGenerator::Init(MapSize size, ShipSet set) {
+  if (!Prepare(size, set)) return false;
+  ShipSet sorted = {lengths_.data(), lengths_.data() + lengths_.size()};
+  Plan const &plan = GetPlan(size, sorted);
+  graph_ = plan.graph.get();
+  for (std::size_t i = 0, e = plan.cells.size(); i != e; ++i)
+    cells_.push_back(plan.cells[i].data());
+  return graph_ == 0 || graph_->fleets() != 0;
+}
+
+// Make room for sets of up to ships ships so that Init never allocates once
+// the placement tables and plan it needs exist.
+void FleetGenerator::Reserve(std::size_t ships) {
+  lengths_.reserve(ships);
+  tables_.reserve(ships);
+  cells_.reserve(ships);
+}
+
+// Return the number of ships in a fleet.
+std::size_t FleetGenerator::fleet_size() const { return lengths_.size(); }
+
+// Fill ships with a random legal fleet of fleet_size() ships. Return false,
+// leaving ships undefined, if the graph has no fleet or there is no graph and
+// kMaxAttempts fleets all had overlapping ships.
+bool FleetGenerator::Generate(Ship *ships) {
+  if (graph_ != 0) {
+    if (graph_->fleets() == 0) return false;
+    std::uniform_int_distribution<std::uint64_t> ranks(0,
+                                                       graph_->fleets() - 1);
+    graph_->GetFleet(ranks(random_), ships);
+    return true;
+  }
+  for (std::size_t attempt = 0; attempt != kMaxAttempts; ++attempt)
+    if (TryGenerate(random_, ships)) return true;
+  return false;
+}
+
+// Fill ships with count consecutive fleets, return false if one could not be
+// drawn.
+bool FleetGenerator::Generate(Ship *ships, std::size_t count) {
+  for (std::size_t i = 0; i != count; ++i)
+    if (!Generate(ships + i * fleet_size())) return false;
+  return true;
+}
+
+}  // namespace battleship
@@ -0,0 +1,62 @@
+#ifndef BATTLESHIP_FLEET_GENERATOR_H
+#define BATTLESHIP_FLEET_GENERATOR_H
+
+#include "layout_graph.hpp"
+#include "placement_table.hpp"
+#include "presets.hpp"
+#include "ship.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace battleship {
+
+// Generates random legal fleets for a map size and ship set, every legal fleet
+// equally likely. Each ship is drawn uniformly from all of its placements,
+// longest ship first, and the whole fleet is drawn again as soon as a ship
+// overlaps one placed before it. Keeping only fleets without overlaps keeps
+// every layout exactly as likely as it was among the independent draws, which
+// drawing each ship from the placements still legal does not: it favours
+// layouts whose ships left the others little room. A draw only compares the
+// ship with those drawn before it, and one random number draws several ships,
+// so it costs a few nanoseconds.
+//
+// Sets that fit so tightly that nearly every draw overlaps are instead drawn
+// from the LayoutGraph counting their fleets, without ever starting over. The
+// first Init of a map size and set measures how often draws overlap and
+// decides, and the decision and graph are kept for later ones.
+class FleetGenerator {
+ private:
+  // How a map size and set are drawn.
+  struct Plan;
+
+  std::mt19937_64 random_;
+  // The placements of every ship to place, longest ship first, if the board
+  // is small enough to have them.
+  std::vector<PlacementTable const *> tables_;
+  // The cells of every placement of every ship, as the plan keeps them, on
+  // boards of a word of cells or less.
+  std::vector<std::uint64_t const *> cells_;
+  // The lengths of the set, longest first.
+  std::vector<std::size_t> lengths_;
+  MapSize size_;
+  // The graph to draw from, null to draw ships and start over on overlaps.
+  LayoutGraph const *graph_;
+
+  static Plan const &GetPlan(MapSize size, ShipSet set);
+  bool Prepare(MapSize size, ShipSet set);
+  bool TryGenerate(std::mt19937_64 &random, Ship *ships) const;
+
+ public:
+  explicit FleetGenerator(unsigned seed = 0);
+  void Seed(unsigned seed);
+  bool Init(MapSize size, ShipSet set);
+  void Reserve(std::size_t ships);
+  std::size_t fleet_size() const;
+  bool Generate(Ship *ships);
+  bool Generate(Ship *ships, std::size_t count);
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_FLEET_GENERATOR_H
@@ -0,0 +1,213 @@
+#include "frame_trace.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+namespace battleship {
+
+// The names of the input types in traces and input files.
+static char const *const kInputNames[] = {"press", "move", "release"};
+
+// Append nanoseconds to a string as the microseconds of a Chrome trace.
+static void AppendMicroseconds(std::string &out, std::uint64_t nanoseconds) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.3f",
+                static_cast<double>(nanoseconds) / 1000);
+  out += buffer;
+}
+
+// Append a complete event of a Chrome trace, without arguments, leaving the
+// object open.
+static void AppendEvent(std::string &out, char const *name,
+                        std::size_t track, std::uint64_t begin,
+                        std::uint64_t end) {
+  char buffer[64];
+  out += out.size() == 0 || out[out.size() - 1] == '[' ? "\n" : ",\n";
+  out += "{\"name\":\"";
+  out += name;
+  out += "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+  std::snprintf(buffer, sizeof(buffer), "%zu", track);
+  out += buffer;
+  out += ",\"ts\":";
+  AppendMicroseconds(out, begin);
+  out += ",\"dur\":";
+  AppendMicroseconds(out, end - begin);
+}
+
+// Return a track, adding it if it is new.
+FrameTrace::Track &FrameTrace::GetTrack(std::size_t track) {
+  if (track >= tracks_.size()) {
+    Track empty = Track();
+    tracks_.resize(track + 1, empty);
+  }
+  return tracks_[track];
+}
+
+// Construct an empty trace beginning now.
+FrameTrace::FrameTrace() : start_(Clock::now()) {}
+
+// Forget everything and begin again now.
+void FrameTrace::Clear() {
+  start_ = Clock::now();
+  tracks_.clear();
+  inputs_.clear();
+  frames_.clear();
+}
+
+// Return the time since the trace began.
+std::uint64_t FrameTrace::Now() const {
+  std::chrono::nanoseconds elapsed = Clock::now() - start_;
+  return static_cast<std::uint64_t>(elapsed.count());
+}
+
+// Note that a track's widget got a mouse event at a position.
+void FrameTrace::BeginInput(std::size_t track, InputType type, int x, int y) {
+  Track &t = GetTrack(track);
+  Input input = {Now(), track, type, x, y};
+  inputs_.push_back(input);
+  t.in_input = true;
+  t.input_updated = false;
+  t.input = input;
+}
+
+// Note that a track's widget is done with the mouse event.
+void FrameTrace::EndInput(std::size_t track) {
+  Track &t = GetTrack(track);
+  if (t.pending && t.frame.handled == 0) t.frame.handled = Now();
+  t.in_input = false;
+}
+
+// Note that a track's widget asked for a repaint. Only repaints asked for by
+// input open or join frames.
+void FrameTrace::Update(std::size_t track) {
+  Track &t = GetTrack(track);
+  if (!t.in_input || t.input_updated) return;
+  t.input_updated = true;
+  if (t.pending) {
+    ++t.frame.inputs;
+    return;
+  }
+  t.pending = true;
+  t.frame.track = track;
+  t.frame.input = t.input;
+  t.frame.inputs = 1;
+  t.frame.handled = 0;
+  t.frame.update = Now();
+}
+
+// Note that a track's widget began to paint.
+void FrameTrace::BeginPaint(std::size_t track) {
+  GetTrack(track).paint_begin = Now();
+}
+
+// Note that a track's widget finished painting, closing its frame.
+void FrameTrace::EndPaint(std::size_t track) {
+  Track &t = GetTrack(track);
+  std::uint64_t now = Now();
+  if (!t.pending) {
+    Input none = {t.paint_begin, track, kPress, 0, 0};
+    Frame frame = {track, none, 0, t.paint_begin, t.paint_begin,
+                   t.paint_begin, now};
+    frames_.push_back(frame);
+    return;
+  }
+  // A paint inside the handler leaves it unfinished.
+  if (t.frame.handled == 0) t.frame.handled = t.paint_begin;
+  t.frame.paint_begin = t.paint_begin;
+  t.frame.paint_end = now;
+  frames_.push_back(t.frame);
+  t.pending = false;
+}
+
+// Count the latency of every frame caused by input, from the event to the
+// end of its paint, and the time taken by every paint.
+void FrameTrace::GetLatencies(LatencyHistogram &latencies,
+                              LatencyHistogram &paints) const {
+  latencies.Clear();
+  paints.Clear();
+  for (std::size_t i = 0, e = frames_.size(); i != e; ++i) {
+    Frame const &frame = frames_[i];
+    paints.Record(frame.paint_end - frame.paint_begin);
+    if (frame.inputs != 0)
+      latencies.Record(frame.paint_end - frame.input.time);
+  }
+}
+
+// Format the frames as a Chrome trace, one thread per track. A frame caused
+// by input spans its handler, the wait for the paint and the paint.
+std::string FrameTrace::FormatChromeTrace() const {
+  std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  for (std::size_t i = 0, e = frames_.size(); i != e; ++i) {
+    Frame const &frame = frames_[i];
+    if (frame.inputs != 0) {
+      char buffer[96];
+      AppendEvent(out, "frame", frame.track, frame.input.time,
+                  frame.paint_end);
+      std::snprintf(buffer, sizeof(buffer),
+                    ",\"args\":{\"input\":\"%s\",\"x\":%d,\"y\":%d,"
+                    "\"inputs\":%zu}}",
+                    kInputNames[frame.input.type], frame.input.x,
+                    frame.input.y, frame.inputs);
+      out += buffer;
+      AppendEvent(out, "input", frame.track, frame.input.time,
+                  frame.handled);
+      out += "}";
+      AppendEvent(out, "wait", frame.track, frame.handled,
+                  frame.paint_begin);
+      out += "}";
+    }
+    AppendEvent(out, "paint", frame.track, frame.paint_begin,
+                frame.paint_end);
+    out += "}";
+  }
+  out += "\n]}\n";
+  return out;
+}
+
+// Write the frames as a Chrome trace, for chrome://tracing or Perfetto.
+// Return false if the file cannot be written.
+bool FrameTrace::WriteChromeTrace(char const *path) const {
+  std::ofstream file(path);
+  file << FormatChromeTrace();
+  file.close();
+  return !file.fail();
+}
+
+// Write the mouse events as text, a line per event with its time in
+// microseconds, track, type and position. Return false if the file cannot
+// be written.
+bool FrameTrace::WriteInputs(char const *path) const {
+  std::ofstream file(path);
+  for (std::size_t i = 0, e = inputs_.size(); i != e; ++i) {
+    Input const &input = inputs_[i];
+    file << input.time / 1000 << ' ' << input.track << ' '
+         << kInputNames[input.type] << ' ' << input.x << ' ' << input.y
+         << '\n';
+  }
+  file.close();
+  return !file.fail();
+}
+
+// Append the mouse events of a file written by WriteInputs, with their times
+// in nanoseconds. Return false if it cannot be read or is malformed.
+bool ReadInputs(char const *path, std::vector<FrameTrace::Input> &inputs) {
+  std::ifstream file(path);
+  if (!file) return false;
+  FrameTrace::Input input;
+  std::string type;
+  while (file >> input.time >> input.track >> type >> input.x >> input.y) {
+    if (type == kInputNames[FrameTrace::kPress])
+      input.type = FrameTrace::kPress;
+    else if (type == kInputNames[FrameTrace::kMove])
+      input.type = FrameTrace::kMove;
+    else if (type == kInputNames[FrameTrace::kRelease])
+      input.type = FrameTrace::kRelease;
+    else
+      return false;
+    input.time *= 1000;
+    inputs.push_back(input);
+  }
+  return file.eof();
+}
+
+}  // namespace battleship
@@ -0,0 +1,90 @@
+#ifndef BATTLESHIP_FRAME_TRACE_H
+#define BATTLESHIP_FRAME_TRACE_H
+
+#include "metrics.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace battleship {
+
+// A timeline of how long input took to reach the screen. A widget reports
+// every mouse event it handles, every repaint it asks for and every paint,
+// on a track of its own. An event that asks for a repaint opens a frame,
+// which the next paint of the track closes, so events arriving before that
+// paint share its frame. Times are in nanoseconds since the trace began.
+class FrameTrace {
+ public:
+  enum InputType { kPress, kMove, kRelease };
+
+  // A mouse event as the widget got it, in its pixel coordinates.
+  struct Input {
+    std::uint64_t time;
+    std::size_t track;
+    InputType type;
+    int x;
+    int y;
+  };
+
+  // From the first event waiting on a paint, or from the paint itself if it
+  // was not caused by input, to the end of that paint.
+  struct Frame {
+    std::size_t track;
+    // The first event, and how many events the paint answered.
+    Input input;
+    std::size_t inputs;
+    // When that event's handler returned and asked for the repaint.
+    std::uint64_t handled;
+    std::uint64_t update;
+    std::uint64_t paint_begin;
+    std::uint64_t paint_end;
+  };
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Track {
+    // The event being handled and whether it asked for a repaint yet.
+    bool in_input;
+    bool input_updated;
+    Input input;
+    // The frame waiting on a paint, if pending.
+    bool pending;
+    Frame frame;
+    std::uint64_t paint_begin;
+  };
+
+  Clock::time_point start_;
+  std::vector<Track> tracks_;
+  std::vector<Input> inputs_;
+  std::vector<Frame> frames_;
+
+  Track &GetTrack(std::size_t track);
+
+ public:
+  FrameTrace();
+  void Clear();
+  std::uint64_t Now() const;
+
+  void BeginInput(std::size_t track, InputType type, int x, int y);
+  void EndInput(std::size_t track);
+  void Update(std::size_t track);
+  void BeginPaint(std::size_t track);
+  void EndPaint(std::size_t track);
+
+  void GetLatencies(LatencyHistogram &latencies,
+                    LatencyHistogram &paints) const;
+  std::string FormatChromeTrace() const;
+  bool WriteChromeTrace(char const *path) const;
+  bool WriteInputs(char const *path) const;
+
+  std::vector<Input> const &inputs() const { return inputs_; }
+  std::vector<Frame> const &frames() const { return frames_; }
+};
+
+bool ReadInputs(char const *path, std::vector<FrameTrace::Input> &inputs);
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_FRAME_TRACE_H
@@ -1,9 +1,34 @@
 #include "game.hpp"
 
+#include "density_attacker.hpp"
+
+#include <QDir>
+#include <QFileDialog>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QStandardPaths>
+#include <QTimer>
+
+#include <algorithm>
 
 namespace battleship {
 
+// How long the computer waits before attacking, in milliseconds.
+static int const kComputerDelay = 400;
+
+// How long the computer thinks before the status bar says so, and how often
+// the time shown is updated, in milliseconds.
+static int const kThinkingDelay = 500;
+static int const kThinkingInterval = 100;
+
+// The names of the players in game records. The computer plays as the
+// density strategy of battleship_sim.
+static char const* const kHumanName = "human";
+static char const* const kComputerName = "density";
+
+// The server offered by File > Play online.
+static char const* const kDefaultServer = "localhost:7411";
+
 // Add the unplaced ships to a string.
 static void AppendRemainingShips(QString& string,
                                  std::vector<std::size_t> const& ship_set) {
@@ -15,105 +40,455 @@ static void AppendRemainingShips(QString& string,
   }
 }
 
-// Try to place a ship on the specified group.
-bool Game::PlaceShip(Group& group, Ship const& ship) {
-  std::vector<std::size_t>::iterator it =
-      std::find(group.ship_set.begin(), group.ship_set.end(), ship.length);
-  if (it == group.ship_set.end()) {
-    QString string = "This is not a valid length. Remaining lengths: ";
-    AppendRemainingShips(string, group.ship_set);
-    status_bar_->showMessage(string);
-    return false;
+// Return the status tip of a player's attack, which in salvo games counts
+// the shots to mark.
+static QString MakeAttackTip(char const* player, GameState const& state) {
+  QString tip = player;
+  if (state.variant() == GameState::kStandard) {
+    tip.append(": Click a cell to make an attack.");
+    return tip;
+  }
+  tip.append(": Mark ");
+  tip.append(QString::number(state.shots()));
+  tip.append(" cells to fire a salvo.");
+  return tip;
+}
+
+// Reset the arenas and the game state for a new game against an opponent,
+// leaving any online game.
+void Game::NewGame(MapSize size, ShipSet set, Opponent opponent,
+                   GameState::Variant variant) {
+  online_ = false;
+  socket_->abort();
+  CancelComputerMove();
+  arena1_->Init(size.x, size.y);
+  arena2_->Init(size.x, size.y);
+  game_state_.Init(size, set, variant);
+  opponent_ = opponent;
+  worker_.Seed(random_());
+  worker_.Init(size, set);
+  generator_.Seed(random_());
+  generator_.Init(size, set);
+
+  // Player1 attacks board 0 and Player2 board 1.
+  record_.Clear();
+  record_.size = size;
+  record_.ship_set.assign(set.first, set.last);
+  record_.players[0] = human_id_;
+  record_.players[1] =
+      opponent_ == kComputerOpponent ? computer_id_ : human_id_;
+  history_.clear();
+  position_ = 0;
+
+  ShowHeatmaps();
+  adjustSize();
+}
+
+// Place the computer's fleet at random on arena1. Return false if no fleet
+// could be drawn, see FleetGenerator::Generate.
+bool Game::PlaceComputerShips() {
+  std::vector<Ship> fleet(generator_.fleet_size());
+  if (!generator_.Generate(&fleet[0])) return false;
+  for (std::size_t i = 0, e = fleet.size(); i != e; ++i) {
+    GameState::PlaceResult res = game_state_.Place(fleet[i]);
+    if (res.type != GameState::kPlaced) continue;
+    arena1_->AddReveal(*res.ship);
+    record_.fleets[0].push_back(Pack(*res.ship));
+  }
+  return true;
+}
+
+// Append the finished game to the record file. Records are a sequence of
+// single attacks in turn, so salvo games are not saved.
+void Game::SaveRecord() {
+  if (!recording_ || game_state_.variant() == GameState::kSalvo) return;
+  if (!writer_.Write(record_) || !writer_.Flush())
+    status_bar_->showMessage("The game could not be saved.");
+}
+
+// Shade arena1 with where players tend to place ships and arena2 with where
+// they tend to shoot, summing the heatmaps that fit the board.
+void Game::ShowHeatmaps() {
+  MapSize size = game_state_.size();
+  std::vector<double> weights[2];
+  for (std::size_t i = 0, e = heatmaps_.size(); i != e; ++i) {
+    Heatmap const& heatmap = heatmaps_[i];
+    if (heatmap.size.x != size.x || heatmap.size.y != size.y) continue;
+    std::vector<double>& sum = weights[heatmap.kind];
+    sum.resize(heatmap.counts.size());
+    for (std::size_t j = 0, e2 = sum.size(); j != e2; ++j)
+      sum[j] += static_cast<double>(heatmap.counts[j]);
+  }
+
+  // The most popular cell is shaded the darkest.
+  for (std::size_t i = 0; i != 2; ++i) {
+    double top = 0;
+    for (std::size_t j = 0, e = weights[i].size(); j != e; ++j)
+      top = std::max(top, weights[i][j]);
+    for (std::size_t j = 0, e = weights[i].size(); j != e; ++j)
+      weights[i][j] = top != 0 ? weights[i][j] / top : 0;
   }
+  arena1_->SetOverlay(weights[Heatmap::kPlacements]);
+  arena2_->SetOverlay(weights[Heatmap::kShots]);
+}
 
-  Board::PlaceResult res2 = group.board.Place(ship);
-  switch (res2.type) {
-    case Board::kPlaced:
-      group.arena->AddReveal(*res2.ship);
-      ++group.ships_left;
+// Tell the player how placing a ship went, given the ships left to place.
+void Game::ShowPlaceResult(GameState::PlaceType type,
+                           std::vector<std::size_t> const& ship_set) {
+  switch (type) {
+    case GameState::kPlaced:
       status_bar_->showMessage("Ship has been placed.");
-      group.ship_set.erase(it);
-      return true;
-    case Board::kOverlap:
+      return;
+    case GameState::kOverlap:
       status_bar_->showMessage("Ships may not overlap.");
-      return false;
+      return;
+    case GameState::kInvalidLength: {
+      QString string = "This is not a valid length. Remaining lengths: ";
+      AppendRemainingShips(string, ship_set);
+      status_bar_->showMessage(string);
+      return;
+    }
+    case GameState::kOutOfBounds:
+      status_bar_->showMessage("Ships must be placed inside the arena.");
+      return;
   }
-
-  return false;
 }
 
-// Try to attack a cell on a specified group.
-bool Game::Attack(Group& group, std::size_t x, std::size_t y) {
-  Board::AttackResult res = group.board.Attack(x, y);
-  switch (res.type) {
+// Mark an attack on an arena and tell the player how it went. ship is the
+// ship sunk, if any.
+void Game::ShowAttack(Arena* arena, std::size_t x, std::size_t y,
+                      Board::AttackType type, Ship const* ship) {
+  switch (type) {
     case Board::kSunk:
       status_bar_->showMessage("You sunk a ship!");
-      group.arena->AddSunk(*res.ship);
-      group.arena->AddHit(x, y);
-      --group.ships_left;
-      return true;
+      arena->AddSunk(*ship);
+      arena->AddHit(x, y);
+      return;
 
     case Board::kHit:
       status_bar_->showMessage("Hit!");
-      group.arena->AddHit(x, y);
-      return true;
+      arena->AddHit(x, y);
+      return;
 
     case Board::kMiss:
       status_bar_->showMessage("Miss!");
-      group.arena->AddMiss(x, y);
-      return true;
+      arena->AddMiss(x, y);
+      return;
 
     case Board::kRetry:
       status_bar_->showMessage("You've already attacked here.");
-      return false;
+      return;
+  }
+}
+
+// Try to place a ship on the board being placed on.
+bool Game::PlaceShip(Arena* arena, Ship const& ship) {
+  std::size_t board = game_state_.turn();
+  GameState::PlaceResult res = game_state_.Place(ship);
+  if (res.type == GameState::kPlaced) {
+    arena->AddReveal(*res.ship);
+    record_.fleets[board].push_back(Pack(*res.ship));
+  }
+  ShowPlaceResult(res.type, game_state_.ship_set(board));
+  return res.type == GameState::kPlaced;
+}
+
+// Try to fire a salvo at the board being attacked and tell the player how it
+// went.
+bool Game::Salvo(Arena* arena, std::vector<Cell> const& cells) {
+  std::size_t board = game_state_.turn();
+  std::vector<Board::AttackResult> results(cells.size());
+  if (!game_state_.AttackMany(cells.data(), cells.size(), results.data()))
+    return false;
+  std::size_t landed = 0;
+  std::size_t hits = 0;
+  std::size_t sunk = 0;
+  for (std::size_t i = 0, e = cells.size(); i != e; ++i) {
+    Board::AttackResult const& res = results[i];
+    if (board == 1 && opponent_ == kComputerOpponent)
+      worker_.Observe(cells[i].x, cells[i].y, res);
+    ShowAttack(arena, cells[i].x, cells[i].y, res.type, res.ship);
+    if (res.type == Board::kRetry) continue;
+    ++landed;
+    if (res.type != Board::kMiss) ++hits;
+    if (res.type == Board::kSunk) ++sunk;
+  }
+  if (landed == 0) return false;
+  QString string = "Salvo: ";
+  string.append(QString::number(hits));
+  string.append(" of ");
+  string.append(QString::number(landed));
+  string.append(" hit, ");
+  string.append(QString::number(sunk));
+  string.append(" sunk.");
+  status_bar_->showMessage(string);
+  return true;
+}
+
+// Try to attack a cell on the board being attacked.
+bool Game::Attack(Arena* arena, std::size_t x, std::size_t y) {
+  if (history_.empty()) history_.push_back(game_state_.TakeSnapshot());
+  std::size_t board = game_state_.turn();
+  Board::AttackResult res = game_state_.Attack(x, y);
+  if (board == 1 && opponent_ == kComputerOpponent)
+    worker_.Observe(x, y, res);
+  if (res.type != Board::kRetry) {
+    RecordedAttack attack = {x, y, res.type};
+    record_.attacks.push_back(attack);
+    // The snapshots share everything but the attacked cell, so keeping every
+    // position costs little.
+    Board::AttackResult same;
+    history_.resize(position_ + 1);
+    history_.push_back(history_[position_].Attack(x, y, same));
+    ++position_;
+  }
+  ShowAttack(arena, x, y, res.type, res.ship);
+  return res.type != Board::kRetry;
+}
+
+// Return the arena displaying a board.
+Arena* Game::ArenaOf(std::size_t board) {
+  return board == 0 ? arena1_ : arena2_;
+}
+
+// Go back or forward to a position of the history: rebuild the game state,
+// the arenas, the record and the computer's view of the board from it and
+// give the turn to whoever has it there.
+void Game::ShowPosition(std::size_t position) {
+  CancelComputerMove();
+  position_ = position;
+  GameState::Snapshot const& snapshot = history_[position];
+  game_state_.Restore(snapshot);
+  MapSize size = game_state_.size();
+  for (std::size_t i = 0; i != 2; ++i) {
+    Arena* arena = ArenaOf(i);
+    BoardSnapshot const& board = snapshot.boards[i];
+    arena->Init(size.x, size.y);
+    for (std::size_t j = 0, e = board.ship_count(); j != e; ++j) {
+      arena->AddReveal(board.ship(j));
+      if (board.hits_left(j) == 0) arena->AddSunk(board.ship(j));
+    }
+    board.ForEachAttack([&](std::size_t x, std::size_t y, Ship const* ship) {
+      if (ship)
+        arena->AddHit(x, y);
+      else
+        arena->AddMiss(x, y);
+    });
   }
+  ShowHeatmaps();
+
+  // Boards are attacked in turn from board 0, so the attacks on board 1 are
+  // the odd ones of the record.
+  record_.attacks.resize(snapshot.boards[0].attacks() +
+                         snapshot.boards[1].attacks());
+  if (opponent_ == kComputerOpponent) {
+    ShipSet set = {record_.ship_set.data(),
+                   record_.ship_set.data() + record_.ship_set.size()};
+    worker_.Init(size, set);
+    for (std::size_t i = 1, e = record_.attacks.size(); i < e; i += 2) {
+      RecordedAttack const& attack = record_.attacks[i];
+      Board::AttackResult res = {attack.result,
+                                 snapshot.boards[1].ShipAt(attack.x, attack.y)};
+      worker_.Observe(attack.x, attack.y, res);
+    }
+  }
+
+  if (game_state_.turn() == 0)
+    BeginAttacking1();
+  else
+    BeginAttacking2();
+}
+
+// Send a message to the server of an online game.
+void Game::SendMessage(Message const& message) {
+  std::vector<std::uint8_t> out;
+  EncodeMessage(message, out);
+  socket_->write(reinterpret_cast<char const*>(out.data()),
+                 static_cast<qint64>(out.size()));
+}
+
+// Follow the server of an online game. The human places the ships of board
+// 1 - seat_ and attacks board seat_.
+void Game::HandleMessage(Message const& message) {
+  Arena* own = ArenaOf(1 - seat_);
+  Arena* target = ArenaOf(seat_);
+  switch (message.type) {
+    case kJoinedMessage:
+      seat_ = message.seat;
+      status_bar_->showMessage(seat_ == 0 ? "Playing online as Player1."
+                                          : "Playing online as Player2.");
+      return;
+
+    case kTurnMessage:
+      arena1_->SetDisplaying();
+      arena2_->SetDisplaying();
+      arena1_->setStatusTip("");
+      arena2_->setStatusTip("");
+      if (message.phase == GameState::kPlacing &&
+          message.board == 1 - seat_) {
+        own->SetPlacing();
+        own->setStatusTip("Click-drag on this arena to place your ships.");
+      } else if (message.phase == GameState::kAttacking &&
+                 message.board == seat_) {
+        target->SetAttacking();
+        target->setStatusTip("Click a cell to make an attack.");
+      } else {
+        status_bar_->showMessage("Waiting for your opponent...");
+      }
+      return;
+
+    case kPlacedMessage:
+      if (message.place == GameState::kPlaced) {
+        own->AddReveal(message.ship);
+        std::vector<std::size_t>::iterator it =
+            std::find(ships_to_place_.begin(), ships_to_place_.end(),
+                      message.ship.length);
+        if (it != ships_to_place_.end()) ships_to_place_.erase(it);
+      }
+      ShowPlaceResult(message.place, ships_to_place_);
+      return;
+
+    case kAttackedMessage: {
+      Ship const* ship = message.attack == Board::kSunk ? &message.ship : 0;
+      ShowAttack(ArenaOf(message.board), message.x, message.y, message.attack,
+                 ship);
+      // Our own attacks keep the target waiting for the result, the
+      // opponent's give us the turn.
+      if (message.board != seat_) {
+        status_bar_->showMessage(ship ? "Your opponent sunk a ship."
+                                      : "Your opponent attacked.");
+        target->SetAttacking();
+      } else if (message.attack == Board::kRetry) {
+        target->SetAttacking();
+      }
+      return;
+    }
+
+    case kFinishedMessage:
+      online_ = false;
+      arena1_->SetRevealing();
+      arena2_->SetRevealing();
+      QMessageBox::information(this, "BattleShip",
+                               message.seat == seat_ ? "You win!"
+                                                     : "Your opponent wins.");
+      return;
+
+    case kLeftMessage:
+      EndOnlineGame("Your opponent left the game.");
+      return;
+
+    case kErrorMessage:
+      if (message.error == kBadRules)
+        EndOnlineGame("The server does not host games of this size.");
+      else if (message.error == kNotYourTurn)
+        status_bar_->showMessage("It is not your turn.");
+      else
+        EndOnlineGame("The server did not understand the game.");
+      return;
+
+    default:
+      EndOnlineGame("The server sent an unexpected message.");
+      return;
+  }
+}
 
-  return false;
+// Stop an online game that cannot go on and tell the player why.
+void Game::EndOnlineGame(char const* text) {
+  online_ = false;
+  socket_->abort();
+  arena1_->SetDisplaying();
+  arena2_->SetDisplaying();
+  arena1_->setStatusTip("");
+  arena2_->setStatusTip("");
+  QMessageBox::information(this, "BattleShip", text);
 }
 
 // Allow placement of ships on arena1.
 void Game::BeginPlacing1() {
-  group1_.arena->SetPlacing();
-  group2_.arena->SetDisplaying();
-  group1_.arena->setStatusTip(
+  arena1_->SetPlacing();
+  arena2_->SetDisplaying();
+  arena1_->setStatusTip(
       "Player2: Click-drag on the left arena to place your ships.");
-  group2_.arena->setStatusTip("");
+  arena2_->setStatusTip("");
 }
 
 // Allow placement of ships on arena2.
 void Game::BeginPlacing2() {
-  group2_.arena->SetPlacing();
-  group1_.arena->SetDisplaying();
-  group1_.arena->setStatusTip("");
-  group2_.arena->setStatusTip(
+  arena2_->SetPlacing();
+  arena1_->SetDisplaying();
+  arena1_->setStatusTip("");
+  arena2_->setStatusTip(
       "Player1: Click-drag on the right arena to place your ships.");
 }
 
 // Allow attacks on arena1.
 void Game::BeginAttacking1() {
-  group1_.arena->SetAttacking();
-  group2_.arena->SetDisplaying();
-  group1_.arena->setStatusTip("Player1: Click a cell to make an attack.");
-  group2_.arena->setStatusTip("");
+  turn_start_ = std::chrono::steady_clock::now();
+  bool salvo = game_state_.variant() == GameState::kSalvo;
+  arena1_->SetSalvo(salvo ? game_state_.shots() : 0);
+  arena1_->SetAttacking();
+  arena2_->SetDisplaying();
+  arena1_->setStatusTip(MakeAttackTip("Player1", game_state_));
+  arena2_->setStatusTip("");
 }
 
-// Allow attacks on arena2.
+// Allow attacks on arena2, or let the computer attack it.
 void Game::BeginAttacking2() {
-  group2_.arena->SetAttacking();
-  group1_.arena->SetDisplaying();
-  group1_.arena->setStatusTip("");
-  group2_.arena->setStatusTip("Player2: Click a cell to make an attack.");
+  turn_start_ = std::chrono::steady_clock::now();
+  if (opponent_ == kComputerOpponent) {
+    arena1_->SetDisplaying();
+    arena2_->SetDisplaying();
+    arena1_->setStatusTip("");
+    arena2_->setStatusTip("");
+    QTimer::singleShot(kComputerDelay, this, &Game::HandleComputerAttack);
+    return;
+  }
+
+  bool salvo = game_state_.variant() == GameState::kSalvo;
+  arena2_->SetSalvo(salvo ? game_state_.shots() : 0);
+  arena2_->SetAttacking();
+  arena1_->SetDisplaying();
+  arena1_->setStatusTip("");
+  arena2_->setStatusTip(MakeAttackTip("Player2", game_state_));
 }
 
 // Handle attacks on arena1.
 void Game::HandleAttacked1(std::size_t x, std::size_t y) {
-  if (!Attack(group1_, x, y)) return;
+  if (opponent_ == kNetworkOpponent) {
+    // Wait for the result before the next attack.
+    Message message;
+    message.type = kAttackMessage;
+    message.x = x;
+    message.y = y;
+    if (online_) SendMessage(message);
+    arena1_->SetDisplaying();
+    return;
+  }
+  if (Attack(arena1_, x, y)) EndTurn1();
+}
+
+// Handle salvos on arena1.
+void Game::HandleSalvo1(std::vector<Cell> const& cells) {
+  if (Salvo(arena1_, cells)) EndTurn1();
+}
 
-  if (group1_.ships_left == 0) {
+// Time the turn that just ended, from when the player could attack, the
+// computer's delay included.
+void Game::RecordTurnTime() {
+  std::chrono::nanoseconds elapsed =
+      std::chrono::steady_clock::now() - turn_start_;
+  RecordTime(kTurnTimer, static_cast<std::uint64_t>(elapsed.count()));
+}
+
+// End Player1's turn: announce the winner or let Player2 attack.
+void Game::EndTurn1() {
+  RecordTurnTime();
+  if (game_state_.phase() == GameState::kFinished) {
+    SaveRecord();
     QMessageBox::information(this, "BattleShip", "Player1 wins!");
-    group1_.arena->setStatusTip("");
-    group1_.arena->SetRevealing();
-    group2_.arena->SetRevealing();
+    arena1_->setStatusTip("");
+    arena1_->SetRevealing();
+    arena2_->SetRevealing();
     return;
   }
 
@@ -122,24 +497,100 @@ void Game::HandleAttacked1(std::size_t x, std::size_t y) {
 
 // Handle attacks on arena2.
 void Game::HandleAttacked2(std::size_t x, std::size_t y) {
-  if (!Attack(group2_, x, y)) return;
+  if (opponent_ == kNetworkOpponent) {
+    Message message;
+    message.type = kAttackMessage;
+    message.x = x;
+    message.y = y;
+    if (online_) SendMessage(message);
+    arena2_->SetDisplaying();
+    return;
+  }
+  if (Attack(arena2_, x, y)) EndTurn2();
+}
+
+// Handle salvos on arena2.
+void Game::HandleSalvo2(std::vector<Cell> const& cells) {
+  if (Salvo(arena2_, cells)) EndTurn2();
+}
 
-  if (group2_.ships_left == 0) {
+// End Player2's turn: announce the winner or let Player1 attack.
+void Game::EndTurn2() {
+  RecordTurnTime();
+  if (game_state_.phase() == GameState::kFinished) {
+    SaveRecord();
     QMessageBox::information(this, "BattleShip", "Player2 wins!");
-    group2_.arena->setStatusTip("");
-    group1_.arena->SetRevealing();
-    group2_.arena->SetRevealing();
+    arena2_->setStatusTip("");
+    arena1_->SetRevealing();
+    arena2_->SetRevealing();
     return;
   }
 
   BeginAttacking1();
 }
 
+// Forget the computer's move being computed, if any. Every caller starts the
+// computer's game over, as the worker requires.
+void Game::CancelComputerMove() {
+  worker_.Cancel();
+  computer_move_ = 0;
+  thinking_timer_->stop();
+}
+
+// Ask the worker for the computer's attack on arena2.
+void Game::HandleComputerAttack() {
+  // The game may have been restarted in the meantime, or the attack asked for
+  // already by an earlier timer.
+  if (opponent_ != kComputerOpponent ||
+      game_state_.phase() != GameState::kAttacking ||
+      game_state_.turn() != 1 || computer_move_ != 0)
+    return;
+
+  computer_move_ = game_state_.variant() == GameState::kSalvo
+                       ? worker_.RequestSalvo(game_state_.shots())
+                       : worker_.RequestAttack();
+  computer_start_ = std::chrono::steady_clock::now();
+  thinking_timer_->start(kThinkingInterval);
+}
+
+// Make the computer's attack on arena2 once the worker chose it, unless it
+// was cancelled.
+void Game::HandleComputerMoved(quint64 request,
+                               std::vector<Cell> const& cells) {
+  if (request != computer_move_) return;
+  computer_move_ = 0;
+  thinking_timer_->stop();
+  if (game_state_.variant() == GameState::kSalvo)
+    HandleSalvo2(cells);
+  else
+    HandleAttacked2(cells[0].x, cells[0].y);
+}
+
+// Show how long the computer has been thinking, once it is long enough to
+// notice.
+void Game::HandleThinking() {
+  std::chrono::milliseconds elapsed =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - computer_start_);
+  if (elapsed.count() < kThinkingDelay) return;
+  QString string = "The computer is thinking... ";
+  string.append(QString::number(elapsed.count() / 1000.0, 'f', 1));
+  string.append(" s");
+  status_bar_->showMessage(string);
+}
+
 // Handle a placed ship on arena1.
 void Game::HandleShipPlaced1(Ship const& ship) {
-  if (!PlaceShip(group1_, ship)) return;
+  if (opponent_ == kNetworkOpponent) {
+    Message message;
+    message.type = kPlaceMessage;
+    message.ship = ship;
+    if (online_) SendMessage(message);
+    return;
+  }
+  if (!PlaceShip(arena1_, ship)) return;
 
-  if (group1_.ship_set.empty()) {
+  if (game_state_.phase() == GameState::kAttacking) {
     QMessageBox::information(this, "BattleShip",
                              "All ships have been deployed for Player2.");
     BeginAttacking1();
@@ -148,11 +599,27 @@ void Game::HandleShipPlaced1(Ship const& ship) {
 
 // Handle a placed ship on arena2.
 void Game::HandleShipPlaced2(Ship const& ship) {
-  if (!PlaceShip(group2_, ship)) return;
+  if (opponent_ == kNetworkOpponent) {
+    Message message;
+    message.type = kPlaceMessage;
+    message.ship = ship;
+    if (online_) SendMessage(message);
+    return;
+  }
+  if (!PlaceShip(arena2_, ship)) return;
 
-  if (group2_.ship_set.empty()) {
+  if (game_state_.turn() == 0) {
     QMessageBox::information(this, "BattleShip",
                              "All ships have been deployed for Player1.");
+    if (opponent_ == kComputerOpponent) {
+      if (!PlaceComputerShips()) {
+        QMessageBox::warning(this, "BattleShip",
+                             "The computer's fleet could not be placed.");
+        return;
+      }
+      BeginAttacking1();
+      return;
+    }
     BeginPlacing1();
   }
 }
@@ -162,16 +629,8 @@ void Game::HandleCancelNewGame() { game_selection_.close(); }
 
 // Create a new game from the selected size.
 void Game::HandleCreateNewGame() {
-  MapSize size = game_selection_.GetMapSize();
-  ShipSet set = game_selection_.GetShipSet();
-  group1_.arena->Init(size.x, size.y);
-  group2_.arena->Init(size.x, size.y);
-  group1_.board.Init(size.x, size.y);
-  group2_.board.Init(size.x, size.y);
-  group1_.ships_left = 0;
-  group2_.ships_left = 0;
-  group1_.ship_set.assign(set.first, set.last);
-  group2_.ship_set.assign(set.first, set.last);
+  NewGame(game_selection_.GetMapSize(), game_selection_.GetShipSet(),
+          game_selection_.GetOpponent(), game_selection_.GetVariant());
   game_selection_.close();
   BeginPlacing2();
 }
@@ -179,16 +638,205 @@ void Game::HandleCreateNewGame() {
 // Open the new game dialog.
 void Game::HandleNewGame(bool) { game_selection_.exec(); }
 
+// Join a game on a server with the rules last selected for a new game.
+void Game::HandlePlayOnline(bool) {
+  bool ok = false;
+  QString address =
+      QInputDialog::getText(this, "Play online", "Server (host:port):",
+                            QLineEdit::Normal, kDefaultServer, &ok);
+  if (!ok || address.isEmpty()) return;
+  int colon = address.lastIndexOf(':');
+  quint16 port = colon < 0 ? 0 : address.mid(colon + 1).toUShort(&ok);
+  if (colon <= 0 || !ok || port == 0) {
+    QMessageBox::warning(this, "BattleShip", "Enter a server as host:port.");
+    return;
+  }
+
+  MapSize size = game_selection_.GetMapSize();
+  ShipSet set = game_selection_.GetShipSet();
+  NewGame(size, set, kNetworkOpponent, GameState::kStandard);
+  online_rules_.size = size;
+  online_rules_.ship_set.assign(set.first, set.last);
+  ships_to_place_ = online_rules_.ship_set;
+  input_.clear();
+  seat_ = 0;
+  online_ = true;
+  arena1_->SetDisplaying();
+  arena2_->SetDisplaying();
+  arena1_->setStatusTip("");
+  arena2_->setStatusTip("");
+  status_bar_->showMessage("Connecting to " + address + "...");
+  socket_->connectToHost(address.left(colon), port);
+}
+
+// Ask the server for an opponent.
+void Game::HandleConnected() {
+  Message message;
+  message.type = kJoinMessage;
+  message.rules = online_rules_;
+  SendMessage(message);
+  status_bar_->showMessage("Waiting for an opponent...");
+}
+
+// Handle every whole message that arrived from the server. Each message
+// leaves input_ before it is handled: handling one may open a dialog whose
+// event loop reads the socket and calls this again, which must only find the
+// bytes nobody has handled yet.
+void Game::HandleReadyRead() {
+  QByteArray data = socket_->readAll();
+  std::uint8_t const* bytes =
+      reinterpret_cast<std::uint8_t const*>(data.constData());
+  input_.insert(input_.end(), bytes, bytes + data.size());
+
+  Message message;
+  while (online_ && !input_.empty()) {
+    std::uint8_t const* first = input_.data();
+    DecodeStatus status =
+        DecodeMessage(first, first + input_.size(), message);
+    if (status == kIncomplete) break;
+    if (status == kMalformed) {
+      input_.clear();
+      EndOnlineGame("The server sent a malformed message.");
+      return;
+    }
+    input_.erase(input_.begin(), input_.begin() + (first - input_.data()));
+    HandleMessage(message);
+  }
+}
+
+// Tell the player if the server went away in the middle of a game.
+void Game::HandleDisconnected() {
+  if (online_) EndOnlineGame("Lost the connection to the server.");
+}
+
+// Tell the player if the server could not be reached.
+void Game::HandleSocketError(QAbstractSocket::SocketError) {
+  if (!online_) return;
+  QString text = "Could not play online: " + socket_->errorString();
+  online_ = false;
+  socket_->abort();
+  QMessageBox::warning(this, "BattleShip", text);
+}
+
 // Exit the game.
 void Game::HandleExit(bool) { close(); }
 
+// Take back the last attack, or against the computer the last attack of
+// the human and the computer's answer. Finished games stay finished, so
+// their records are only saved once. Salvo games keep no history.
+void Game::HandleUndo(bool) {
+  if (opponent_ == kNetworkOpponent ||
+      game_state_.variant() == GameState::kSalvo ||
+      game_state_.phase() != GameState::kAttacking || position_ == 0) {
+    status_bar_->showMessage("There is no attack to undo.");
+    return;
+  }
+  std::size_t position = position_ - 1;
+  if (opponent_ == kComputerOpponent)
+    while (position != 0 && history_[position].turn != 0) --position;
+  ShowPosition(position);
+  status_bar_->showMessage("Attack undone.");
+}
+
+// Make the attacks taken back by Undo again, up to the human's next turn.
+void Game::HandleRedo(bool) {
+  if (opponent_ == kNetworkOpponent ||
+      game_state_.phase() != GameState::kAttacking ||
+      position_ + 1 >= history_.size()) {
+    status_bar_->showMessage("There is no attack to redo.");
+    return;
+  }
+  std::size_t position = position_ + 1;
+  if (opponent_ == kComputerOpponent) {
+    while (position + 1 != history_.size() &&
+           history_[position].phase == GameState::kAttacking &&
+           history_[position].turn != 0)
+      ++position;
+  }
+  ShowPosition(position);
+  status_bar_->showMessage("Attack redone.");
+}
+
 // Open the new rules dialog.
 void Game::HandleHowToPlay(bool) { rules_.exec(); }
 
-// Resize the window when our layout changes.
-bool Game::event(QEvent* event) {
-  if (event->type() == QEvent::LayoutRequest) setFixedSize(sizeHint());
-  return QMainWindow::event(event);
+// Zoom both arenas in.
+void Game::HandleZoomIn(bool) {
+  arena1_->ZoomIn();
+  arena2_->ZoomIn();
+}
+
+// Zoom both arenas out.
+void Game::HandleZoomOut(bool) {
+  arena1_->ZoomOut();
+  arena2_->ZoomOut();
+}
+
+// Load heatmaps written by battleship_stats and show them over the arenas.
+void Game::HandleShowHeatmap(bool) {
+  QString path = QFileDialog::getOpenFileName(
+      this, "Show heatmap", QString(), "Heatmaps (*.txt);;All files (*)");
+  if (path.isEmpty()) return;
+  std::vector<Heatmap> heatmaps;
+  if (!ReadHeatmaps(path.toLocal8Bit().constData(), heatmaps)) {
+    QMessageBox::warning(this, "BattleShip", "This is not a heatmap file.");
+    return;
+  }
+  heatmaps_.swap(heatmaps);
+  ShowHeatmaps();
+  status_bar_->showMessage("Left: where ships tend to be placed. Right: "
+                           "where shots tend to land.");
+}
+
+// Remove the heatmaps.
+void Game::HandleHideHeatmap(bool) {
+  heatmaps_.clear();
+  ShowHeatmaps();
+}
+
+// Write what the games played so far counted and timed to a file.
+void Game::HandleSaveMetrics(bool) {
+  QString path = QFileDialog::getSaveFileName(
+      this, "Save metrics", QString(),
+      "Prometheus text (*.prom);;JSON (*.json);;All files (*)");
+  if (path.isEmpty()) return;
+  Metrics metrics;
+  CollectMetrics(metrics);
+  if (!WriteMetrics(path.toLocal8Bit().constData(), metrics))
+    QMessageBox::warning(this, "BattleShip", "The metrics were not saved.");
+}
+
+// Trace the latency of input on both arenas from now on, or stop.
+void Game::HandleTraceInput(bool checked) {
+  trace_.Clear();
+  arena1_->SetTrace(checked ? &trace_ : 0, 0);
+  arena2_->SetTrace(checked ? &trace_ : 0, 1);
+  status_bar_->showMessage(checked ? "Tracing input latency." : "");
+}
+
+// Write the input latency traced so far as a Chrome trace, and the mouse
+// events next to it for battleship_arena_replay.
+void Game::HandleSaveTrace(bool) {
+  QString path = QFileDialog::getSaveFileName(
+      this, "Save trace", QString(), "Chrome traces (*.json);;All files (*)");
+  if (path.isEmpty()) return;
+  QString inputs = path + ".inputs";
+  if (!trace_.WriteChromeTrace(path.toLocal8Bit().constData()) ||
+      !trace_.WriteInputs(inputs.toLocal8Bit().constData())) {
+    QMessageBox::warning(this, "BattleShip", "The trace was not saved.");
+    return;
+  }
+  LatencyHistogram latencies;
+  LatencyHistogram paints;
+  trace_.GetLatencies(latencies, paints);
+  QString message = "Input to paint: median ";
+  message.append(QString::number(latencies.ValueAt(0.5) / 1e6, 'f', 2));
+  message.append(" ms, 99th percentile ");
+  message.append(QString::number(latencies.ValueAt(0.99) / 1e6, 'f', 2));
+  message.append(" ms over ");
+  message.append(QString::number(latencies.count()));
+  message.append(" frames.");
+  status_bar_->showMessage(message);
 }
 
 // Construct a Game and wait for a new game.
@@ -197,23 +845,95 @@ Game::Game(std::size_t width, std::size_t height)
       rules_(this),
       menu_bar_(new QMenuBar),
       layout_(new QHBoxLayout),
-      status_bar_(new QStatusBar) {
-  group1_.arena = new Arena(width, height);
-  group2_.arena = new Arena(width, height);
+      status_bar_(new QStatusBar),
+      opponent_(kHumanOpponent),
+      worker_(std::unique_ptr<Attacker>(new DensityAttacker),
+              [this](std::uint64_t request, std::vector<Cell> const& cells) {
+                emit ComputerMoved(request, cells);
+              }),
+      computer_move_(0),
+      thinking_timer_(new QTimer(this)),
+      random_(std::random_device()()),
+      recording_(false),
+      human_id_(0),
+      computer_id_(0),
+      position_(0),
+      socket_(new QTcpSocket(this)),
+      seat_(0),
+      online_(false) {
+  MapSize size = {width, height};
+  ShipSet set = {0, 0};
+  game_state_.Reserve(GameState::kMaxShips);
+  generator_.Reserve(GameState::kMaxShips);
+  game_state_.Init(size, set);
+  // A human's game is too slow for the clock reads to show.
+  SetMetricsTiming(true);
+  arena1_ = new Arena(width, height);
+  arena2_ = new Arena(width, height);
+
+  QString data =
+      QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  if (!data.isEmpty() && QDir().mkpath(data)) {
+    QString path = data + "/games.bsgr";
+    recording_ = writer_.Open(path.toLocal8Bit().constData());
+  }
+  if (recording_) {
+    human_id_ = writer_.AddPlayer(kHumanName);
+    computer_id_ = writer_.AddPlayer(kComputerName);
+    recording_ = !writer_.failed();
+  }
 
   QAction* new_game = new QAction("New game", this);
+  QAction* play_online = new QAction("Play online...", this);
+  QAction* save_metrics = new QAction("Save metrics...", this);
+  QAction* save_trace = new QAction("Save trace...", this);
   QAction* exit = new QAction("Exit", this);
   QMenu* file_menu = menu_bar_->addMenu("&File");
   file_menu->addAction(new_game);
+  file_menu->addAction(play_online);
+  file_menu->addAction(save_metrics);
+  file_menu->addAction(save_trace);
   file_menu->addAction(exit);
 
+  QAction* undo = new QAction("Undo attack", this);
+  QAction* redo = new QAction("Redo attack", this);
+  undo->setShortcut(QKeySequence::Undo);
+  redo->setShortcut(QKeySequence::Redo);
+  QMenu* edit_menu = menu_bar_->addMenu("&Edit");
+  edit_menu->addAction(undo);
+  edit_menu->addAction(redo);
+
+  QAction* zoom_in = new QAction("Zoom in", this);
+  QAction* zoom_out = new QAction("Zoom out", this);
+  zoom_in->setShortcut(QKeySequence::ZoomIn);
+  zoom_out->setShortcut(QKeySequence::ZoomOut);
+  QMenu* view_menu = menu_bar_->addMenu("&View");
+  view_menu->addAction(zoom_in);
+  view_menu->addAction(zoom_out);
+  QAction* show_heatmap = new QAction("Show heatmap...", this);
+  QAction* hide_heatmap = new QAction("Hide heatmap", this);
+  view_menu->addSeparator();
+  view_menu->addAction(show_heatmap);
+  view_menu->addAction(hide_heatmap);
+  QAction* trace_input = new QAction("Trace input latency", this);
+  trace_input->setCheckable(true);
+  view_menu->addSeparator();
+  view_menu->addAction(trace_input);
+
   QAction* how_to_play = new QAction("How to play", this);
   QMenu* help_menu = menu_bar_->addMenu("&Help");
   help_menu->addAction(how_to_play);
 
   setMenuBar(menu_bar_);
-  layout_->addWidget(group1_.arena);
-  layout_->addWidget(group2_.arena);
+  // Large arenas scroll, small ones stay centered.
+  QScrollArea* scroll1 = new QScrollArea;
+  QScrollArea* scroll2 = new QScrollArea;
+  scroll1->setAlignment(Qt::AlignCenter);
+  scroll2->setAlignment(Qt::AlignCenter);
+  scroll1->setWidget(arena1_);
+  scroll2->setWidget(arena2_);
+  layout_->addWidget(scroll1);
+  layout_->addWidget(scroll2);
   QWidget* widget = new QWidget;
   widget->setLayout(layout_);
   setCentralWidget(widget);
@@ -221,12 +941,45 @@ Game::Game(std::size_t width, std::size_t height)
 
   // Connect callbacks.
   connect(new_game, &QAction::triggered, this, &Game::HandleNewGame);
+  connect(play_online, &QAction::triggered, this, &Game::HandlePlayOnline);
+  connect(save_metrics, &QAction::triggered, this, &Game::HandleSaveMetrics);
+  connect(save_trace, &QAction::triggered, this, &Game::HandleSaveTrace);
   connect(exit, &QAction::triggered, this, &Game::HandleExit);
+  connect(undo, &QAction::triggered, this, &Game::HandleUndo);
+  connect(redo, &QAction::triggered, this, &Game::HandleRedo);
   connect(how_to_play, &QAction::triggered, this, &Game::HandleHowToPlay);
-  connect(group1_.arena, &Arena::Attacked, this, &Game::HandleAttacked1);
-  connect(group1_.arena, &Arena::ShipPlaced, this, &Game::HandleShipPlaced1);
-  connect(group2_.arena, &Arena::Attacked, this, &Game::HandleAttacked2);
-  connect(group2_.arena, &Arena::ShipPlaced, this, &Game::HandleShipPlaced2);
+  connect(zoom_in, &QAction::triggered, this, &Game::HandleZoomIn);
+  connect(zoom_out, &QAction::triggered, this, &Game::HandleZoomOut);
+  connect(show_heatmap, &QAction::triggered, this,
+          &Game::HandleShowHeatmap);
+  connect(hide_heatmap, &QAction::triggered, this,
+          &Game::HandleHideHeatmap);
+  connect(trace_input, &QAction::triggered, this, &Game::HandleTraceInput);
+  // The worker's moves come from its thread.
+  qRegisterMetaType<std::vector<Cell> >();
+  connect(this, &Game::ComputerMoved, this, &Game::HandleComputerMoved,
+          Qt::QueuedConnection);
+  connect(thinking_timer_, &QTimer::timeout, this, &Game::HandleThinking);
+  connect(arena1_, &Arena::Attacked, this, &Game::HandleAttacked1);
+  connect(arena1_, &Arena::ShipPlaced, this, &Game::HandleShipPlaced1);
+  connect(arena2_, &Arena::Attacked, this, &Game::HandleAttacked2);
+  connect(arena1_, &Arena::SalvoFired, this, &Game::HandleSalvo1);
+  connect(arena2_, &Arena::SalvoFired, this, &Game::HandleSalvo2);
+  connect(arena2_, &Arena::ShipPlaced, this, &Game::HandleShipPlaced2);
+  connect(socket_, &QTcpSocket::connected, this, &Game::HandleConnected);
+  connect(socket_, &QTcpSocket::readyRead, this, &Game::HandleReadyRead);
+  connect(socket_, &QTcpSocket::disconnected, this,
+          &Game::HandleDisconnected);
+  // QAbstractSocket::error is overloaded, and deprecated since Qt 5.15.
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+  connect(socket_, &QAbstractSocket::errorOccurred, this,
+          &Game::HandleSocketError);
+#else
+  connect(socket_,
+          static_cast<void (QAbstractSocket::*)(QAbstractSocket::SocketError)>(
+              &QAbstractSocket::error),
+          this, &Game::HandleSocketError);
+#endif
   connect(game_selection_.buttons(), &QDialogButtonBox::accepted, this,
           &Game::HandleCreateNewGame);
   connect(game_selection_.buttons(), &QDialogButtonBox::rejected, this,
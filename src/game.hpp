@@ -2,63 +2,155 @@
 #define BATTLESHIP_GAME_H
 
 #include "arena.hpp"
-#include "board.hpp"
+#include "fleet_generator.hpp"
+#include "frame_trace.hpp"
 #include "game_selection.hpp"
+#include "game_record.hpp"
+#include "game_state.hpp"
+#include "heatmap.hpp"
+#include "metrics.hpp"
+#include "move_worker.hpp"
+#include "protocol.hpp"
+#include "record_writer.hpp"
 #include "rules.hpp"
 
 #include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <random>
 #include <QEvent>
 #include <QHBoxLayout>
 #include <QMainWindow>
 #include <QMenuBar>
+#include <QMetaType>
+#include <QScrollArea>
 #include <QStatusBar>
+#include <QTcpSocket>
+#include <QTimer>
 
 namespace battleship {
 
-// Ties together an 2 Arenas and 2 Boards. Implements game logic.
+// Ties together 2 Arenas and a GameState. Presents the game logic.
 class Game : public QMainWindow {
   Q_OBJECT
 
  private:
-  struct Group {
-    Arena *arena;
-    Board board;
-    std::size_t ships_left;
-    std::vector<std::size_t> ship_set;
-  };
-
   GameSelection game_selection_;
   Rules rules_;
   QMenuBar *menu_bar_;
   QHBoxLayout *layout_;
   QStatusBar *status_bar_;
-  Group group1_;
-  Group group2_;
+  GameState game_state_;
+  // Arena i displays board i of the game state.
+  Arena *arena1_;
+  Arena *arena2_;
+  // Who plays as Player2 and the computer player if it is not a human. The
+  // computer chooses its attacks on worker_'s thread: computer_move_ is the
+  // request awaited, or 0, made at computer_start_, and thinking_timer_ shows
+  // how long it has been thinking.
+  Opponent opponent_;
+  MoveWorker worker_;
+  quint64 computer_move_;
+  std::chrono::steady_clock::time_point computer_start_;
+  QTimer *thinking_timer_;
+  FleetGenerator generator_;
+  std::mt19937 random_;
+
+  // Finished games are appended to a record file for battleship_stats, if
+  // it could be opened.
+  RecordWriter writer_;
+  bool recording_;
+  std::uint32_t human_id_;
+  std::uint32_t computer_id_;
+  GameRecord record_;
+  // The heatmaps shown over the arenas when they fit the board.
+  std::vector<Heatmap> heatmaps_;
+  // Every position of the attacks made so far, from the first, and the one
+  // shown. Undo and Redo move between them and the next attack drops the
+  // positions after the one shown.
+  std::vector<GameState::Snapshot> history_;
+  std::size_t position_;
+  // When the turn being played began, for the turn timer.
+  std::chrono::steady_clock::time_point turn_start_;
+  // The input latency of both arenas, arena i on track i - 1, while
+  // tracing.
+  FrameTrace trace_;
+
+  // The connection of an online game, in which the human sits in seat_ and the
+  // server keeps the game state. online_ is true until the match ends.
+  QTcpSocket* socket_;
+  std::vector<std::uint8_t> input_;
+  GameRules online_rules_;
+  std::size_t seat_;
+  // The lengths of the ships the human has yet to place online.
+  std::vector<std::size_t> ships_to_place_;
+  bool online_;
 
   void BeginPlacing1();
   void BeginPlacing2();
   void BeginAttacking1();
   void BeginAttacking2();
 
-  bool PlaceShip(Group &group, Ship const &ship);
-  bool Attack(Group &group, std::size_t x, std::size_t y);
+  void NewGame(MapSize size, ShipSet set, Opponent opponent,
+               GameState::Variant variant);
+  bool PlaceComputerShips();
+  void SaveRecord();
+  void ShowHeatmaps();
+  void ShowPlaceResult(GameState::PlaceType type,
+                       std::vector<std::size_t> const &ship_set);
+  void ShowAttack(Arena *arena, std::size_t x, std::size_t y,
+                  Board::AttackType type, Ship const *ship);
+  bool PlaceShip(Arena *arena, Ship const &ship);
+  bool Attack(Arena *arena, std::size_t x, std::size_t y);
+  bool Salvo(Arena *arena, std::vector<Cell> const &cells);
+  void RecordTurnTime();
+  void EndTurn1();
+  void EndTurn2();
+  Arena *ArenaOf(std::size_t board);
+  void ShowPosition(std::size_t position);
+  void SendMessage(Message const &message);
+  void HandleMessage(Message const &message);
+  void EndOnlineGame(char const *text);
 
   void HandleShipPlaced1(Ship const &ship);
   void HandleAttacked1(std::size_t x, std::size_t y);
   void HandleShipPlaced2(Ship const &ship);
   void HandleAttacked2(std::size_t x, std::size_t y);
+  void HandleSalvo1(std::vector<Cell> const &cells);
+  void HandleSalvo2(std::vector<Cell> const &cells);
+  void CancelComputerMove();
+  void HandleComputerAttack();
+  void HandleComputerMoved(quint64 request, std::vector<Cell> const &cells);
+  void HandleThinking();
   void HandleNewGame(bool);
+  void HandlePlayOnline(bool);
+  void HandleConnected();
+  void HandleReadyRead();
+  void HandleDisconnected();
+  void HandleSocketError(QAbstractSocket::SocketError);
+  void HandleSaveMetrics(bool);
+  void HandleSaveTrace(bool);
   void HandleExit(bool);
+  void HandleUndo(bool);
+  void HandleRedo(bool);
   void HandleHowToPlay(bool);
+  void HandleZoomIn(bool);
+  void HandleZoomOut(bool);
+  void HandleShowHeatmap(bool);
+  void HandleHideHeatmap(bool);
+  void HandleTraceInput(bool checked);
   void HandleCreateNewGame();
   void HandleCancelNewGame();
 
- protected:
-  bool event(QEvent *event);
-
  public:
   Game(std::size_t width = 10, std::size_t height = 10);
+
+ signals:
+  // Emitted from the worker thread with the cells chosen for a request.
+  void ComputerMoved(quint64 request, std::vector<Cell> const &cells);
 };
 
 }  // namespace battleship
+
+Q_DECLARE_METATYPE(std::vector<battleship::Cell>)
 #endif  // #ifndef BATTLESHIP_GAME_H
@@ -0,0 +1,54 @@
+#include "game_context.hpp"
+
+#include <cassert>
+
+namespace battleship {
+
+// Construct a context with room for any game, call Reset before playing.
+GameContext::GameContext(unsigned seed)
+    : generator_(seed) {
+  fleets_[0].resize(GameState::kMaxShips);
+  fleets_[1].resize(GameState::kMaxShips);
+  state_.Reserve(GameState::kMaxShips);
+  generator_.Reserve(GameState::kMaxShips);
+}
+
+// Restart the random sequence used to place fleets.
+void GameContext::Seed(unsigned seed) { generator_.Seed(seed); }
+
+// Start a new game, clearing the previous one, and return false if the ships
+// cannot fit the board. Only fleets larger than any before need more room.
+bool GameContext::Reset(MapSize size, ShipSet set,
+                        GameState::Variant variant) {
+  std::size_t ships = static_cast<std::size_t>(set.last - set.first);
+  for (std::size_t i = 0; i != 2; ++i)
+    if (ships > fleets_[i].size()) fleets_[i].resize(ships);
+  state_.Init(size, set, variant);
+  return generator_.Init(size, set);
+}
+
+// Place a random fleet on each board in turn, board 1 first as the rules have
+// it, leaving the game ready for the first attack. Return false if no fleet
+// could be drawn, see FleetGenerator::Generate.
+bool GameContext::PlaceRandomFleets() {
+  std::size_t ships = generator_.fleet_size();
+  for (std::size_t i = 2; i-- != 0;) {
+    if (!generator_.Generate(&fleets_[i][0])) return false;
+    for (std::size_t j = 0; j != ships; ++j) state_.Place(fleets_[i][j]);
+  }
+  assert(state_.phase() == GameState::kAttacking);
+  return true;
+}
+
+// Return the game.
+GameState &GameContext::state() { return state_; }
+
+// Return the game.
+GameState const &GameContext::state() const { return state_; }
+
+// Return the fleet placed on a board by the last PlaceRandomFleets.
+Ship const *GameContext::fleet(std::size_t board) const {
+  return &fleets_[board][0];
+}
+
+}  // namespace battleship
@@ -0,0 +1,37 @@
+#ifndef BATTLESHIP_GAME_CONTEXT_H
+#define BATTLESHIP_GAME_CONTEXT_H
+
+#include "fleet_generator.hpp"
+#include "game_state.hpp"
+#include "presets.hpp"
+#include "ship.hpp"
+
+#include <vector>
+
+namespace battleship {
+
+// A game and the scratch space to set one up, reused from game to game. The
+// constructor makes room for the largest fleet on the largest board, so once
+// the placement tables of a map size and ship set exist, starting a new game
+// never touches the heap.
+class GameContext {
+ private:
+  GameState state_;
+  FleetGenerator generator_;
+  // The fleet placed on each board.
+  std::vector<Ship> fleets_[2];
+
+ public:
+  explicit GameContext(unsigned seed = 0);
+  void Seed(unsigned seed);
+  bool Reset(MapSize size, ShipSet set,
+             GameState::Variant variant = GameState::kStandard);
+  bool PlaceRandomFleets();
+
+  GameState &state();
+  GameState const &state() const;
+  Ship const *fleet(std::size_t board) const;
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_GAME_CONTEXT_H
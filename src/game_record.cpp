@@ -0,0 +1,349 @@
+#include "game_record.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace battleship {
+
+// The most cells on a board ShipIndex keeps dense.
+static std::size_t const kDenseCells = std::size_t(1) << 16;
+
+// Return the number of bits needed to tell count values apart.
+static unsigned BitsFor(std::uint64_t count) {
+  unsigned bits = 0;
+  while (bits != 64 && (std::uint64_t(1) << bits) < count) ++bits;
+  return bits;
+}
+
+// Appends values of a few bits each to a byte vector, lowest bits first.
+class BitWriter {
+ private:
+  std::vector<std::uint8_t> &out_;
+  std::uint64_t pending_;
+  unsigned count_;
+
+ public:
+  explicit BitWriter(std::vector<std::uint8_t> &out)
+      : out_(out), pending_(0), count_(0) {}
+
+  // Append the low bits of value.
+  void Write(std::uint64_t value, unsigned bits) {
+    for (; bits > 32; bits -= 32, value >>= 32) Write(value, 32);
+    pending_ |= (value & ((std::uint64_t(1) << bits) - 1)) << count_;
+    for (count_ += bits; count_ >= 8; count_ -= 8, pending_ >>= 8)
+      out_.push_back(static_cast<std::uint8_t>(pending_));
+  }
+
+  // Pad the last byte with zeros.
+  void Finish() {
+    if (count_ != 0) out_.push_back(static_cast<std::uint8_t>(pending_));
+    pending_ = 0;
+    count_ = 0;
+  }
+};
+
+// Reads what a BitWriter wrote.
+class BitReader {
+ private:
+  std::uint8_t const *first_;
+  std::uint8_t const *last_;
+  std::uint64_t pending_;
+  unsigned count_;
+
+ public:
+  BitReader(std::uint8_t const *first, std::uint8_t const *last)
+      : first_(first), last_(last), pending_(0), count_(0) {}
+
+  // Read a value of bits bits. Return false if the input runs out.
+  bool Read(unsigned bits, std::uint64_t &value) {
+    if (bits > 32) {
+      std::uint64_t high;
+      if (!Read(32, value) || !Read(bits - 32, high)) return false;
+      value |= high << 32;
+      return true;
+    }
+    for (; count_ < bits; count_ += 8) {
+      if (first_ == last_) return false;
+      pending_ |= std::uint64_t(*first_++) << count_;
+    }
+    value = pending_ & ((std::uint64_t(1) << bits) - 1);
+    pending_ >>= bits;
+    count_ -= bits;
+    return true;
+  }
+
+  // Return whether everything was read, leaving only the padding.
+  bool Finished() const { return first_ == last_ && pending_ == 0; }
+};
+
+// Decode a varint and check that it fits a size_t.
+static bool DecodeSize(std::uint8_t const *&first, std::uint8_t const *last,
+                       std::size_t &value) {
+  std::uint64_t wide;
+  if (!DecodeVarint(first, last, wide)) return false;
+  value = static_cast<std::size_t>(wide);
+  return value == wide;
+}
+
+// Forget the previous game, keeping the room it used.
+void GameRecord::Clear() {
+  size.x = 0;
+  size.y = 0;
+  ship_set.clear();
+  rules = 0;
+  players[0] = 0;
+  players[1] = 0;
+  for (std::size_t i = 0; i != 2; ++i) {
+    fleets[i].clear();
+    damage[i].clear();
+  }
+  attacks.clear();
+}
+
+// Append a value seven bits at a time, lowest first, with the high bit set on
+// every byte but the last.
+void EncodeVarint(std::uint64_t value, std::vector<std::uint8_t> &out) {
+  for (; value >= 0x80; value >>= 7)
+    out.push_back(static_cast<std::uint8_t>(value | 0x80));
+  out.push_back(static_cast<std::uint8_t>(value));
+}
+
+// Read a varint and advance first past it. Return false if it runs past last
+// or does not fit 64 bits.
+bool DecodeVarint(std::uint8_t const *&first, std::uint8_t const *last,
+                  std::uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (first == last) return false;
+    std::uint8_t byte = *first++;
+    value |= std::uint64_t(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+// Read the kind and payload of the chunk at first and advance first past it.
+// Return false if the chunk runs past last, as the tail of a file being
+// written or cut short does.
+bool DecodeChunk(std::uint8_t const *&first, std::uint8_t const *last,
+                 std::uint64_t &kind, std::uint8_t const *&payload,
+                 std::size_t &size) {
+  std::uint8_t const *it = first;
+  if (!DecodeVarint(it, last, kind) || !DecodeSize(it, last, size) ||
+      size > static_cast<std::size_t>(last - it))
+    return false;
+  payload = it;
+  first = it + size;
+  return true;
+}
+
+// Append the payload of a rules chunk.
+void EncodeRules(GameRules const &rules, std::vector<std::uint8_t> &out) {
+  EncodeVarint(rules.size.x, out);
+  EncodeVarint(rules.size.y, out);
+  EncodeVarint(rules.ship_set.size(), out);
+  for (std::size_t i = 0, e = rules.ship_set.size(); i != e; ++i)
+    EncodeVarint(rules.ship_set[i], out);
+}
+
+// Decode the payload of a rules chunk. Return false if it is malformed.
+bool DecodeRules(std::uint8_t const *first, std::uint8_t const *last,
+                 GameRules &rules) {
+  std::size_t count;
+  if (!DecodeSize(first, last, rules.size.x) ||
+      !DecodeSize(first, last, rules.size.y) || rules.size.x == 0 ||
+      rules.size.y == 0 ||
+      rules.size.x > static_cast<std::size_t>(-1) / rules.size.y ||
+      !DecodeSize(first, last, count) ||
+      count > static_cast<std::size_t>(last - first))
+    return false;
+  rules.ship_set.resize(count);
+  for (std::size_t i = 0; i != count; ++i)
+    if (!DecodeSize(first, last, rules.ship_set[i])) return false;
+  return first == last;
+}
+
+// Append the payload of a game chunk, rules being the id of the map size and
+// ship set of the game.
+void EncodeGame(GameRecord const &record, std::uint32_t rules,
+                std::vector<std::uint8_t> &out) {
+  EncodeVarint(rules, out);
+  EncodeVarint(record.players[0], out);
+  EncodeVarint(record.players[1], out);
+  EncodeVarint(record.fleets[0].size(), out);
+  EncodeVarint(record.fleets[1].size(), out);
+  EncodeVarint(record.attacks.size(), out);
+
+  std::uint64_t cells = std::uint64_t(record.size.x) * record.size.y;
+  unsigned cell_bits = BitsFor(cells);
+  unsigned length_bits = BitsFor(record.ship_set.size());
+  BitWriter writer(out);
+  for (std::size_t board = 0; board != 2; ++board) {
+    std::vector<PackedShip> const &fleet = record.fleets[board];
+    for (std::size_t i = 0, e = fleet.size(); i != e; ++i) {
+      Ship ship = Unpack(fleet[i]);
+      std::size_t length =
+          std::find(record.ship_set.begin(), record.ship_set.end(),
+                    ship.length) -
+          record.ship_set.begin();
+      assert(length != record.ship_set.size());
+      writer.Write(length, length_bits);
+      writer.Write(std::uint64_t(ship.y) * record.size.x + ship.x, cell_bits);
+      writer.Write(ship.orientation == Ship::kVertical, 1);
+    }
+  }
+  for (std::size_t i = 0, e = record.attacks.size(); i != e; ++i) {
+    RecordedAttack const &attack = record.attacks[i];
+    writer.Write(std::uint64_t(attack.y) * record.size.x + attack.x,
+                 cell_bits);
+  }
+  writer.Finish();
+}
+
+// Point the cells of a ship at it. Return false if one already has a ship.
+static bool IndexShip(PackedShip packed, std::size_t width,
+                      std::size_t board, std::uint32_t value, ShipIndex &index,
+                      bool dense) {
+  Ship ship = Unpack(packed);
+  std::size_t step = ship.orientation == Ship::kVertical ? width : 1;
+  std::uint64_t cell = std::uint64_t(ship.y) * width + ship.x;
+  for (std::size_t i = 0; i != ship.length; ++i, cell += step) {
+    std::uint64_t key = cell * 2 + board;
+    if (!dense) {
+      if (!index.sparse.Insert(key, value)) return false;
+    } else if (value != 0 && index.dense[key] != 0) {
+      return false;
+    } else {
+      index.dense[key] = value;
+    }
+  }
+  return true;
+}
+
+// Decode the payload of a game chunk into record, reusing its room, and replay
+// the attacks against the fleets for their results. Return false if the
+// payload is malformed, describes ships off the board or overlapping, or
+// attacks a cell of a board twice, or if the board is too large for its ships
+// to pack.
+bool DecodeGame(std::uint8_t const *first, std::uint8_t const *last,
+                std::vector<GameRules> const &rules, ShipIndex &index,
+                GameRecord &record) {
+  record.Clear();
+  std::uint64_t value;
+  std::size_t counts[3];
+  if (!DecodeVarint(first, last, value) || value >= rules.size()) return false;
+  GameRules const &game_rules = rules[static_cast<std::size_t>(value)];
+  record.rules = static_cast<std::uint32_t>(value);
+  for (std::size_t i = 0; i != 2; ++i) {
+    if (!DecodeVarint(first, last, value) || value >> 32 != 0) return false;
+    record.players[i] = static_cast<std::uint32_t>(value);
+  }
+  for (std::size_t i = 0; i != 3; ++i)
+    if (!DecodeSize(first, last, counts[i])) return false;
+
+  // Neither the fleets nor the attacks can outnumber the cells, which keeps a
+  // corrupt count from making us allocate without bound.
+  record.size = game_rules.size;
+  record.ship_set = game_rules.ship_set;
+  std::size_t width = record.size.x;
+  std::size_t cells = width * record.size.y;
+  if (!CanPack(width, record.size.y)) return false;
+  if (counts[0] > cells || counts[1] > cells || counts[2] / 2 > cells)
+    return false;
+  unsigned cell_bits = BitsFor(cells);
+  unsigned length_bits = BitsFor(record.ship_set.size());
+  BitReader reader(first, last);
+
+  for (std::size_t board = 0; board != 2; ++board) {
+    std::vector<PackedShip> &fleet = record.fleets[board];
+    fleet.resize(counts[board]);
+    record.damage[board].assign(counts[board], 0);
+    for (std::size_t i = 0; i != counts[board]; ++i) {
+      Ship ship;
+      std::uint64_t length;
+      std::uint64_t cell;
+      std::uint64_t vertical;
+      if (!reader.Read(length_bits, length) ||
+          length >= record.ship_set.size() || !reader.Read(cell_bits, cell) ||
+          cell >= cells || !reader.Read(1, vertical))
+        return false;
+      ship.orientation = vertical ? Ship::kVertical : Ship::kHorizontal;
+      ship.x = static_cast<std::size_t>(cell) % width;
+      ship.y = static_cast<std::size_t>(cell) / width;
+      ship.length = record.ship_set[static_cast<std::size_t>(length)];
+      std::size_t end = (vertical ? ship.y : ship.x) + ship.length;
+      if (ship.length == 0 || end > (vertical ? record.size.y : width))
+        return false;
+      fleet[i] = Pack(ship);
+    }
+  }
+
+  // Index the ships by cell, then look up every attack.
+  bool dense = cells <= kDenseCells;
+  if (dense && index.dense.size() < 2 * cells) index.dense.resize(2 * cells);
+  index.sparse.Clear();
+  bool ok = true;
+  for (std::size_t board = 0; board != 2; ++board)
+    for (std::size_t i = 0; ok && i != counts[board]; ++i)
+      ok = IndexShip(record.fleets[board][i], width, board,
+                     static_cast<std::uint32_t>(i + 1), index, dense);
+
+  // A game only ever attacks a cell once, the results would be wrong
+  // otherwise.
+  std::size_t attacked_words = (2 * cells + 63) / 64;
+  if (index.attacked.size() < attacked_words)
+    index.attacked.resize(attacked_words);
+  std::size_t attacked = 0;
+  record.attacks.resize(ok ? counts[2] : 0);
+  for (std::size_t i = 0; ok && i != counts[2]; ++i) {
+    std::uint64_t cell;
+    if (!reader.Read(cell_bits, cell) || cell >= cells) {
+      ok = false;
+      break;
+    }
+    std::uint64_t key = cell * 2 + i % 2;
+    std::uint64_t &word = index.attacked[static_cast<std::size_t>(key / 64)];
+    std::uint64_t bit = std::uint64_t(1) << (key % 64);
+    if ((word & bit) != 0) {
+      ok = false;
+      break;
+    }
+    word |= bit;
+    ++attacked;
+    RecordedAttack &attack = record.attacks[i];
+    attack.x = static_cast<std::size_t>(cell) % width;
+    attack.y = static_cast<std::size_t>(cell) / width;
+    std::uint32_t ship;
+    if (dense) {
+      ship = index.dense[cell * 2 + i % 2];
+    } else {
+      std::uint32_t const *value = index.sparse.Get(cell * 2 + i % 2);
+      ship = value != 0 ? *value : 0;
+    }
+    if (ship == 0) {
+      attack.result = Board::kMiss;
+      continue;
+    }
+    std::size_t &damage = record.damage[i % 2][ship - 1];
+    attack.result = ++damage == Unpack(record.fleets[i % 2][ship - 1]).length
+                        ? Board::kSunk
+                        : Board::kHit;
+  }
+
+  // Leave the attacked cells and the dense index clear for the next game.
+  for (std::size_t i = 0; i != attacked; ++i) {
+    RecordedAttack const &attack = record.attacks[i];
+    std::uint64_t cell = std::uint64_t(attack.y) * width + attack.x;
+    std::uint64_t key = cell * 2 + i % 2;
+    index.attacked[static_cast<std::size_t>(key / 64)] &=
+        ~(std::uint64_t(1) << (key % 64));
+  }
+  if (dense) {
+    for (std::size_t board = 0; board != 2; ++board)
+      for (std::size_t i = 0; i != counts[board]; ++i)
+        IndexShip(record.fleets[board][i], width, board, 0, index, true);
+  }
+  return ok && reader.Finished();
+}
+
+}  // namespace battleship
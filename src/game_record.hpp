@@ -0,0 +1,99 @@
+#ifndef BATTLESHIP_GAME_RECORD_H
+#define BATTLESHIP_GAME_RECORD_H
+
+#include "board.hpp"
+#include "cell_map.hpp"
+#include "presets.hpp"
+#include "ship.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace battleship {
+
+// An attack that was not a retry and what it did.
+struct RecordedAttack {
+  std::size_t x;
+  std::size_t y;
+  Board::AttackType result;
+};
+
+// The map size and ship set a game was created with.
+struct GameRules {
+  MapSize size;
+  std::vector<std::size_t> ship_set;
+};
+
+// Everything needed to replay a finished or abandoned game. The rules fix the
+// order of play: the fleet of board 1 is placed first, and the attacks start
+// on board 0 and alternate, so attack i is on board i % 2.
+struct GameRecord {
+  MapSize size;
+  std::vector<std::size_t> ship_set;
+  // The id of the size and ship set in the file, filled in by DecodeGame.
+  std::uint32_t rules;
+  // The players attacking board 0 and board 1, as ids from a RecordWriter.
+  std::uint32_t players[2];
+  // The fleet of every board in placement order. Records only hold boards
+  // CanPack accepts.
+  std::vector<PackedShip> fleets[2];
+  std::vector<RecordedAttack> attacks;
+  // The cells hit of every ship of a board after the last attack, filled in
+  // by DecodeGame.
+  std::vector<std::size_t> damage[2];
+
+  void Clear();
+};
+
+// Scratch space DecodeGame uses to find the ship on a cell, reused from game
+// to game so that decoding does not allocate.
+struct ShipIndex {
+  // The ship plus one on cell * 2 + board, or 0, on boards small enough.
+  // Only the cells of the last fleets are ever set, and DecodeGame clears
+  // them again.
+  std::vector<std::uint32_t> dense;
+  // The same for larger boards.
+  CellMap sparse;
+  // One bit per cell * 2 + board, set for the cells attacked so far. Decoding
+  // clears them again.
+  std::vector<std::uint64_t> attacked;
+};
+
+// A record file is the magic "BSGR", a format version byte and a sequence of
+// chunks. A chunk is a varint kind, a varint payload size and the payload, so
+// readers can skip kinds they do not know and detect a truncated tail.
+//
+// Player and rules chunks declare what games refer to by id, numbered in the
+// order of their chunks of that kind. A player chunk holds a UTF-8 name and a
+// rules chunk holds the map size, the number of ships and their lengths as
+// varints.
+//
+// A game chunk holds the rules id, the two player ids, the size of the two
+// fleets and the number of attacks as varints, followed by a little endian bit
+// stream padded to a byte. Every ship is stored as the index of its length in
+// the ship set, its first cell y * width + x and whether it is vertical, and
+// every attack as its cell, each in as few bits as the rules allow. Results
+// follow from the fleets and are not stored, so a 10x10 game of about 80
+// attacks takes about 90 bytes.
+enum RecordChunk { kPlayerChunk = 1, kRulesChunk = 2, kGameChunk = 3 };
+
+static std::uint8_t const kRecordMagic[4] = {'B', 'S', 'G', 'R'};
+static std::uint8_t const kRecordVersion = 1;
+
+void EncodeVarint(std::uint64_t value, std::vector<std::uint8_t> &out);
+bool DecodeVarint(std::uint8_t const *&first, std::uint8_t const *last,
+                  std::uint64_t &value);
+bool DecodeChunk(std::uint8_t const *&first, std::uint8_t const *last,
+                 std::uint64_t &kind, std::uint8_t const *&payload,
+                 std::size_t &size);
+void EncodeRules(GameRules const &rules, std::vector<std::uint8_t> &out);
+bool DecodeRules(std::uint8_t const *first, std::uint8_t const *last,
+                 GameRules &rules);
+void EncodeGame(GameRecord const &record, std::uint32_t rules,
+                std::vector<std::uint8_t> &out);
+bool DecodeGame(std::uint8_t const *first, std::uint8_t const *last,
+                std::vector<GameRules> const &rules, ShipIndex &index,
+                GameRecord &record);
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_GAME_RECORD_H
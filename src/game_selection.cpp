@@ -2,15 +2,10 @@
 
 namespace battleship {
 
-// Options.
-static MapSize size1 = {8, 8};
-static MapSize size2 = {10, 10};
-static MapSize size3 = {9, 16};
-static MapSize size4 = {26, 26};
-static std::size_t set1[] = {1, 2, 3};
-static std::size_t set2[] = {2, 3, 3, 4, 5};
-static std::size_t set3[] = {1, 3, 5, 7};
-static std::size_t set4[] = {1, 1, 2, 3, 5, 8};
+// Limits of a custom map size. Every preset ship fits on the smallest.
+static int const kMinCustomSize = 8;
+static int const kMaxCustomSize = 500;
+static int const kDefaultCustomSize = 100;
 
 // Return a string representation of a map size.
 static QString MakeSizeString(MapSize size) {
@@ -21,15 +16,6 @@ static QString MakeSizeString(MapSize size) {
   return ret;
 }
 
-// Generate an iterator pair from an array.
-template <std::size_t N>
-static ShipSet MakeShipSet(std::size_t (&lengths)[N]) {
-  ShipSet set;
-  set.first = &lengths[0];
-  set.last = set.first + N;
-  return set;
-}
-
 // Return a string representation of a ship set.
 static QString MakeSetString(ShipSet set) {
   QString ret;
@@ -44,24 +30,41 @@ static QString MakeSetString(ShipSet set) {
 
 GameSelection::GameSelection(QWidget* parent)
     : QDialog(parent),
-      size_radio1_(new QRadioButton(MakeSizeString(size1))),
-      size_radio2_(new QRadioButton(MakeSizeString(size2))),
-      size_radio3_(new QRadioButton(MakeSizeString(size3))),
-      size_radio4_(new QRadioButton(MakeSizeString(size4))),
-      set_radio1_(new QRadioButton(MakeSetString(MakeShipSet(set1)))),
-      set_radio2_(new QRadioButton(MakeSetString(MakeShipSet(set2)))),
-      set_radio3_(new QRadioButton(MakeSetString(MakeShipSet(set3)))),
-      set_radio4_(new QRadioButton(MakeSetString(MakeShipSet(set4)))),
+      size_radio1_(new QRadioButton(MakeSizeString(GetPresetMapSize(0)))),
+      size_radio2_(new QRadioButton(MakeSizeString(GetPresetMapSize(1)))),
+      size_radio3_(new QRadioButton(MakeSizeString(GetPresetMapSize(2)))),
+      size_radio4_(new QRadioButton(MakeSizeString(GetPresetMapSize(3)))),
+      custom_radio_(new QRadioButton("Custom")),
+      width_box_(new QSpinBox),
+      height_box_(new QSpinBox),
+      set_radio1_(new QRadioButton(MakeSetString(GetPresetShipSet(0)))),
+      set_radio2_(new QRadioButton(MakeSetString(GetPresetShipSet(1)))),
+      set_radio3_(new QRadioButton(MakeSetString(GetPresetShipSet(2)))),
+      set_radio4_(new QRadioButton(MakeSetString(GetPresetShipSet(3)))),
+      human_radio_(new QRadioButton("Human")),
+      computer_radio_(new QRadioButton("Computer")),
+      standard_radio_(new QRadioButton("One shot a turn")),
+      salvo_radio_(new QRadioButton("Salvo: a shot per ship afloat")),
       buttons_(new QDialogButtonBox(QDialogButtonBox::Ok |
                                     QDialogButtonBox::Cancel)) {
   size_radio2_->setChecked(true);
   set_radio2_->setChecked(true);
+  human_radio_->setChecked(true);
+  standard_radio_->setChecked(true);
+  width_box_->setRange(kMinCustomSize, kMaxCustomSize);
+  width_box_->setValue(kDefaultCustomSize);
+  height_box_->setRange(kMinCustomSize, kMaxCustomSize);
+  height_box_->setValue(kDefaultCustomSize);
 
   QHBoxLayout* size_layout = new QHBoxLayout;
   size_layout->addWidget(size_radio1_);
   size_layout->addWidget(size_radio2_);
   size_layout->addWidget(size_radio3_);
   size_layout->addWidget(size_radio4_);
+  size_layout->addWidget(custom_radio_);
+  size_layout->addWidget(width_box_);
+  size_layout->addWidget(new QLabel("x"));
+  size_layout->addWidget(height_box_);
   QGroupBox* size_box = new QGroupBox("Arena size");
   size_box->setLayout(size_layout);
 
@@ -73,9 +76,23 @@ GameSelection::GameSelection(QWidget* parent)
   QGroupBox* set_box = new QGroupBox("Ship set");
   set_box->setLayout(set_layout);
 
+  QHBoxLayout* opponent_layout = new QHBoxLayout;
+  opponent_layout->addWidget(human_radio_);
+  opponent_layout->addWidget(computer_radio_);
+  QGroupBox* opponent_box = new QGroupBox("Player2");
+  opponent_box->setLayout(opponent_layout);
+
+  QHBoxLayout* variant_layout = new QHBoxLayout;
+  variant_layout->addWidget(standard_radio_);
+  variant_layout->addWidget(salvo_radio_);
+  QGroupBox* variant_box = new QGroupBox("Attacks");
+  variant_box->setLayout(variant_layout);
+
   QVBoxLayout* vbox = new QVBoxLayout;
   vbox->addWidget(size_box);
   vbox->addWidget(set_box);
+  vbox->addWidget(opponent_box);
+  vbox->addWidget(variant_box);
   vbox->addWidget(buttons_);
   setLayout(vbox);
 }
@@ -85,18 +102,34 @@ QDialogButtonBox* GameSelection::buttons() { return buttons_; }
 
 // Return the selected map size.
 MapSize GameSelection::GetMapSize() {
-  if (size_radio1_->isChecked()) return size1;
-  if (size_radio2_->isChecked()) return size2;
-  if (size_radio3_->isChecked()) return size3;
-  return size4;
+  if (size_radio1_->isChecked()) return GetPresetMapSize(0);
+  if (size_radio2_->isChecked()) return GetPresetMapSize(1);
+  if (size_radio3_->isChecked()) return GetPresetMapSize(2);
+  if (size_radio4_->isChecked()) return GetPresetMapSize(3);
+  MapSize size;
+  size.x = static_cast<std::size_t>(width_box_->value());
+  size.y = static_cast<std::size_t>(height_box_->value());
+  return size;
 }
 
 // Return the selected ship set.
 ShipSet GameSelection::GetShipSet() {
-  if (set_radio1_->isChecked()) return MakeShipSet(set1);
-  if (set_radio2_->isChecked()) return MakeShipSet(set2);
-  if (set_radio3_->isChecked()) return MakeShipSet(set3);
-  return MakeShipSet(set4);
+  if (set_radio1_->isChecked()) return GetPresetShipSet(0);
+  if (set_radio2_->isChecked()) return GetPresetShipSet(1);
+  if (set_radio3_->isChecked()) return GetPresetShipSet(2);
+  return GetPresetShipSet(3);
+}
+
+// Return who plays as Player2.
+Opponent GameSelection::GetOpponent() {
+  if (computer_radio_->isChecked()) return kComputerOpponent;
+  return kHumanOpponent;
+}
+
+// Return whether turns are single attacks or salvos.
+GameState::Variant GameSelection::GetVariant() {
+  if (salvo_radio_->isChecked()) return GameState::kSalvo;
+  return GameState::kStandard;
 }
 
 }  // namespace battleship
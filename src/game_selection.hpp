@@ -1,23 +1,22 @@
 #ifndef BATTLESHIP_GAME_SELECTION_H
 #define BATTLESHIP_GAME_SELECTION_H
 
+#include "game_state.hpp"
+#include "presets.hpp"
+
 #include <QDialog>
 #include <QDialogButtonBox>
 #include <QGroupBox>
 #include <QHBoxLayout>
+#include <QLabel>
 #include <QRadioButton>
+#include <QSpinBox>
 
 namespace battleship {
 
-struct MapSize {
-  std::size_t x;
-  std::size_t y;
-};
-
-struct ShipSet {
-  std::size_t* first;
-  std::size_t* last;
-};
+// Who plays as Player2. A network opponent is chosen by File > Play online,
+// not in the dialog.
+enum Opponent { kHumanOpponent, kComputerOpponent, kNetworkOpponent };
 
 // Modal dialog for creating a new game.
 class GameSelection : public QDialog {
@@ -28,10 +27,17 @@ class GameSelection : public QDialog {
   QRadioButton* size_radio2_;
   QRadioButton* size_radio3_;
   QRadioButton* size_radio4_;
+  QRadioButton* custom_radio_;
+  QSpinBox* width_box_;
+  QSpinBox* height_box_;
   QRadioButton* set_radio1_;
   QRadioButton* set_radio2_;
   QRadioButton* set_radio3_;
   QRadioButton* set_radio4_;
+  QRadioButton* human_radio_;
+  QRadioButton* computer_radio_;
+  QRadioButton* standard_radio_;
+  QRadioButton* salvo_radio_;
   QDialogButtonBox* buttons_;
 
  public:
@@ -39,6 +45,8 @@ class GameSelection : public QDialog {
   QDialogButtonBox* buttons();
   MapSize GetMapSize();
   ShipSet GetShipSet();
+  Opponent GetOpponent();
+  GameState::Variant GetVariant();
 };
 
 }  // namespace battleship
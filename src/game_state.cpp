@@ -0,0 +1,218 @@
+#include "game_state.hpp"
+
+#include <algorithm>
+
+namespace battleship {
+
+// Construct an empty game, call Init before playing.
+GameState::GameState() {
+  MapSize size = {0, 0};
+  ShipSet set = {0, 0};
+  Init(size, set);
+}
+
+// Start a new game, Player1 places the first ship on board 1.
+void GameState::Init(MapSize size, ShipSet set, Variant variant) {
+  size_ = size;
+  variant_ = variant;
+  for (std::size_t i = 0; i != 2; ++i) {
+    sides_[i].board.Init(size.x, size.y);
+    sides_[i].ships_left = 0;
+    sides_[i].attacks = 0;
+    sides_[i].ship_set.assign(set.first, set.last);
+  }
+  phase_ = kPlacing;
+  turn_ = 1;
+}
+
+// Make room for fleets of up to ships ships on boards up to the largest preset
+// so that Init and placing them never allocate.
+void GameState::Reserve(std::size_t ships) {
+  for (std::size_t i = 0; i != 2; ++i) {
+    sides_[i].board.Reserve(kMaxWidth, kMaxHeight, ships);
+    sides_[i].ship_set.reserve(ships);
+  }
+}
+
+// Try to place a ship on the current board.
+GameState::PlaceResult GameState::Place(Ship const &ship) {
+  assert(phase_ == kPlacing);
+  PlaceResult result;
+  Side &side = sides_[turn_];
+
+  std::vector<std::size_t>::iterator it =
+      std::find(side.ship_set.begin(), side.ship_set.end(), ship.length);
+  if (it == side.ship_set.end()) {
+    result.type = kInvalidLength;
+    return result;
+  }
+
+  bool horizontal = ship.orientation == Ship::kHorizontal;
+  std::size_t x_end = ship.x + (horizontal ? ship.length : 1);
+  std::size_t y_end = ship.y + (horizontal ? 1 : ship.length);
+  if (x_end > size_.x || y_end > size_.y) {
+    result.type = kOutOfBounds;
+    return result;
+  }
+
+  Board::PlaceResult res = side.board.Place(ship);
+  switch (res.type) {
+    case Board::kPlaced:
+      break;
+    case Board::kOverlap:
+      result.type = kOverlap;
+      return result;
+  }
+
+  ++side.ships_left;
+  side.ship_set.erase(it);
+  result.type = kPlaced;
+  result.ship = res.ship;
+
+  // Move on to the next fleet, or to the attacks once both are deployed.
+  if (side.ship_set.empty()) {
+    if (turn_ == 1)
+      turn_ = 0;
+    else
+      phase_ = kAttacking;
+  }
+  return result;
+}
+
+// Try to attack a cell on the current board. The turn passes to the other
+// player after every attack that was not a retry. In salvo games this is a
+// salvo of one shot.
+Board::AttackResult GameState::Attack(std::size_t x, std::size_t y) {
+  assert(phase_ == kAttacking);
+  Side &side = sides_[turn_];
+  Board::AttackResult res = side.board.Attack(x, y);
+
+  switch (res.type) {
+    case Board::kRetry:
+      return res;
+    case Board::kSunk:
+      --side.ships_left;
+      break;
+    case Board::kMiss:
+    case Board::kHit:
+      break;
+  }
+  ++side.attacks;
+
+  // The winner is left as the current turn.
+  if (side.ships_left == 0)
+    phase_ = kFinished;
+  else
+    turn_ = 1 - turn_;
+  return res;
+}
+
+// Fire a salvo of up to shots() cells at the current board and store the
+// result of each in results. The turn passes unless every shot was a retry.
+// Return false, changing nothing, if the salvo is empty or too large.
+bool GameState::AttackMany(Cell const *cells, std::size_t count,
+                           Board::AttackResult *results) {
+  assert(phase_ == kAttacking);
+  if (count == 0 || count > shots()) return false;
+  Side &side = sides_[turn_];
+  side.board.AttackMany(cells, count, results);
+
+  std::size_t landed = 0;
+  for (std::size_t i = 0; i != count; ++i) {
+    if (results[i].type == Board::kRetry) continue;
+    ++landed;
+    if (results[i].type == Board::kSunk) --side.ships_left;
+  }
+  side.attacks += landed;
+
+  if (side.ships_left == 0)
+    phase_ = kFinished;
+  else if (landed != 0)
+    turn_ = 1 - turn_;
+  return true;
+}
+
+// Return the game as it is now. Fleets must be placed.
+GameState::Snapshot GameState::TakeSnapshot() const {
+  assert(phase_ != kPlacing);
+  Snapshot snapshot;
+  for (std::size_t i = 0; i != 2; ++i)
+    snapshot.boards[i] = sides_[i].board.Snapshot();
+  snapshot.phase = phase_;
+  snapshot.turn = turn_;
+  return snapshot;
+}
+
+// Put the game back as it was in a snapshot, which may be of another game.
+// Boards are rebuilt from their ships and attacks.
+void GameState::Restore(Snapshot const &snapshot) {
+  BoardSnapshot const &first = snapshot.boards[0];
+  size_.x = first.x_size();
+  size_.y = first.y_size();
+  for (std::size_t i = 0; i != 2; ++i) {
+    BoardSnapshot const &from = snapshot.boards[i];
+    Side &side = sides_[i];
+    side.board.Init(size_.x, size_.y);
+    for (std::size_t j = 0, e = from.ship_count(); j != e; ++j)
+      side.board.Place(from.ship(j));
+    Board &board = side.board;
+    from.ForEachAttack([&](std::size_t x, std::size_t y, Ship const *) {
+      board.Attack(x, y);
+    });
+    side.ships_left = from.ships_left();
+    side.attacks = from.attacks();
+    side.ship_set.clear();
+  }
+  phase_ = snapshot.phase;
+  turn_ = snapshot.turn;
+}
+
+// Return the game after attacking a cell on the current board, with the same
+// rules as GameState::Attack.
+GameState::Snapshot GameState::Snapshot::Attack(
+    std::size_t x, std::size_t y, Board::AttackResult &result) const {
+  assert(phase == kAttacking);
+  Snapshot next(*this);
+  next.boards[turn] = boards[turn].Attack(x, y, result);
+  if (result.type == Board::kRetry) return next;
+  if (next.boards[turn].ships_left() == 0)
+    next.phase = kFinished;
+  else
+    next.turn = 1 - turn;
+  return next;
+}
+
+// Return the map size of the current game.
+MapSize GameState::size() const { return size_; }
+
+// Return whether turns are single attacks or salvos.
+GameState::Variant GameState::variant() const { return variant_; }
+
+// Return how many cells the current player attacks in a turn: one, or in
+// salvo games one per ship of theirs afloat, but never more than the cells
+// left to attack.
+std::size_t GameState::shots() const {
+  if (phase_ != kAttacking) return 0;
+  if (variant_ == kStandard) return 1;
+  std::size_t left = size_.x * size_.y - sides_[turn_].attacks;
+  return std::min(sides_[1 - turn_].ships_left, left);
+}
+
+// Return what the players are currently doing.
+GameState::Phase GameState::phase() const { return phase_; }
+
+// Return the board currently being placed on or attacked. Once the game is
+// finished this is the board that was cleared, which is also the winner.
+std::size_t GameState::turn() const { return turn_; }
+
+// Return how many ships on a board are still afloat.
+std::size_t GameState::ships_left(std::size_t board) const {
+  return sides_[board].ships_left;
+}
+
+// Return the lengths of the ships still to be placed on a board.
+std::vector<std::size_t> const &GameState::ship_set(std::size_t board) const {
+  return sides_[board].ship_set;
+}
+
+}  // namespace battleship
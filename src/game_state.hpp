@@ -0,0 +1,87 @@
+#ifndef BATTLESHIP_GAME_STATE_H
+#define BATTLESHIP_GAME_STATE_H
+
+#include "board.hpp"
+#include "board_snapshot.hpp"
+#include "presets.hpp"
+#include "ship.hpp"
+
+#include <vector>
+
+namespace battleship {
+
+// Implements the rules of a game between two players without any user
+// interface. Board i is attacked by player i and its ships are placed by the
+// other player. Player1 places first, then Player2, then the players alternate
+// attacks starting with Player1 until one board has no ships left. In salvo
+// games every turn is a salvo of one shot per ship the attacker has afloat.
+class GameState {
+ public:
+  // The largest board and fleet Reserve makes room for: the largest preset
+  // board with a ship on every cell. Larger games allocate in Init.
+  static std::size_t const kMaxWidth = 26;
+  static std::size_t const kMaxHeight = 26;
+  static std::size_t const kMaxShips = kMaxWidth * kMaxHeight;
+
+  enum Phase { kPlacing, kAttacking, kFinished };
+
+  enum Variant { kStandard, kSalvo };
+
+  enum PlaceType { kPlaced, kOverlap, kInvalidLength, kOutOfBounds };
+
+  struct PlaceResult {
+    PlaceType type;
+    Ship const *ship;
+  };
+
+  // A game after both fleets are placed. Attacking one gives the next and
+  // leaves it as it was, so a list of them is the history of a standard
+  // game.
+  struct Snapshot {
+    BoardSnapshot boards[2];
+    Phase phase;
+    std::size_t turn;
+
+    Snapshot Attack(std::size_t x, std::size_t y,
+                    Board::AttackResult &result) const;
+  };
+
+ private:
+  struct Side {
+    Board board;
+    // Ships placed and not yet sunk, and cells attacked.
+    std::size_t ships_left;
+    std::size_t attacks;
+    // Lengths of the ships still to be placed.
+    std::vector<std::size_t> ship_set;
+  };
+
+  MapSize size_;
+  Variant variant_;
+  Side sides_[2];
+  Phase phase_;
+  // The board currently being placed on or attacked.
+  std::size_t turn_;
+
+ public:
+  GameState();
+  void Init(MapSize size, ShipSet set, Variant variant = kStandard);
+  void Reserve(std::size_t ships);
+  PlaceResult Place(Ship const &ship);
+  Board::AttackResult Attack(std::size_t x, std::size_t y);
+  bool AttackMany(Cell const *cells, std::size_t count,
+                  Board::AttackResult *results);
+  Snapshot TakeSnapshot() const;
+  void Restore(Snapshot const &snapshot);
+
+  MapSize size() const;
+  Variant variant() const;
+  std::size_t shots() const;
+  Phase phase() const;
+  std::size_t turn() const;
+  std::size_t ships_left(std::size_t board) const;
+  std::vector<std::size_t> const &ship_set(std::size_t board) const;
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_GAME_STATE_H
@@ -0,0 +1,59 @@
+#include "heatmap.hpp"
+
+#include <fstream>
+
+namespace battleship {
+
+// The names of the kinds in a heatmap file.
+static char const *const kKindNames[] = {"placements", "shots"};
+
+// Write heatmaps as text: a line with the kind, the map size, the number of
+// games and the player, then a line of counts for every row. Return false if
+// the file cannot be written.
+bool WriteHeatmaps(char const *path, std::vector<Heatmap> const &heatmaps) {
+  std::ofstream file(path);
+  for (std::size_t i = 0, e = heatmaps.size(); i != e; ++i) {
+    Heatmap const &heatmap = heatmaps[i];
+    file << kKindNames[heatmap.kind] << ' ' << heatmap.size.x << ' '
+         << heatmap.size.y << ' ' << heatmap.games << ' ' << heatmap.player
+         << '\n';
+    for (std::size_t y = 0; y != heatmap.size.y; ++y) {
+      for (std::size_t x = 0; x != heatmap.size.x; ++x)
+        file << (x == 0 ? "" : " ") << heatmap.counts[y * heatmap.size.x + x];
+      file << '\n';
+    }
+  }
+  file.close();
+  return !file.fail();
+}
+
+// Append the heatmaps of a file written by WriteHeatmaps. Return false if it
+// cannot be read or is malformed.
+bool ReadHeatmaps(char const *path, std::vector<Heatmap> &heatmaps) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::string kind;
+  while (file >> kind) {
+    Heatmap heatmap;
+    if (kind == kKindNames[Heatmap::kPlacements])
+      heatmap.kind = Heatmap::kPlacements;
+    else if (kind == kKindNames[Heatmap::kShots])
+      heatmap.kind = Heatmap::kShots;
+    else
+      return false;
+
+    // The player is the rest of the line, so it may hold spaces.
+    if (!(file >> heatmap.size.x >> heatmap.size.y >> heatmap.games) ||
+        file.get() != ' ' || !std::getline(file, heatmap.player) ||
+        heatmap.size.x == 0 ||
+        heatmap.size.y > Heatmap::kMaxCells / heatmap.size.x)
+      return false;
+    heatmap.counts.resize(heatmap.size.x * heatmap.size.y);
+    for (std::size_t i = 0, e = heatmap.counts.size(); i != e; ++i)
+      if (!(file >> heatmap.counts[i])) return false;
+    heatmaps.push_back(heatmap);
+  }
+  return file.eof();
+}
+
+}  // namespace battleship
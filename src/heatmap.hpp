@@ -0,0 +1,33 @@
+#ifndef BATTLESHIP_HEATMAP_H
+#define BATTLESHIP_HEATMAP_H
+
+#include "presets.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace battleship {
+
+// How often every cell of a board held a ship or was shot at over many games
+// of one player, as battleship_stats finds them and Arena overlays them.
+struct Heatmap {
+  enum Kind { kPlacements, kShots };
+
+  // Larger boards get no heatmaps.
+  static std::size_t const kMaxCells = std::size_t(1) << 20;
+
+  Kind kind;
+  MapSize size;
+  // The player who placed the ships or fired the shots.
+  std::string player;
+  std::uint64_t games;
+  // The count of every cell, y * width + x.
+  std::vector<std::uint64_t> counts;
+};
+
+bool WriteHeatmaps(char const *path, std::vector<Heatmap> const &heatmaps);
+bool ReadHeatmaps(char const *path, std::vector<Heatmap> &heatmaps);
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_HEATMAP_H
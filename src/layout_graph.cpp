@@ -0,0 +1,270 @@
+#include "layout_graph.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+
+namespace battleship {
+
+namespace {
+
+// Nodes reached before a graph is given up on, bounding the memory of
+// building it to about 50 MB.
+std::size_t const kMaxNodes = std::size_t(1) << 20;
+
+// A node of the walk while building: the cells from the next one on covered
+// by ships starting before it, with the next cell as bit 0, and the ships used
+// as a mixed radix number of ships per distinct length.
+struct Key {
+  std::uint64_t window;
+  std::uint32_t used;
+
+  bool operator==(Key const &other) const {
+    return window == other.window && used == other.used;
+  }
+};
+
+// Hashes a key.
+struct KeyHash {
+  std::size_t operator()(Key const &key) const {
+    std::uint64_t hash = (key.window ^ key.used) * 0xff51afd7ed558ccdULL;
+    return static_cast<std::size_t>(hash ^ hash >> 33);
+  }
+};
+
+}  // namespace
+
+// Construct an empty graph for a map size and a set sorted longest first.
+LayoutGraph::LayoutGraph(MapSize size, ShipSet set)
+    : size_(size), lengths_(set.first, set.last), fleets_(0) {}
+
+// Build the graph. Return false if a vertical ship covers more cells ahead
+// than a word holds, the nodes do not fit kMaxNodes or the fleets do not fit
+// 64 bits.
+bool LayoutGraph::Build() {
+  std::size_t width = size_.x;
+  std::size_t height = size_.y;
+  std::size_t cells = width * height;
+
+  // The distinct lengths, how many ships of each, their radix in used, where
+  // the first of them goes in a fleet, the last cell one may start on and the
+  // window bits of a vertical one.
+  std::vector<std::size_t> lengths;
+  std::vector<std::size_t> counts;
+  std::vector<std::size_t> radices;
+  std::vector<std::size_t> offsets;
+  std::vector<std::size_t> last_starts;
+  std::vector<std::uint64_t> columns;
+  std::size_t radix = 1;
+  std::size_t ship_cells = 0;
+  for (std::size_t i = 0, e = lengths_.size(); i != e; ++i) {
+    ship_cells += lengths_[i];
+    if (i != 0 && lengths_[i] == lengths_[i - 1]) {
+      ++counts.back();
+      continue;
+    }
+    lengths.push_back(lengths_[i]);
+    counts.push_back(1);
+    offsets.push_back(i);
+  }
+  std::uint32_t fleet = 0;
+  for (std::size_t slot = 0, e = lengths.size(); slot != e; ++slot) {
+    std::size_t length = lengths[slot];
+    radices.push_back(radix);
+    fleet += static_cast<std::uint32_t>(counts[slot] * radix);
+    radix *= counts[slot] + 1;
+    if (radix > std::numeric_limits<std::uint32_t>::max() || length > 64)
+      return false;
+    std::uint64_t column = 0;
+    std::size_t last = 0;
+    if (length <= width) last = (height - 1) * width + width - length;
+    if (length > 1 && length <= height) {
+      if ((length - 1) * width >= 64) return false;
+      for (std::size_t j = 0; j != length; ++j)
+        column |= std::uint64_t(1) << (j * width);
+      last = std::max(last, (height - length) * width + width - 1);
+    }
+    columns.push_back(column);
+    last_starts.push_back(last);
+  }
+  std::size_t slots = lengths.size();
+
+  // Walk forward, numbering the nodes in the order they are reached, so every
+  // edge goes to a later node and the nodes after the last cell come last.
+  std::vector<Key> keys;
+  std::vector<std::uint32_t> first_edges;
+  std::vector<Edge> edges;
+  Key start = {0, 0};
+  keys.push_back(start);
+  std::unordered_map<Key, std::uint32_t, KeyHash> next_nodes;
+  std::size_t layer_begin = 0;
+  for (std::size_t cell = 0; cell != cells; ++cell) {
+    std::size_t layer_end = keys.size();
+    std::size_t x = cell % width;
+    std::size_t y = cell / width;
+    next_nodes.clear();
+    for (std::size_t node = layer_begin; node != layer_end; ++node) {
+      first_edges.push_back(static_cast<std::uint32_t>(edges.size()));
+      Key const key = keys[node];
+
+      // The ways out: no ship, or a ship of a length left starting here.
+      Key nexts[1 + 2 * 64];
+      Ship starts[1 + 2 * 64];
+      std::size_t moves = 0;
+      nexts[moves++] = key;
+      for (std::size_t slot = 0; (key.window & 1) == 0 && slot != slots;
+           ++slot) {
+        std::size_t placed = key.used / radices[slot] % (counts[slot] + 1);
+        if (placed == counts[slot]) continue;
+        std::size_t length = lengths[slot];
+        std::uint64_t row = length == 64 ? ~std::uint64_t(0)
+                                         : (std::uint64_t(1) << length) - 1;
+        Key next = {key.window, static_cast<std::uint32_t>(key.used +
+                                                           radices[slot])};
+        Ship ship = {Ship::kHorizontal, x, y, length};
+        if (x + length <= width && (key.window & row) == 0) {
+          nexts[moves] = next;
+          nexts[moves].window |= row;
+          starts[moves++] = ship;
+        }
+        if (columns[slot] != 0 && y + length <= height &&
+            (key.window & columns[slot]) == 0) {
+          nexts[moves] = next;
+          nexts[moves].window |= columns[slot];
+          ship.orientation = Ship::kVertical;
+          starts[moves++] = ship;
+        }
+      }
+
+      for (std::size_t k = 0; k != moves; ++k) {
+        Key next = nexts[k];
+        next.window >>= 1;
+        // Drop walks with a ship left that can no longer start anywhere or
+        // no longer fits the cells left.
+        std::size_t left = ship_cells;
+        bool dead = false;
+        for (std::size_t slot = 0; slot != slots; ++slot) {
+          std::size_t placed = next.used / radices[slot] % (counts[slot] + 1);
+          left -= placed * lengths[slot];
+          dead = dead || (placed != counts[slot] && last_starts[slot] <= cell);
+        }
+        std::size_t ahead =
+            cells - cell - 1 - __builtin_popcountll(next.window);
+        if (dead || ahead < left) continue;
+
+        std::unordered_map<Key, std::uint32_t, KeyHash>::iterator it =
+            next_nodes.find(next);
+        if (it == next_nodes.end()) {
+          if (keys.size() == kMaxNodes) return false;
+          it = next_nodes.insert(std::make_pair(
+                                     next, static_cast<std::uint32_t>(
+                                               keys.size())))
+                   .first;
+          keys.push_back(next);
+        }
+        Edge edge = {0, it->second, kNoShip};
+        if (k != 0) {
+          std::size_t slot =
+              std::find(lengths.begin(), lengths.end(), starts[k].length) -
+              lengths.begin();
+          edge.ship = static_cast<std::uint32_t>(ships_.size());
+          ships_.push_back(starts[k]);
+          positions_.push_back(static_cast<std::uint32_t>(
+              offsets[slot] + key.used / radices[slot] % (counts[slot] + 1)));
+        }
+        edges.push_back(edge);
+      }
+    }
+    layer_begin = layer_end;
+  }
+  // Every walk left after the last cell placed the whole fleet, so there is
+  // at most one node there.
+  std::size_t nodes = keys.size();
+  for (std::size_t node = layer_begin; node != nodes; ++node)
+    first_edges.push_back(static_cast<std::uint32_t>(edges.size()));
+  first_edges.push_back(static_cast<std::uint32_t>(edges.size()));
+  bool finished = nodes - layer_begin == 1 && keys.back().used == fleet;
+
+  // Count the fleets from every node, from the end back, and where a node
+  // has nothing to choose, skip to the next node that has.
+  std::vector<std::uint64_t> fleets(nodes, 0);
+  std::vector<std::uint32_t> skips(nodes);
+  if (finished) fleets[nodes - 1] = 1;
+  for (std::size_t node = nodes; node-- != 0;) {
+    skips[node] = static_cast<std::uint32_t>(node);
+    std::size_t live = 0;
+    Edge const *only = 0;
+    for (std::size_t i = first_edges[node]; i != first_edges[node + 1]; ++i) {
+      Edge &edge = edges[i];
+      edge.fleets = fleets[edge.target];
+      if (edge.fleets == 0) continue;
+      edge.target = skips[edge.target];
+      if (__builtin_add_overflow(fleets[node], edge.fleets, &fleets[node]))
+        return false;
+      ++live;
+      only = &edge;
+    }
+    if (live == 1 && only->ship == kNoShip) skips[node] = only->target;
+  }
+  fleets_ = fleets[0];
+  first_edges_.assign(1, 0);
+  if (fleets_ == 0) return true;
+
+  // Keep the nodes a fleet can go through, in order, from the first with a
+  // choice.
+  std::vector<std::uint32_t> ids(nodes, 0);
+  std::vector<bool> reached(nodes, false);
+  reached[skips[0]] = true;
+  std::uint32_t id = 0;
+  for (std::size_t node = skips[0]; node != nodes; ++node) {
+    if (!reached[node]) continue;
+    ids[node] = id++;
+    for (std::size_t i = first_edges[node]; i != first_edges[node + 1]; ++i)
+      if (edges[i].fleets != 0) reached[edges[i].target] = true;
+  }
+  std::vector<Ship> ships;
+  std::vector<std::uint32_t> positions;
+  for (std::size_t node = skips[0]; node != nodes; ++node) {
+    if (!reached[node]) continue;
+    for (std::size_t i = first_edges[node]; i != first_edges[node + 1]; ++i) {
+      Edge edge = edges[i];
+      if (edge.fleets == 0) continue;
+      edge.target = ids[edge.target];
+      if (edge.ship != kNoShip) {
+        ships.push_back(ships_[edge.ship]);
+        positions.push_back(positions_[edge.ship]);
+        edge.ship = static_cast<std::uint32_t>(ships.size() - 1);
+      }
+      edges_.push_back(edge);
+    }
+    first_edges_.push_back(static_cast<std::uint32_t>(edges_.size()));
+  }
+  ships_.swap(ships);
+  positions_.swap(positions);
+  return true;
+}
+
+// Return a new graph of a map size and a set sorted longest first, or null
+// if it cannot be built.
+LayoutGraph *LayoutGraph::Create(MapSize size, ShipSet set) {
+  std::unique_ptr<LayoutGraph> graph(new LayoutGraph(size, set));
+  return graph->Build() ? graph.release() : 0;
+}
+
+// Fill ships with the fleet of a rank below fleets(), in the order of the
+// set, longest first.
+void LayoutGraph::GetFleet(std::uint64_t rank, Ship *ships) const {
+  assert(rank < fleets_);
+  std::uint32_t last = static_cast<std::uint32_t>(nodes() - 1);
+  for (std::uint32_t node = 0; node != last;) {
+    Edge const *edge = &edges_[first_edges_[node]];
+    while (rank >= edge->fleets) rank -= edge++->fleets;
+    if (edge->ship != kNoShip)
+      ships[positions_[edge->ship]] = ships_[edge->ship];
+    node = edge->target;
+  }
+}
+
+}  // namespace battleship
@@ -0,0 +1,69 @@
+#ifndef BATTLESHIP_LAYOUT_GRAPH_H
+#define BATTLESHIP_LAYOUT_GRAPH_H
+
+#include "presets.hpp"
+#include "ship.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace battleship {
+
+// Every legal fleet of a map size and ship set as a path through a graph,
+// with the number of fleets through every node, so that a random number below
+// the number of fleets picks one fleet, each exactly once.
+//
+// The graph is built as PosteriorSolver counts: walking the cells in
+// row-major order and choosing which ship, if any, starts on each, with the
+// walks that leave the cells ahead covered the same way and the same ships
+// left merged into one node. Ships of equal length are not told apart, so
+// every layout is one path. Nodes that cannot finish a fleet are dropped and
+// runs of cells with nothing to choose are skipped, so drawing a fleet only
+// visits the cells where a choice is left. It still visits tens of nodes
+// spread over megabytes for a fleet, so drawing ships at random and starting
+// over on an overlap is faster unless nearly every draw overlaps. The graph
+// can only be built when the cells a vertical ship covers ahead fit a word
+// and the nodes fit a budget.
+class LayoutGraph {
+ private:
+  // A way out of a node: the node after it, the fleets through it and the
+  // ship it starts, as an index into ships_ or kNoShip.
+  struct Edge {
+    std::uint64_t fleets;
+    std::uint32_t target;
+    std::uint32_t ship;
+  };
+
+  static std::uint32_t const kNoShip = ~std::uint32_t(0);
+
+  MapSize size_;
+  // The lengths of the set, longest first.
+  std::vector<std::size_t> lengths_;
+  std::uint64_t fleets_;
+  // The edges of node i are first_edges_[i] to first_edges_[i + 1]. Node 0
+  // is the start and the last node the end of every fleet.
+  std::vector<std::uint32_t> first_edges_;
+  std::vector<Edge> edges_;
+  // The ship of an edge and where it goes in a fleet ordered as lengths_.
+  std::vector<Ship> ships_;
+  std::vector<std::uint32_t> positions_;
+
+  LayoutGraph(MapSize size, ShipSet set);
+  bool Build();
+
+  LayoutGraph(LayoutGraph const &);
+  LayoutGraph &operator=(LayoutGraph const &);
+
+ public:
+  static LayoutGraph *Create(MapSize size, ShipSet set);
+  void GetFleet(std::uint64_t rank, Ship *ships) const;
+
+  // Return the number of legal fleets.
+  std::uint64_t fleets() const { return fleets_; }
+
+  // Return the number of nodes.
+  std::size_t nodes() const { return first_edges_.size() - 1; }
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_LAYOUT_GRAPH_H
@@ -0,0 +1,359 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace battleship {
+
+namespace {
+
+char const *const kCounterNames[kCounterCount] = {
+    "placed", "overlap", "hit", "miss", "sunk", "retry"};
+char const *const kTimerNames[kTimerCount] = {"place", "attack", "move",
+                                              "turn"};
+
+// What one thread counted and timed. Only its thread writes to it, with
+// plain loads and stores of relaxed atomics, so writing costs what a plain
+// increment would and collecting from another thread is still defined.
+struct Shard {
+  struct Timer {
+    std::atomic<std::uint64_t> buckets[LatencyHistogram::kBuckets];
+    std::atomic<std::uint64_t> sum;
+    std::atomic<std::uint64_t> max;
+  };
+
+  std::atomic<std::uint64_t> counters[kCounterCount];
+  Timer timers[kTimerCount];
+};
+
+// The shards of the threads running, and what the threads that exited
+// counted. A thread's shard is merged into the totals and freed when the
+// thread exits, as WorkStealingPool::ParallelFor starts new threads on every
+// call and their shards would otherwise pile up.
+struct Registry {
+  std::mutex mutex;
+  std::vector<Shard *> shards;
+  Metrics retired;
+
+  Registry() {
+    for (std::size_t i = 0; i != kCounterCount; ++i) retired.counters[i] = 0;
+  }
+};
+
+// Owns the calling thread's shard and retires it when the thread exits.
+struct ShardOwner {
+  Shard *shard;
+
+  ~ShardOwner();
+};
+
+thread_local ShardOwner thread_shard = {0};
+
+// Return the registry. It is never destroyed, so threads may count while
+// the program exits.
+Registry &GetRegistry() {
+  static Registry *registry = new Registry;
+  return *registry;
+}
+
+// Add to a counter only this thread writes to.
+void Bump(std::atomic<std::uint64_t> &counter, std::uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+// Append a number to a string.
+void AppendNumber(std::string &out, std::uint64_t value) {
+  char buffer[24];
+  std::snprintf(buffer, sizeof(buffer), "%llu",
+                static_cast<unsigned long long>(value));
+  out += buffer;
+}
+
+// Append nanoseconds to a string as seconds.
+void AppendSeconds(std::string &out, std::uint64_t nanoseconds) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.9g", nanoseconds * 1e-9);
+  out += buffer;
+}
+
+// Return the calling thread's shard, registering it on first use.
+Shard &GetShard() {
+  if (thread_shard.shard) return *thread_shard.shard;
+  RegisterMetricsThread();
+  return *thread_shard.shard;
+}
+
+// Add what a shard counted and timed to metrics.
+void AddShard(Shard const &shard, Metrics &metrics) {
+  std::uint64_t counts[LatencyHistogram::kBuckets];
+  for (std::size_t i = 0; i != kCounterCount; ++i)
+    metrics.counters[i] += shard.counters[i].load(std::memory_order_relaxed);
+  for (std::size_t i = 0; i != kTimerCount; ++i) {
+    Shard::Timer const &timer = shard.timers[i];
+    for (std::size_t j = 0; j != LatencyHistogram::kBuckets; ++j)
+      counts[j] = timer.buckets[j].load(std::memory_order_relaxed);
+    metrics.timers[i].Merge(counts, timer.sum.load(std::memory_order_relaxed),
+                            timer.max.load(std::memory_order_relaxed));
+  }
+}
+
+// Move what the thread counted to the totals of the exited threads and free
+// its shard. Should the thread count again while exiting, it registers a new
+// shard, which is then never freed.
+ShardOwner::~ShardOwner() {
+  if (shard == 0) return;
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  AddShard(*shard, registry.retired);
+  std::vector<Shard *> &shards = registry.shards;
+  shards.erase(std::find(shards.begin(), shards.end(), shard));
+  delete shard;
+  shard = 0;
+  ThreadMetricCounters() = 0;
+}
+
+}  // namespace
+
+std::atomic<bool> metrics_timing(false);
+
+// Give the calling thread a shard and return its counters.
+std::atomic<std::uint64_t> *RegisterMetricsThread() {
+  if (thread_shard.shard) return thread_shard.shard->counters;
+  Shard *shard = new Shard;
+  for (std::size_t i = 0; i != kCounterCount; ++i)
+    shard->counters[i].store(0, std::memory_order_relaxed);
+  for (std::size_t i = 0; i != kTimerCount; ++i) {
+    Shard::Timer &timer = shard->timers[i];
+    for (std::size_t j = 0; j != LatencyHistogram::kBuckets; ++j)
+      timer.buckets[j].store(0, std::memory_order_relaxed);
+    timer.sum.store(0, std::memory_order_relaxed);
+    timer.max.store(0, std::memory_order_relaxed);
+  }
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.shards.push_back(shard);
+  thread_shard.shard = shard;
+  ThreadMetricCounters() = shard->counters;
+  return shard->counters;
+}
+
+std::size_t const LatencyHistogram::kSubBits;
+std::size_t const LatencyHistogram::kSubBuckets;
+std::size_t const LatencyHistogram::kBuckets;
+
+// Construct an empty histogram.
+LatencyHistogram::LatencyHistogram() { Clear(); }
+
+// Return the bucket of a value. Values below kSubBuckets have a bucket each,
+// the others share a bucket with the values that agree on their kSubBits + 1
+// highest bits.
+std::size_t LatencyHistogram::BucketOf(std::uint64_t value) {
+  if (value < kSubBuckets) return static_cast<std::size_t>(value);
+  std::size_t exponent = 63;
+  while ((value >> exponent) == 0) --exponent;
+  std::size_t shift = exponent - kSubBits;
+  std::size_t sub = static_cast<std::size_t>(value >> shift) &
+                    (kSubBuckets - 1);
+  return (shift + 1) * kSubBuckets + sub;
+}
+
+// Return the smallest value of a bucket.
+std::uint64_t LatencyHistogram::BucketLow(std::size_t bucket) {
+  if (bucket < kSubBuckets) return bucket;
+  std::size_t shift = bucket / kSubBuckets - 1;
+  return (kSubBuckets + bucket % kSubBuckets) << shift;
+}
+
+// Return the largest value of a bucket.
+std::uint64_t LatencyHistogram::BucketHigh(std::size_t bucket) {
+  if (bucket < kSubBuckets) return bucket;
+  std::size_t shift = bucket / kSubBuckets - 1;
+  return BucketLow(bucket) + ((std::uint64_t(1) << shift) - 1);
+}
+
+// Forget every value.
+void LatencyHistogram::Clear() {
+  for (std::size_t i = 0; i != kBuckets; ++i) counts_[i] = 0;
+  count_ = 0;
+  sum_ = 0;
+  max_ = 0;
+}
+
+// Count a value.
+void LatencyHistogram::Record(std::uint64_t value) {
+  ++counts_[BucketOf(value)];
+  ++count_;
+  sum_ += value;
+  if (value > max_) max_ = value;
+}
+
+// Count every value of another histogram.
+void LatencyHistogram::Merge(LatencyHistogram const &other) {
+  Merge(other.counts_, other.sum_, other.max_);
+}
+
+// Count values given as counts of each bucket, their sum and their maximum.
+void LatencyHistogram::Merge(std::uint64_t const *counts, std::uint64_t sum,
+                             std::uint64_t max) {
+  for (std::size_t i = 0; i != kBuckets; ++i) {
+    counts_[i] += counts[i];
+    count_ += counts[i];
+  }
+  sum_ += sum;
+  if (max > max_) max_ = max;
+}
+
+// Return a value at least as large as the given fraction of the values, to
+// within a bucket, or 0 if there are none.
+std::uint64_t LatencyHistogram::ValueAt(double quantile) const {
+  if (count_ == 0) return 0;
+  double rank = quantile * static_cast<double>(count_);
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i != kBuckets; ++i) {
+    seen += counts_[i];
+    if (seen != 0 && static_cast<double>(seen) >= rank) {
+      std::uint64_t high = BucketHigh(i);
+      return high < max_ ? high : max_;
+    }
+  }
+  return max_;
+}
+
+// Count how long an operation took.
+void RecordTime(MetricTimer timer, std::uint64_t nanoseconds) {
+  Shard::Timer &t = GetShard().timers[timer];
+  Bump(t.buckets[LatencyHistogram::BucketOf(nanoseconds)], 1);
+  Bump(t.sum, nanoseconds);
+  if (nanoseconds > t.max.load(std::memory_order_relaxed))
+    t.max.store(nanoseconds, std::memory_order_relaxed);
+}
+
+// Turn timing on or off for every thread.
+void SetMetricsTiming(bool on) {
+  metrics_timing.store(on, std::memory_order_relaxed);
+}
+
+// Sum what every thread counted and timed. Threads still running may be
+// counting meanwhile, so the sum is exact only once they stopped.
+void CollectMetrics(Metrics &metrics) {
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  metrics = registry.retired;
+  for (std::size_t s = 0, e = registry.shards.size(); s != e; ++s)
+    AddShard(*registry.shards[s], metrics);
+}
+
+// Format metrics as a JSON object: the count of every outcome, and for every
+// operation how many were timed, their total and longest time and a few
+// quantiles, in nanoseconds.
+std::string FormatMetricsJson(Metrics const &metrics) {
+  static double const kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+  static char const *const kQuantileNames[] = {"p50", "p90", "p99", "p999"};
+  std::string out = "{\n  \"counters\": {";
+  for (std::size_t i = 0; i != kCounterCount; ++i) {
+    out += i == 0 ? "\n    \"" : ",\n    \"";
+    out += kCounterNames[i];
+    out += "\": ";
+    AppendNumber(out, metrics.counters[i]);
+  }
+  out += "\n  },\n  \"timers\": {";
+  for (std::size_t i = 0; i != kTimerCount; ++i) {
+    LatencyHistogram const &histogram = metrics.timers[i];
+    out += i == 0 ? "\n    \"" : ",\n    \"";
+    out += kTimerNames[i];
+    out += "\": {\"count\": ";
+    AppendNumber(out, histogram.count());
+    out += ", \"sum_ns\": ";
+    AppendNumber(out, histogram.sum());
+    out += ", \"max_ns\": ";
+    AppendNumber(out, histogram.max());
+    for (std::size_t j = 0; j != 4; ++j) {
+      out += ", \"";
+      out += kQuantileNames[j];
+      out += "_ns\": ";
+      AppendNumber(out, histogram.ValueAt(kQuantiles[j]));
+    }
+    out += "}";
+  }
+  out += "\n  }\n}\n";
+  return out;
+}
+
+// Format metrics in the Prometheus text format: a counter of outcomes and a
+// histogram of durations in seconds, both labelled. The histogram's bounds
+// are the powers of two nanoseconds up to the longest time, coarser than
+// LatencyHistogram's buckets to keep the output short.
+std::string FormatMetricsPrometheus(Metrics const &metrics) {
+  std::string out =
+      "# HELP battleship_outcomes_total Ships placed and cells attacked, by "
+      "outcome.\n# TYPE battleship_outcomes_total counter\n";
+  for (std::size_t i = 0; i != kCounterCount; ++i) {
+    out += "battleship_outcomes_total{outcome=\"";
+    out += kCounterNames[i];
+    out += "\"} ";
+    AppendNumber(out, metrics.counters[i]);
+    out += "\n";
+  }
+  out +=
+      "# HELP battleship_duration_seconds Time taken, by operation.\n"
+      "# TYPE battleship_duration_seconds histogram\n";
+  for (std::size_t i = 0; i != kTimerCount; ++i) {
+    LatencyHistogram const &histogram = metrics.timers[i];
+    std::string labels = "{op=\"";
+    labels += kTimerNames[i];
+    labels += "\"";
+    std::uint64_t seen = 0;
+    std::size_t bucket = 0;
+    for (std::size_t shift = 0; shift != 64; ++shift) {
+      std::uint64_t bound = std::uint64_t(1) << shift;
+      for (; bucket != LatencyHistogram::kBuckets &&
+             LatencyHistogram::BucketHigh(bucket) <= bound;
+           ++bucket)
+        seen += histogram.bucket(bucket);
+      out += "battleship_duration_seconds_bucket";
+      out += labels;
+      out += ",le=\"";
+      AppendSeconds(out, bound);
+      out += "\"} ";
+      AppendNumber(out, seen);
+      out += "\n";
+      if (bound > histogram.max()) break;
+    }
+    out += "battleship_duration_seconds_bucket";
+    out += labels;
+    out += ",le=\"+Inf\"} ";
+    AppendNumber(out, histogram.count());
+    out += "\nbattleship_duration_seconds_sum";
+    out += labels;
+    out += "} ";
+    AppendSeconds(out, histogram.sum());
+    out += "\nbattleship_duration_seconds_count";
+    out += labels;
+    out += "} ";
+    AppendNumber(out, histogram.count());
+    out += "\n";
+  }
+  return out;
+}
+
+// Write metrics to a file, in the Prometheus text format if its name ends
+// in .prom and as JSON otherwise. Return whether it was written.
+bool WriteMetrics(std::string const &path, Metrics const &metrics) {
+  std::string const kPromSuffix = ".prom";
+  bool prometheus =
+      path.size() >= kPromSuffix.size() &&
+      path.compare(path.size() - kPromSuffix.size(), kPromSuffix.size(),
+                   kPromSuffix) == 0;
+  std::string text = prometheus ? FormatMetricsPrometheus(metrics)
+                                : FormatMetricsJson(metrics);
+  std::FILE *file = std::fopen(path.c_str(), "w");
+  if (file == 0) return false;
+  bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+  return std::fclose(file) == 0 && written;
+}
+
+}  // namespace battleship
@@ -0,0 +1,129 @@
+#include "move_worker.hpp"
+
+#include "metrics.hpp"
+
+#include <cassert>
+#include <utility>
+
+namespace battleship {
+
+// Run commands in order until the worker is destroyed.
+void MoveWorker::Work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    while (!stopping_ && commands_.empty()) wake_.wait(lock);
+    if (stopping_) return;
+    std::function<void()> command = commands_.front();
+    commands_.pop_front();
+    lock.unlock();
+    command();
+    lock.lock();
+  }
+}
+
+// Queue a command for the worker thread.
+void MoveWorker::Post(std::function<void()> const &command) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  commands_.push_back(command);
+  wake_.notify_one();
+}
+
+// Queue a request for count cells, or for a single attack if count is 0, and
+// return its number.
+std::uint64_t MoveWorker::Request(std::size_t count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::uint64_t request = ++requests_;
+  commands_.push_back(std::bind(&MoveWorker::Choose, this, request, count));
+  wake_.notify_one();
+  return request;
+}
+
+// Choose the cells of a request and hand them over, skipping both steps for a
+// cancelled request. The callback runs under the lock, so no move is handed
+// over once Cancel returns.
+void MoveWorker::Choose(std::uint64_t request, std::size_t count) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (request <= cancelled_) return;
+  }
+  std::vector<Cell> cells(count == 0 ? 1 : count);
+  {
+    ScopedTimer timer(kMoveTimer);
+    if (count == 0)
+      cells[0] = attacker_->NextAttack();
+    else
+      attacker_->NextSalvo(cells.data(), count);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (request > cancelled_) callback_(request, cells);
+}
+
+// Construct a worker running a player and start its thread.
+MoveWorker::MoveWorker(std::unique_ptr<Attacker> attacker,
+                       Callback const &callback)
+    : attacker_(std::move(attacker)),
+      callback_(callback),
+      requests_(0),
+      cancelled_(0),
+      stopping_(false) {
+  assert(attacker_);
+  thread_ = std::thread(&MoveWorker::Work, this);
+}
+
+// Drop what is queued and wait for the move being computed, if any.
+MoveWorker::~MoveWorker() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = requests_;
+    stopping_ = true;
+    wake_.notify_one();
+  }
+  thread_.join();
+}
+
+// Seed the player's random choices.
+void MoveWorker::Seed(unsigned seed) {
+  Attacker *attacker = attacker_.get();
+  Post([attacker, seed]() { attacker->Seed(seed); });
+}
+
+// Start a new game for the player. The ship set is copied.
+void MoveWorker::Init(MapSize size, ShipSet set) {
+  Attacker *attacker = attacker_.get();
+  std::vector<std::size_t> ships(set.first, set.last);
+  Post([attacker, size, ships]() mutable {
+    ShipSet copy = {ships.data(), ships.data() + ships.size()};
+    attacker->Init(size, copy);
+  });
+}
+
+// Tell the player the result of attacking a cell. The ship hit is copied, as
+// the board holding it may change before the worker gets to it.
+void MoveWorker::Observe(std::size_t x, std::size_t y,
+                         Board::AttackResult const &result) {
+  Attacker *attacker = attacker_.get();
+  Board::AttackType type = result.type;
+  bool has_ship = type == Board::kHit || type == Board::kSunk;
+  Ship ship = has_ship ? *result.ship : Ship();
+  Post([attacker, x, y, type, has_ship, ship]() {
+    Board::AttackResult copy = {type, has_ship ? &ship : 0};
+    attacker->Observe(x, y, copy);
+  });
+}
+
+// Ask for the player's next attack and return the number of the request.
+std::uint64_t MoveWorker::RequestAttack() { return Request(0); }
+
+// Ask for a salvo of count cells and return the number of the request.
+std::uint64_t MoveWorker::RequestSalvo(std::size_t count) {
+  assert(count != 0);
+  return Request(count);
+}
+
+// Drop every request made so far.
+void MoveWorker::Cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cancelled_ = requests_;
+}
+
+}  // namespace battleship
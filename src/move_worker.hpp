@@ -0,0 +1,65 @@
+#ifndef BATTLESHIP_MOVE_WORKER_H
+#define BATTLESHIP_MOVE_WORKER_H
+
+#include "attacker.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace battleship {
+
+// Runs a computer player on a thread of its own, so that a slow player never
+// blocks the thread asking for its moves. Only the worker touches the player:
+// seeding, starting games and observing results are queued in order with the
+// requests for moves, and every move chosen is handed to a callback on the
+// worker thread with the number of the request it answers.
+//
+// Cancel drops every request made so far. One that is being computed runs to
+// its end, but its move is never handed over, so the player may have chosen a
+// cell whose result it will not see: Init must follow before the next request.
+class MoveWorker {
+ public:
+  // Called with a request and the cells chosen for it.
+  typedef std::function<void(std::uint64_t, std::vector<Cell> const &)>
+      Callback;
+
+ private:
+  std::unique_ptr<Attacker> attacker_;
+  Callback callback_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::function<void()> > commands_;
+  // The last request made and the last one cancelled.
+  std::uint64_t requests_;
+  std::uint64_t cancelled_;
+  bool stopping_;
+  std::thread thread_;
+
+  MoveWorker(MoveWorker const &);
+  MoveWorker &operator=(MoveWorker const &);
+
+  void Work();
+  void Post(std::function<void()> const &command);
+  std::uint64_t Request(std::size_t count);
+  void Choose(std::uint64_t request, std::size_t count);
+
+ public:
+  MoveWorker(std::unique_ptr<Attacker> attacker, Callback const &callback);
+  ~MoveWorker();
+  void Seed(unsigned seed);
+  void Init(MapSize size, ShipSet set);
+  void Observe(std::size_t x, std::size_t y, Board::AttackResult const &result);
+  std::uint64_t RequestAttack();
+  std::uint64_t RequestSalvo(std::size_t count);
+  void Cancel();
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_MOVE_WORKER_H
@@ -0,0 +1,246 @@
+#include "opening_book.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace battleship {
+
+// The bytes of the header before the ship lengths, and of a slot.
+static std::size_t const kBookHeaderSize = 28;
+static std::size_t const kBookSlotSize = 16;
+
+// Scramble a value into a hash, as in splitmix64.
+static std::uint64_t Mix(std::uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// Append a value as little endian bytes.
+static void Put32(std::uint32_t value, std::vector<std::uint8_t> &out) {
+  for (std::size_t i = 0; i != 4; ++i)
+    out.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+}
+
+// Append a value as little endian bytes.
+static void Put64(std::uint64_t value, std::vector<std::uint8_t> &out) {
+  for (std::size_t i = 0; i != 8; ++i)
+    out.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+}
+
+// Read little endian bytes.
+static std::uint32_t Load32(std::uint8_t const *data) {
+  std::uint32_t value = 0;
+  for (std::size_t i = 0; i != 4; ++i)
+    value |= static_cast<std::uint32_t>(data[i]) << (8 * i);
+  return value;
+}
+
+// Read little endian bytes.
+static std::uint64_t Load64(std::uint8_t const *data) {
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i != 8; ++i)
+    value |= static_cast<std::uint64_t>(data[i]) << (8 * i);
+  return value;
+}
+
+// Add an observation to a key. A sunk ship is told apart by where it lies.
+std::uint64_t BookKey(std::uint64_t key, MapSize size, std::size_t x,
+                      std::size_t y, Board::AttackResult const &result) {
+  if (result.type == Board::kRetry) return key;
+  std::uint64_t cell = y * size.x + x;
+  std::uint64_t hash = Mix((cell * 4 + result.type) * 0x9e3779b97f4a7c15ULL);
+  if (result.type == Board::kSunk) {
+    Ship const &ship = *result.ship;
+    std::uint64_t start = ship.y * size.x + ship.x;
+    hash = Mix(hash ^ ((start * 2 + ship.orientation) << 16 | ship.length));
+  }
+  return key ^ hash;
+}
+
+// Write a book of entries with distinct keys. Return false if the file
+// cannot be written.
+bool WriteOpeningBook(char const *path, MapSize size, ShipSet set,
+                      std::size_t depth, std::string const &strategy,
+                      std::vector<BookEntry> const &entries) {
+  std::vector<std::size_t> lengths(set.first, set.last);
+  std::sort(lengths.begin(), lengths.end());
+
+  std::vector<std::uint8_t> out(kBookMagic, kBookMagic + sizeof(kBookMagic));
+  out.push_back(kBookVersion);
+  out.resize(out.size() + 3, 0);
+  Put32(static_cast<std::uint32_t>(size.x), out);
+  Put32(static_cast<std::uint32_t>(size.y), out);
+  Put32(static_cast<std::uint32_t>(depth), out);
+  Put32(static_cast<std::uint32_t>(lengths.size()), out);
+  Put32(static_cast<std::uint32_t>(strategy.size()), out);
+  for (std::size_t i = 0, e = lengths.size(); i != e; ++i)
+    Put32(static_cast<std::uint32_t>(lengths[i]), out);
+  out.insert(out.end(), strategy.begin(), strategy.end());
+  out.resize((out.size() + 7) / 8 * 8, 0);
+
+  // At most half the slots are used, so probes stay short.
+  std::uint64_t slots = 16;
+  while (slots < 2 * entries.size()) slots *= 2;
+  Put64(slots, out);
+  std::size_t table = out.size();
+  for (std::uint64_t i = 0; i != slots; ++i) {
+    Put64(0, out);
+    Put32(kBookNoCell, out);
+    Put32(0, out);
+  }
+  for (std::size_t i = 0, e = entries.size(); i != e; ++i) {
+    std::uint64_t slot = entries[i].key & (slots - 1);
+    while (Load32(&out[table + slot * kBookSlotSize + 8]) != kBookNoCell)
+      slot = (slot + 1) & (slots - 1);
+    std::uint8_t *it = &out[table + slot * kBookSlotSize];
+    for (std::size_t j = 0; j != 8; ++j)
+      it[j] = static_cast<std::uint8_t>(entries[i].key >> (8 * j));
+    for (std::size_t j = 0; j != 4; ++j)
+      it[8 + j] = static_cast<std::uint8_t>(entries[i].cell >> (8 * j));
+  }
+
+  std::FILE *file = std::fopen(path, "wb");
+  if (file == 0) return false;
+  bool ok = std::fwrite(&out[0], 1, out.size(), file) == out.size();
+  return std::fclose(file) == 0 && ok;
+}
+
+// Construct a book with no file open.
+OpeningBook::OpeningBook()
+    : data_(0), size_(0), depth_(0), slots_(0), mask_(0) {
+  map_size_.x = 0;
+  map_size_.y = 0;
+}
+
+// Unmap the file.
+OpeningBook::~OpeningBook() { Close(); }
+
+// Map a book file and check its header. Return false if it cannot be read
+// or is not a book of a version we know.
+bool OpeningBook::Open(char const *path) {
+  Close();
+#ifdef _WIN32
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  buffer_.assign(std::istreambuf_iterator<char>(file),
+                 std::istreambuf_iterator<char>());
+  data_ = buffer_.empty() ? 0 : &buffer_[0];
+  size_ = buffer_.size();
+#else
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat info;
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    return false;
+  }
+  size_ = static_cast<std::size_t>(info.st_size);
+  if (size_ != 0) {
+    void *data = ::mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      ::close(fd);
+      size_ = 0;
+      return false;
+    }
+    // Lookups jump around the table.
+    ::madvise(data, size_, MADV_RANDOM);
+    data_ = static_cast<std::uint8_t const *>(data);
+  }
+  ::close(fd);
+#endif
+
+  if (size_ < kBookHeaderSize ||
+      std::memcmp(data_, kBookMagic, sizeof(kBookMagic)) != 0 ||
+      data_[sizeof(kBookMagic)] != kBookVersion) {
+    Close();
+    return false;
+  }
+  std::uint64_t ships = Load32(data_ + 20);
+  std::uint64_t name = Load32(data_ + 24);
+  std::uint64_t table = (kBookHeaderSize + 4 * ships + name + 7) / 8 * 8;
+  if (table + 8 > size_) {
+    Close();
+    return false;
+  }
+  std::uint64_t slots = Load64(data_ + table);
+  if (slots == 0 || (slots & (slots - 1)) != 0 ||
+      slots > (size_ - table - 8) / kBookSlotSize ||
+      table + 8 + slots * kBookSlotSize != size_) {
+    Close();
+    return false;
+  }
+
+  map_size_.x = Load32(data_ + 8);
+  map_size_.y = Load32(data_ + 12);
+  depth_ = Load32(data_ + 16);
+  for (std::size_t i = 0; i != ships; ++i)
+    lengths_.push_back(Load32(data_ + kBookHeaderSize + 4 * i));
+  char const *text =
+      reinterpret_cast<char const *>(data_ + kBookHeaderSize + 4 * ships);
+  strategy_.assign(text, name);
+  slots_ = data_ + table + 8;
+  mask_ = slots - 1;
+  return true;
+}
+
+// Unmap the file.
+void OpeningBook::Close() {
+#ifdef _WIN32
+  buffer_.clear();
+#else
+  if (data_ != 0) ::munmap(const_cast<std::uint8_t *>(data_), size_);
+#endif
+  data_ = 0;
+  size_ = 0;
+  map_size_.x = 0;
+  map_size_.y = 0;
+  lengths_.clear();
+  depth_ = 0;
+  strategy_.clear();
+  slots_ = 0;
+  mask_ = 0;
+}
+
+// Return whether the book was built for a map size and ship set, in any
+// order.
+bool OpeningBook::Matches(MapSize size, ShipSet set) const {
+  if (slots_ == 0 || size.x != map_size_.x || size.y != map_size_.y)
+    return false;
+  std::vector<std::size_t> lengths(set.first, set.last);
+  std::sort(lengths.begin(), lengths.end());
+  return lengths == lengths_;
+}
+
+// Find the attack for a set of observations. Return false if the book does
+// not have it.
+bool OpeningBook::Find(std::uint64_t key, Cell &cell) const {
+  if (slots_ == 0) return false;
+  std::uint64_t slot = key & mask_;
+  for (std::uint64_t probes = 0; probes <= mask_; ++probes) {
+    std::uint8_t const *it = slots_ + slot * kBookSlotSize;
+    std::uint32_t index = Load32(it + 8);
+    if (index == kBookNoCell) return false;
+    if (Load64(it) == key) {
+      if (index >= map_size_.x * map_size_.y) return false;
+      cell.x = index % map_size_.x;
+      cell.y = index / map_size_.x;
+      return true;
+    }
+    slot = (slot + 1) & mask_;
+  }
+  return false;
+}
+
+}  // namespace battleship
@@ -0,0 +1,79 @@
+#ifndef BATTLESHIP_OPENING_BOOK_H
+#define BATTLESHIP_OPENING_BOOK_H
+
+#include "board.hpp"
+#include "presets.hpp"
+#include "ship.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace battleship {
+
+// The attack a strategy chose after a set of observations, keyed by
+// BookKey. Cells are y * width + x.
+struct BookEntry {
+  std::uint64_t key;
+  std::uint32_t cell;
+};
+
+// A book file is the magic "BSOB", a format version byte and three zero
+// bytes, then the little endian 32 bit width, height, depth, number of ships
+// and length of the strategy name, the sorted ship lengths and the name,
+// padded with zeros to 8 bytes. An open addressing table follows: its 64 bit
+// number of slots, a power of two, and the slots, each a 64 bit key and the
+// 32 bit cell, or kBookNoCell if the slot is empty, and 32 zero bits.
+static std::uint8_t const kBookMagic[4] = {'B', 'S', 'O', 'B'};
+static std::uint8_t const kBookVersion = 1;
+static std::uint32_t const kBookNoCell = 0xffffffff;
+
+// Add an observation to the key of the set of observations made before it.
+// Keys are the xor of a hash of every observation, so the order in which
+// they were made does not matter, and the empty set is 0. Retries are not
+// observations.
+std::uint64_t BookKey(std::uint64_t key, MapSize size, std::size_t x,
+                      std::size_t y, Board::AttackResult const &result);
+
+bool WriteOpeningBook(char const *path, MapSize size, ShipSet set,
+                      std::size_t depth, std::string const &strategy,
+                      std::vector<BookEntry> const &entries);
+
+// The first attacks of a strategy for one map size and ship set, precomputed
+// for every set of observations the strategy can meet in its first depth
+// attacks. The file is mapped into memory and looked up in place, so opening
+// it costs nothing per entry and a lookup is a probe or two of the table.
+class OpeningBook {
+ private:
+  std::uint8_t const *data_;
+  std::size_t size_;
+  MapSize map_size_;
+  std::vector<std::size_t> lengths_;
+  std::size_t depth_;
+  std::string strategy_;
+  std::uint8_t const *slots_;
+  std::uint64_t mask_;
+#ifdef _WIN32
+  // Without mmap the whole file is read into memory instead.
+  std::vector<std::uint8_t> buffer_;
+#endif
+
+  OpeningBook(OpeningBook const &);
+  OpeningBook &operator=(OpeningBook const &);
+
+ public:
+  OpeningBook();
+  ~OpeningBook();
+  bool Open(char const *path);
+  void Close();
+  bool Matches(MapSize size, ShipSet set) const;
+  bool Find(std::uint64_t key, Cell &cell) const;
+
+  MapSize map_size() const { return map_size_; }
+  std::vector<std::size_t> const &lengths() const { return lengths_; }
+  std::size_t depth() const { return depth_; }
+  std::string const &strategy() const { return strategy_; }
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_OPENING_BOOK_H
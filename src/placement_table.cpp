@@ -0,0 +1,177 @@
+#include "placement_table.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BATTLESHIP_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace battleship {
+
+// Signature of the loops filtering placements against the words of a plane.
+typedef std::size_t (*FilterFunction)(std::uint64_t const *cells,
+                                      std::uint8_t const *words,
+                                      std::uint64_t const *masks,
+                                      std::size_t first, std::size_t last,
+                                      std::uint32_t *out);
+
+// Filter one placement at a time. Every index is written and the output
+// position only advances past legal ones, so the loop has no branch.
+static std::size_t FilterScalar(std::uint64_t const *cells,
+                                std::uint8_t const *words,
+                                std::uint64_t const *masks, std::size_t first,
+                                std::size_t last, std::uint32_t *out) {
+  std::size_t count = 0;
+  for (std::size_t i = first; i != last; ++i) {
+    out[count] = static_cast<std::uint32_t>(i);
+    count += (cells[words[i]] & masks[i]) == 0;
+  }
+  return count;
+}
+
+#ifdef BATTLESHIP_X86_KERNELS
+
+// Filter eight placements per step. The compiler leaves the scalar loop alone
+// because its stores depend on the count, so the words are gathered and
+// tested four to a register, the results compared into a bit mask, and pdep
+// and pext turn the mask into the order that packs the legal indexes to the
+// front of a register. All eight are stored and count only advances past the
+// legal ones, so out needs no more room than the scalar loop.
+__attribute__((target("avx2,bmi2,popcnt"))) static std::size_t FilterAvx2(
+    std::uint64_t const *cells, std::uint8_t const *words,
+    std::uint64_t const *masks, std::size_t first, std::size_t last,
+    std::uint32_t *out) {
+  long long const *base = reinterpret_cast<long long const *>(cells);
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i const steps = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  std::size_t count = 0;
+  std::size_t i = first;
+  for (; i + 8 <= last; i += 8) {
+    __m256i index = _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<__m128i const *>(words + i)));
+    __m256i low = _mm256_i32gather_epi64(
+        base, _mm256_castsi256_si128(index), 8);
+    __m256i high = _mm256_i32gather_epi64(
+        base, _mm256_extracti128_si256(index, 1), 8);
+    low = _mm256_and_si256(
+        low, _mm256_loadu_si256(reinterpret_cast<__m256i const *>(masks + i)));
+    high = _mm256_and_si256(
+        high,
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(masks + i + 4)));
+    unsigned legal =
+        static_cast<unsigned>(_mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpeq_epi64(low, zero)))) |
+        static_cast<unsigned>(_mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpeq_epi64(high, zero))))
+            << 4;
+
+    // Spread the mask to one byte per placement and pick out the positions
+    // of the legal ones, lowest first.
+    std::uint64_t bytes = _pdep_u64(legal, 0x0101010101010101ULL) * 0xff;
+    std::uint64_t order = _pext_u64(0x0706050403020100ULL, bytes);
+    __m256i indexes =
+        _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), steps);
+    __m256i packed = _mm256_permutevar8x32_epi32(
+        indexes, _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(
+                     static_cast<long long>(order))));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + count), packed);
+    count += static_cast<std::size_t>(_mm_popcnt_u32(legal));
+  }
+  return count + FilterScalar(cells, words, masks, i, last, out + count);
+}
+
+#endif  // #ifdef BATTLESHIP_X86_KERNELS
+
+// Return the fastest filter this processor runs.
+static FilterFunction ChooseFilter() {
+#ifdef BATTLESHIP_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") &&
+      __builtin_cpu_supports("popcnt"))
+    return FilterAvx2;
+#endif
+  return FilterScalar;
+}
+
+// Return the mask of a run of cells starting at a cell of a row.
+static std::uint64_t RunMask(std::size_t x, std::size_t y, std::size_t length) {
+  return ((std::uint64_t(1) << length) - 1) * Bitboard::BitOf(x, y);
+}
+
+// Build every placement of a ship length.
+PlacementTable::PlacementTable(std::size_t x_size, std::size_t y_size,
+                               std::size_t length)
+    : length_(length) {
+  // Horizontal placements are runs along a row of the row-major plane.
+  for (std::size_t y = 0; length <= x_size && y != y_size; ++y)
+    for (std::size_t x = 0; x + length <= x_size; ++x)
+      Add(x, y, Bitboard::WordOf(x, y), RunMask(x, y, length));
+  vertical_ = size();
+
+  // Vertical placements are runs along a row of the column-major plane,
+  // single cells were already added.
+  for (std::size_t x = 0; length != 1 && length <= y_size && x != x_size; ++x)
+    for (std::size_t y = 0; y + length <= y_size; ++y)
+      Add(x, y, Bitboard::WordOf(y, x), RunMask(y, x, length));
+}
+
+// Append a placement.
+void PlacementTable::Add(std::size_t x, std::size_t y, std::size_t word,
+                         std::uint64_t mask) {
+  xs_.push_back(static_cast<std::uint8_t>(x));
+  ys_.push_back(static_cast<std::uint8_t>(y));
+  words_.push_back(static_cast<std::uint8_t>(word));
+  masks_.push_back(mask);
+}
+
+// Write the indexes in [first, last) of the placements sharing no cell with a
+// plane to out and return how many there are.
+std::size_t PlacementTable::Filter(Bitboard const &cells, std::size_t first,
+                                   std::size_t last, std::uint32_t *out) const {
+  static FilterFunction const filter = ChooseFilter();
+  if (first == last) return 0;
+  std::uint64_t words[Bitboard::kWords];
+  for (std::size_t i = 0; i != Bitboard::kWords; ++i) words[i] = cells.word(i);
+  return filter(words, &words_[0], &masks_[0], first, last, out);
+}
+
+// Return the table for a board size and ship length. Tables are built on first
+// use and shared by every caller for the rest of the program, so keep the
+// reference rather than looking it up in a hot loop.
+PlacementTable const &PlacementTable::Get(std::size_t x_size,
+                                          std::size_t y_size,
+                                          std::size_t length) {
+  assert(x_size <= Bitboard::kMaxWidth && y_size <= Bitboard::kMaxHeight);
+  assert(Bitboard::kMaxWidth == Bitboard::kMaxHeight);
+  typedef std::map<std::size_t, std::unique_ptr<PlacementTable> > Cache;
+  static std::mutex mutex;
+  static Cache cache;
+
+  std::size_t key = (x_size * (Bitboard::kMaxHeight + 1) + y_size) *
+                        (Bitboard::kMaxWidth + Bitboard::kMaxHeight + 1) +
+                    length;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::unique_ptr<PlacementTable> &table = cache[key];
+  if (!table) table.reset(new PlacementTable(x_size, y_size, length));
+  return *table;
+}
+
+// Write the indexes of the placements sharing no cell with a set to out and
+// return how many there are. out must have room for size() indexes.
+std::size_t PlacementTable::Filter(Bitboard const &rows,
+                                   Bitboard const &columns,
+                                   std::uint32_t *out) const {
+  std::size_t count = Filter(rows, 0, vertical_, out);
+  return count + Filter(columns, vertical_, size(), out + count);
+}
+
+// Same as above for a set only given in row-major order.
+std::size_t PlacementTable::Filter(Bitboard const &cells,
+                                   std::uint32_t *out) const {
+  return Filter(cells, cells.Transposed(), out);
+}
+
+}  // namespace battleship
@@ -0,0 +1,85 @@
+#ifndef BATTLESHIP_PLACEMENT_TABLE_H
+#define BATTLESHIP_PLACEMENT_TABLE_H
+
+#include "bitboard.hpp"
+#include "ship.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace battleship {
+
+// Every placement of a ship length on a board size. A placement is a run of
+// cells inside one word: horizontal placements are masks over a row-major
+// Bitboard and vertical placements masks over the transposed, column-major
+// Bitboard. Horizontal placements come first. The tables are stored as
+// separate arrays so filtering them is a tight branchless loop, eight
+// placements a step where AVX2 is available.
+class PlacementTable {
+ private:
+  std::size_t length_;
+  // Index of the first vertical placement.
+  std::size_t vertical_;
+  std::vector<std::uint8_t> xs_;
+  std::vector<std::uint8_t> ys_;
+  std::vector<std::uint8_t> words_;
+  std::vector<std::uint64_t> masks_;
+
+  PlacementTable(std::size_t x_size, std::size_t y_size, std::size_t length);
+  void Add(std::size_t x, std::size_t y, std::size_t word, std::uint64_t mask);
+  std::size_t Filter(Bitboard const &cells, std::size_t first,
+                     std::size_t last, std::uint32_t *out) const;
+
+ public:
+  static PlacementTable const &Get(std::size_t x_size, std::size_t y_size,
+                                   std::size_t length);
+
+  // Return the number of placements.
+  std::size_t size() const { return masks_.size(); }
+
+  // Return the ship of a placement.
+  Ship GetShip(std::size_t i) const {
+    Ship ship;
+    ship.orientation = i < vertical_ ? Ship::kHorizontal : Ship::kVertical;
+    ship.x = xs_[i];
+    ship.y = ys_[i];
+    ship.length = length_;
+    return ship;
+  }
+
+  // Return whether a placement shares a cell with a set, given as both its
+  // row-major and its transposed planes.
+  bool Intersects(std::size_t i, Bitboard const &rows,
+                  Bitboard const &columns) const {
+    Bitboard const &cells = i < vertical_ ? rows : columns;
+    return (cells.word(words_[i]) & masks_[i]) != 0;
+  }
+
+  // Return how many cells of a placement are in a set.
+  std::size_t Overlap(std::size_t i, Bitboard const &rows,
+                      Bitboard const &columns) const {
+    Bitboard const &cells = i < vertical_ ? rows : columns;
+    return Bitboard::CountBits(cells.word(words_[i]) & masks_[i]);
+  }
+
+  // Add the cells of a placement to both planes of a set.
+  void Set(std::size_t i, Bitboard &rows, Bitboard &columns) const {
+    Ship ship = GetShip(i);
+    rows.SetShip(ship);
+    columns.SetShip(Transposed(ship));
+  }
+
+  // Remove the cells of a placement from both planes of a set.
+  void Reset(std::size_t i, Bitboard &rows, Bitboard &columns) const {
+    Ship ship = GetShip(i);
+    rows.ResetShip(ship);
+    columns.ResetShip(Transposed(ship));
+  }
+
+  std::size_t Filter(Bitboard const &rows, Bitboard const &columns,
+                     std::uint32_t *out) const;
+  std::size_t Filter(Bitboard const &cells, std::uint32_t *out) const;
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_PLACEMENT_TABLE_H
@@ -0,0 +1,76 @@
+#include "posterior_attacker.hpp"
+
+#include <cassert>
+
+namespace battleship {
+
+// Construct an attacker spending about budget per turn, call Init before
+// playing.
+PosteriorAttacker::PosteriorAttacker(unsigned seed,
+                                     PosteriorSolver::Clock::duration budget)
+    : solver_(seed), budget_(budget), x_size_(0), y_size_(0), random_(seed) {}
+
+// Restart the random sequences used for sampling and breaking ties.
+void PosteriorAttacker::Seed(unsigned seed) {
+  solver_.Seed(seed);
+  random_.seed(seed);
+}
+
+// Start a new game.
+void PosteriorAttacker::Init(MapSize size, ShipSet set) {
+  x_size_ = size.x;
+  y_size_ = size.y;
+  picked_.Init(size.x, size.y);
+  solver_.Init(size, set);
+}
+
+// Return the cell neither attacked nor picked with the highest probability,
+// breaking ties at random.
+Cell PosteriorAttacker::PickBest() {
+  Cell best = {0, 0};
+  double best_probability = -1;
+  std::size_t ties = 0;
+  for (std::size_t y = 0; y != y_size_; ++y) {
+    for (std::size_t x = 0; x != x_size_; ++x) {
+      if (solver_.attacked(x, y) || picked_.Test(x, y)) continue;
+      double probability = solver_.probability(x, y);
+      if (probability < best_probability) continue;
+      if (probability > best_probability) {
+        best_probability = probability;
+        ties = 0;
+      }
+      // Keep each of the tied cells with equal probability.
+      ++ties;
+      if (random_() % ties == 0) {
+        best.x = x;
+        best.y = y;
+      }
+    }
+  }
+  assert(ties != 0);
+  return best;
+}
+
+// Attack the unattacked cell with the highest probability.
+Cell PosteriorAttacker::NextAttack() {
+  solver_.Solve(budget_);
+  return PickBest();
+}
+
+// Attack the count most likely cells, solving once for the whole salvo.
+void PosteriorAttacker::NextSalvo(Cell *cells, std::size_t count) {
+  solver_.Solve(budget_);
+  for (std::size_t i = 0; i != count; ++i) {
+    cells[i] = PickBest();
+    picked_.Set(cells[i].x, cells[i].y);
+  }
+  picked_.Clear();
+}
+
+// Pass the result of an attack to the solver.
+void PosteriorAttacker::Observe(std::size_t x, std::size_t y,
+                                Board::AttackResult const &result) {
+  solver_.Observe(x, y, result);
+}
+
+}  // namespace battleship
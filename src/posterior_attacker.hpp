@@ -0,0 +1,39 @@
+#ifndef BATTLESHIP_POSTERIOR_ATTACKER_H
+#define BATTLESHIP_POSTERIOR_ATTACKER_H
+
+#include "attacker.hpp"
+#include "bit_grid.hpp"
+#include "posterior_solver.hpp"
+
+#include <random>
+
+namespace battleship {
+
+// A computer player that attacks the cell most likely to hold a ship given
+// everything it has seen, as computed by a PosteriorSolver on every turn. It
+// is the strongest and slowest attacker, meant as a reference for the others.
+class PosteriorAttacker : public Attacker {
+ private:
+  PosteriorSolver solver_;
+  PosteriorSolver::Clock::duration budget_;
+  std::size_t x_size_;
+  std::size_t y_size_;
+  std::mt19937 random_;
+  // Cells of the salvo being chosen.
+  BitGrid picked_;
+
+  Cell PickBest();
+
+ public:
+  explicit PosteriorAttacker(
+      unsigned seed = 0,
+      PosteriorSolver::Clock::duration budget = std::chrono::milliseconds(20));
+  void Seed(unsigned seed);
+  void Init(MapSize size, ShipSet set);
+  Cell NextAttack();
+  void NextSalvo(Cell *cells, std::size_t count);
+  void Observe(std::size_t x, std::size_t y, Board::AttackResult const &result);
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_POSTERIOR_ATTACKER_H
@@ -0,0 +1,478 @@
+#include "posterior_solver.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace battleship {
+
+// Steps between two looks at the clock.
+static std::uint64_t const kClockInterval = 4096;
+// States kept at once before counting gives up, bounding its memory to about
+// 170 bytes a state. The empty 10x10 board with five ships keeps 3.9 million.
+static std::size_t const kMaxStates = std::size_t(1) << 23;
+// Samples drawn when counting gives up.
+static std::uint64_t const kSamples = 20000;
+// Cell of a free slot of a StateMap, past any board.
+static std::uint32_t const kFree = ~std::uint32_t(0);
+
+// Return whether two states are the same point of the walk.
+bool PosteriorSolver::State::operator==(State const &other) const {
+  return cell == other.cell && used == other.used &&
+         std::equal(window, window + kWindowWords, other.window);
+}
+
+// Return the slot holding a state or the free slot it would go to.
+std::size_t PosteriorSolver::StateMap::Find(State const &state) const {
+  std::uint64_t hash = (std::uint64_t(state.cell) << 32) | state.used;
+  for (std::size_t i = 0; i != kWindowWords; ++i) {
+    hash = (hash ^ state.window[i]) * 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+  }
+  std::size_t mask = entries_.size() - 1;
+  for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask)
+    if (entries_[slot].state.cell == kFree || entries_[slot].state == state)
+      return slot;
+}
+
+// Double the slots and insert the states again.
+void PosteriorSolver::StateMap::Grow() {
+  std::vector<Entry> entries(entries_.size() * 2);
+  for (std::size_t i = 0, e = entries.size(); i != e; ++i)
+    entries[i].state.cell = kFree;
+  entries_.swap(entries);
+  for (std::size_t i = 0, e = used_.size(); i != e; ++i) {
+    std::size_t slot = Find(entries[used_[i]].state);
+    entries_[slot] = entries[used_[i]];
+    used_[i] = slot;
+  }
+}
+
+// Construct an empty map.
+PosteriorSolver::StateMap::StateMap() : entries_(16) {
+  for (std::size_t i = 0, e = entries_.size(); i != e; ++i)
+    entries_[i].state.cell = kFree;
+}
+
+// Remove all states, keeping the slots.
+void PosteriorSolver::StateMap::Clear() {
+  for (std::size_t i = 0, e = used_.size(); i != e; ++i)
+    entries_[used_[i]].state.cell = kFree;
+  used_.clear();
+}
+
+// Make room for a number of states without growing.
+void PosteriorSolver::StateMap::Reserve(std::size_t states) {
+  std::size_t slots = entries_.size();
+  while (2 * states > slots) slots *= 2;
+  if (slots == entries_.size()) return;
+  entries_.resize(slots / 2);
+  Grow();
+}
+
+// Return the entry of a state or null if it is not in the map.
+PosteriorSolver::Entry const *PosteriorSolver::StateMap::Get(
+    State const &state) const {
+  Entry const &entry = entries_[Find(state)];
+  return entry.state.cell == kFree ? 0 : &entry;
+}
+
+// Return the entry of a state, inserting it with no ways if it is new.
+PosteriorSolver::Entry &PosteriorSolver::StateMap::operator[](
+    State const &state) {
+  std::size_t slot = Find(state);
+  if (entries_[slot].state.cell == kFree) {
+    if (2 * (used_.size() + 1) > entries_.size()) {
+      Grow();
+      slot = Find(state);
+    }
+    entries_[slot].state = state;
+    entries_[slot].count = 0;
+    used_.push_back(slot);
+  }
+  return entries_[slot];
+}
+
+// Return whether the solve ran out of time, only looking at the clock now and
+// then.
+bool PosteriorSolver::Expired() {
+  if (!expired_ && ++steps_ % kClockInterval == 0)
+    expired_ = Clock::now() > deadline_;
+  return expired_;
+}
+
+// Gather the ships afloat and where each may start. Return false if their
+// windows do not fit a state.
+bool PosteriorSolver::Prepare() {
+  lengths_.clear();
+  counts_.clear();
+  for (std::size_t i = 0, e = afloat_.size(); i != e; ++i) {
+    if (i != 0 && afloat_[i] == afloat_[i - 1]) {
+      ++counts_.back();
+    } else {
+      lengths_.push_back(afloat_[i]);
+      counts_.push_back(1);
+    }
+  }
+
+  std::size_t cells = x_size_ * y_size_;
+  std::size_t slots = lengths_.size();
+  Bitboard blocked_columns = blocked_.Transposed();
+  Bitboard hit_columns = open_hits_.Transposed();
+  tables_.resize(slots);
+  candidates_.resize(slots);
+  radices_.resize(slots);
+  starts_.assign(slots * cells, 0);
+  last_starts_.assign(slots, 0);
+  columns_.resize(slots);
+  moves_.resize(1 + 2 * slots);
+
+  std::size_t radix = 1;
+  bool fits = true;
+  fleet_ = 0;
+  for (std::size_t slot = 0; slot != slots; ++slot) {
+    std::size_t length = lengths_[slot];
+    PlacementTable const &table = PlacementTable::Get(x_size_, y_size_, length);
+    tables_[slot] = &table;
+    radices_[slot] = radix;
+    fleet_ += static_cast<std::uint32_t>(counts_[slot] * radix);
+    radix *= counts_[slot] + 1;
+    // The ships used must fit a state.
+    if (radix > std::numeric_limits<std::uint32_t>::max()) fits = false;
+
+    // A ship with every cell hit would have been reported sunk.
+    std::vector<std::uint32_t> &candidates = candidates_[slot];
+    candidates.resize(table.size());
+    candidates.resize(
+        table.Filter(blocked_, blocked_columns, candidates.data()));
+    std::size_t kept = 0;
+    for (std::size_t k = 0, e = candidates.size(); k != e; ++k) {
+      std::size_t i = candidates[k];
+      if (table.Overlap(i, open_hits_, hit_columns) == length) continue;
+      candidates[kept++] = static_cast<std::uint32_t>(i);
+      Ship ship = table.GetShip(i);
+      std::size_t cell = ship.y * x_size_ + ship.x;
+      starts_[slot * cells + cell] |= ship.orientation == Ship::kHorizontal
+                                          ? 1
+                                          : 2;
+      last_starts_[slot] = std::max(last_starts_[slot], cell);
+    }
+    candidates.resize(kept);
+
+    State &column = columns_[slot];
+    std::fill(column.window, column.window + kWindowWords, 0);
+    for (std::size_t j = 0; j != length; ++j) {
+      std::size_t bit = j * x_size_;
+      if (bit >= 64 * kWindowWords) {
+        fits = false;
+        break;
+      }
+      column.window[bit / 64] |= std::uint64_t(1) << (bit % 64);
+    }
+  }
+  return fits;
+}
+
+// Write the ways to leave a state to moves and return how many there are.
+std::size_t PosteriorSolver::GetMoves(State const &state, Move *moves) const {
+  std::size_t cells = x_size_ * y_size_;
+  std::size_t slots = lengths_.size();
+  std::size_t x = state.cell % x_size_;
+  std::size_t y = state.cell / x_size_;
+
+  // Give up on states with a ship left that can no longer start anywhere.
+  std::size_t used = state.used;
+  for (std::size_t slot = 0; slot != slots; ++slot) {
+    std::size_t placed = used / radices_[slot] % (counts_[slot] + 1);
+    if (placed != counts_[slot] && last_starts_[slot] < state.cell) return 0;
+  }
+
+  std::size_t count = 0;
+  bool covered = (state.window[0] & 1) != 0;
+  if (covered || !open_hits_.Test(x, y)) {
+    Move &move = moves[count++];
+    move.next = state;
+    move.slot = slots;
+    move.orientation = Ship::kHorizontal;
+  }
+  for (std::size_t slot = 0; !covered && slot != slots; ++slot) {
+    std::size_t placed = used / radices_[slot] % (counts_[slot] + 1);
+    std::uint8_t starts = starts_[slot * cells + state.cell];
+    if (placed == counts_[slot] || starts == 0) continue;
+
+    std::uint64_t row = (std::uint64_t(1) << lengths_[slot]) - 1;
+    if ((starts & 1) != 0 && (state.window[0] & row) == 0) {
+      Move &move = moves[count++];
+      move.next = state;
+      move.next.window[0] |= row;
+      move.next.used += static_cast<std::uint32_t>(radices_[slot]);
+      move.slot = slot;
+      move.orientation = Ship::kHorizontal;
+    }
+
+    State const &column = columns_[slot];
+    std::uint64_t any = 0;
+    for (std::size_t i = 0; i != kWindowWords; ++i)
+      any |= state.window[i] & column.window[i];
+    if ((starts & 2) != 0 && any == 0) {
+      Move &move = moves[count++];
+      move.next = state;
+      for (std::size_t i = 0; i != kWindowWords; ++i)
+        move.next.window[i] |= column.window[i];
+      move.next.used += static_cast<std::uint32_t>(radices_[slot]);
+      move.slot = slot;
+      move.orientation = Ship::kVertical;
+    }
+  }
+
+  // Step to the next cell.
+  for (std::size_t k = 0; k != count; ++k) {
+    State &next = moves[k].next;
+    for (std::size_t i = 0; i + 1 != kWindowWords; ++i)
+      next.window[i] = next.window[i] >> 1 | next.window[i + 1] << 63;
+    next.window[kWindowWords - 1] >>= 1;
+    ++next.cell;
+  }
+  return count;
+}
+
+// Find the states reached before the cell after cell from those before it and
+// the ways to reach them. Return false if counting must give up.
+bool PosteriorSolver::Advance(std::size_t cell) {
+  StateMap &layer = layers_[cell];
+  StateMap &next_layer = layers_[cell + 1];
+  Move *moves = &moves_[0];
+  for (std::size_t s = 0, e = layer.size(); s != e; ++s) {
+    if (Expired()) return false;
+    Entry const &entry = layer.entry(s);
+    std::size_t count = GetMoves(entry.state, moves);
+    for (std::size_t k = 0; k != count; ++k) {
+      std::uint64_t &ways = next_layer[moves[k].next].count;
+      if (__builtin_add_overflow(ways, entry.count, &ways)) return false;
+    }
+  }
+  states_ += next_layer.size();
+  return states_ <= kMaxStates;
+}
+
+// Replace the ways to reach the states before a cell by the ways to finish the
+// walk from them, from the completions of the states after it, and add the
+// fleets through every move to the cells of its ship. Return false if
+// counting must give up.
+bool PosteriorSolver::Retreat(std::size_t cell) {
+  StateMap &layer = layers_[cell];
+  StateMap const &next_layer = layers_[cell + 1];
+  Move *moves = &moves_[0];
+  for (std::size_t s = 0, e = layer.size(); s != e; ++s) {
+    if (Expired()) return false;
+    Entry &entry = layer.entry(s);
+    std::uint64_t completions = 0;
+    std::size_t count = GetMoves(entry.state, moves);
+    for (std::size_t k = 0; k != count; ++k) {
+      std::uint64_t next = next_layer.Get(moves[k].next)->count;
+      if (next == 0) continue;
+      // The fleets through a move are counted fleets, so once the product
+      // fits, so does every cell's sum of them.
+      std::uint64_t fleets = 0;
+      if (__builtin_add_overflow(completions, next, &completions) ||
+          __builtin_mul_overflow(entry.count, next, &fleets))
+        return false;
+      if (moves[k].slot == lengths_.size()) continue;
+      Ship ship = {moves[k].orientation, cell % x_size_, cell / x_size_,
+                   lengths_[moves[k].slot]};
+      Cover(ship, fleets);
+    }
+    entry.count = completions;
+  }
+  return true;
+}
+
+// Free the states before a cell.
+void PosteriorSolver::Drop(std::size_t cell) {
+  states_ -= layers_[cell].size();
+  layers_[cell] = StateMap();
+}
+
+// Count the fleets and how many cover each cell. A first pass finds the states
+// reached before every cell and the number of ways to reach them, keeping
+// those before the first cell of every row. A second pass goes back row by
+// row, finding the states of the row again from its first cell and counting
+// the ways to finish the walk from each state, so each move adds the fleets
+// through it to the cells of its ship. Return 0 with expired_ set if counting
+// gave up.
+std::uint64_t PosteriorSolver::Count() {
+  std::size_t cells = x_size_ * y_size_;
+  layers_.assign(cells + 1, StateMap());
+
+  State start;
+  std::fill(start.window, start.window + kWindowWords, 0);
+  start.cell = 0;
+  start.used = 0;
+  layers_[0][start].count = 1;
+  states_ = 1;
+  // The size of every layer, so that walking a row again never grows a map.
+  std::vector<std::size_t> sizes(cells + 1, 0);
+  for (std::size_t cell = 0; cell != cells; ++cell) {
+    if (!Advance(cell)) {
+      expired_ = true;
+      return 0;
+    }
+    sizes[cell + 1] = layers_[cell + 1].size();
+    if (cell % x_size_ != 0) Drop(cell);
+  }
+
+  StateMap &end = layers_[cells];
+  for (std::size_t s = 0, e = end.size(); s != e; ++s)
+    end.entry(s).count = end.entry(s).state.used == fleet_ ? 1 : 0;
+  for (std::size_t row = y_size_; row-- != 0;) {
+    std::size_t first = row * x_size_;
+    std::size_t last = first + x_size_;
+    for (std::size_t cell = first; cell + 1 != last; ++cell) {
+      layers_[cell + 1].Reserve(sizes[cell + 1]);
+      if (!Advance(cell)) {
+        expired_ = true;
+        return 0;
+      }
+    }
+    for (std::size_t cell = last; cell-- != first;) {
+      if (!Retreat(cell)) {
+        expired_ = true;
+        return 0;
+      }
+      Drop(cell + 1);
+    }
+  }
+  return layers_[0].entry(0).count;
+}
+
+// Draw every ship independently among its candidates and keep the fleets that
+// do not overlap and cover every open hit, which are then uniform. Return the
+// number of fleets kept.
+std::uint64_t PosteriorSolver::Sample() {
+  std::size_t open_hits = 0;
+  for (std::size_t i = 0; i != Bitboard::kWords; ++i)
+    open_hits += Bitboard::CountBits(open_hits_.word(i));
+  for (std::size_t slot = 0, e = lengths_.size(); slot != e; ++slot)
+    if (candidates_[slot].empty()) return 0;
+
+  Bitboard hit_columns = open_hits_.Transposed();
+  std::vector<Ship> fleet(afloat_.size());
+  std::uint64_t fleets = 0;
+  while (fleets != kSamples && !Expired()) {
+    Bitboard rows;
+    Bitboard columns;
+    std::size_t covered = 0;
+    std::size_t placed = 0;
+    for (std::size_t slot = 0, e = lengths_.size(); slot != e; ++slot) {
+      PlacementTable const &table = *tables_[slot];
+      std::vector<std::uint32_t> const &candidates = candidates_[slot];
+      std::size_t j = 0;
+      for (; j != counts_[slot]; ++j) {
+        std::size_t i = candidates[random_() % candidates.size()];
+        if (table.Intersects(i, rows, columns)) break;
+        covered += table.Overlap(i, open_hits_, hit_columns);
+        table.Set(i, rows, columns);
+        fleet[placed++] = table.GetShip(i);
+      }
+      if (j != counts_[slot]) break;
+    }
+    if (placed != fleet.size() || covered != open_hits) continue;
+
+    for (std::size_t i = 0, e = fleet.size(); i != e; ++i) Cover(fleet[i], 1);
+    ++fleets;
+  }
+  return fleets;
+}
+
+// Add fleets to every cell of a ship.
+void PosteriorSolver::Cover(Ship const &ship, std::uint64_t fleets) {
+  std::size_t dx = ship.orientation == Ship::kHorizontal ? 1 : 0;
+  std::size_t dy = 1 - dx;
+  for (std::size_t i = 0; i != ship.length; ++i)
+    coverage_[(ship.y + i * dy) * x_size_ + ship.x + i * dx] += fleets;
+}
+
+// Construct a solver, call Init before observing.
+PosteriorSolver::PosteriorSolver(unsigned seed)
+    : x_size_(0), y_size_(0), random_(seed), fleet_(0), states_(0),
+      steps_(0), expired_(false) {}
+
+// Restart the random sequence used for sampling.
+void PosteriorSolver::Seed(unsigned seed) { random_.seed(seed); }
+
+// Start a new game with nothing observed.
+void PosteriorSolver::Init(MapSize size, ShipSet set) {
+  x_size_ = size.x;
+  y_size_ = size.y;
+  afloat_.assign(set.first, set.last);
+  std::sort(afloat_.begin(), afloat_.end(), std::greater<std::size_t>());
+  attacks_.Clear();
+  blocked_.Clear();
+  open_hits_.Clear();
+  probabilities_.assign(x_size_ * y_size_, 0);
+}
+
+// Record the result of an attack.
+void PosteriorSolver::Observe(std::size_t x, std::size_t y,
+                              Board::AttackResult const &result) {
+  switch (result.type) {
+    case Board::kRetry:
+      return;
+
+    case Board::kMiss:
+      attacks_.Set(x, y);
+      blocked_.Set(x, y);
+      return;
+
+    case Board::kHit:
+      attacks_.Set(x, y);
+      open_hits_.Set(x, y);
+      return;
+
+    case Board::kSunk: {
+      Ship const &ship = *result.ship;
+      attacks_.Set(x, y);
+      blocked_.SetShip(ship);
+      open_hits_.ResetShip(ship);
+      std::vector<std::size_t>::iterator it =
+          std::find(afloat_.begin(), afloat_.end(), ship.length);
+      assert(it != afloat_.end());
+      afloat_.erase(it);
+      return;
+    }
+  }
+}
+
+// Compute the probability of every cell. Counting gets at most budget and if
+// it does not finish, sampling gets at most budget more.
+PosteriorSolver::SolveResult PosteriorSolver::Solve(Clock::duration budget) {
+  deadline_ = Clock::now() + budget;
+  steps_ = 0;
+  expired_ = false;
+  coverage_.assign(x_size_ * y_size_, 0);
+
+  SolveResult result = {kExact, 0};
+  bool fits = Prepare();
+  if (fits) result.fleets = Count();
+  std::vector<StateMap>().swap(layers_);
+  if (!fits || expired_) {
+    // Nothing was counted when counting did not finish.
+    std::fill(coverage_.begin(), coverage_.end(), 0);
+    deadline_ = Clock::now() + budget;
+    expired_ = false;
+    result.type = kSampled;
+    result.fleets = Sample();
+  }
+  if (result.fleets == 0) {
+    result.type = kInconsistent;
+    std::fill(probabilities_.begin(), probabilities_.end(), 0);
+    return result;
+  }
+
+  double scale = 1.0 / static_cast<double>(result.fleets);
+  for (std::size_t i = 0, e = coverage_.size(); i != e; ++i)
+    probabilities_[i] = scale * static_cast<double>(coverage_[i]);
+  return result;
+}
+
+}  // namespace battleship
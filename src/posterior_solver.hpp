@@ -0,0 +1,167 @@
+#ifndef BATTLESHIP_POSTERIOR_SOLVER_H
+#define BATTLESHIP_POSTERIOR_SOLVER_H
+
+#include "bitboard.hpp"
+#include "board.hpp"
+#include "placement_table.hpp"
+#include "presets.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace battleship {
+
+// Computes the probability that each cell holds a ship from what an attacker
+// has seen: misses, hits and sunk ships. Every fleet of the ships still afloat
+// that avoids the misses and sunk ships, covers every open hit and has no ship
+// fully hit is equally likely.
+//
+// The solver counts these fleets exactly by walking the cells in row-major
+// order and choosing which ship, if any, starts on each one. What the rest of
+// the walk can do only depends on the cells ahead that are already covered and
+// on how many ships of each length are left, so the sub-fleets leading to the
+// same such state are merged and their completions counted once. Ships of
+// equal length are not told apart, so each fleet is counted once. The way
+// back needs the states before every cell, so only those starting a row are
+// kept on the way forward and each row is walked again when the way back
+// reaches it. When the states do not fit the time budget or memory, or the
+// counts do not fit 64 bits, the solver samples fleets instead.
+class PosteriorSolver {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  enum SolveType { kExact, kSampled, kInconsistent };
+
+  struct SolveResult {
+    SolveType type;
+    // The number of fleets counted or sampled.
+    std::uint64_t fleets;
+  };
+
+ private:
+  static std::size_t const kWindowWords = 3;
+
+  // A point of the walk: the next cell, the cells from it on covered by ships
+  // starting before it, with the next cell as bit 0, and the ships used as a
+  // mixed radix number of ships per distinct length.
+  struct State {
+    std::uint64_t window[kWindowWords];
+    std::uint32_t cell;
+    std::uint32_t used;
+
+    bool operator==(State const &other) const;
+  };
+
+  // A state reached and the number of ways to reach it, replaced by the
+  // number of ways to finish the walk from it once the way back passed it.
+  struct Entry {
+    State state;
+    std::uint64_t count;
+  };
+
+  // An open addressing map of entries, keeping the slots in use so that
+  // clearing and walking it only touches those.
+  class StateMap {
+   private:
+    std::vector<Entry> entries_;
+    std::vector<std::size_t> used_;
+
+    std::size_t Find(State const &state) const;
+    void Grow();
+
+   public:
+    StateMap();
+    void Clear();
+    void Reserve(std::size_t states);
+    Entry const *Get(State const &state) const;
+    Entry &operator[](State const &state);
+
+    // Return the number of states.
+    std::size_t size() const { return used_.size(); }
+
+    // Return the i-th state inserted.
+    Entry &entry(std::size_t i) { return entries_[used_[i]]; }
+  };
+
+  // A way to leave a state: a ship of a distinct length starting on the cell
+  // or, with slot equal to the number of lengths, no ship.
+  struct Move {
+    State next;
+    std::size_t slot;
+    Ship::Orientation orientation;
+  };
+
+  std::size_t x_size_;
+  std::size_t y_size_;
+  std::mt19937 random_;
+
+  // Lengths of the ships still afloat, longest first.
+  std::vector<std::size_t> afloat_;
+  Bitboard attacks_;
+  // Cells no floating ship can cover: misses and sunk ships.
+  Bitboard blocked_;
+  // Hits that do not belong to a sunk ship yet.
+  Bitboard open_hits_;
+  std::vector<double> probabilities_;
+
+  // The distinct lengths afloat, their placements avoiding misses and sunk
+  // ships, how many ships of each and their radix in used.
+  std::vector<std::size_t> lengths_;
+  std::vector<PlacementTable const *> tables_;
+  std::vector<std::vector<std::uint32_t> > candidates_;
+  std::vector<std::size_t> counts_;
+  std::vector<std::size_t> radices_;
+  // The ships used by a whole fleet.
+  std::uint32_t fleet_;
+  // For every length and cell, whether a horizontal (bit 0) or vertical (bit
+  // 1) ship may start there, and the last cell any of them may start on.
+  std::vector<std::uint8_t> starts_;
+  std::vector<std::size_t> last_starts_;
+  // The window bits of a vertical ship of every length.
+  std::vector<State> columns_;
+  // The states reached before every cell and after the last one, of which
+  // only those the walk needs are kept, how many states they hold, and
+  // scratch space for the moves out of a state.
+  std::vector<StateMap> layers_;
+  std::size_t states_;
+  std::vector<Move> moves_;
+  // The fleets covering every cell.
+  std::vector<std::uint64_t> coverage_;
+
+  Clock::time_point deadline_;
+  std::uint64_t steps_;
+  bool expired_;
+
+  bool Expired();
+  bool Prepare();
+  std::size_t GetMoves(State const &state, Move *moves) const;
+  bool Advance(std::size_t cell);
+  bool Retreat(std::size_t cell);
+  void Drop(std::size_t cell);
+  std::uint64_t Count();
+  std::uint64_t Sample();
+  void Cover(Ship const &ship, std::uint64_t fleets);
+
+ public:
+  explicit PosteriorSolver(unsigned seed = 0);
+  void Seed(unsigned seed);
+  void Init(MapSize size, ShipSet set);
+  void Observe(std::size_t x, std::size_t y, Board::AttackResult const &result);
+  SolveResult Solve(Clock::duration budget);
+
+  // Return whether a cell was attacked.
+  bool attacked(std::size_t x, std::size_t y) const {
+    return attacks_.Test(x, y);
+  }
+
+  // Return the probability of a ship on a cell found by the last Solve.
+  double probability(std::size_t x, std::size_t y) const {
+    return probabilities_[y * x_size_ + x];
+  }
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_POSTERIOR_SOLVER_H
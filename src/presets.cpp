@@ -0,0 +1,37 @@
+#include "presets.hpp"
+
+#include <cassert>
+
+namespace battleship {
+
+// Options.
+static std::size_t set1[] = {1, 2, 3};
+static std::size_t set2[] = {2, 3, 3, 4, 5};
+static std::size_t set3[] = {1, 3, 5, 7};
+static std::size_t set4[] = {1, 1, 2, 3, 5, 8};
+
+// Generate an iterator pair from an array.
+template <std::size_t N>
+static ShipSet MakeShipSet(std::size_t (&lengths)[N]) {
+  ShipSet set;
+  set.first = &lengths[0];
+  set.last = set.first + N;
+  return set;
+}
+
+// Return one of the preset map sizes.
+MapSize GetPresetMapSize(std::size_t i) {
+  assert(i < kNumPresets);
+  MapSize size = {kPresetWidths[i], kPresetHeights[i]};
+  return size;
+}
+
+// Return one of the preset ship sets.
+ShipSet GetPresetShipSet(std::size_t i) {
+  assert(i < kNumPresets);
+  ShipSet const sets[kNumPresets] = {MakeShipSet(set1), MakeShipSet(set2),
+                                     MakeShipSet(set3), MakeShipSet(set4)};
+  return sets[i];
+}
+
+}  // namespace battleship
@@ -0,0 +1,29 @@
+#ifndef BATTLESHIP_PRESETS_H
+#define BATTLESHIP_PRESETS_H
+
+#include <cstdlib>
+
+namespace battleship {
+
+struct MapSize {
+  std::size_t x;
+  std::size_t y;
+};
+
+struct ShipSet {
+  std::size_t* first;
+  std::size_t* last;
+};
+
+// The number of map sizes and ship sets offered when creating a new game.
+static std::size_t const kNumPresets = 4;
+
+// The preset map sizes, constant so that boards can be built for each.
+constexpr std::size_t kPresetWidths[kNumPresets] = {8, 10, 9, 26};
+constexpr std::size_t kPresetHeights[kNumPresets] = {8, 10, 16, 26};
+
+MapSize GetPresetMapSize(std::size_t i);
+ShipSet GetPresetShipSet(std::size_t i);
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_PRESETS_H
@@ -0,0 +1,176 @@
+#include "protocol.hpp"
+
+namespace battleship {
+
+// Append a ship.
+static void EncodeShip(Ship const &ship, std::vector<std::uint8_t> &out) {
+  EncodeVarint(ship.x, out);
+  EncodeVarint(ship.y, out);
+  EncodeVarint(ship.orientation == Ship::kVertical, out);
+  EncodeVarint(ship.length, out);
+}
+
+// Decode a varint that must be below limit.
+static bool DecodeBelow(std::uint8_t const *&first, std::uint8_t const *last,
+                        std::uint64_t limit, std::size_t &value) {
+  std::uint64_t wide;
+  if (!DecodeVarint(first, last, wide) || wide >= limit) return false;
+  value = static_cast<std::size_t>(wide);
+  return true;
+}
+
+// Decode a ship.
+static bool DecodeShip(std::uint8_t const *&first, std::uint8_t const *last,
+                       Ship &ship) {
+  std::uint64_t const kAny = ~std::uint64_t(0);
+  std::size_t vertical;
+  if (!DecodeBelow(first, last, kAny, ship.x) ||
+      !DecodeBelow(first, last, kAny, ship.y) ||
+      !DecodeBelow(first, last, 2, vertical) ||
+      !DecodeBelow(first, last, kAny, ship.length))
+    return false;
+  ship.orientation = vertical ? Ship::kVertical : Ship::kHorizontal;
+  return true;
+}
+
+// Decode the fields of a message of known type from a whole payload.
+static bool DecodeFields(std::uint8_t const *first, std::uint8_t const *last,
+                         Message &message) {
+  std::uint64_t const kAny = ~std::uint64_t(0);
+  std::size_t value;
+  switch (message.type) {
+    case kJoinMessage:
+      return DecodeRules(first, last, message.rules);
+
+    case kJoinedMessage:
+    case kFinishedMessage:
+      if (!DecodeBelow(first, last, 2, message.seat)) return false;
+      break;
+
+    case kTurnMessage:
+      if (!DecodeBelow(first, last, GameState::kFinished + 1, value) ||
+          !DecodeBelow(first, last, 2, message.board))
+        return false;
+      message.phase = static_cast<GameState::Phase>(value);
+      break;
+
+    case kPlaceMessage:
+      if (!DecodeShip(first, last, message.ship)) return false;
+      break;
+
+    case kPlacedMessage:
+      if (!DecodeBelow(first, last, GameState::kOutOfBounds + 1, value) ||
+          !DecodeShip(first, last, message.ship))
+        return false;
+      message.place = static_cast<GameState::PlaceType>(value);
+      break;
+
+    case kAttackMessage:
+      if (!DecodeBelow(first, last, kAny, message.x) ||
+          !DecodeBelow(first, last, kAny, message.y))
+        return false;
+      break;
+
+    case kAttackedMessage:
+      if (!DecodeBelow(first, last, 2, message.board) ||
+          !DecodeBelow(first, last, kAny, message.x) ||
+          !DecodeBelow(first, last, kAny, message.y) ||
+          !DecodeBelow(first, last, Board::kRetry + 1, value))
+        return false;
+      message.attack = static_cast<Board::AttackType>(value);
+      if (message.attack == Board::kSunk &&
+          !DecodeShip(first, last, message.ship))
+        return false;
+      break;
+
+    case kLeftMessage:
+      break;
+
+    case kErrorMessage:
+      if (!DecodeBelow(first, last, kBadMessage + 1, value) || value == 0)
+        return false;
+      message.error = static_cast<ErrorCode>(value);
+      break;
+  }
+  return first == last;
+}
+
+// Append a message framed by its size.
+void EncodeMessage(Message const &message, std::vector<std::uint8_t> &out) {
+  // Most messages fit a single byte of size, make room for that and move the
+  // payload along for the rest.
+  std::size_t start = out.size();
+  out.push_back(0);
+  EncodeVarint(message.type, out);
+  switch (message.type) {
+    case kJoinMessage:
+      EncodeRules(message.rules, out);
+      break;
+    case kJoinedMessage:
+    case kFinishedMessage:
+      EncodeVarint(message.seat, out);
+      break;
+    case kTurnMessage:
+      EncodeVarint(message.phase, out);
+      EncodeVarint(message.board, out);
+      break;
+    case kPlaceMessage:
+      EncodeShip(message.ship, out);
+      break;
+    case kPlacedMessage:
+      EncodeVarint(message.place, out);
+      EncodeShip(message.ship, out);
+      break;
+    case kAttackMessage:
+      EncodeVarint(message.x, out);
+      EncodeVarint(message.y, out);
+      break;
+    case kAttackedMessage:
+      EncodeVarint(message.board, out);
+      EncodeVarint(message.x, out);
+      EncodeVarint(message.y, out);
+      EncodeVarint(message.attack, out);
+      if (message.attack == Board::kSunk) EncodeShip(message.ship, out);
+      break;
+    case kLeftMessage:
+      break;
+    case kErrorMessage:
+      EncodeVarint(message.error, out);
+      break;
+  }
+
+  std::size_t size = out.size() - start - 1;
+  if (size < 0x80) {
+    out[start] = static_cast<std::uint8_t>(size);
+    return;
+  }
+  std::vector<std::uint8_t> prefix;
+  EncodeVarint(size, prefix);
+  out[start] = prefix[0];
+  out.insert(out.begin() + static_cast<std::ptrdiff_t>(start) + 1,
+             prefix.begin() + 1, prefix.end());
+}
+
+// Decode the message at first and advance first past it. Return kIncomplete
+// without moving first if not all of it has arrived yet.
+DecodeStatus DecodeMessage(std::uint8_t const *&first, std::uint8_t const *last,
+                           Message &message) {
+  std::uint8_t const *it = first;
+  std::uint64_t size;
+  if (!DecodeVarint(it, last, size))
+    return last - first < 10 ? kIncomplete : kMalformed;
+  if (size == 0 || size > kMaxMessageSize) return kMalformed;
+  if (size > static_cast<std::uint64_t>(last - it)) return kIncomplete;
+
+  std::uint8_t const *end = it + size;
+  std::uint64_t type;
+  if (!DecodeVarint(it, end, type) || type < kJoinMessage ||
+      type > kErrorMessage)
+    return kMalformed;
+  message.type = static_cast<MessageType>(type);
+  if (!DecodeFields(it, end, message)) return kMalformed;
+  first = end;
+  return kDecoded;
+}
+
+}  // namespace battleship
@@ -0,0 +1,73 @@
+#ifndef BATTLESHIP_PROTOCOL_H
+#define BATTLESHIP_PROTOCOL_H
+
+#include "board.hpp"
+#include "game_record.hpp"
+#include "game_state.hpp"
+#include "ship.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace battleship {
+
+// The messages between battleship_server and its clients. A connection plays
+// a single match: the client joins with the rules it wants and is paired with
+// the next client that wants the same ones. The client in seat 0 is Player1,
+// who places the ships of board 1 and attacks board 0, and seat 1 is Player2.
+//
+// Client to server: kJoin, kPlace, kAttack.
+// Server to client: kJoined once paired, kTurn at the start and whenever the
+// phase or the board being placed on changes, kPlaced in reply to kPlace, and
+// kAttacked to both players after every attack. Retries only go to the
+// attacker, and any other attack passes the turn. The match ends with
+// kFinished, or kLeft if the opponent disconnected, after which the server
+// closes the connection. kError replies to anything out of turn or malformed.
+enum MessageType {
+  kJoinMessage = 1,
+  kJoinedMessage,
+  kTurnMessage,
+  kPlaceMessage,
+  kPlacedMessage,
+  kAttackMessage,
+  kAttackedMessage,
+  kFinishedMessage,
+  kLeftMessage,
+  kErrorMessage
+};
+
+enum ErrorCode { kNotYourTurn = 1, kBadRules, kBadMessage };
+
+// A message of any type. Only the fields of its type are used.
+struct Message {
+  MessageType type;
+  // kJoin.
+  GameRules rules;
+  // kJoined, kFinished: the seat of the player or the winner.
+  std::size_t seat;
+  // kTurn: the phase and the board being placed on or attacked. kAttacked:
+  // the board attacked.
+  GameState::Phase phase;
+  std::size_t board;
+  // kPlace, kPlaced, and kAttacked when a ship was sunk.
+  Ship ship;
+  GameState::PlaceType place;
+  // kAttack, kAttacked.
+  std::size_t x;
+  std::size_t y;
+  Board::AttackType attack;
+  // kError.
+  ErrorCode error;
+};
+
+enum DecodeStatus { kDecoded, kIncomplete, kMalformed };
+
+// The largest message, so a peer cannot make us buffer without bound.
+static std::size_t const kMaxMessageSize = 4096;
+
+void EncodeMessage(Message const &message, std::vector<std::uint8_t> &out);
+DecodeStatus DecodeMessage(std::uint8_t const *&first, std::uint8_t const *last,
+                           Message &message);
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_PROTOCOL_H
@@ -0,0 +1,43 @@
+#include "random_attacker.hpp"
+
+#include <cassert>
+
+namespace battleship {
+
+// Construct an attacker, call Init before playing.
+RandomAttacker::RandomAttacker(unsigned seed) : random_(seed) {}
+
+// Restart the random sequence.
+void RandomAttacker::Seed(unsigned seed) { random_.seed(seed); }
+
+// Start a new game with every cell left to attack.
+void RandomAttacker::Init(MapSize size, ShipSet) {
+  cells_.clear();
+  for (std::size_t y = 0; y != size.y; ++y) {
+    for (std::size_t x = 0; x != size.x; ++x) {
+      Cell cell = {x, y};
+      cells_.push_back(cell);
+    }
+  }
+}
+
+// Draw one of the remaining cells.
+Cell RandomAttacker::NextAttack() {
+  assert(!cells_.empty());
+  std::size_t i = random_() % cells_.size();
+  Cell cell = cells_[i];
+  cells_[i] = cells_.back();
+  cells_.pop_back();
+  return cell;
+}
+
+// Draw count of the remaining cells.
+void RandomAttacker::NextSalvo(Cell *cells, std::size_t count) {
+  for (std::size_t i = 0; i != count; ++i) cells[i] = NextAttack();
+}
+
+// The result does not change the order of attacks.
+void RandomAttacker::Observe(std::size_t, std::size_t,
+                             Board::AttackResult const &) {}
+
+}  // namespace battleship
@@ -0,0 +1,28 @@
+#ifndef BATTLESHIP_RANDOM_ATTACKER_H
+#define BATTLESHIP_RANDOM_ATTACKER_H
+
+#include "attacker.hpp"
+
+#include <random>
+#include <vector>
+
+namespace battleship {
+
+// A computer player that attacks the cells in a uniformly random order.
+class RandomAttacker : public Attacker {
+ private:
+  std::mt19937 random_;
+  // Cells not returned yet.
+  std::vector<Cell> cells_;
+
+ public:
+  explicit RandomAttacker(unsigned seed = 0);
+  void Seed(unsigned seed);
+  void Init(MapSize size, ShipSet set);
+  Cell NextAttack();
+  void NextSalvo(Cell *cells, std::size_t count);
+  void Observe(std::size_t x, std::size_t y, Board::AttackResult const &result);
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_RANDOM_ATTACKER_H
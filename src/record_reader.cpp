@@ -0,0 +1,203 @@
+#include "record_reader.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace battleship {
+
+// Construct a reader with no file open.
+RecordReader::RecordReader()
+    : data_(0), size_(0), position_(0), failed_(false) {}
+
+// Unmap the file.
+RecordReader::~RecordReader() { Close(); }
+
+// Map a record file and check its header. Return false if it cannot be read
+// or is not a record file of a version we know.
+bool RecordReader::Open(char const *path) {
+  Close();
+#ifdef _WIN32
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  buffer_.assign(std::istreambuf_iterator<char>(file),
+                 std::istreambuf_iterator<char>());
+  data_ = buffer_.empty() ? 0 : &buffer_[0];
+  size_ = buffer_.size();
+#else
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat info;
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    return false;
+  }
+  size_ = static_cast<std::size_t>(info.st_size);
+  if (size_ != 0) {
+    void *data = ::mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      ::close(fd);
+      size_ = 0;
+      return false;
+    }
+    ::madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<std::uint8_t const *>(data);
+  }
+  ::close(fd);
+#endif
+
+  std::size_t header = sizeof(kRecordMagic) + 1;
+  if (size_ < header ||
+      std::memcmp(data_, kRecordMagic, sizeof(kRecordMagic)) != 0 ||
+      data_[sizeof(kRecordMagic)] != kRecordVersion) {
+    Close();
+    return false;
+  }
+  position_ = header;
+  return true;
+}
+
+// Unmap the file and forget its players and rules.
+void RecordReader::Close() {
+#ifdef _WIN32
+  buffer_.clear();
+#else
+  if (data_ != 0) ::munmap(const_cast<std::uint8_t *>(data_), size_);
+#endif
+  data_ = 0;
+  size_ = 0;
+  position_ = 0;
+  failed_ = false;
+  players_.clear();
+  rules_.clear();
+}
+
+// Decode the next game into record, collecting the players and rules declared
+// on the way. Return false at the end of the file or at a malformed game, which
+// failed tells apart.
+bool RecordReader::Next(GameRecord &record) {
+  if (failed_) return false;
+  std::uint8_t const *last = data_ + size_;
+  for (;;) {
+    std::uint8_t const *it = data_ + position_;
+    std::uint64_t kind;
+    std::uint8_t const *payload;
+    std::size_t size;
+    if (!DecodeChunk(it, last, kind, payload, size)) return false;
+    position_ = static_cast<std::size_t>(it - data_);
+
+    switch (kind) {
+      case kPlayerChunk:
+        players_.push_back(
+            std::string(reinterpret_cast<char const *>(payload), size));
+        break;
+      case kRulesChunk:
+        rules_.resize(rules_.size() + 1);
+        if (!DecodeRules(payload, payload + size, rules_.back())) {
+          failed_ = true;
+          return false;
+        }
+        break;
+      case kGameChunk:
+        if (DecodeGame(payload, payload + size, rules_, index_, record))
+          return true;
+        failed_ = true;
+        return false;
+      default:
+        // Written by a later version, skip it.
+        break;
+    }
+  }
+}
+
+// Read the players and rules of the whole file and collect where every
+// stride-th game starts, followed by where the last whole chunk ends, so that
+// the games between consecutive starts can go to different threads. Return
+// false at a malformed chunk.
+bool RecordReader::Split(std::size_t stride, std::vector<std::size_t> &starts) {
+  assert(stride != 0);
+  players_.clear();
+  rules_.clear();
+  starts.clear();
+  failed_ = false;
+  position_ = sizeof(kRecordMagic) + 1;
+  std::uint8_t const *last = data_ + size_;
+  std::size_t games = 0;
+  for (;;) {
+    std::uint8_t const *it = data_ + position_;
+    std::uint64_t kind;
+    std::uint8_t const *payload;
+    std::size_t size;
+    if (!DecodeChunk(it, last, kind, payload, size)) break;
+
+    switch (kind) {
+      case kPlayerChunk:
+        players_.push_back(
+            std::string(reinterpret_cast<char const *>(payload), size));
+        break;
+      case kRulesChunk:
+        rules_.resize(rules_.size() + 1);
+        if (!DecodeRules(payload, payload + size, rules_.back())) {
+          failed_ = true;
+          return false;
+        }
+        break;
+      case kGameChunk:
+        if (games++ % stride == 0) starts.push_back(position_);
+        break;
+      default:
+        break;
+    }
+    position_ = static_cast<std::size_t>(it - data_);
+  }
+  starts.push_back(position_);
+  return true;
+}
+
+// Decode the first game from position on into record and move position past
+// it. Return false once position reaches end, or at a malformed game, leaving
+// position at it. Only Split must have been called, so any number of threads
+// may read at once, each with its own index and record.
+bool RecordReader::Read(std::size_t &position, std::size_t end,
+                        ShipIndex &index, GameRecord &record) const {
+  assert(end <= size_);
+  std::uint8_t const *last = data_ + end;
+  while (position != end) {
+    std::uint8_t const *it = data_ + position;
+    std::uint64_t kind;
+    std::uint8_t const *payload;
+    std::size_t size;
+    if (!DecodeChunk(it, last, kind, payload, size)) return false;
+    if (kind == kGameChunk &&
+        !DecodeGame(payload, payload + size, rules_, index, record))
+      return false;
+    position = static_cast<std::size_t>(it - data_);
+    if (kind == kGameChunk) return true;
+  }
+  return false;
+}
+
+// Return true if reading stopped at a malformed chunk.
+bool RecordReader::failed() const { return failed_; }
+
+// Return the offset just past the last chunk read.
+std::size_t RecordReader::position() const { return position_; }
+
+// Return the names of the players declared so far, indexed by id.
+std::vector<std::string> const &RecordReader::players() const {
+  return players_;
+}
+
+// Return the rules declared so far, indexed by id.
+std::vector<GameRules> const &RecordReader::rules() const { return rules_; }
+
+}  // namespace battleship
@@ -0,0 +1,53 @@
+#ifndef BATTLESHIP_RECORD_READER_H
+#define BATTLESHIP_RECORD_READER_H
+
+#include "game_record.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace battleship {
+
+// Reads the games of a record file in order. The file is mapped into memory
+// and decoded in place, and Next reuses the room of the record it is given,
+// so reading millions of games does not allocate once the record has grown
+// to the largest game. A tail cut short by a writer that stopped mid chunk
+// ends the games without an error. Split and Read let several threads share
+// the games of one file.
+class RecordReader {
+ private:
+  std::uint8_t const *data_;
+  std::size_t size_;
+  // Where the next chunk starts.
+  std::size_t position_;
+  bool failed_;
+  std::vector<std::string> players_;
+  std::vector<GameRules> rules_;
+  ShipIndex index_;
+#ifdef _WIN32
+  // Without mmap the whole file is read into memory instead.
+  std::vector<std::uint8_t> buffer_;
+#endif
+
+  RecordReader(RecordReader const &);
+  RecordReader &operator=(RecordReader const &);
+
+ public:
+  RecordReader();
+  ~RecordReader();
+  bool Open(char const *path);
+  void Close();
+  bool Next(GameRecord &record);
+  bool Split(std::size_t stride, std::vector<std::size_t> &starts);
+  bool Read(std::size_t &position, std::size_t end, ShipIndex &index,
+            GameRecord &record) const;
+
+  bool failed() const;
+  std::size_t position() const;
+  std::vector<std::string> const &players() const;
+  std::vector<GameRules> const &rules() const;
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_RECORD_READER_H
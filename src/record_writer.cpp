@@ -0,0 +1,141 @@
+#include "record_writer.hpp"
+
+#include "record_reader.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace battleship {
+
+// Frame the payload as a chunk and append it. Return false, failing the
+// writer, if it could not be written, or if the writer already failed.
+bool RecordWriter::WriteChunk(RecordChunk kind) {
+  if (failed_) return false;
+  chunk_.clear();
+  EncodeVarint(kind, chunk_);
+  EncodeVarint(payload_.size(), chunk_);
+  chunk_.insert(chunk_.end(), payload_.begin(), payload_.end());
+  if (std::fwrite(&chunk_[0], 1, chunk_.size(), file_) != chunk_.size())
+    failed_ = true;
+  return !failed_;
+}
+
+// Return the id of the rules of a game, declaring them the first time. If
+// they cannot be declared the writer fails.
+std::uint32_t RecordWriter::AddRules(GameRecord const &record) {
+  for (std::size_t i = 0, e = rules_.size(); i != e; ++i)
+    if (rules_[i].size.x == record.size.x &&
+        rules_[i].size.y == record.size.y &&
+        rules_[i].ship_set == record.ship_set)
+      return static_cast<std::uint32_t>(i);
+
+  GameRules rules = {record.size, record.ship_set};
+  payload_.clear();
+  EncodeRules(rules, payload_);
+  WriteChunk(kRulesChunk);
+  rules_.push_back(rules);
+  return static_cast<std::uint32_t>(rules_.size() - 1);
+}
+
+// Construct a writer with no file open.
+RecordWriter::RecordWriter() : file_(0), failed_(false) {}
+
+// Flush and close the file.
+RecordWriter::~RecordWriter() { Close(); }
+
+// Open a record file for appending, creating it if needed. The players and
+// rules of an existing file are picked up so ids stay consistent, and a chunk
+// cut short is removed. Return false if the file is not a record file we can
+// extend.
+bool RecordWriter::Open(char const *path) {
+  Close();
+  failed_ = false;
+  players_.clear();
+  rules_.clear();
+
+  long size = 0;
+  if (std::FILE *file = std::fopen(path, "rb")) {
+    std::fseek(file, 0, SEEK_END);
+    size = std::ftell(file);
+    std::fclose(file);
+  }
+  if (size > 0) {
+    RecordReader reader;
+    GameRecord record;
+    if (!reader.Open(path)) return false;
+    while (reader.Next(record)) {
+    }
+    if (reader.failed()) return false;
+    players_ = reader.players();
+    rules_ = reader.rules();
+    if (reader.position() != static_cast<std::size_t>(size)) {
+#ifdef _WIN32
+      return false;
+#else
+      if (::truncate(path, static_cast<off_t>(reader.position())) != 0)
+        return false;
+#endif
+    }
+  }
+
+  file_ = std::fopen(path, "ab");
+  if (file_ == 0) return false;
+  if (size == 0 &&
+      (std::fwrite(kRecordMagic, 1, sizeof(kRecordMagic), file_) !=
+           sizeof(kRecordMagic) ||
+       std::fputc(kRecordVersion, file_) == EOF)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+// Flush and close the file. Return false if anything failed to be written.
+bool RecordWriter::Close() {
+  if (file_ == 0) return !failed_;
+  if (std::fclose(file_) != 0) failed_ = true;
+  file_ = 0;
+  return !failed_;
+}
+
+// Return the id of a player, declaring it in the file the first time. If it
+// cannot be declared the writer fails, and the Write of a game naming it
+// returns false.
+std::uint32_t RecordWriter::AddPlayer(std::string const &name) {
+  std::vector<std::string>::iterator it =
+      std::find(players_.begin(), players_.end(), name);
+  if (it != players_.end())
+    return static_cast<std::uint32_t>(it - players_.begin());
+
+  payload_.assign(name.begin(), name.end());
+  WriteChunk(kPlayerChunk);
+  players_.push_back(name);
+  return static_cast<std::uint32_t>(players_.size() - 1);
+}
+
+// Append a game, declaring its rules if they are new. Its player ids must come
+// from AddPlayer.
+bool RecordWriter::Write(GameRecord const &record) {
+  assert(record.players[0] < players_.size() &&
+         record.players[1] < players_.size());
+  std::uint32_t rules = AddRules(record);
+  payload_.clear();
+  EncodeGame(record, rules, payload_);
+  return WriteChunk(kGameChunk);
+}
+
+// Push buffered games to the file. Return false, failing the writer, if they
+// could not be written, or if the writer already failed.
+bool RecordWriter::Flush() {
+  if (!failed_ && std::fflush(file_) != 0) failed_ = true;
+  return !failed_;
+}
+
+// Return whether a write failed since Open.
+bool RecordWriter::failed() const { return failed_; }
+
+}  // namespace battleship
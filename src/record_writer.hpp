@@ -0,0 +1,47 @@
+#ifndef BATTLESHIP_RECORD_WRITER_H
+#define BATTLESHIP_RECORD_WRITER_H
+
+#include "game_record.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace battleship {
+
+// Appends games to a record file, see game_record.hpp for the format. Games
+// are only ever added at the end, so a crash loses at most the chunk being
+// written, which readers ignore and the next Open cuts off. Not thread safe.
+class RecordWriter {
+ private:
+  std::FILE *file_;
+  // Whether a write failed. The file may then end in a chunk cut short or
+  // name a player or rules it never declared, so nothing more is written and
+  // every later Write, Flush and Close reports the failure until Open.
+  bool failed_;
+  std::vector<std::string> players_;
+  std::vector<GameRules> rules_;
+  // Scratch space for a chunk, reused from game to game.
+  std::vector<std::uint8_t> payload_;
+  std::vector<std::uint8_t> chunk_;
+
+  bool WriteChunk(RecordChunk kind);
+  std::uint32_t AddRules(GameRecord const &record);
+
+  RecordWriter(RecordWriter const &);
+  RecordWriter &operator=(RecordWriter const &);
+
+ public:
+  RecordWriter();
+  ~RecordWriter();
+  bool Open(char const *path);
+  bool Close();
+  std::uint32_t AddPlayer(std::string const &name);
+  bool Write(GameRecord const &record);
+  bool Flush();
+  bool failed() const;
+};
+
+}  // namespace battleship
+#endif  // #ifndef BATTLESHIP_RECORD_WRITER_H
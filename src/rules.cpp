@@ -18,7 +18,27 @@ static char const* const kRules =
     "When the placing round is over, players will alternate in making attacks. "
     "After each attack, markers will be placed indicating hits and misses. "
     "Sunk ships will also be revealed. When a player has sunk all of the "
-    "opponents ships, that player has won the game.";
+    "opponents ships, that player has won the game.\n\n"
+
+    "In salvo games every turn is a salvo of one shot per ship the attacker "
+    "has afloat. Click cells to mark them, or a marked cell to unmark it, and "
+    "the salvo is fired once every shot has a cell. Salvo games are not "
+    "saved.\n\n"
+
+    "Edit > Undo attack takes back attacks of one shot a turn until the game "
+    "is over, against the computer along with its answer, and Edit > Redo "
+    "attack makes them again.\n\n"
+
+    "Large arenas scroll. Hold Ctrl and turn the mouse wheel, or use the View "
+    "menu, to zoom in and out.\n\n"
+
+    "Finished games are saved for battleship_stats, which finds where players "
+    "tend to place ships and shoot. View > Show heatmap shades the arenas with "
+    "the heatmaps it writes.\n\n"
+
+    "File > Play online joins a battleship_server with the board size and "
+    "ships selected for the last new game, and starts once another player "
+    "joins with the same ones. Online games are not saved.";
 
 Rules::Rules(QWidget* parent) : QDialog(parent) {
   QTextEdit* text_edit = new QTextEdit;
@@ -1,9 +1,16 @@
 #ifndef BATTLESHIP_SHIP_H
 #define BATTLESHIP_SHIP_H
 
+#include <cassert>
+#include <cstdint>
 #include <cstdlib>
 namespace battleship {
 
+struct Cell {
+  std::size_t x;
+  std::size_t y;
+};
+
 struct Ship {
   enum Orientation { kHorizontal, kVertical };
   Orientation orientation;
@@ -12,5 +19,67 @@ struct Ship {
   std::size_t length;
 };
 
+// Return a ship mirrored along the diagonal, as it lies on a transposed board.
+inline Ship Transposed(Ship ship) {
+  std::size_t x = ship.x;
+  ship.x = ship.y;
+  ship.y = x;
+  ship.orientation = ship.orientation == Ship::kHorizontal ? Ship::kVertical
+                                                           : Ship::kHorizontal;
+  return ship;
+}
+
+// Return whether a ship covers a cell.
+inline bool Covers(Ship const &ship, std::size_t x, std::size_t y) {
+  if (ship.orientation == Ship::kHorizontal)
+    return y == ship.y && x >= ship.x && x - ship.x < ship.length;
+  return x == ship.x && y >= ship.y && y - ship.y < ship.length;
+}
+
+// A ship in one 32 bit word, for wherever ships are kept in bulk: x in bits
+// 0-9, y in bits 10-19, the length in bits 20-30 and whether it is vertical
+// in bit 31. Every ship of a board up to kMaxPackedSide cells a side packs
+// and unpacks losslessly.
+struct PackedShip {
+  std::uint32_t bits;
+};
+
+static std::size_t const kMaxPackedSide = 1024;
+
+// Return whether every ship of a board fits a PackedShip.
+inline bool CanPack(std::size_t x_size, std::size_t y_size) {
+  return x_size <= kMaxPackedSide && y_size <= kMaxPackedSide;
+}
+
+// Return a ship in one word. It must lie on a board CanPack accepts.
+inline PackedShip Pack(Ship const &ship) {
+  assert(ship.x < kMaxPackedSide && ship.y < kMaxPackedSide &&
+         ship.length <= kMaxPackedSide);
+  PackedShip packed;
+  packed.bits = static_cast<std::uint32_t>(
+      ship.x | ship.y << 10 | ship.length << 20 |
+      std::size_t(ship.orientation == Ship::kVertical) << 31);
+  return packed;
+}
+
+// Return the ship a word holds.
+inline Ship Unpack(PackedShip packed) {
+  Ship ship;
+  ship.orientation = packed.bits >> 31 ? Ship::kVertical : Ship::kHorizontal;
+  ship.x = packed.bits & 0x3ff;
+  ship.y = packed.bits >> 10 & 0x3ff;
+  ship.length = packed.bits >> 20 & 0x7ff;
+  return ship;
+}
+
+// Return whether a packed ship covers a cell, reading its fields in place.
+inline bool Covers(PackedShip ship, std::size_t x, std::size_t y) {
+  std::size_t start_x = ship.bits & 0x3ff;
+  std::size_t start_y = ship.bits >> 10 & 0x3ff;
+  std::size_t length = ship.bits >> 20 & 0x7ff;
+  if (ship.bits >> 31) return x == start_x && y - start_y < length;
+  return y == start_y && x - start_x < length;
+}
+
 }  // namespace battleship
 #endif  // #ifndef BATTLESHIP_SHIP_H
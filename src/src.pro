@@ -1,6 +1,21 @@
-QT += core gui widgets
+QT += core gui network widgets
 
 TARGET = BattleShip
 TEMPLATE = app
-SOURCES += arena.cpp board.cpp game.cpp game_selection.cpp rules.cpp main.cpp
-HEADERS  += arena.hpp board.hpp game.hpp game_selection.hpp rules.hpp ship.hpp
+SOURCES += arena.cpp attacker.cpp batch_board.cpp board.cpp board_snapshot.cpp \
+           book_attacker.cpp cell_map.cpp density_attacker.cpp \
+           engine_protocol.cpp fleet_generator.cpp frame_trace.cpp game.cpp \
+           game_context.cpp game_record.cpp game_selection.cpp game_state.cpp \
+           heatmap.cpp layout_graph.cpp metrics.cpp move_worker.cpp \
+           opening_book.cpp placement_table.cpp posterior_attacker.cpp \
+           posterior_solver.cpp presets.cpp protocol.cpp random_attacker.cpp \
+           record_reader.cpp record_writer.cpp rules.cpp main.cpp
+HEADERS  += arena.hpp attacker.hpp batch_board.hpp bit_grid.hpp bitboard.hpp \
+            board.hpp board_snapshot.hpp book_attacker.hpp cell_map.hpp \
+            density_attacker.hpp engine_protocol.hpp fixed_board.hpp \
+            fleet_generator.hpp frame_trace.hpp game.hpp game_context.hpp \
+            game_record.hpp game_selection.hpp game_state.hpp heatmap.hpp \
+            layout_graph.hpp metrics.hpp move_worker.hpp opening_book.hpp \
+            placement_table.hpp posterior_attacker.hpp posterior_solver.hpp \
+            presets.hpp protocol.hpp random_attacker.hpp record_reader.hpp \
+            record_writer.hpp rules.hpp ship.hpp
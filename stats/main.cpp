@@ -0,0 +1,435 @@
+#include "heatmap.hpp"
+#include "record_reader.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace battleship {
+namespace {
+
+// Games handed to a worker at a time.
+std::size_t const kStride = 4096;
+
+struct Options {
+  std::size_t threads;
+  // Where to write the heatmaps, empty to write none.
+  std::string heatmaps;
+  // Only write the heatmaps of this player if not empty.
+  std::string player;
+  bool histograms;
+  std::vector<std::string> files;
+};
+
+// A count of every value seen.
+struct Histogram {
+  std::vector<std::uint64_t> counts;
+  std::uint64_t total;
+  std::uint64_t sum;
+};
+
+// What a player did under one configuration.
+struct PlayerTally {
+  // Every game counts once for each side the player played.
+  std::uint64_t games;
+  std::uint64_t wins;
+  std::uint64_t shots;
+  std::uint64_t hits;
+  Histogram shots_to_win;
+  // Shots until the first hit, for boards that were hit at all.
+  Histogram first_hit;
+  // Where the player put ships and fired, over how many boards. Empty on
+  // boards too large for heatmaps.
+  std::vector<std::uint64_t> placements;
+  std::vector<std::uint64_t> shot_cells;
+  std::uint64_t boards;
+};
+
+// Sums over games. Tallies of a configuration and player are kept at
+// configuration * players + player, and wins of a player over another at
+// (configuration * players + winner) * players + loser. Everything is an
+// integer so merging the workers in any order gives the same result.
+struct Tally {
+  std::uint64_t games;
+  std::uint64_t finished;
+  std::vector<PlayerTally> players;
+  std::vector<std::uint64_t> versus;
+};
+
+// A record file and how its ids map to ours.
+struct Source {
+  std::string path;
+  RecordReader reader;
+  std::vector<std::size_t> starts;
+  std::vector<std::size_t> players;
+  std::vector<std::size_t> rules;
+};
+
+// A run of games of one source.
+struct Task {
+  std::size_t source;
+  std::size_t begin;
+  std::size_t end;
+};
+
+// The state a worker reuses from game to game.
+struct Worker {
+  ShipIndex index;
+  GameRecord record;
+  Tally tally;
+  // The first malformed game found, if any.
+  std::size_t bad_source;
+  std::size_t bad_position;
+  bool failed;
+};
+
+// Count a value.
+void Add(Histogram &histogram, std::size_t value) {
+  if (value >= histogram.counts.size()) histogram.counts.resize(value + 1);
+  ++histogram.counts[value];
+  ++histogram.total;
+  histogram.sum += value;
+}
+
+// Add the counts of another histogram.
+void Merge(Histogram &histogram, Histogram const &other) {
+  if (other.counts.size() > histogram.counts.size())
+    histogram.counts.resize(other.counts.size());
+  for (std::size_t i = 0, e = other.counts.size(); i != e; ++i)
+    histogram.counts[i] += other.counts[i];
+  histogram.total += other.total;
+  histogram.sum += other.sum;
+}
+
+// Return the mean of the values seen, 0 if there are none.
+double Mean(Histogram const &histogram) {
+  if (histogram.total == 0) return 0;
+  return static_cast<double>(histogram.sum) /
+         static_cast<double>(histogram.total);
+}
+
+// Return the smallest value at least a fraction of the values do not exceed.
+std::size_t Percentile(Histogram const &histogram, double fraction) {
+  std::uint64_t seen = 0;
+  double wanted = fraction * static_cast<double>(histogram.total);
+  for (std::size_t i = 0, e = histogram.counts.size(); i != e; ++i) {
+    seen += histogram.counts[i];
+    if (seen != 0 && static_cast<double>(seen) >= wanted) return i;
+  }
+  return 0;
+}
+
+// Make an empty tally for the players and configurations of all sources.
+void InitTally(Tally &tally, std::size_t players, std::size_t rules) {
+  tally.games = 0;
+  tally.finished = 0;
+  PlayerTally empty = {0, 0, 0, 0, {}, {}, {}, {}, 0};
+  tally.players.assign(rules * players, empty);
+  tally.versus.assign(rules * players * players, 0);
+}
+
+// Add the counts of another tally.
+void Merge(Tally &tally, Tally const &other) {
+  tally.games += other.games;
+  tally.finished += other.finished;
+  for (std::size_t i = 0, e = tally.players.size(); i != e; ++i) {
+    PlayerTally &player = tally.players[i];
+    PlayerTally const &from = other.players[i];
+    player.games += from.games;
+    player.wins += from.wins;
+    player.shots += from.shots;
+    player.hits += from.hits;
+    Merge(player.shots_to_win, from.shots_to_win);
+    Merge(player.first_hit, from.first_hit);
+    player.boards += from.boards;
+    if (player.placements.empty()) {
+      player.placements = from.placements;
+      player.shot_cells = from.shot_cells;
+      continue;
+    }
+    for (std::size_t j = 0, e2 = from.placements.size(); j != e2; ++j) {
+      player.placements[j] += from.placements[j];
+      player.shot_cells[j] += from.shot_cells[j];
+    }
+  }
+  for (std::size_t i = 0, e = tally.versus.size(); i != e; ++i)
+    tally.versus[i] += other.versus[i];
+}
+
+// Add a game to the tally. Board b is attacked by players[b] and holds the
+// fleet the other player placed.
+void CountGame(Tally &tally, GameRecord const &record, Source const &source,
+               std::size_t players) {
+  std::size_t rules = source.rules[record.rules];
+  std::size_t ids[2];
+  for (std::size_t b = 0; b != 2; ++b)
+    ids[b] = source.players[record.players[b]];
+
+  std::size_t cells = record.size.x * record.size.y;
+  bool heatmaps = cells <= Heatmap::kMaxCells;
+  std::size_t shots[2] = {0, 0};
+  std::size_t hits[2] = {0, 0};
+  std::size_t first_hit[2] = {0, 0};
+  std::size_t sunk[2] = {0, 0};
+  for (std::size_t i = 0, e = record.attacks.size(); i != e; ++i) {
+    RecordedAttack const &attack = record.attacks[i];
+    std::size_t b = i % 2;
+    ++shots[b];
+    if (heatmaps) {
+      PlayerTally &attacker = tally.players[rules * players + ids[b]];
+      if (attacker.shot_cells.empty()) {
+        attacker.placements.assign(cells, 0);
+        attacker.shot_cells.assign(cells, 0);
+      }
+      ++attacker.shot_cells[attack.y * record.size.x + attack.x];
+    }
+    if (attack.result == Board::kMiss) continue;
+    if (hits[b]++ == 0) first_hit[b] = shots[b];
+    if (attack.result == Board::kSunk) ++sunk[b];
+  }
+
+  ++tally.games;
+  for (std::size_t b = 0; b != 2; ++b) {
+    PlayerTally &attacker = tally.players[rules * players + ids[b]];
+    ++attacker.games;
+    attacker.shots += shots[b];
+    attacker.hits += hits[b];
+    if (hits[b] != 0) Add(attacker.first_hit, first_hit[b]);
+
+    std::vector<PackedShip> const &fleet = record.fleets[b];
+    if (!fleet.empty() && sunk[b] == fleet.size()) {
+      ++tally.finished;
+      ++attacker.wins;
+      Add(attacker.shots_to_win, shots[b]);
+      ++tally.versus[(rules * players + ids[b]) * players + ids[1 - b]];
+    }
+
+    if (!heatmaps) continue;
+    PlayerTally &placer = tally.players[rules * players + ids[1 - b]];
+    if (placer.placements.empty()) {
+      placer.placements.assign(cells, 0);
+      placer.shot_cells.assign(cells, 0);
+    }
+    ++placer.boards;
+    for (std::size_t i = 0, e = fleet.size(); i != e; ++i) {
+      Ship ship = Unpack(fleet[i]);
+      std::size_t step = ship.orientation == Ship::kVertical ? record.size.x
+                                                             : 1;
+      std::size_t cell = ship.y * record.size.x + ship.x;
+      for (std::size_t j = 0; j != ship.length; ++j, cell += step)
+        ++placer.placements[cell];
+    }
+  }
+}
+
+// Return the id of a name, adding it if it is new.
+std::size_t FindPlayer(std::vector<std::string> &names,
+                       std::string const &name) {
+  std::size_t i = std::find(names.begin(), names.end(), name) - names.begin();
+  if (i == names.size()) names.push_back(name);
+  return i;
+}
+
+// Return the id of a configuration, adding it if it is new.
+std::size_t FindRules(std::vector<GameRules> &all, GameRules const &rules) {
+  for (std::size_t i = 0, e = all.size(); i != e; ++i)
+    if (all[i].size.x == rules.size.x && all[i].size.y == rules.size.y &&
+        all[i].ship_set == rules.ship_set)
+      return i;
+  all.push_back(rules);
+  return all.size() - 1;
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: battleship_stats [options] FILE...\n"
+               "  --threads N      worker threads (default: all cores)\n"
+               "  --heatmaps FILE  write placement and shot heatmaps\n"
+               "  --player NAME    only write the heatmaps of a player\n"
+               "  --histograms     print the full distributions\n"
+               "FILEs are game records, as battleship_sim --record writes\n");
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+  options.threads = 0;
+  options.histograms = false;
+  for (int i = 1; i < argc; ++i) {
+    char const *arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (std::strcmp(arg, "--threads") == 0 && has_value) {
+      options.threads = std::strtoul(argv[++i], 0, 10);
+    } else if (std::strcmp(arg, "--heatmaps") == 0 && has_value) {
+      options.heatmaps = argv[++i];
+    } else if (std::strcmp(arg, "--player") == 0 && has_value) {
+      options.player = argv[++i];
+    } else if (std::strcmp(arg, "--histograms") == 0) {
+      options.histograms = true;
+    } else if (arg[0] != '-') {
+      options.files.push_back(arg);
+    } else {
+      return false;
+    }
+  }
+  return !options.files.empty();
+}
+
+// Print the values seen and how often.
+void PrintHistogram(char const *name, Histogram const &histogram) {
+  std::printf("    %s:", name);
+  for (std::size_t i = 0, e = histogram.counts.size(); i != e; ++i)
+    if (histogram.counts[i] != 0)
+      std::printf(" %zu:%llu", i,
+                  static_cast<unsigned long long>(histogram.counts[i]));
+  std::printf("\n");
+}
+
+}  // namespace
+}  // namespace battleship
+
+int main(int argc, char *argv[]) {
+  using namespace battleship;
+
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+
+  // Find the games of every file and give players and configurations the
+  // same ids across files.
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::vector<std::string> names;
+  std::vector<GameRules> rules;
+  std::vector<std::unique_ptr<Source> > sources;
+  std::vector<Task> tasks;
+  for (std::size_t i = 0, e = options.files.size(); i != e; ++i) {
+    sources.push_back(std::unique_ptr<Source>(new Source));
+    Source &source = *sources.back();
+    source.path = options.files[i];
+    if (!source.reader.Open(source.path.c_str()) ||
+        !source.reader.Split(kStride, source.starts)) {
+      std::fprintf(stderr, "cannot read %s\n", source.path.c_str());
+      return 1;
+    }
+    std::vector<std::string> const &players = source.reader.players();
+    for (std::size_t j = 0, e2 = players.size(); j != e2; ++j)
+      source.players.push_back(FindPlayer(names, players[j]));
+    std::vector<GameRules> const &file_rules = source.reader.rules();
+    for (std::size_t j = 0, e2 = file_rules.size(); j != e2; ++j)
+      source.rules.push_back(FindRules(rules, file_rules[j]));
+    for (std::size_t j = 0; j + 1 < source.starts.size(); ++j) {
+      Task task = {i, source.starts[j], source.starts[j + 1]};
+      tasks.push_back(task);
+    }
+  }
+
+  WorkStealingPool pool(options.threads);
+  std::vector<Worker> workers(pool.threads());
+  for (std::size_t i = 0, e = workers.size(); i != e; ++i) {
+    InitTally(workers[i].tally, names.size(), rules.size());
+    workers[i].failed = false;
+  }
+  pool.ParallelFor(
+      tasks.size(), 1,
+      [&](std::size_t worker, std::size_t begin, std::size_t end) {
+        Worker &w = workers[worker];
+        for (std::size_t t = begin; t != end; ++t) {
+          Source const &source = *sources[tasks[t].source];
+          std::size_t position = tasks[t].begin;
+          while (source.reader.Read(position, tasks[t].end, w.index,
+                                    w.record))
+            CountGame(w.tally, w.record, source, names.size());
+          if (position != tasks[t].end && !w.failed) {
+            w.failed = true;
+            w.bad_source = tasks[t].source;
+            w.bad_position = position;
+          }
+        }
+      });
+
+  Tally total;
+  InitTally(total, names.size(), rules.size());
+  for (std::size_t i = 0, e = workers.size(); i != e; ++i) {
+    Merge(total, workers[i].tally);
+    if (workers[i].failed)
+      std::fprintf(stderr, "malformed game in %s at offset %zu\n",
+                   sources[workers[i].bad_source]->path.c_str(),
+                   workers[i].bad_position);
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  std::printf("games: %llu (%llu finished)\n",
+              static_cast<unsigned long long>(total.games),
+              static_cast<unsigned long long>(total.finished));
+  std::size_t players = names.size();
+  std::vector<Heatmap> heatmaps;
+  for (std::size_t r = 0, e = rules.size(); r != e; ++r) {
+    std::printf("\n%zux%zu, ships", rules[r].size.x, rules[r].size.y);
+    for (std::size_t i = 0, e2 = rules[r].ship_set.size(); i != e2; ++i)
+      std::printf("%c%zu", i == 0 ? ' ' : ',', rules[r].ship_set[i]);
+    std::printf("\n  %-12s %10s %8s %12s %16s %10s\n", "player", "games",
+                "win %", "shots to win", "p10/p50/p90", "first hit");
+
+    for (std::size_t p = 0; p != players; ++p) {
+      PlayerTally const &tally = total.players[r * players + p];
+      if (tally.games == 0 && tally.boards == 0) continue;
+      double games = static_cast<double>(std::max<std::uint64_t>(
+          tally.games, 1));
+      char percentiles[64];
+      std::snprintf(percentiles, sizeof(percentiles), "%zu/%zu/%zu",
+                    Percentile(tally.shots_to_win, 0.1),
+                    Percentile(tally.shots_to_win, 0.5),
+                    Percentile(tally.shots_to_win, 0.9));
+      std::printf("  %-12s %10llu %8.2f %12.3f %16s %10.3f\n",
+                  names[p].c_str(),
+                  static_cast<unsigned long long>(tally.games),
+                  100 * static_cast<double>(tally.wins) / games,
+                  Mean(tally.shots_to_win), percentiles,
+                  Mean(tally.first_hit));
+      if (options.histograms) {
+        PrintHistogram("shots to win", tally.shots_to_win);
+        PrintHistogram("first hit", tally.first_hit);
+      }
+
+      bool wanted = options.player.empty() || options.player == names[p];
+      if (!wanted || tally.placements.empty()) continue;
+      Heatmap heatmap = {Heatmap::kPlacements, rules[r].size, names[p],
+                         tally.boards, tally.placements};
+      if (tally.boards != 0) heatmaps.push_back(heatmap);
+      heatmap.kind = Heatmap::kShots;
+      heatmap.games = tally.games;
+      heatmap.counts = tally.shot_cells;
+      if (tally.games != 0) heatmaps.push_back(heatmap);
+    }
+
+    for (std::size_t a = 0; a != players; ++a)
+      for (std::size_t b = 0; b != players; ++b) {
+        std::uint64_t wins = total.versus[(r * players + a) * players + b];
+        std::uint64_t losses = total.versus[(r * players + b) * players + a];
+        if (a < b && wins + losses != 0)
+          std::printf("  %s vs %s: %llu-%llu\n", names[a].c_str(),
+                      names[b].c_str(), static_cast<unsigned long long>(wins),
+                      static_cast<unsigned long long>(losses));
+      }
+  }
+
+  if (!options.heatmaps.empty() &&
+      !WriteHeatmaps(options.heatmaps.c_str(), heatmaps)) {
+    std::fprintf(stderr, "cannot write %s\n", options.heatmaps.c_str());
+    return 1;
+  }
+  std::fprintf(stderr, "%.2f s, %.0f games/s on %zu threads\n", seconds,
+               static_cast<double>(total.games) / seconds, pool.threads());
+  for (std::size_t i = 0, e = workers.size(); i != e; ++i)
+    if (workers[i].failed) return 1;
+  return 0;
+}
@@ -0,0 +1,123 @@
+// Checks that every BatchBoard kernel this processor runs plays as sixteen
+// Boards do, on every preset map size: placements that overlap, attacks on
+// random lanes, retries and lanes restarted mid batch.
+
+#include "batch_board.hpp"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace battleship;
+
+namespace {
+
+// Attacks made per kernel and map size.
+std::size_t const kSteps = 3000;
+
+// Tries to place a ship at random before leaving it out of a game.
+std::size_t const kPlaceTries = 100;
+
+// Return whether two results agree.
+bool SameResult(Board::AttackResult const &a, Board::AttackResult const &b) {
+  if (a.type != b.type) return false;
+  if (a.type != Board::kHit && a.type != Board::kSunk) return true;
+  return a.ship->orientation == b.ship->orientation && a.ship->x == b.ship->x &&
+         a.ship->y == b.ship->y && a.ship->length == b.ship->length;
+}
+
+// Start a new game in a lane and on its Board, placing every ship of the set
+// at random and checking that both turn down the same overlaps. Return the
+// number of ships placed, or 0 on a mismatch.
+std::size_t StartGame(BatchBoard &batch, std::size_t lane, Board &board,
+                      ShipSet set, std::mt19937 &random) {
+  MapSize size = batch.size();
+  batch.ClearLane(lane);
+  board.Init(size.x, size.y);
+  std::size_t placed = 0;
+  for (std::size_t const *length = set.first; length != set.last; ++length) {
+    for (std::size_t i = 0; i != kPlaceTries; ++i) {
+      Ship ship;
+      ship.orientation = random() % 2 == 0 ? Ship::kHorizontal
+                                           : Ship::kVertical;
+      ship.length = *length;
+      bool across = ship.orientation == Ship::kHorizontal;
+      if ((across ? size.x : size.y) < ship.length) continue;
+      ship.x = random() % (size.x - (across ? ship.length - 1 : 0));
+      ship.y = random() % (size.y - (across ? 0 : ship.length - 1));
+      Board::PlaceResult expected = board.Place(ship);
+      Board::PlaceResult result = batch.Place(lane, ship);
+      if (result.type != expected.type) return 0;
+      if (result.type == Board::kPlaced) {
+        ++placed;
+        break;
+      }
+    }
+  }
+  return placed;
+}
+
+// Return whether a kernel plays games of a preset as Boards do.
+bool CheckPreset(BatchBoard::Kernel kernel, std::size_t preset) {
+  MapSize size = GetPresetMapSize(preset);
+  ShipSet set = GetPresetShipSet(preset);
+  std::mt19937 random(static_cast<unsigned>(preset + 1));
+  BatchBoard batch;
+  batch.UseKernel(kernel);
+  batch.Init(size, set.last - set.first);
+  std::vector<Board> boards(BatchBoard::kLanes);
+  std::vector<std::size_t> afloat(BatchBoard::kLanes);
+  for (std::size_t lane = 0; lane != BatchBoard::kLanes; ++lane) {
+    afloat[lane] = StartGame(batch, lane, boards[lane], set, random);
+    if (afloat[lane] == 0) return false;
+  }
+
+  std::uint32_t cells[BatchBoard::kLanes];
+  for (std::size_t step = 0; step != kSteps; ++step) {
+    BatchBoard::LaneMask lanes = random() & BatchBoard::kAllLanes;
+    for (std::size_t lane = 0; lane != BatchBoard::kLanes; ++lane)
+      cells[lane] = static_cast<std::uint32_t>(random() % (size.x * size.y));
+    BatchBoard::Outcome const &outcome = batch.Attack(cells, lanes);
+    for (std::size_t lane = 0; lane != BatchBoard::kLanes; ++lane) {
+      BatchBoard::LaneMask bit = BatchBoard::LaneMask(1) << lane;
+      if ((lanes & bit) == 0) continue;
+      Board::AttackResult expected =
+          boards[lane].Attack(cells[lane] % size.x, cells[lane] / size.x);
+      if (!SameResult(batch.result(lane), expected)) return false;
+      if (expected.type == Board::kSunk) --afloat[lane];
+      if (batch.ships_left(lane) != afloat[lane] ||
+          ((outcome.finished & bit) != 0) != (afloat[lane] == 0))
+        return false;
+      if (afloat[lane] != 0) continue;
+      afloat[lane] = StartGame(batch, lane, boards[lane], set, random);
+      if (afloat[lane] == 0) return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  BatchBoard::Kernel const kernels[] = {BatchBoard::kScalarKernel,
+                                        BatchBoard::kAvx2Kernel,
+                                        BatchBoard::kAvx512Kernel};
+  char const *const names[] = {"scalar", "AVX2", "AVX-512"};
+  bool ok = true;
+  for (std::size_t k = 0; k != 3; ++k) {
+    BatchBoard probe;
+    if (!probe.UseKernel(kernels[k])) {
+      std::printf("%s: not supported here, skipped\n", names[k]);
+      continue;
+    }
+    for (std::size_t preset = 0; preset != kNumPresets; ++preset) {
+      if (!CheckPreset(kernels[k], preset)) {
+        MapSize size = GetPresetMapSize(preset);
+        std::printf("FAIL: %s on %zux%zu\n", names[k], size.x, size.y);
+        ok = false;
+      }
+    }
+    std::printf("%s: checked\n", names[k]);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+// Checks that a FixedBoard of every preset size plays and counts salvos as a
+// Board does.
+
+#include "fixed_board.hpp"
+#include "fleet_generator.hpp"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace battleship;
+
+namespace {
+
+// Salvos of cells fired at each board, some at cells already attacked.
+std::size_t const kSalvos = 40;
+std::size_t const kSalvoSize = 5;
+
+// Return the attack counters collected so far.
+std::vector<std::uint64_t> AttackCounts() {
+  Metrics metrics;
+  CollectMetrics(metrics);
+  std::vector<std::uint64_t> counts;
+  counts.push_back(metrics.counters[kHitCounter]);
+  counts.push_back(metrics.counters[kMissCounter]);
+  counts.push_back(metrics.counters[kSunkCounter]);
+  counts.push_back(metrics.counters[kRetryCounter]);
+  return counts;
+}
+
+// Play the same fleet and salvos on a board as on a Board and record whether
+// every result and counter agreed.
+class Compare {
+ private:
+  MapSize size_;
+  std::vector<Ship> const &fleet_;
+  std::vector<Cell> const &cells_;
+
+ public:
+  bool same;
+
+  Compare(MapSize size, std::vector<Ship> const &fleet,
+          std::vector<Cell> const &cells)
+      : size_(size), fleet_(fleet), cells_(cells), same(true) {}
+
+  // A preset size must not fall through to a Board.
+  void operator()(Board &) { same = false; }
+
+  template <typename Fixed>
+  void operator()(Fixed &fixed) {
+    Board board(size_.x, size_.y);
+    for (std::size_t i = 0, e = fleet_.size(); i != e; ++i) {
+      board.Place(fleet_[i]);
+      fixed.Place(fleet_[i]);
+    }
+    std::vector<Board::AttackResult> expected(kSalvoSize);
+    std::vector<Board::AttackResult> results(kSalvoSize);
+    for (std::size_t s = 0; s != kSalvos; ++s) {
+      Cell const *salvo = &cells_[s * kSalvoSize];
+      std::vector<std::uint64_t> before = AttackCounts();
+      board.AttackMany(salvo, kSalvoSize, &expected[0]);
+      std::vector<std::uint64_t> middle = AttackCounts();
+      fixed.AttackMany(salvo, kSalvoSize, &results[0]);
+      std::vector<std::uint64_t> after = AttackCounts();
+      for (std::size_t i = 0; i != kSalvoSize; ++i) {
+        same = same && results[i].type == expected[i].type;
+        if (expected[i].type == Board::kHit ||
+            expected[i].type == Board::kSunk)
+          same = same && results[i].ship->x == expected[i].ship->x &&
+                 results[i].ship->y == expected[i].ship->y;
+      }
+      for (std::size_t i = 0; i != before.size(); ++i)
+        same = same && after[i] - middle[i] == middle[i] - before[i];
+    }
+  }
+};
+
+}  // namespace
+
+int main() {
+  std::mt19937 random(1);
+  bool ok = true;
+  for (std::size_t p = 0; p != kNumPresets; ++p) {
+    MapSize size = GetPresetMapSize(p);
+    ShipSet set = GetPresetShipSet(p);
+    FleetGenerator generator(1);
+    std::vector<Ship> fleet(set.last - set.first);
+    if (!generator.Init(size, set) || !generator.Generate(&fleet[0])) {
+      std::printf("FAIL: no fleet for %zux%zu\n", size.x, size.y);
+      return 1;
+    }
+    std::vector<Cell> cells;
+    for (std::size_t i = 0; i != kSalvos * kSalvoSize; ++i) {
+      Cell cell = {random() % size.x, random() % size.y};
+      cells.push_back(cell);
+    }
+    Compare compare(size, fleet, cells);
+    DispatchBoard(size, compare);
+    if (!compare.same) {
+      std::printf("FAIL: %zux%zu\n", size.x, size.y);
+      ok = false;
+    }
+  }
+  return ok ? 0 : 1;
+}
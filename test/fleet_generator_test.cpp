@@ -0,0 +1,170 @@
+// Checks that FleetGenerator draws every legal fleet equally often and turns
+// down sets that do not fit their board.
+
+#include "fleet_generator.hpp"
+#include "placement_table.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <vector>
+
+using namespace battleship;
+
+namespace {
+
+// Fleets drawn per legal layout.
+std::size_t const kDrawsPerLayout = 200;
+
+// A layout as the placement of each ship, ships of the same length sorted so
+// that a layout has one key whatever order its ships were drawn in.
+typedef std::vector<int> Layout;
+
+// Return the key of a fleet of ships sorted longest first.
+Layout MakeLayout(Ship const *ships, std::size_t count) {
+  Layout layout;
+  for (std::size_t i = 0; i != count; ++i)
+    layout.push_back(static_cast<int>(
+        ((ships[i].length * 64 + ships[i].y) * 64 + ships[i].x) * 2 +
+        (ships[i].orientation == Ship::kVertical)));
+  std::sort(layout.begin(), layout.end());
+  return layout;
+}
+
+// Add every legal layout of the ships from i on to layouts.
+void Enumerate(MapSize size, std::vector<std::size_t> const &lengths,
+               std::size_t i, std::vector<Ship> &ships, Bitboard &rows,
+               Bitboard &columns, std::map<Layout, std::size_t> &layouts) {
+  if (i == lengths.size()) {
+    layouts.insert(std::make_pair(MakeLayout(&ships[0], ships.size()), 0));
+    return;
+  }
+  PlacementTable const &table =
+      PlacementTable::Get(size.x, size.y, lengths[i]);
+  for (std::size_t p = 0, e = table.size(); p != e; ++p) {
+    if (table.Intersects(p, rows, columns)) continue;
+    ships[i] = table.GetShip(p);
+    table.Set(p, rows, columns);
+    Enumerate(size, lengths, i + 1, ships, rows, columns, layouts);
+    table.Reset(p, rows, columns);
+  }
+}
+
+// Draw fleets and return whether every layout came up as often as a uniform
+// draw would have it, by a chi-squared test far enough out to never fail by
+// chance with a fixed seed.
+bool CheckUniform(MapSize size, std::vector<std::size_t> lengths) {
+  std::sort(lengths.begin(), lengths.end(), std::greater<std::size_t>());
+  std::map<Layout, std::size_t> layouts;
+  std::vector<Ship> ships(lengths.size());
+  Bitboard rows;
+  Bitboard columns;
+  Enumerate(size, lengths, 0, ships, rows, columns, layouts);
+
+  FleetGenerator generator(1);
+  ShipSet set = {&lengths[0], &lengths[0] + lengths.size()};
+  if (!generator.Init(size, set)) {
+    std::printf("FAIL: %zux%zu set was rejected\n", size.x, size.y);
+    return false;
+  }
+  std::size_t draws = kDrawsPerLayout * layouts.size();
+  for (std::size_t i = 0; i != draws; ++i) {
+    if (!generator.Generate(&ships[0])) {
+      std::printf("FAIL: %zux%zu generation gave up\n", size.x, size.y);
+      return false;
+    }
+    std::map<Layout, std::size_t>::iterator it =
+        layouts.find(MakeLayout(&ships[0], ships.size()));
+    if (it == layouts.end()) {
+      std::printf("FAIL: %zux%zu generated an illegal fleet\n", size.x,
+                  size.y);
+      return false;
+    }
+    ++it->second;
+  }
+
+  double expected = static_cast<double>(kDrawsPerLayout);
+  double chi2 = 0;
+  for (std::map<Layout, std::size_t>::const_iterator it = layouts.begin();
+       it != layouts.end(); ++it) {
+    double d = static_cast<double>(it->second) - expected;
+    chi2 += d * d / expected;
+  }
+  double df = static_cast<double>(layouts.size() - 1);
+  double limit = df + 6 * std::sqrt(2 * df);
+  std::printf("%zux%zu: %zu layouts, chi2 %.1f, limit %.1f\n", size.x, size.y,
+              layouts.size(), chi2, limit);
+  return chi2 < limit;
+}
+
+// Return whether Init accepts a set.
+bool Accepts(MapSize size, std::vector<std::size_t> lengths) {
+  FleetGenerator generator;
+  ShipSet set = {&lengths[0], &lengths[0] + lengths.size()};
+  return generator.Init(size, set);
+}
+
+// Return whether Generate draws a fleet of a set that Init accepts.
+bool Generates(MapSize size, std::vector<std::size_t> lengths) {
+  FleetGenerator generator;
+  ShipSet set = {&lengths[0], &lengths[0] + lengths.size()};
+  std::vector<Ship> ships(lengths.size());
+  return generator.Init(size, set) && generator.Generate(&ships[0]);
+}
+
+// Return a set from a list of lengths ending in 0.
+std::vector<std::size_t> Lengths(std::size_t const *lengths) {
+  std::vector<std::size_t> set;
+  while (*lengths != 0) set.push_back(*lengths++);
+  return set;
+}
+
+}  // namespace
+
+int main() {
+  bool ok = true;
+
+  // Drawing each ship among the placements still legal fails all three.
+  MapSize small = {4, 4};
+  MapSize narrow = {5, 3};
+  std::size_t const set1[] = {3, 2, 2, 0};
+  std::size_t const set2[] = {4, 2, 2, 0};
+  std::size_t const set3[] = {4, 3, 2, 0};
+  ok = CheckUniform(small, Lengths(set1)) && ok;
+  ok = CheckUniform(small, Lengths(set2)) && ok;
+  ok = CheckUniform(narrow, Lengths(set3)) && ok;
+
+  // Fewer than one draw in 300 of this set fits, so it is drawn from its
+  // LayoutGraph.
+  std::size_t const packed[] = {3, 3, 3, 3, 2, 0};
+  ok = CheckUniform(small, Lengths(packed)) && ok;
+
+  // A ship longer than the board and a set with more cells than the board.
+  std::size_t const too_long[] = {5, 0};
+  std::size_t const too_many[] = {4, 4, 4, 4, 1, 0};
+  if (Accepts(small, Lengths(too_long)) || Accepts(small, Lengths(too_many))) {
+    std::printf("FAIL: Init accepted a set that cannot fit\n");
+    ok = false;
+  }
+
+  // Three ships of three cells fit a 5x2 board by count but not side by side.
+  MapSize flat = {5, 2};
+  std::size_t const tight[] = {3, 3, 3, 0};
+  std::size_t const loose[] = {3, 3, 0};
+  if (Generates(flat, Lengths(tight)) || !Generates(flat, Lengths(loose))) {
+    std::printf("FAIL: Generate on a 5x2 board\n");
+    ok = false;
+  }
+
+  // Boards too large for a Bitboard take the other path.
+  MapSize large = {1100, 3};
+  std::size_t const fleet[] = {5, 4, 3, 3, 2, 0};
+  if (!Generates(large, Lengths(fleet))) {
+    std::printf("FAIL: Generate on a 1100x3 board\n");
+    ok = false;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+// Checks that a GameContext starts new games without allocating once the
+// placement tables of their map sizes and ship sets exist.
+
+#include "game_context.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// Count every allocation of the program.
+static std::atomic<std::size_t> allocations(0);
+
+void *operator new(std::size_t size) {
+  ++allocations;
+  void *p = std::malloc(size != 0 ? size : 1);
+  if (p == 0) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+using namespace battleship;
+
+namespace {
+
+// Games started for every preset map size, ship set and variant.
+std::size_t const kRounds = 10;
+
+// Start a game of every preset map size, ship set and variant.
+bool PlayPresets(GameContext &context) {
+  GameState::Variant const variants[] = {GameState::kStandard,
+                                         GameState::kSalvo};
+  for (std::size_t size = 0; size != kNumPresets; ++size) {
+    for (std::size_t set = 0; set != kNumPresets; ++set) {
+      for (std::size_t variant = 0; variant != 2; ++variant) {
+        if (!context.Reset(GetPresetMapSize(size), GetPresetShipSet(set),
+                           variants[variant]) ||
+            !context.PlaceRandomFleets())
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  GameContext context(1);
+  // The first game of a size builds its placement tables.
+  if (!PlayPresets(context)) {
+    std::printf("FAIL: a preset game could not be set up\n");
+    return 1;
+  }
+
+  std::size_t before = allocations;
+  for (std::size_t i = 0; i != kRounds; ++i) PlayPresets(context);
+  std::size_t allocated = allocations - before;
+  std::printf("%zu allocations in %zu rounds of preset games\n", allocated,
+              kRounds);
+  return allocated == 0 ? 0 : 1;
+}
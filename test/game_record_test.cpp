@@ -0,0 +1,91 @@
+// Checks that DecodeGame replays the results of a game and turns down games
+// attacking a cell of a board twice, on boards with a dense and a sparse
+// ShipIndex.
+
+#include "game_record.hpp"
+
+#include <cstdio>
+#include <vector>
+
+using namespace battleship;
+
+namespace {
+
+// Return a record of a game on a board with one ship of two cells in the
+// corner of each board, attacking board 0 at cells and board 1 far away.
+GameRecord MakeRecord(MapSize size, std::vector<Cell> const &cells) {
+  GameRecord record;
+  record.Clear();
+  record.size = size;
+  record.ship_set.assign(1, 2);
+  record.players[0] = 0;
+  record.players[1] = 1;
+  Ship ship = {Ship::kHorizontal, 0, 0, 2};
+  record.fleets[0].assign(1, Pack(ship));
+  record.fleets[1].assign(1, Pack(ship));
+  for (std::size_t i = 0, e = cells.size(); i != e; ++i) {
+    RecordedAttack attack = {cells[i].x, cells[i].y, Board::kMiss};
+    record.attacks.push_back(attack);
+    RecordedAttack far = {size.x - 1, size.y - 1 - i, Board::kMiss};
+    record.attacks.push_back(far);
+  }
+  return record;
+}
+
+// Encode a record and return whether it decodes.
+bool Decodes(GameRecord const &record, ShipIndex &index, GameRecord &decoded) {
+  GameRules rules = {record.size, record.ship_set};
+  std::vector<GameRules> all(1, rules);
+  std::vector<std::uint8_t> payload;
+  EncodeGame(record, 0, payload);
+  return DecodeGame(&payload[0], &payload[0] + payload.size(), all, index,
+                    decoded);
+}
+
+// Return a cell.
+Cell MakeCell(std::size_t x, std::size_t y) {
+  Cell cell = {x, y};
+  return cell;
+}
+
+// Return whether decoding works on a board size.
+bool CheckSize(MapSize size) {
+  ShipIndex index;
+  GameRecord decoded;
+
+  std::vector<Cell> twice;
+  twice.push_back(MakeCell(0, 0));
+  twice.push_back(MakeCell(3, 3));
+  twice.push_back(MakeCell(0, 0));
+  if (Decodes(MakeRecord(size, twice), index, decoded)) {
+    std::printf("FAIL: %zux%zu decoded a cell attacked twice\n", size.x,
+                size.y);
+    return false;
+  }
+
+  // The same cells of board 0 again in a game of their own, with the index
+  // left by the game turned down.
+  std::vector<Cell> sink;
+  sink.push_back(MakeCell(0, 0));
+  sink.push_back(MakeCell(3, 3));
+  sink.push_back(MakeCell(1, 0));
+  if (!Decodes(MakeRecord(size, sink), index, decoded) ||
+      decoded.attacks.size() != 6 ||
+      decoded.attacks[0].result != Board::kHit ||
+      decoded.attacks[2].result != Board::kMiss ||
+      decoded.attacks[4].result != Board::kSunk) {
+    std::printf("FAIL: %zux%zu did not replay a game\n", size.x, size.y);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  MapSize small = {10, 10};
+  MapSize large = {300, 300};
+  bool ok = CheckSize(small);
+  ok = CheckSize(large) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+// Checks that what threads counted and timed is still collected after they
+// exit, and that their shards are freed when they do.
+
+#include "metrics.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+// Count the allocations of the program that were not freed.
+static std::atomic<long> live_allocations(0);
+
+void *operator new(std::size_t size) {
+  ++live_allocations;
+  void *p = std::malloc(size != 0 ? size : 1);
+  if (p == 0) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept {
+  if (p != 0) --live_allocations;
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  if (p != 0) --live_allocations;
+  std::free(p);
+}
+
+using namespace battleship;
+
+namespace {
+
+// Threads started one after another, as repeated ParallelFor calls do.
+std::size_t const kThreads = 200;
+
+// Count and time a little, then exit.
+void Play() {
+  CountMetric(kHitCounter, 3);
+  RecordTime(kMoveTimer, 100);
+}
+
+}  // namespace
+
+int main() {
+  SetMetricsTiming(true);
+  // The first thread makes the registry.
+  std::thread(Play).join();
+  long before = live_allocations;
+  for (std::size_t i = 1; i != kThreads; ++i) std::thread(Play).join();
+  long leaked = live_allocations - before;
+
+  Metrics metrics;
+  CollectMetrics(metrics);
+  std::printf("%llu hits, %llu moves timed, %ld allocations left\n",
+              static_cast<unsigned long long>(metrics.counters[kHitCounter]),
+              static_cast<unsigned long long>(
+                  metrics.timers[kMoveTimer].count()),
+              leaked);
+  bool ok = metrics.counters[kHitCounter] == 3 * kThreads &&
+            metrics.timers[kMoveTimer].count() == kThreads &&
+            metrics.timers[kMoveTimer].max() == 100 && leaked == 0;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+// Checks that PlacementTable::Filter keeps exactly the placements that do not
+// intersect a set, in order, on every board size a table covers.
+
+#include "placement_table.hpp"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace battleship;
+
+namespace {
+
+// Random sets tried per table.
+std::size_t const kSets = 20;
+
+// Return whether Filter agrees with Intersects on a set.
+bool CheckFilter(PlacementTable const &table, Bitboard const &cells) {
+  Bitboard columns = cells.Transposed();
+  std::vector<std::uint32_t> legal(table.size());
+  std::size_t count = table.Filter(cells, columns, legal.data());
+  std::size_t expected = 0;
+  for (std::size_t i = 0, e = table.size(); i != e; ++i) {
+    if (table.Intersects(i, cells, columns)) continue;
+    if (expected == count || legal[expected] != i) return false;
+    ++expected;
+  }
+  return expected == count;
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 random(1);
+  std::size_t failures = 0;
+  for (std::size_t x = 1; x <= Bitboard::kMaxWidth; ++x) {
+    for (std::size_t y = 1; y <= Bitboard::kMaxHeight; ++y) {
+      for (std::size_t length = 1; length <= 8; ++length) {
+        if (length > x && length > y) continue;
+        PlacementTable const &table = PlacementTable::Get(x, y, length);
+        // Fill from empty to full, so every outcome of a step comes up.
+        for (std::size_t i = 0; i != kSets; ++i) {
+          Bitboard cells;
+          for (std::size_t cx = 0; cx != x; ++cx)
+            for (std::size_t cy = 0; cy != y; ++cy)
+              if (random() % kSets < i) cells.Set(cx, cy);
+          if (!CheckFilter(table, cells)) {
+            std::printf("FAIL: %zux%zu length %zu\n", x, y, length);
+            ++failures;
+            break;
+          }
+        }
+      }
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+// Checks the exact counts of PosteriorSolver against enumerating every fleet,
+// and that counts too large for 64 bits fall back to sampling.
+
+#include "posterior_solver.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+using namespace battleship;
+
+namespace {
+
+// What was seen of a board, as the solver is told it.
+struct Observation {
+  std::size_t x;
+  std::size_t y;
+  Board::AttackType type;
+  Ship ship;
+};
+
+// A game seen so far: the board, the whole ship set and the attacks made.
+struct Scenario {
+  char const *name;
+  MapSize size;
+  std::vector<std::size_t> lengths;
+  std::vector<Observation> observations;
+};
+
+// Every fleet of the ships afloat that fits what was seen, counted by trying
+// every placement of every ship.
+class BruteForce {
+ private:
+  MapSize size_;
+  std::vector<std::size_t> afloat_;
+  // Misses and sunk ships, and hits of ships afloat.
+  std::vector<bool> blocked_;
+  std::vector<bool> hits_;
+  std::vector<int> occupied_;
+
+  // Return the cells of a ship.
+  std::vector<std::size_t> Cells(Ship const &ship) const {
+    std::vector<std::size_t> cells;
+    std::size_t dx = ship.orientation == Ship::kHorizontal ? 1 : 0;
+    std::size_t dy = 1 - dx;
+    for (std::size_t i = 0; i != ship.length; ++i)
+      cells.push_back((ship.y + i * dy) * size_.x + ship.x + i * dx);
+    return cells;
+  }
+
+  // Place the ships from i on, ships of equal length in increasing order of
+  // placement so every fleet is counted once.
+  void Place(std::size_t i, std::size_t first) {
+    if (i == afloat_.size()) {
+      for (std::size_t c = 0, e = hits_.size(); c != e; ++c)
+        if (hits_[c] && occupied_[c] == 0) return;
+      ++fleets;
+      for (std::size_t c = 0, e = hits_.size(); c != e; ++c)
+        coverage[c] += occupied_[c] != 0;
+      return;
+    }
+    std::size_t length = afloat_[i];
+    std::size_t count = 2 * size_.x * size_.y;
+    for (std::size_t p = first; p != count; ++p) {
+      Ship ship;
+      ship.orientation = p % 2 == 0 ? Ship::kHorizontal : Ship::kVertical;
+      ship.x = p / 2 % size_.x;
+      ship.y = p / 2 / size_.x;
+      ship.length = length;
+      if (length == 1 && ship.orientation == Ship::kVertical) continue;
+      if (ship.orientation == Ship::kHorizontal ? ship.x + length > size_.x
+                                                : ship.y + length > size_.y)
+        continue;
+      std::vector<std::size_t> cells = Cells(ship);
+      bool free = true;
+      std::size_t hit = 0;
+      for (std::size_t j = 0; j != length; ++j) {
+        free = free && !blocked_[cells[j]] && occupied_[cells[j]] == 0;
+        hit += hits_[cells[j]];
+      }
+      // A ship with every cell hit would have been reported sunk.
+      if (!free || hit == length) continue;
+      for (std::size_t j = 0; j != length; ++j) ++occupied_[cells[j]];
+      bool same = i + 1 != afloat_.size() && afloat_[i + 1] == length;
+      Place(i + 1, same ? p + 1 : 0);
+      for (std::size_t j = 0; j != length; ++j) --occupied_[cells[j]];
+    }
+  }
+
+ public:
+  std::uint64_t fleets;
+  std::vector<std::uint64_t> coverage;
+
+  explicit BruteForce(Scenario const &scenario)
+      : size_(scenario.size),
+        afloat_(scenario.lengths),
+        blocked_(size_.x * size_.y, false),
+        hits_(size_.x * size_.y, false),
+        occupied_(size_.x * size_.y, 0),
+        fleets(0),
+        coverage(size_.x * size_.y, 0) {
+    for (std::size_t i = 0, e = scenario.observations.size(); i != e; ++i) {
+      Observation const &observation = scenario.observations[i];
+      std::size_t cell = observation.y * size_.x + observation.x;
+      if (observation.type == Board::kMiss) blocked_[cell] = true;
+      if (observation.type == Board::kHit) hits_[cell] = true;
+      if (observation.type != Board::kSunk) continue;
+      std::vector<std::size_t> cells = Cells(observation.ship);
+      for (std::size_t j = 0, f = cells.size(); j != f; ++j) {
+        blocked_[cells[j]] = true;
+        hits_[cells[j]] = false;
+      }
+      afloat_.erase(std::find(afloat_.begin(), afloat_.end(),
+                              observation.ship.length));
+    }
+    std::sort(afloat_.begin(), afloat_.end(), std::greater<std::size_t>());
+    Place(0, 0);
+  }
+};
+
+// Tell a solver what was seen in a scenario.
+void Observe(PosteriorSolver &solver, Scenario const &scenario) {
+  std::vector<std::size_t> lengths(scenario.lengths);
+  ShipSet set = {&lengths[0], &lengths[0] + lengths.size()};
+  solver.Init(scenario.size, set);
+  for (std::size_t i = 0, e = scenario.observations.size(); i != e; ++i) {
+    Observation const &observation = scenario.observations[i];
+    Board::AttackResult result = {observation.type, &observation.ship};
+    solver.Observe(observation.x, observation.y, result);
+  }
+}
+
+// Return whether the solver counts a scenario exactly as enumerating does.
+bool CheckExact(Scenario const &scenario) {
+  BruteForce brute(scenario);
+  PosteriorSolver solver(1);
+  Observe(solver, scenario);
+  PosteriorSolver::SolveResult result = solver.Solve(std::chrono::seconds(60));
+  std::printf("%s: %llu fleets, solver %llu\n", scenario.name,
+              static_cast<unsigned long long>(brute.fleets),
+              static_cast<unsigned long long>(result.fleets));
+  if (result.type != PosteriorSolver::kExact || result.fleets != brute.fleets)
+    return false;
+  for (std::size_t y = 0; y != scenario.size.y; ++y) {
+    for (std::size_t x = 0; x != scenario.size.x; ++x) {
+      std::uint64_t coverage = brute.coverage[y * scenario.size.x + x];
+      double expected = static_cast<double>(coverage) /
+                        static_cast<double>(brute.fleets);
+      if (std::fabs(solver.probability(x, y) - expected) > 1e-12) {
+        std::printf("FAIL: %s cell %zu,%zu\n", scenario.name, x, y);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Return an observation of a cell.
+Observation Seen(std::size_t x, std::size_t y, Board::AttackType type) {
+  Observation observation = {x, y, type, Ship()};
+  return observation;
+}
+
+// Return the observation sinking a ship on a cell of it.
+Observation Sunk(std::size_t x, std::size_t y, Ship::Orientation orientation,
+                 std::size_t ship_x, std::size_t ship_y, std::size_t length) {
+  Ship ship = {orientation, ship_x, ship_y, length};
+  Observation observation = {x, y, Board::kSunk, ship};
+  return observation;
+}
+
+// Return a set from a list of lengths ending in 0.
+std::vector<std::size_t> Lengths(std::size_t const *lengths) {
+  std::vector<std::size_t> set;
+  while (*lengths != 0) set.push_back(*lengths++);
+  return set;
+}
+
+}  // namespace
+
+int main() {
+  bool ok = true;
+
+  Scenario empty = {"5x5 empty", {5, 5}, {}, {}};
+  std::size_t const empty_set[] = {3, 2, 2, 0};
+  empty.lengths = Lengths(empty_set);
+  ok = CheckExact(empty) && ok;
+
+  Scenario open = {"6x4 misses and hits", {6, 4}, {}, {}};
+  std::size_t const open_set[] = {4, 3, 2, 2, 0};
+  open.lengths = Lengths(open_set);
+  open.observations.push_back(Seen(1, 1, Board::kMiss));
+  open.observations.push_back(Seen(4, 2, Board::kMiss));
+  open.observations.push_back(Seen(2, 0, Board::kHit));
+  open.observations.push_back(Seen(0, 3, Board::kHit));
+  ok = CheckExact(open) && ok;
+
+  Scenario sunk = {"7x6 sunk ship", {7, 6}, {}, {}};
+  std::size_t const sunk_set[] = {4, 3, 3, 2, 0};
+  sunk.lengths = Lengths(sunk_set);
+  sunk.observations.push_back(Seen(1, 2, Board::kHit));
+  sunk.observations.push_back(Seen(2, 2, Board::kHit));
+  sunk.observations.push_back(Sunk(3, 2, Ship::kHorizontal, 1, 2, 3));
+  sunk.observations.push_back(Seen(5, 5, Board::kMiss));
+  sunk.observations.push_back(Seen(6, 0, Board::kHit));
+  sunk.observations.push_back(Seen(6, 1, Board::kHit));
+  ok = CheckExact(sunk) && ok;
+
+  Scenario tall = {"4x9 single cells", {4, 9}, {}, {}};
+  std::size_t const tall_set[] = {5, 1, 1, 1, 0};
+  tall.lengths = Lengths(tall_set);
+  tall.observations.push_back(Seen(3, 4, Board::kMiss));
+  ok = CheckExact(tall) && ok;
+
+  // Ten single cells on 26x26 make about 4e21 fleets, more than 64 bits hold.
+  Scenario crowd = {"26x26 single cells", {26, 26}, {}, {}};
+  crowd.lengths.assign(10, 1);
+  PosteriorSolver solver(1);
+  Observe(solver, crowd);
+  PosteriorSolver::SolveResult result = solver.Solve(std::chrono::seconds(60));
+  double expected = 10.0 / (26 * 26);
+  std::printf("%s: solver %llu fleets, p %.4f\n", crowd.name,
+              static_cast<unsigned long long>(result.fleets),
+              solver.probability(13, 13));
+  if (result.type != PosteriorSolver::kSampled ||
+      std::fabs(solver.probability(13, 13) - expected) > 0.005) {
+    std::printf("FAIL: %s\n", crowd.name);
+    ok = false;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+// Checks that RecordWriter reports a player it could not declare on every
+// later write, on a device that is always full.
+
+#include "record_writer.hpp"
+
+#include <cstdio>
+#include <string>
+
+using namespace battleship;
+
+namespace {
+
+// Return a game between two players on a board with no ships.
+GameRecord MakeRecord(std::uint32_t first, std::uint32_t second) {
+  GameRecord record;
+  record.Clear();
+  record.size.x = 10;
+  record.size.y = 10;
+  record.players[0] = first;
+  record.players[1] = second;
+  return record;
+}
+
+}  // namespace
+
+int main() {
+#ifdef __linux__
+  RecordWriter writer;
+  if (!writer.Open("/dev/full")) {
+    std::printf("FAIL: /dev/full could not be opened\n");
+    return 1;
+  }
+  // A name longer than any stdio buffer is written at once and fails there.
+  std::uint32_t first = writer.AddPlayer(std::string(1 << 20, 'a'));
+  std::uint32_t second = writer.AddPlayer("b");
+  bool ok = writer.failed();
+  ok = !writer.Write(MakeRecord(first, second)) && ok;
+  ok = !writer.Flush() && ok;
+  ok = !writer.Close() && ok;
+  if (!ok) std::printf("FAIL: a failed player declaration went unreported\n");
+
+  // A failure only seen when flushing is reported the same way.
+  RecordWriter buffered;
+  buffered.Open("/dev/full");
+  first = buffered.AddPlayer("a");
+  second = buffered.AddPlayer("b");
+  bool flushed = buffered.Flush();
+  if (flushed || buffered.Write(MakeRecord(first, second)) ||
+      buffered.Close()) {
+    std::printf("FAIL: a failed flush went unreported\n");
+    ok = false;
+  }
+  return ok ? 0 : 1;
+#else
+  return 0;
+#endif
+}